@@ -83,8 +83,10 @@ class Renderer {
 
         bool isValid(void) const; //m_apiInstance created successfully
 
+        //has to be set before the instance is created, nullptr = driver default
         void setAllocator(const Allocator* pAllocator);
-        const Allocator& getAllocator(void) const;
+        const Allocator* getAllocator(void) const;
+        const VkAllocationCallbacks* getAllocationCallbacks(void) const;
 
         const Instance* getInstance(void) const;
         const InstanceLayerProperties* getInstanceLayerProperties(void) const;
@@ -112,7 +114,7 @@ class Renderer {
         bool queryPhysicalDeviceGroups(void);
 
         //Debug log level
-        //std::unique_ptr<Allocator>                      m_pAllocator;
+        const Allocator*                                m_pAllocator = nullptr;
 
         DebugLog*                                       m_pLog = nullptr;
 
@@ -135,6 +137,7 @@ class Renderer {
 };
 
 inline DebugLog* Renderer::getLog(void) const { return m_pLog; }
+inline const Allocator* Renderer::getAllocator(void) const { return m_pAllocator; }
 inline const Instance* Renderer::getInstance(void) const { return m_pInstance.get(); }
 
 
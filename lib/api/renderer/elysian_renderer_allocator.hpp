@@ -1,79 +1,174 @@
 #ifndef ELYSIAN_RENDERER_ALLOCATOR_HPP
 #define ELYSIAN_RENDERER_ALLOCATOR_HPP
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
 namespace elysian::renderer {
 
-//AMD has an open-source implementation?
+class DebugLog;
+
+// Host allocator handed to the driver through VkAllocationCallbacks, routed by scope:
+//  COMMAND          -> per-thread bump arena, everything is freed before the command returns
+//  OBJECT           -> fixed size-class pools, the churny small stuff behind every vkCreate*
+//  CACHE/DEVICE/INSTANCE -> general aligned heap, long-lived and arbitrarily sized
+// Every block carries a small header recording where it came from, so free/realloc
+// never need to know the scope again.
+//
+// Install it with Renderer::setAllocator() before the instance is created; it has to
+// outlive every Vulkan object created through it.
+//
+// With tracking on, live/peak bytes and allocation counts are kept per scope (our own
+// blocks) and per internal allocation type (driver-side memory we only get notified about).
+// Counters are plain relaxed atomics, so the hot path never takes a lock.
 class Allocator: public VkAllocationCallbacks {
 public:
-    Allocator(void):
-        VkAllocationCallbacks({
-            this,
-            &Allocator::allocationCallback,
-            &Allocator::reallocationCallback,
-            &Allocator::freeCallback,
-            &Allocator::internalAllocationNotificationCallback,
-            &Allocator::internalFreeNotificationCallback
-        })
-    {}
-
-    operator const VkAllocationCallbacks*() {
-        return nullptr;
-    }
-
-    bool isDefault(void) const { return true; }
-
-    void* allocate(size_t  size,
-        size_t  alignment,
-        VkSystemAllocationScope allocationScope) {
-        return nullptr;
-    }
-
-    void* reallocate(void* pOriginal,
-        size_t size,
-        size_t alignment,
-        VkSystemAllocationScope allocationScope) {
-        return nullptr;
-    }
-
-    void free(void* pMemory) {}
-
-    void internalAllocateNotification(size_t size,
-        VkInternalAllocationType allocationType,
-                                      VkSystemAllocationScope allocationScope) {}
-
-    void internalFreeNotification(size_t  size,
-        VkInternalAllocationType allocationType,
-                                  VkSystemAllocationScope allocationScope) {}
+    enum class Route: uint16_t {
+        Heap,
+        Pool,
+        Arena
+    };
+
+    static constexpr size_t     kPoolClassCount     = 8;    //16 bytes to 2KB
+    static constexpr size_t     kPoolMinSize        = 16;
+    static constexpr size_t     kPoolMaxSize        = kPoolMinSize << (kPoolClassCount - 1);
+    static constexpr size_t     kPoolSlabSize       = 64 * 1024;
+    static constexpr size_t     kArenaSize          = 256 * 1024;
+    static constexpr size_t     kHeaderSize         = 16;
+    static constexpr size_t     kScopeCount         = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+    static constexpr size_t     kInternalTypeCount  = VK_INTERNAL_ALLOCATION_TYPE_EXECUTABLE + 1;
+
+    struct Counters {
+        uint64_t    liveBytes       = 0;
+        uint64_t    peakBytes       = 0;
+        uint64_t    liveCount       = 0;
+        uint64_t    allocationCount = 0; //total since tracking started
+        uint64_t    freeCount       = 0;
+        uint64_t    resizeCount     = 0; //reallocations done in place
+        double      allocationRate  = 0.0; //allocations/s over the snapshot interval
+    };
+
+    struct Statistics {
+        Counters    scopes[kScopeCount];
+        Counters    internalTypes[kInternalTypeCount];
+        Counters    total;
+        double      seconds         = 0.0; //since tracking started
+
+        auto        getScope(VkSystemAllocationScope scope) const -> const Counters&;
+        auto        getInternalType(VkInternalAllocationType type) const -> const Counters&;
+    };
+
+                Allocator(void);
+                Allocator(const Allocator& rhs) = delete;
+                ~Allocator(void);
+
+    Allocator&  operator=(const Allocator& rhs) = delete;
+
+    operator const VkAllocationCallbacks*() const { return this; }
+
+    void        setTrackingEnabled(bool enabled);
+    bool        isTrackingEnabled(void) const;
+    void        resetStatistics(void);
+
+    // rates are measured against pPrevious, or against when tracking started
+    Statistics  getStatistics(const Statistics* pPrevious=nullptr) const;
+    void        log(DebugLog* pLog, const Statistics* pPrevious=nullptr) const;
+
+    void*       allocate(size_t                     size,
+                         size_t                     alignment,
+                         VkSystemAllocationScope    allocationScope);
+
+    void*       reallocate(void*                    pOriginal,
+                           size_t                   size,
+                           size_t                   alignment,
+                           VkSystemAllocationScope  allocationScope);
+
+    void        free(void* pMemory);
+
+    void        internalAllocationNotification(size_t                   size,
+                                               VkInternalAllocationType allocationType,
+                                               VkSystemAllocationScope  allocationScope);
+
+    void        internalFreeNotification(size_t                     size,
+                                         VkInternalAllocationType   allocationType,
+                                         VkSystemAllocationScope    allocationScope);
+
+    static size_t getAllocationSize(const void* pMemory);
+    static Route  getAllocationRoute(const void* pMemory);
 
 protected:
-    void* allocationCallback(void* pUserData,
-        size_t  size,
-        size_t  alignment,
-        VkSystemAllocationScope allocationScope);
-
-    void* reallocationCallback(void* pUserData,
-        void* pOriginal,
-        size_t size,
-        size_t alignment,
-        VkSystemAllocationScope allocationScope);
-
-    void freeCallback(void* pUserData, void* pMemory);
-
-    void internalAllocationNotificationCallback(void* pUserData,
-        size_t size,
-        VkInternalAllocationType allocationType,
-        VkSystemAllocationScope allocationScope);
-
-    void internalFreeNotificationCallback(void* pUserData,
-        size_t  size,
-        VkInternalAllocationType allocationType,
-        VkSystemAllocationScope allocationScope);
-private:
+    static VKAPI_ATTR void* VKAPI_CALL allocationCallback(void*                   pUserData,
+                                                         size_t                  size,
+                                                         size_t                  alignment,
+                                                         VkSystemAllocationScope allocationScope);
+
+    static VKAPI_ATTR void* VKAPI_CALL reallocationCallback(void*                   pUserData,
+                                                           void*                   pOriginal,
+                                                           size_t                  size,
+                                                           size_t                  alignment,
+                                                           VkSystemAllocationScope allocationScope);
 
+    static VKAPI_ATTR void VKAPI_CALL  freeCallback(void* pUserData, void* pMemory);
 
+    static VKAPI_ATTR void VKAPI_CALL  internalAllocationNotificationCallback(void*                      pUserData,
+                                                                             size_t                     size,
+                                                                             VkInternalAllocationType   allocationType,
+                                                                             VkSystemAllocationScope    allocationScope);
+
+    static VKAPI_ATTR void VKAPI_CALL  internalFreeNotificationCallback(void*                        pUserData,
+                                                                       size_t                       size,
+                                                                       VkInternalAllocationType     allocationType,
+                                                                       VkSystemAllocationScope      allocationScope);
+
+private:
+    struct Pool {
+        std::mutex          mutex;
+        void*               pFreeList   = nullptr;
+        std::vector<void*>  slabs;
+    };
+
+    // own cache line each, threads hammering different scopes shouldn't share
+    struct alignas(64) AtomicCounters {
+        std::atomic<uint64_t>   liveBytes       = 0;
+        std::atomic<uint64_t>   peakBytes       = 0;
+        std::atomic<uint64_t>   liveCount       = 0;
+        std::atomic<uint64_t>   allocationCount = 0;
+        std::atomic<uint64_t>   freeCount       = 0;
+        std::atomic<uint64_t>   resizeCount     = 0;
+
+        void        add(uint64_t size);
+        void        remove(uint64_t size);
+        void        resize(uint64_t oldSize, uint64_t newSize);
+        void        reset(void);
+        Counters    load(void) const;
+    };
+
+    void*       allocateHeap(size_t size, size_t alignment);
+    void*       allocatePool(size_t size, size_t alignment);
+    void*       allocateArena(size_t size, size_t alignment);
+
+    Pool                    m_pools[kPoolClassCount];
+    AtomicCounters          m_scopeCounters[kScopeCount];
+    AtomicCounters          m_internalCounters[kInternalTypeCount];
+    std::atomic<bool>       m_tracking      = false;
+    std::atomic<int64_t>    m_trackingStart = 0; //steady_clock ticks
 };
 
+inline bool Allocator::isTrackingEnabled(void) const { return m_tracking.load(std::memory_order_relaxed); }
+
+inline auto Allocator::Statistics::getScope(VkSystemAllocationScope scope) const -> const Counters& {
+    return scopes[scope];
+}
+
+inline auto Allocator::Statistics::getInternalType(VkInternalAllocationType type) const -> const Counters& {
+    return internalTypes[type];
+}
+
 }
 
 #endif // ELYSIAN_RENDERER_ALLOCATOR_HPP
@@ -2,6 +2,8 @@
 #define ELYSIAN_RENDERER_BUFFER_HPP
 
 #include "elysian_renderer_object.hpp"
+#include "elysian_renderer_memory.hpp"
+#include "elysian_renderer_vma.hpp"
 
 namespace elysian::renderer {
 
@@ -45,10 +47,11 @@ void vkDestroyBufferView(
      */
 
 class BufferCreateInfo: public VkBufferCreateInfo {
+public:
     BufferCreateInfo(VkBufferCreateFlags   flags,
                VkDeviceSize          size,
                VkBufferUsageFlags    usage,
-\               std::vector<uint32_t> queueFamilyIndices={}): //only used with concurrent access
+               std::vector<uint32_t> queueFamilyIndices={}): //only used with concurrent access
         VkBufferCreateInfo({
             VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
             nullptr,
@@ -68,8 +71,10 @@ public:
     struct Initializer {
         std::string     name;
         const Device*   pDevice;
-        CreateInfo      info;
-        const Renderer* pRenderer;
+        BufferCreateInfo info;
+        //OPTIONAL: creates, allocates and binds memory in one shot
+        const VmaBackend*                   pVmaBackend = nullptr;
+        VmaBackend::AllocationCreateInfo    vmaInfo;
     };
 
                 Buffer(Initializer initializer);
@@ -83,12 +88,16 @@ public:
     auto        getDeviceAddress(void) const -> VkDeviceAddress;
 
     auto        getMemoryRequirements(void) const -> VkMemoryRequirements;
-    Result      bindDeviceMemory(std::shared_ptr<DeviceMemory> pMemory, VkDeviceSize offset=0) const;
+    Result      bindDeviceMemory(std::shared_ptr<DeviceMemory> pMemory, VkDeviceSize offset=0);
+
+    auto        getVmaAllocation(void) const -> const VmaBackend::Allocation&;
+    void*       getMappedData(void) const; //only for persistently mapped VMA buffers
 
 private:
     Initializer                     m_initializer;
     std::shared_ptr<DeviceMemory>   m_pMemory       = nullptr; // shared ptr?
     VkDeviceSize                    m_memoryOffset  = 0;
+    VmaBackend::Allocation          m_vmaAllocation;
     Result                          m_result;
 
 };
@@ -96,25 +105,41 @@ private:
 inline Buffer::Buffer(Initializer initializer):
     m_initializer(std::move(initializer))
 {
-    m_result = vkCreateBuffer(m_initializer.pDevice,
-                              &m_initializer.info,
-                              pRenderer? pRenderer->getAllocator() : nullptr,
-                              &m_handle);
+    VkBuffer buffer = VK_NULL_HANDLE;
+    if(m_initializer.pVmaBackend) {
+        m_result = m_initializer.pVmaBackend->createBuffer(m_initializer.info,
+                                                           m_initializer.vmaInfo,
+                                                           &buffer,
+                                                           &m_vmaAllocation);
+        m_memoryOffset = m_vmaAllocation.offset;
+    } else {
+        m_result = vkCreateBuffer(m_initializer.pDevice->getHandle(),
+                                  &m_initializer.info,
+                                  m_initializer.pDevice->getAllocationCallbacks(),
+                                  &buffer);
+    }
+    setHandle(buffer);
 }
 
 inline Buffer::~Buffer(void) {
-    vkDestroyBuffer(m_initializer.pDevice,
-                    getHandle(),
-                    pRenderer? pRenderer->getAllocator() : nullptr);
+    if(m_vmaAllocation.isValid()) {
+        m_initializer.pVmaBackend->destroyBuffer(getHandle(), m_vmaAllocation);
+    } else {
+        vkDestroyBuffer(m_initializer.pDevice->getHandle(),
+                        getHandle(),
+                        m_initializer.pDevice->getAllocationCallbacks());
+    }
 }
 
 inline Result Buffer::getResult(void) const { return m_result; }
 inline auto Buffer::getMemoryOffset(void) const -> VkDeviceSize { return m_memoryOffset; }
+inline auto Buffer::getVmaAllocation(void) const -> const VmaBackend::Allocation& { return m_vmaAllocation; }
+inline void* Buffer::getMappedData(void) const { return m_vmaAllocation.pMappedData; }
 
 inline VkMemoryRequirements Buffer::getMemoryRequirements(void) const {
     VkMemoryRequirements requirements;
     memset(&requirements, 0, sizeof(VkMemoryRequirements));
-    vkGetBufferMemoryRequirements(m_initializer.pDevice, getHandle(), &requirements);
+    vkGetBufferMemoryRequirements(m_initializer.pDevice->getHandle(), getHandle(), &requirements);
     return requirements;
 }
 
@@ -126,13 +151,14 @@ inline VkDeviceAddress Buffer::getDeviceAddress(void) const {
         getHandle()
     };
 
-    return vkGetBufferDeviceAddress(m_initializer.pDevice, &info);
+    return vkGetBufferDeviceAddress(m_initializer.pDevice->getHandle(), &info);
 }
 
-inline Result Buffer::bindDeviceMemory(std::shared_ptr<DeviceMemory> pMemory, VkDeviceSize offset=0) const {
-    const Result result = vkBindBufferMemory(m_initializer.pDevice,
+inline Result Buffer::bindDeviceMemory(std::shared_ptr<DeviceMemory> pMemory, VkDeviceSize offset) {
+    assert(!m_vmaAllocation.isValid()); //VMA already bound it
+    const Result result = vkBindBufferMemory(m_initializer.pDevice->getHandle(),
                                              getHandle(),
-                                             pMemory.get(),
+                                             pMemory->getHandle(),
                                              offset);
     if(result) {
         m_pMemory = pMemory;
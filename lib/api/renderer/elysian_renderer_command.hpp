@@ -2,6 +2,9 @@
 #define ELYSIAN_RENDERER_COMMAND_HPP
 
 #include "elysian_renderer_object.hpp"
+#include "elysian_renderer_hash.hpp"
+#include <cstring>
+#include <functional>
 #include <vector>
 
 namespace elysian::renderer {
@@ -60,6 +63,13 @@ public:
 
     auto            getGroup(void) const -> const CommandBufferGroup*;
     uint32_t        getCommandCount(void) const;
+    uint32_t        getElidedCommandCount(void) const; //redundant binds/state sets dropped since begin()
+    uint64_t        getContentHash(void) const; //begin info + everything recorded since, 0 = never begun or marked dirty
+
+    // Shadow state tracking, on by default: binds and dynamic state matching what's
+    // already set are dropped instead of going to the driver.
+    void            setStateTrackingEnabled(bool enabled);
+    bool            isStateTrackingEnabled(void) const;
 
     State           getState(void) const;
     Result          getResult(void) const;
@@ -71,66 +81,182 @@ public:
     // Actual commands to be enqueued
 
     // Debugging
-    void cmdBeginDebugUtilsLabel(const char* pLabelName, float r=0.0f, float g=0.0f, float b=0.0f, float a=0.0f) const;
-    void cmdEndDebugUtilsLabel(void) const;
-    void cmdInsertDebugUtilsLabel(const char* pLabelName, float r=0.0f, float g=0.0f, float b=0.0f, float a=0.0f) const;
+    void cmdBeginDebugUtilsLabel(const char* pLabelName, float r=0.0f, float g=0.0f, float b=0.0f, float a=0.0f);
+    void cmdEndDebugUtilsLabel(void);
+    void cmdInsertDebugUtilsLabel(const char* pLabelName, float r=0.0f, float g=0.0f, float b=0.0f, float a=0.0f);
 
-    void cmdExecuteCommands(uint32_t commandBufferCount, const VkCommandBuffer* pCommandBuffers) const;
+    void cmdExecuteCommands(uint32_t commandBufferCount, const VkCommandBuffer* pCommandBuffers);
+    void cmdExecuteCommands(const std::vector<const CommandBuffer*>& secondaries); //executed in order
 #if 0
     This one better be a PRIMARY buffer too...
     If any element of pCommandBuffers was not recorded with the VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT flag, and it was recorded into any other primary command buffer which is currently in the executable or recording state, that primary command buffer becomes invalid.
 #endif
 
-    void cmdSetDeviceMask(uint32_t deviceMask) const; //better all be present within VkCommandGroupBeginInfo substruct!
+    void cmdSetDeviceMask(uint32_t deviceMask); //better all be present within VkCommandGroupBeginInfo substruct!
 
     // Compute
     void cmdDispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ);
     void cmdDispatchIndirect(VkBuffer buffer, VkDeviceSize offset);
 
+    // Synchronization
+    void cmdPipelineBarrier(VkPipelineStageFlags            srcStageMask,
+                            VkPipelineStageFlags            dstStageMask,
+                            VkDependencyFlags               dependencyFlags,
+                            uint32_t                        memoryBarrierCount,
+                            const VkMemoryBarrier*          pMemoryBarriers,
+                            uint32_t                        bufferMemoryBarrierCount,
+                            const VkBufferMemoryBarrier*    pBufferMemoryBarriers,
+                            uint32_t                        imageMemoryBarrierCount,
+                            const VkImageMemoryBarrier*     pImageMemoryBarriers);
+
+    // Transfer
+    void cmdCopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, uint32_t regionCount, const VkBufferCopy* pRegions);
+    void cmdCopyBufferToImage(VkBuffer srcBuffer, VkImage dstImage, VkImageLayout dstImageLayout, uint32_t regionCount, const VkBufferImageCopy* pRegions);
+
     void cmdBeginRenderPass(const VkRenderPassBeginInfo& info, VkSubpassContents subpassContents);
     void cmdEndRenderPass(void);
 
     // Binding
     void cmdBindPipeline(VkPipelineBindPoint pipelineBindPoint, VkPipeline pipeline);
-    void cmdBindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType) const;
-    void cmdBindVertexBuffers(uint32_t firstBinding, uint32_t bindingCount, const VkBuffer* pBuffers, const VkDeviceSize* pOffsets) const;
-    void cmdBindDescriptorSets(VkPipelineBindPoint pipelineBindPoint, VkPipelineLayout layout, uint32_t firstSet, uint32_t descriptorSetCount, const VkDescriptorSet* pDescriptorSets, uint32_t dynamicOffsetCount, const uint32_t* pDynamicOffsets) const;
+    void cmdBindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType);
+    void cmdBindVertexBuffers(uint32_t firstBinding, uint32_t bindingCount, const VkBuffer* pBuffers, const VkDeviceSize* pOffsets);
+    void cmdBindDescriptorSets(VkPipelineBindPoint pipelineBindPoint, VkPipelineLayout layout, uint32_t firstSet, uint32_t descriptorSetCount, const VkDescriptorSet* pDescriptorSets, uint32_t dynamicOffsetCount, const uint32_t* pDynamicOffsets);
+    void cmdPushConstants(VkPipelineLayout layout, VkShaderStageFlags stageFlags, uint32_t offset, uint32_t size, const void* pValues);
 
     // Drawing
     void cmdDraw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance);
     void cmdDrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance);
-    void cmdDrawIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride) const;
-    void cmdDrawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride) const;
+    void cmdDrawIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride);
+    void cmdDrawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride);
+    // Provided by VK_VERSION_1_2, needs the drawIndirectCount feature
+    void cmdDrawIndirectCount(VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount, uint32_t stride);
+    void cmdDrawIndexedIndirectCount(VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount, uint32_t stride);
 
     // Dynamic State
-    void cmdSetLineWidth(float lineWidth) const;
-    void cmdSetBlendConstants(const float blendConstants[4]) const;
-    void cmdSetDepthBias(float constantFactor, float clamp, float slopeFactor) const;
-    void cmdSetDepthBounds(float minBounds, float maxBounds) const;
+    void cmdSetViewport(uint32_t firstViewport, uint32_t viewportCount, const VkViewport* pViewports);
+    void cmdSetScissor(uint32_t firstScissor, uint32_t scissorCount, const VkRect2D* pScissors);
+    void cmdSetLineWidth(float lineWidth);
+    void cmdSetBlendConstants(const float blendConstants[4]);
+    void cmdSetDepthBias(float constantFactor, float clamp, float slopeFactor);
+    void cmdSetDepthBounds(float minBounds, float maxBounds);
 
     // Query Pools
-    void cmdBeginQuery(VkQueryPool queryPool, uint32_t query, VkQueryControlFlags flags) const;
-    void cmdEndQuery(VkQueryPool queryPool, uint32_t query) const;
+    void cmdBeginQuery(VkQueryPool queryPool, uint32_t query, VkQueryControlFlags flags);
+    void cmdEndQuery(VkQueryPool queryPool, uint32_t query);
     void cmdCopyQueryPoolResults(VkQueryPool queryPool,
                                  uint32_t firstQuery,
                                  uint32_t queryCount,
                                  VkBuffer dstBuffer,
                                  VkDeviceSize dstOffset,
                                  VkDeviceSize stride,
-                                 VkQueryResultFlags flags) const;
-    void cmdResetQueryPool(VkQueryPool queryPool, uint32_t firstQuery, uint32_t queryCount) const;
-    void cmdWriteTimestamp(VkPipelineStageFlagBits pipelineStage, VkQueryPool queryPool, uint32_t query) const;
+                                 VkQueryResultFlags flags);
+    void cmdResetQueryPool(VkQueryPool queryPool, uint32_t firstQuery, uint32_t queryCount);
+    void cmdWriteTimestamp(VkPipelineStageFlagBits pipelineStage, VkQueryPool queryPool, uint32_t query);
 
     // Events
-    void cmdSetEvent(VkEvent event, VkPipelineStageFlags stageFlags) const;
-    void cmdResetEvent(VkEvent event, VkPipelineStageFlags stageFlags) const;
+    void cmdSetEvent(VkEvent event, VkPipelineStageFlags stageFlags);
+    void cmdResetEvent(VkEvent event, VkPipelineStageFlags stageFlags);
 
 
 private:
+    friend class CommandBufferGroup;
+
+    enum class Op: uint8_t {
+        Begin,
+        DebugLabelBegin,
+        DebugLabelEnd,
+        DebugLabelInsert,
+        ExecuteCommands,
+        SetDeviceMask,
+        Dispatch,
+        DispatchIndirect,
+        PipelineBarrier,
+        CopyBuffer,
+        CopyBufferToImage,
+        BeginRenderPass,
+        EndRenderPass,
+        BindPipeline,
+        BindIndexBuffer,
+        BindVertexBuffers,
+        BindDescriptorSets,
+        PushConstants,
+        Draw,
+        DrawIndexed,
+        DrawIndirect,
+        DrawIndexedIndirect,
+        DrawIndirectCount,
+        DrawIndexedIndirectCount,
+        SetViewport,
+        SetScissor,
+        SetLineWidth,
+        SetBlendConstants,
+        SetDepthBias,
+        SetDepthBounds,
+        BeginQuery,
+        EndQuery,
+        CopyQueryPoolResults,
+        ResetQueryPool,
+        WriteTimestamp,
+        SetEvent,
+        ResetEvent
+    };
+
+    // Counts the command and folds it into the content hash. Returns false during a dry
+    // run, where commands only get hashed and nothing reaches the driver.
+    template<typename... Args>
+    bool            track(Op op, const Args&... args);
+    uint64_t        hashBeginInfo(const VkCommandBufferBeginInfo& info) const;
+    uint64_t        dryRun(const VkCommandBufferBeginInfo& info, const std::function<void(CommandBuffer*)>& record);
+
+    // What we last handed the driver. Null handles and cleared bits mean unknown, never elide.
+    struct ShadowState {
+        static constexpr uint32_t kBindPointCount       = 2; //graphics, compute
+        static constexpr uint32_t kMaxSets              = 8;
+        static constexpr uint32_t kMaxVertexBindings    = 16;
+        static constexpr uint32_t kMaxViewports         = 16;
+
+        enum DynamicBits: uint32_t {
+            LineWidth       = 0x1,
+            DepthBias       = 0x2,
+            DepthBounds     = 0x4,
+            BlendConstants  = 0x8
+        };
+
+        VkPipeline          pipelines[kBindPointCount];
+        VkPipelineLayout    layouts[kBindPointCount];
+        VkDescriptorSet     sets[kBindPointCount][kMaxSets];
+        VkBuffer            indexBuffer;
+        VkDeviceSize        indexOffset;
+        VkIndexType         indexType;
+        VkBuffer            vertexBuffers[kMaxVertexBindings];
+        VkDeviceSize        vertexOffsets[kMaxVertexBindings];
+
+        uint32_t            dynamicValid;
+        uint32_t            viewportValid; //bit per viewport
+        uint32_t            scissorValid;
+        float               lineWidth;
+        float               depthBias[3];
+        float               depthBounds[2];
+        float               blendConstants[4];
+        VkViewport          viewports[kMaxViewports];
+        VkRect2D            scissors[kMaxViewports];
+
+        static uint32_t     getBindPointIndex(VkPipelineBindPoint bindPoint);
+        void                invalidateDynamic(void);
+    };
+
+    void            resetShadowState(void);
+    bool            elide(void); //counts it, always returns true
+
     const CommandBufferGroup* m_pGroup      = nullptr;
     Result                  m_result;
     State                   m_state     = State::Initial;
     uint32_t                m_cmdCount  = 0;
+    uint32_t                m_elidedCount = 0;
+    uint64_t                m_contentHash = 0;
+    bool                    m_dryRun    = false;
+    bool                    m_trackState = true;
+    ShadowState             m_shadow    = {};
     VkRenderPassBeginInfo   m_renderPassBeginInfo; //used for validation during recording
 };
 
@@ -160,12 +286,35 @@ public:
     const CommandPool*    getCommandPool(void) const;
 
     const CommandBuffer* getBuffer(uint32_t index=0) const;
+    CommandBuffer*       getBuffer(uint32_t index=0);
     auto                 getBuffers(void) const -> const std::vector<CommandBuffer>&;
 
+    // CommandPool::reset() puts every buffer allocated from it back into the initial state
+    void                 onPoolReset(void);
+
+    using RecordFunction = std::function<void(CommandBuffer* pCmdBuffer)>;
+
+    // Record once, resubmit: record() is run as a dry run which only hashes the commands,
+    // buffer index is only re-recorded when that hash differs from what it already holds.
+    // On a miss record() therefore runs twice, once hashing and once for real, so it has to
+    // be free of side effects beyond the commands it records. pRecorded is set when it had
+    // to re-record. The buffer may not be pending, the pool needs
+    // VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT and info can't be ONE_TIME_SUBMIT.
+    Result               recordCached(uint32_t                          index,
+                                      const VkCommandBufferBeginInfo&   info,
+                                      const RecordFunction&             record,
+                                      bool*                             pRecorded=nullptr);
+    void                 markDirty(uint32_t index); //forces the next recordCached() to re-record
+
+    uint32_t             getReuseCount(void) const;
+    uint32_t             getRecordCount(void) const;
+
 private:
     const Device*               m_pDevice   = nullptr;
     VkCommandPool               m_pool      = VK_NULL_HANDLE;
     std::vector<CommandBuffer>  m_buffers;
+    uint32_t                    m_reuseCount    = 0;
+    uint32_t                    m_recordCount   = 0;
     Result                      m_result;
 };
 
@@ -180,6 +329,60 @@ inline Result CommandBuffer::getResult(void) const { return m_result; }
 inline auto CommandBuffer::getState(void) const -> State { return m_state; }
 inline const CommandBufferGroup* CommandBuffer::getGroup(void) const { return m_pGroup; }
 inline uint32_t CommandBuffer::getCommandCount(void) const { return m_cmdCount; }
+inline uint64_t CommandBuffer::getContentHash(void) const { return m_contentHash; }
+inline uint32_t CommandBuffer::getElidedCommandCount(void) const { return m_elidedCount; }
+inline bool CommandBuffer::isStateTrackingEnabled(void) const { return m_trackState; }
+
+inline void CommandBuffer::setStateTrackingEnabled(bool enabled) {
+    m_trackState = enabled;
+    resetShadowState();
+}
+
+inline uint32_t CommandBuffer::ShadowState::getBindPointIndex(VkPipelineBindPoint bindPoint) {
+    switch(bindPoint) {
+    case VK_PIPELINE_BIND_POINT_GRAPHICS:   return 0;
+    case VK_PIPELINE_BIND_POINT_COMPUTE:    return 1;
+    default:                                return ~0u; //ray tracing and friends aren't tracked
+    }
+}
+
+inline void CommandBuffer::ShadowState::invalidateDynamic(void) {
+    dynamicValid = 0;
+    viewportValid = 0;
+    scissorValid = 0;
+}
+
+inline void CommandBuffer::resetShadowState(void) {
+    m_shadow = {};
+}
+
+inline bool CommandBuffer::elide(void) {
+    ++m_elidedCount;
+    return true;
+}
+
+template<typename... Args>
+inline bool CommandBuffer::track(Op op, const Args&... args) {
+    assert(getState() == State::Recording);
+    ++m_cmdCount;
+    m_contentHash = hashValue(op, m_contentHash);
+    ((m_contentHash = hashValue(args, m_contentHash)), ...);
+    return !m_dryRun;
+}
+
+inline uint64_t CommandBuffer::hashBeginInfo(const VkCommandBufferBeginInfo& info) const {
+    uint64_t hash = hashValue(Op::Begin);
+    hash = hashValue(info.flags, hash);
+    if(const VkCommandBufferInheritanceInfo* pInheritance = info.pInheritanceInfo) {
+        hash = hashValue(pInheritance->renderPass, hash);
+        hash = hashValue(pInheritance->subpass, hash);
+        hash = hashValue(pInheritance->framebuffer, hash);
+        hash = hashValue(pInheritance->occlusionQueryEnable, hash);
+        hash = hashValue(pInheritance->queryFlags, hash);
+        hash = hashValue(pInheritance->pipelineStatistics, hash);
+    }
+    return hash;
+}
 
 inline Result CommandBuffer::begin(const VkCommandBufferBeginInfo& info) {
     assert(getState() != State::Recording &&
@@ -188,6 +391,11 @@ inline Result CommandBuffer::begin(const VkCommandBufferBeginInfo& info) {
       //          getGroup()->getCommandPool()->flags & VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
     m_result = vkBeginCommandBuffer(getHandle(), &info);
     m_state = m_result? State::Recording : State::Invalid;
+    m_cmdCount = 0;
+    m_elidedCount = 0;
+    m_contentHash = hashBeginInfo(info);
+    resetShadowState();
+    return m_result;
 }
 
 inline Result CommandBuffer::end(void) {
@@ -195,6 +403,7 @@ inline Result CommandBuffer::end(void) {
     m_result = vkEndCommandBuffer(getHandle());
     assert(m_result);
     m_state = m_result? State::Executable : State::Invalid;
+    return m_result;
 }
 
 inline Result CommandBuffer::reset(VkCommandBufferResetFlags flags) {
@@ -203,97 +412,264 @@ inline Result CommandBuffer::reset(VkCommandBufferResetFlags flags) {
     assert(m_result);
     m_state = m_result? State::Initial : State::Invalid;
     m_cmdCount = 0;
+    m_elidedCount = 0;
+    m_contentHash = 0;
+    resetShadowState();
+    return m_result;
 }
 
-inline void CommandBuffer::cmdSetDeviceMask(uint32_t deviceMask) const {
-    assert(getState() == State::Recording);
-    vkCmdSetDeviceMask(getHandle(), deviceMask);
+inline void CommandBuffer::cmdSetDeviceMask(uint32_t deviceMask) {
+    if(track(Op::SetDeviceMask, deviceMask))
+        vkCmdSetDeviceMask(getHandle(), deviceMask);
 }
 
 inline void CommandBuffer::cmdDispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) {
-    assert(getState() == State::Recording);
-    vkCmdDispatch(getHandle(), groupCountX, groupCountY, groupCountZ);
-    ++m_cmdCount;
+    if(track(Op::Dispatch, groupCountX, groupCountY, groupCountZ))
+        vkCmdDispatch(getHandle(), groupCountX, groupCountY, groupCountZ);
+}
+
+inline void CommandBuffer::cmdDispatchIndirect(VkBuffer buffer, VkDeviceSize offset) {
+    if(track(Op::DispatchIndirect, buffer, offset))
+        vkCmdDispatchIndirect(getHandle(), buffer, offset);
+}
+
+inline void CommandBuffer::cmdExecuteCommands(uint32_t commandBufferCount, const VkCommandBuffer* pCommandBuffers) {
+    if(track(Op::ExecuteCommands, hashArray(pCommandBuffers, commandBufferCount)))
+        vkCmdExecuteCommands(getHandle(), commandBufferCount, pCommandBuffers);
+    // everything bound is undefined after secondaries ran
+    resetShadowState();
+}
+
+inline void CommandBuffer::cmdExecuteCommands(const std::vector<const CommandBuffer*>& secondaries) {
+    std::vector<VkCommandBuffer> handles;
+    handles.reserve(secondaries.size());
+    for(const CommandBuffer* pSecondary : secondaries) {
+        assert(pSecondary->getState() == State::Executable);
+        handles.push_back(pSecondary->getHandle());
+    }
+    cmdExecuteCommands(static_cast<uint32_t>(handles.size()), handles.data());
+}
+
+inline void CommandBuffer::cmdPipelineBarrier(VkPipelineStageFlags            srcStageMask,
+                                              VkPipelineStageFlags            dstStageMask,
+                                              VkDependencyFlags               dependencyFlags,
+                                              uint32_t                        memoryBarrierCount,
+                                              const VkMemoryBarrier*          pMemoryBarriers,
+                                              uint32_t                        bufferMemoryBarrierCount,
+                                              const VkBufferMemoryBarrier*    pBufferMemoryBarriers,
+                                              uint32_t                        imageMemoryBarrierCount,
+                                              const VkImageMemoryBarrier*     pImageMemoryBarriers)
+{
+    // barriers have padding after sType, hash them field by field
+    uint64_t hash = kHashSeed;
+    for(uint32_t b = 0; b < memoryBarrierCount; ++b) {
+        hash = hashValue(pMemoryBarriers[b].srcAccessMask, hash);
+        hash = hashValue(pMemoryBarriers[b].dstAccessMask, hash);
+    }
+    for(uint32_t b = 0; b < bufferMemoryBarrierCount; ++b) {
+        const VkBufferMemoryBarrier& barrier = pBufferMemoryBarriers[b];
+        hash = hashValue(barrier.srcAccessMask, hash);
+        hash = hashValue(barrier.dstAccessMask, hash);
+        hash = hashValue(barrier.srcQueueFamilyIndex, hash);
+        hash = hashValue(barrier.dstQueueFamilyIndex, hash);
+        hash = hashValue(barrier.buffer, hash);
+        hash = hashValue(barrier.offset, hash);
+        hash = hashValue(barrier.size, hash);
+    }
+    for(uint32_t b = 0; b < imageMemoryBarrierCount; ++b) {
+        const VkImageMemoryBarrier& barrier = pImageMemoryBarriers[b];
+        hash = hashValue(barrier.srcAccessMask, hash);
+        hash = hashValue(barrier.dstAccessMask, hash);
+        hash = hashValue(barrier.oldLayout, hash);
+        hash = hashValue(barrier.newLayout, hash);
+        hash = hashValue(barrier.srcQueueFamilyIndex, hash);
+        hash = hashValue(barrier.dstQueueFamilyIndex, hash);
+        hash = hashValue(barrier.image, hash);
+        hash = hashValue(barrier.subresourceRange, hash);
+    }
+
+    if(track(Op::PipelineBarrier, srcStageMask, dstStageMask, dependencyFlags,
+             memoryBarrierCount, bufferMemoryBarrierCount, imageMemoryBarrierCount, hash))
+    {
+        vkCmdPipelineBarrier(getHandle(),
+                             srcStageMask,
+                             dstStageMask,
+                             dependencyFlags,
+                             memoryBarrierCount,
+                             pMemoryBarriers,
+                             bufferMemoryBarrierCount,
+                             pBufferMemoryBarriers,
+                             imageMemoryBarrierCount,
+                             pImageMemoryBarriers);
+    }
+}
+
+inline void CommandBuffer::cmdCopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, uint32_t regionCount, const VkBufferCopy* pRegions) {
+    if(track(Op::CopyBuffer, srcBuffer, dstBuffer, hashArray(pRegions, regionCount)))
+        vkCmdCopyBuffer(getHandle(), srcBuffer, dstBuffer, regionCount, pRegions);
+}
+
+inline void CommandBuffer::cmdCopyBufferToImage(VkBuffer srcBuffer, VkImage dstImage, VkImageLayout dstImageLayout, uint32_t regionCount, const VkBufferImageCopy* pRegions) {
+    if(track(Op::CopyBufferToImage, srcBuffer, dstImage, dstImageLayout, hashArray(pRegions, regionCount)))
+        vkCmdCopyBufferToImage(getHandle(), srcBuffer, dstImage, dstImageLayout, regionCount, pRegions);
 }
 
 inline void CommandBuffer::cmdBeginRenderPass(const VkRenderPassBeginInfo& info, VkSubpassContents subpassContents) {
-    assert(getState() == State::Recording);
-    vkCmdBeginRenderPass(getHandle(), &info, subpassContents);
+    if(track(Op::BeginRenderPass, info.renderPass, info.framebuffer, info.renderArea,
+             hashArray(info.pClearValues, info.clearValueCount), subpassContents))
+    {
+        vkCmdBeginRenderPass(getHandle(), &info, subpassContents);
+    }
     memcpy(&m_renderPassBeginInfo, &info, sizeof(VkRenderPassBeginInfo));
-    ++m_cmdCount;
 }
 
 inline void CommandBuffer::cmdEndRenderPass(void) {
-    assert(getState() == State::Recording);
-    vkCmdEndRenderPass(getHandle());
-    ++m_cmdCount;
+    if(track(Op::EndRenderPass))
+        vkCmdEndRenderPass(getHandle());
 }
 
 inline void CommandBuffer::cmdBindPipeline(VkPipelineBindPoint bindPoint, VkPipeline pipeline) {
-    assert(getState() == State::Recording && pipeline != VK_NULL_HANDLE);
-    vkCmdBindPipeline(getHandle(), bindPoint, pipeline);
-    ++m_cmdCount;
+    assert(pipeline != VK_NULL_HANDLE);
+    const uint32_t b = ShadowState::getBindPointIndex(bindPoint);
+    if(m_trackState && b < ShadowState::kBindPointCount) {
+        if(m_shadow.pipelines[b] == pipeline && elide()) return;
+        m_shadow.pipelines[b] = pipeline;
+        // we don't know which state the new pipeline has baked in, so anything set dynamically is suspect
+        if(bindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS) m_shadow.invalidateDynamic();
+    }
+    if(track(Op::BindPipeline, bindPoint, pipeline))
+        vkCmdBindPipeline(getHandle(), bindPoint, pipeline);
+}
+
+inline void CommandBuffer::cmdBindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType) {
+    if(m_trackState) {
+        if(m_shadow.indexBuffer == buffer && m_shadow.indexOffset == offset &&
+           m_shadow.indexType == indexType && buffer != VK_NULL_HANDLE && elide()) return;
+        m_shadow.indexBuffer = buffer;
+        m_shadow.indexOffset = offset;
+        m_shadow.indexType = indexType;
+    }
+    if(track(Op::BindIndexBuffer, buffer, offset, indexType))
+        vkCmdBindIndexBuffer(getHandle(), buffer, offset, indexType);
+}
+
+inline void CommandBuffer::cmdPushConstants(VkPipelineLayout layout, VkShaderStageFlags stageFlags, uint32_t offset, uint32_t size, const void* pValues) {
+    if(track(Op::PushConstants, layout, stageFlags, offset, hashBytes(pValues, size)))
+        vkCmdPushConstants(getHandle(), layout, stageFlags, offset, size, pValues);
 }
 
 inline void CommandBuffer::cmdDraw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance) {
-    assert(getState() == State::Recording);
-    vkCmdDraw(getHandle(), vertexCount, instanceCount, firstVertex, firstInstance);
-    ++m_cmdCount;
+    if(track(Op::Draw, vertexCount, instanceCount, firstVertex, firstInstance))
+        vkCmdDraw(getHandle(), vertexCount, instanceCount, firstVertex, firstInstance);
 }
 
 inline void CommandBuffer::cmdDrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance) {
-    assert(getState() == State::Recording);
-    vkCmdDrawIndexed(getHandle(), indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
-    ++m_cmdCount;
+    if(track(Op::DrawIndexed, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance))
+        vkCmdDrawIndexed(getHandle(), indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
 }
 
-inline void CommandBuffer::cmdBeginDebugUtilsLabel(const char* pLabelName, float r, float g, float b, float a) const {
+inline void CommandBuffer::cmdDrawIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride) {
+    if(track(Op::DrawIndirect, buffer, offset, drawCount, stride))
+        vkCmdDrawIndirect(getHandle(), buffer, offset, drawCount, stride);
+}
+
+inline void CommandBuffer::cmdDrawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride) {
+    if(track(Op::DrawIndexedIndirect, buffer, offset, drawCount, stride))
+        vkCmdDrawIndexedIndirect(getHandle(), buffer, offset, drawCount, stride);
+}
+
+inline void CommandBuffer::cmdDrawIndirectCount(VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount, uint32_t stride) {
+    if(track(Op::DrawIndirectCount, buffer, offset, countBuffer, countBufferOffset, maxDrawCount, stride))
+        vkCmdDrawIndirectCount(getHandle(), buffer, offset, countBuffer, countBufferOffset, maxDrawCount, stride);
+}
+
+inline void CommandBuffer::cmdDrawIndexedIndirectCount(VkBuffer buffer, VkDeviceSize offset, VkBuffer countBuffer, VkDeviceSize countBufferOffset, uint32_t maxDrawCount, uint32_t stride) {
+    if(track(Op::DrawIndexedIndirectCount, buffer, offset, countBuffer, countBufferOffset, maxDrawCount, stride))
+        vkCmdDrawIndexedIndirectCount(getHandle(), buffer, offset, countBuffer, countBufferOffset, maxDrawCount, stride);
+}
+
+inline void CommandBuffer::cmdBeginDebugUtilsLabel(const char* pLabelName, float r, float g, float b, float a) {
     const auto label = VkDebugUtilsLabelEXT {
         VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT,
         nullptr,
         pLabelName,
         { r, g, b, a }
     };
-    vkCmdBeginDebugUtilsLabelEXT(getHandle(), &label);
+    if(track(Op::DebugLabelBegin, hashString(pLabelName), label.color))
+        vkCmdBeginDebugUtilsLabelEXT(getHandle(), &label);
 }
 
-inline void CommandBuffer::cmdEndDebugUtilsLabel(void) const {
-    vkCmdEndDebugUtilsLabelEXT(getHandle());
+inline void CommandBuffer::cmdEndDebugUtilsLabel(void) {
+    if(track(Op::DebugLabelEnd))
+        vkCmdEndDebugUtilsLabelEXT(getHandle());
 }
 
-inline void CommandBuffer::cmdInsertDebugUtilsLabel(const char* pLabelName, float r, float g, float b, float a) const {
+inline void CommandBuffer::cmdInsertDebugUtilsLabel(const char* pLabelName, float r, float g, float b, float a) {
     const auto label = VkDebugUtilsLabelEXT {
         VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT,
         nullptr,
         pLabelName,
         { r, g, b, a }
     };
-    vkCmdInsertDebugUtilsLabelEXT(getHandle(), &label);
+    if(track(Op::DebugLabelInsert, hashString(pLabelName), label.color))
+        vkCmdInsertDebugUtilsLabelEXT(getHandle(), &label);
 }
 
-inline void CommandBuffer::cmdSetLineWidth(float lineWidth) const {
-    vkCmdSetLineWidth(getHandle(), lineWidth);
+inline void CommandBuffer::cmdSetLineWidth(float lineWidth) {
+    if(m_trackState) {
+        if((m_shadow.dynamicValid & ShadowState::LineWidth) &&
+           !memcmp(&m_shadow.lineWidth, &lineWidth, sizeof(float)) && elide()) return;
+        m_shadow.lineWidth = lineWidth;
+        m_shadow.dynamicValid |= ShadowState::LineWidth;
+    }
+    if(track(Op::SetLineWidth, lineWidth))
+        vkCmdSetLineWidth(getHandle(), lineWidth);
 }
 
-inline void CommandBuffer::cmdSetBlendConstants(const float blendConstants[4]) const {
-    vkCmdSetBlendConstants(getHandle(), blendConstants);
+inline void CommandBuffer::cmdSetBlendConstants(const float blendConstants[4]) {
+    if(m_trackState) {
+        if((m_shadow.dynamicValid & ShadowState::BlendConstants) &&
+           !memcmp(m_shadow.blendConstants, blendConstants, sizeof(m_shadow.blendConstants)) && elide()) return;
+        memcpy(m_shadow.blendConstants, blendConstants, sizeof(m_shadow.blendConstants));
+        m_shadow.dynamicValid |= ShadowState::BlendConstants;
+    }
+    if(track(Op::SetBlendConstants, hashArray(blendConstants, 4)))
+        vkCmdSetBlendConstants(getHandle(), blendConstants);
 }
 
 
-inline void CommandBuffer::cmdSetDepthBias(float constantFactor, float clamp, float slopeFactor) const {
-    vkCmdSetDepthBias(getHandle(), constantFactor, clamp, slopeFactor);
+inline void CommandBuffer::cmdSetDepthBias(float constantFactor, float clamp, float slopeFactor) {
+    if(m_trackState) {
+        const float depthBias[3] = { constantFactor, clamp, slopeFactor };
+        if((m_shadow.dynamicValid & ShadowState::DepthBias) &&
+           !memcmp(m_shadow.depthBias, depthBias, sizeof(depthBias)) && elide()) return;
+        memcpy(m_shadow.depthBias, depthBias, sizeof(depthBias));
+        m_shadow.dynamicValid |= ShadowState::DepthBias;
+    }
+    if(track(Op::SetDepthBias, constantFactor, clamp, slopeFactor))
+        vkCmdSetDepthBias(getHandle(), constantFactor, clamp, slopeFactor);
 }
 
-inline void CommandBuffer::cmdSetDepthBounds(float minBounds, float maxBounds) const {
-    vkCmdSetDepthBounds(getHandle(), minBounds, maxBounds);
+inline void CommandBuffer::cmdSetDepthBounds(float minBounds, float maxBounds) {
+    if(m_trackState) {
+        const float depthBounds[2] = { minBounds, maxBounds };
+        if((m_shadow.dynamicValid & ShadowState::DepthBounds) &&
+           !memcmp(m_shadow.depthBounds, depthBounds, sizeof(depthBounds)) && elide()) return;
+        memcpy(m_shadow.depthBounds, depthBounds, sizeof(depthBounds));
+        m_shadow.dynamicValid |= ShadowState::DepthBounds;
+    }
+    if(track(Op::SetDepthBounds, minBounds, maxBounds))
+        vkCmdSetDepthBounds(getHandle(), minBounds, maxBounds);
 }
 
-inline void CommandBuffer::cmdBeginQuery(VkQueryPool queryPool, uint32_t query, VkQueryControlFlags flags) const {
-    vkCmdBeginQuery(getHandle(), queryPool, query, flags);
+inline void CommandBuffer::cmdBeginQuery(VkQueryPool queryPool, uint32_t query, VkQueryControlFlags flags) {
+    if(track(Op::BeginQuery, queryPool, query, flags))
+        vkCmdBeginQuery(getHandle(), queryPool, query, flags);
 }
 
-inline void CommandBuffer::cmdEndQuery(VkQueryPool queryPool, uint32_t query) const {
-    vkCmdEndQuery(getHandle(), queryPool, query);
+inline void CommandBuffer::cmdEndQuery(VkQueryPool queryPool, uint32_t query) {
+    if(track(Op::EndQuery, queryPool, query))
+        vkCmdEndQuery(getHandle(), queryPool, query);
 }
 
 inline void CommandBuffer::cmdCopyQueryPoolResults(VkQueryPool queryPool,
@@ -302,25 +678,30 @@ inline void CommandBuffer::cmdCopyQueryPoolResults(VkQueryPool queryPool,
                                                     VkBuffer dstBuffer,
                                                     VkDeviceSize dstOffset,
                                                     VkDeviceSize stride,
-                                                    VkQueryResultFlags flags) const
+                                                    VkQueryResultFlags flags)
 {
-    vkCmdCopyQueryPoolResults(getHandle(), queryPool, firstQuery, queryCount, dstBuffer, dstOffset, stride, flags);
+    if(track(Op::CopyQueryPoolResults, queryPool, firstQuery, queryCount, dstBuffer, dstOffset, stride, flags))
+        vkCmdCopyQueryPoolResults(getHandle(), queryPool, firstQuery, queryCount, dstBuffer, dstOffset, stride, flags);
 }
 
-inline void CommandBuffer::cmdResetQueryPool(VkQueryPool queryPool, uint32_t firstQuery, uint32_t queryCount) const {
-    vkCmdResetQueryPool(getHandle(), queryPool, firstQuery, queryCount);
+inline void CommandBuffer::cmdResetQueryPool(VkQueryPool queryPool, uint32_t firstQuery, uint32_t queryCount) {
+    if(track(Op::ResetQueryPool, queryPool, firstQuery, queryCount))
+        vkCmdResetQueryPool(getHandle(), queryPool, firstQuery, queryCount);
 }
 
-inline void CommandBuffer::cmdWriteTimestamp(VkPipelineStageFlagBits pipelineStage, VkQueryPool queryPool, uint32_t query) const {
-    vkCmdWriteTimestamp(getHandle(), pipelineStage, queryPool, query);
+inline void CommandBuffer::cmdWriteTimestamp(VkPipelineStageFlagBits pipelineStage, VkQueryPool queryPool, uint32_t query) {
+    if(track(Op::WriteTimestamp, pipelineStage, queryPool, query))
+        vkCmdWriteTimestamp(getHandle(), pipelineStage, queryPool, query);
 }
 
-inline void CommandBuffer::cmdSetEvent(VkEvent event, VkPipelineStageFlags stageFlags) const {
-    vkCmdSetEvent(getHandle(), event, stageFlags);
+inline void CommandBuffer::cmdSetEvent(VkEvent event, VkPipelineStageFlags stageFlags) {
+    if(track(Op::SetEvent, event, stageFlags))
+        vkCmdSetEvent(getHandle(), event, stageFlags);
 }
 
-inline void CommandBuffer::cmdResetEvent(VkEvent event, VkPipelineStageFlags stageFlags) const {
-    vkCmdResetEvent(getHandle(), event, stageFlags);
+inline void CommandBuffer::cmdResetEvent(VkEvent event, VkPipelineStageFlags stageFlags) {
+    if(track(Op::ResetEvent, event, stageFlags))
+        vkCmdResetEvent(getHandle(), event, stageFlags);
 }
 
 
@@ -496,10 +877,34 @@ inline const CommandBuffer* CommandBufferGroup::getBuffer(uint32_t index) const
     return &m_buffers[index];
 }
 
+inline CommandBuffer* CommandBufferGroup::getBuffer(uint32_t index) {
+    assert(index < m_buffers.size());
+    return &m_buffers[index];
+}
+
 inline auto CommandBufferGroup::getBuffers(void) const -> const std::vector<CommandBuffer>& {
     return m_buffers;
 }
 
+inline uint32_t CommandBufferGroup::getReuseCount(void) const { return m_reuseCount; }
+inline uint32_t CommandBufferGroup::getRecordCount(void) const { return m_recordCount; }
+
+inline void CommandBufferGroup::markDirty(uint32_t index) {
+    assert(index < m_buffers.size());
+    m_buffers[index].m_contentHash = 0;
+}
+
+inline void CommandBufferGroup::onPoolReset(void) {
+    for(auto& buffer : m_buffers) {
+        buffer.m_state = CommandBuffer::State::Initial;
+        buffer.m_result = VK_SUCCESS;
+        buffer.m_cmdCount = 0;
+        buffer.m_elidedCount = 0;
+        buffer.m_contentHash = 0;
+        buffer.resetShadowState();
+    }
+}
+
 
 }
 
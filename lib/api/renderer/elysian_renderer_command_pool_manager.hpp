@@ -0,0 +1,96 @@
+#ifndef ELYSIAN_RENDERER_COMMAND_POOL_MANAGER_HPP
+#define ELYSIAN_RENDERER_COMMAND_POOL_MANAGER_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "elysian_renderer_command.hpp"
+#include "elysian_renderer_thread_registry.hpp"
+
+namespace elysian::renderer {
+
+class DebugLog;
+
+// Hands out command buffers from pools owned by the calling thread, so recording on N
+// workers never touches a shared (externally synchronized) CommandPool.
+//
+// Every thread gets one pool per frame per queue family. Buffers are never freed
+// individually: the first acquire() of a thread in a new frame resets its whole pool for
+// that frame with CommandPool::reset() and hands the same buffers out again.
+//
+// Per frame:
+//      waitForFence(frame);                    //frame's last submission has to be done
+//      manager.beginFrame();
+//      ...on any worker: manager.acquire(family, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+//
+// acquire() is safe to call concurrently, beginFrame()/trim() are not.
+class CommandPoolManager {
+public:
+
+    struct Initializer {
+        std::string                 name;
+        const Device*               pDevice     = nullptr;
+        uint32_t                    frameCount  = 3;
+        VkCommandPoolCreateFlags    flags       = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        uint32_t                    groupSize   = 8; //buffers allocated at once when a pool runs dry
+    };
+
+                        CommandPoolManager(Initializer initializer);
+                        ~CommandPoolManager(void);
+
+    const char*         getName(void) const;
+    uint32_t            getFrameIndex(void) const;
+    uint32_t            getFrameCount(void) const;
+    uint32_t            getThreadCount(void) const;
+
+    // moves on to the next frame, its pools get reset lazily by their threads
+    void                beginFrame(void);
+
+    // a fresh buffer in the initial state, valid until this frame slot comes around again
+    CommandBuffer*      acquire(uint32_t queueFamilyIndex, VkCommandBufferLevel level=VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    // the calling thread's pool for the current frame
+    const CommandPool*  getThreadPool(uint32_t queueFamilyIndex);
+
+    // returns unused memory of every pool back to the system
+    void                trim(void);
+
+    void                log(DebugLog* pLog) const;
+
+private:
+    struct FamilyPool {
+        std::unique_ptr<CommandPool>                        pPool;
+        std::vector<std::unique_ptr<CommandBufferGroup>>    groups[2]; //primary, secondary
+        uint32_t                                            used[2]     = { 0, 0 };
+    };
+
+    struct FrameContext {
+        std::vector<FamilyPool>     families; //indexed by queue family
+        uint64_t                    frame   = 0; //last beginFrame() this was reset for
+    };
+
+    struct ThreadContext {
+        std::vector<FrameContext>   frames;
+    };
+
+    ThreadContext*      getThreadContext(void);
+    FamilyPool*         getFamilyPool(uint32_t queueFamilyIndex);
+
+    Initializer                                 m_initializer;
+    ThreadRegistry<ThreadContext>               m_registry;
+    std::atomic<uint64_t>                       m_frame     = { 0 };
+    uint32_t                                    m_familyCount = 0;
+
+    mutable std::mutex                          m_mutex;
+    std::vector<std::unique_ptr<ThreadContext>> m_threads;
+};
+
+inline const char* CommandPoolManager::getName(void) const { return m_initializer.name.c_str(); }
+inline uint32_t CommandPoolManager::getFrameIndex(void) const { return m_frame.load(std::memory_order_relaxed) % m_initializer.frameCount; }
+inline uint32_t CommandPoolManager::getFrameCount(void) const { return m_initializer.frameCount; }
+inline void CommandPoolManager::beginFrame(void) { m_frame.fetch_add(1, std::memory_order_relaxed); }
+
+}
+
+#endif // ELYSIAN_RENDERER_COMMAND_POOL_MANAGER_HPP
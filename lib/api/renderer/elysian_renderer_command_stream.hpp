@@ -0,0 +1,220 @@
+#ifndef ELYSIAN_RENDERER_COMMAND_STREAM_HPP
+#define ELYSIAN_RENDERER_COMMAND_STREAM_HPP
+
+#include <functional>
+#include <initializer_list>
+#include <type_traits>
+#include <vector>
+#include "elysian_renderer_object.hpp"
+
+namespace elysian::renderer {
+
+class CommandBuffer;
+class DebugLog;
+
+// Deferred command recording: cmd* calls are appended to a flat buffer as tagged POD
+// packets instead of going into the driver, and replayed into a command buffer later,
+// possibly on another thread. Nothing in here touches Vulkan until replay(), so streams
+// can be built, inspected and replayed against a mock DispatchTable entirely on the CPU.
+//
+// Packets are an 8 byte Header followed by the op's payload struct and then its arrays in
+// the order listed next to the struct, each part padded to 8 bytes. Anything referenced
+// by pointer is copied in, pNext chains can't be and have to be null.
+//
+// Streams record exactly what they're given. Redundant binds get dropped at replay(CommandBuffer*)
+// by the buffer's shadow state, the raw replay() forwards everything.
+//
+// Recording one stream is single threaded, replaying it is read only.
+class CommandStream {
+public:
+
+    enum class Op: uint16_t {
+        BindPipeline,
+        BindIndexBuffer,
+        BindVertexBuffers,
+        BindDescriptorSets,
+        PushConstants,
+        SetViewport,
+        SetScissor,
+        Draw,
+        DrawIndexed,
+        DrawIndirect,
+        DrawIndexedIndirect,
+        Dispatch,
+        DispatchIndirect,
+        PipelineBarrier,
+        CopyBuffer,
+        CopyBufferToImage,
+        BeginRenderPass,
+        EndRenderPass,
+        ExecuteCommands,
+        Count
+    };
+
+    struct Header {
+        Op          op;
+        uint16_t    reserved;
+        uint32_t    size;       //whole packet in bytes, header included
+    };
+
+    struct BindPipeline         { VkPipelineBindPoint bindPoint; VkPipeline pipeline; };
+    struct BindIndexBuffer      { VkBuffer buffer; VkDeviceSize offset; VkIndexType indexType; };
+    struct BindVertexBuffers    { uint32_t firstBinding; uint32_t bindingCount; };                  //VkBuffer[], VkDeviceSize[]
+    struct BindDescriptorSets   { VkPipelineBindPoint bindPoint; VkPipelineLayout layout; uint32_t firstSet;
+                                  uint32_t setCount; uint32_t dynamicOffsetCount; };                //VkDescriptorSet[], uint32_t[]
+    struct PushConstants        { VkPipelineLayout layout; VkShaderStageFlags stageFlags; uint32_t offset; uint32_t size; }; //bytes
+    struct SetViewport          { uint32_t firstViewport; uint32_t viewportCount; };                //VkViewport[]
+    struct SetScissor           { uint32_t firstScissor; uint32_t scissorCount; };                  //VkRect2D[]
+    struct Draw                 { uint32_t vertexCount; uint32_t instanceCount; uint32_t firstVertex; uint32_t firstInstance; };
+    struct DrawIndexed          { uint32_t indexCount; uint32_t instanceCount; uint32_t firstIndex; int32_t vertexOffset; uint32_t firstInstance; };
+    struct DrawIndirect         { VkBuffer buffer; VkDeviceSize offset; uint32_t drawCount; uint32_t stride; };
+    struct Dispatch             { uint32_t groupCountX; uint32_t groupCountY; uint32_t groupCountZ; };
+    struct DispatchIndirect     { VkBuffer buffer; VkDeviceSize offset; };
+    struct PipelineBarrier      { VkPipelineStageFlags srcStageMask; VkPipelineStageFlags dstStageMask; VkDependencyFlags dependencyFlags;
+                                  uint32_t memoryBarrierCount; uint32_t bufferMemoryBarrierCount; uint32_t imageMemoryBarrierCount; };
+                                                                                                    //VkMemoryBarrier[], VkBufferMemoryBarrier[], VkImageMemoryBarrier[]
+    struct CopyBuffer           { VkBuffer srcBuffer; VkBuffer dstBuffer; uint32_t regionCount; };  //VkBufferCopy[]
+    struct CopyBufferToImage    { VkBuffer srcBuffer; VkImage dstImage; VkImageLayout dstImageLayout; uint32_t regionCount; }; //VkBufferImageCopy[]
+    struct BeginRenderPass      { VkRenderPass renderPass; VkFramebuffer framebuffer; VkRect2D renderArea;
+                                  VkSubpassContents contents; uint32_t clearValueCount; };          //VkClearValue[]
+    struct EndRenderPass        { };
+    struct ExecuteCommands      { uint32_t commandBufferCount; };                                   //VkCommandBuffer[]
+
+    // What replay() calls into, null entries are skipped. global() points at the loader's
+    // vkCmd* entry points, tests fill in their own.
+    struct DispatchTable {
+        PFN_vkCmdBindPipeline           pfnBindPipeline         = nullptr;
+        PFN_vkCmdBindIndexBuffer        pfnBindIndexBuffer      = nullptr;
+        PFN_vkCmdBindVertexBuffers      pfnBindVertexBuffers    = nullptr;
+        PFN_vkCmdBindDescriptorSets     pfnBindDescriptorSets   = nullptr;
+        PFN_vkCmdPushConstants          pfnPushConstants        = nullptr;
+        PFN_vkCmdSetViewport            pfnSetViewport          = nullptr;
+        PFN_vkCmdSetScissor             pfnSetScissor           = nullptr;
+        PFN_vkCmdDraw                   pfnDraw                 = nullptr;
+        PFN_vkCmdDrawIndexed            pfnDrawIndexed          = nullptr;
+        PFN_vkCmdDrawIndirect           pfnDrawIndirect         = nullptr;
+        PFN_vkCmdDrawIndexedIndirect    pfnDrawIndexedIndirect  = nullptr;
+        PFN_vkCmdDispatch               pfnDispatch             = nullptr;
+        PFN_vkCmdDispatchIndirect       pfnDispatchIndirect     = nullptr;
+        PFN_vkCmdPipelineBarrier        pfnPipelineBarrier      = nullptr;
+        PFN_vkCmdCopyBuffer             pfnCopyBuffer           = nullptr;
+        PFN_vkCmdCopyBufferToImage      pfnCopyBufferToImage    = nullptr;
+        PFN_vkCmdBeginRenderPass        pfnBeginRenderPass      = nullptr;
+        PFN_vkCmdEndRenderPass          pfnEndRenderPass        = nullptr;
+        PFN_vkCmdExecuteCommands        pfnExecuteCommands      = nullptr;
+
+        static DispatchTable global(void);
+    };
+
+    struct Statistics {
+        uint32_t    packetCount     = 0;
+        size_t      byteSize        = 0;
+    };
+
+    // One packet while iterating, getPayload<BindVertexBuffers>() for the struct and
+    // getArray<VkDeviceSize>(1) for its second array.
+    class Packet {
+    public:
+        Op                  getOp(void) const;
+        uint32_t            getSize(void) const;
+
+        template<typename T>
+        const T*            getPayload(void) const;
+        template<typename T>
+        const T*            getArray(uint32_t index) const;
+
+    private:
+        friend class CommandStream;
+        const void*         getArrayData(uint32_t index) const;
+
+        const Header*       m_pHeader = nullptr;
+    };
+
+    void                clear(void); //keeps the memory around
+
+    bool                isEmpty(void) const;
+    const Statistics&   getStatistics(void) const;
+
+    void cmdBindPipeline(VkPipelineBindPoint pipelineBindPoint, VkPipeline pipeline);
+    void cmdBindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType);
+    void cmdBindVertexBuffers(uint32_t firstBinding, uint32_t bindingCount, const VkBuffer* pBuffers, const VkDeviceSize* pOffsets);
+    void cmdBindDescriptorSets(VkPipelineBindPoint pipelineBindPoint, VkPipelineLayout layout, uint32_t firstSet, uint32_t descriptorSetCount, const VkDescriptorSet* pDescriptorSets, uint32_t dynamicOffsetCount=0, const uint32_t* pDynamicOffsets=nullptr);
+    void cmdPushConstants(VkPipelineLayout layout, VkShaderStageFlags stageFlags, uint32_t offset, uint32_t size, const void* pValues);
+    void cmdSetViewport(uint32_t firstViewport, uint32_t viewportCount, const VkViewport* pViewports);
+    void cmdSetScissor(uint32_t firstScissor, uint32_t scissorCount, const VkRect2D* pScissors);
+    void cmdDraw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance);
+    void cmdDrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance);
+    void cmdDrawIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride);
+    void cmdDrawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride);
+    void cmdDispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ);
+    void cmdDispatchIndirect(VkBuffer buffer, VkDeviceSize offset);
+    void cmdPipelineBarrier(VkPipelineStageFlags            srcStageMask,
+                            VkPipelineStageFlags            dstStageMask,
+                            VkDependencyFlags               dependencyFlags,
+                            uint32_t                        memoryBarrierCount,
+                            const VkMemoryBarrier*          pMemoryBarriers,
+                            uint32_t                        bufferMemoryBarrierCount,
+                            const VkBufferMemoryBarrier*    pBufferMemoryBarriers,
+                            uint32_t                        imageMemoryBarrierCount,
+                            const VkImageMemoryBarrier*     pImageMemoryBarriers);
+    void cmdCopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, uint32_t regionCount, const VkBufferCopy* pRegions);
+    void cmdCopyBufferToImage(VkBuffer srcBuffer, VkImage dstImage, VkImageLayout dstImageLayout, uint32_t regionCount, const VkBufferImageCopy* pRegions);
+    void cmdBeginRenderPass(const VkRenderPassBeginInfo& info, VkSubpassContents subpassContents);
+    void cmdEndRenderPass(void);
+    void cmdExecuteCommands(uint32_t commandBufferCount, const VkCommandBuffer* pCommandBuffers);
+
+    // straight into the driver (or whatever the table points at)
+    void                replay(VkCommandBuffer commandBuffer, const DispatchTable& table) const;
+    // through the CommandBuffer wrapper, so its command count/content hash stay in sync and
+    // its state tracking elides redundant binds
+    void                replay(CommandBuffer* pCmdBuffer) const;
+
+    void                forEach(const std::function<void(const Packet& packet)>& visitor) const;
+
+    static const char*  getOpName(Op op);
+    void                log(DebugLog* pLog) const;
+
+private:
+    struct Array {
+        const void*     pData;
+        size_t          size;
+    };
+
+    void*               writePacket(Op op, const void* pPayload, size_t payloadSize, std::initializer_list<Array> arrays);
+    template<typename T>
+    void                write(Op op, const T& payload, std::initializer_list<Array> arrays={});
+
+    std::vector<uint64_t>   m_data; //uint64_t keeps every packet 8 byte aligned
+    size_t                  m_size          = 0; //bytes
+    Statistics              m_statistics;
+};
+
+namespace detail {
+    constexpr size_t alignPacket(size_t size) { return (size + 7) & ~size_t(7); }
+}
+
+inline bool CommandStream::isEmpty(void) const { return m_size == 0; }
+inline auto CommandStream::getStatistics(void) const -> const Statistics& { return m_statistics; }
+
+template<typename T>
+inline void CommandStream::write(Op op, const T& payload, std::initializer_list<Array> arrays) {
+    static_assert(std::is_trivially_copyable_v<T>, "packets are memcpy'd around");
+    writePacket(op, &payload, sizeof(T), arrays);
+}
+
+inline auto CommandStream::Packet::getOp(void) const -> Op { return m_pHeader->op; }
+inline uint32_t CommandStream::Packet::getSize(void) const { return m_pHeader->size; }
+
+template<typename T>
+inline const T* CommandStream::Packet::getPayload(void) const {
+    return reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(m_pHeader) + detail::alignPacket(sizeof(Header)));
+}
+
+template<typename T>
+inline const T* CommandStream::Packet::getArray(uint32_t index) const {
+    return static_cast<const T*>(getArrayData(index));
+}
+
+}
+
+#endif // ELYSIAN_RENDERER_COMMAND_STREAM_HPP
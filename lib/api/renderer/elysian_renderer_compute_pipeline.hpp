@@ -34,6 +34,8 @@ typedef struct VkPipelineShaderStageCreateInfo {
 } VkPipelineShaderStageCreateInfo;
 #endif
 
+#include "elysian_renderer_pipeline_cache.hpp"
+
 namespace elysian::renderer {
 
 
@@ -88,12 +90,24 @@ public:
         m_pModule(pModule)
     {}
 
+    // keeps the specialization alive along with the stage, e.g. SpecializationSet::makeInfo()
+    ShaderStage(VkPipelineShaderStageCreateFlags            flags,
+                        VkShaderStageFlagBits               stage,
+                        ShaderModule*                       pModule,
+                        const char*                         pName,
+                        std::shared_ptr<const VkSpecializationInfo> pSpecialization):
+        ShaderStage(flags, stage, pModule, pName, pSpecialization.get())
+    {
+        m_pSpecialization = std::move(pSpecialization);
+    }
+
     const ShaderModule*     getModule(void) const;
     VkShaderStageFlagBits   getStage(void) const;
     const char*             getEntryPoint(void) const;
+    const VkSpecializationInfo* getSpecializationInfo(void) const { return pSpecializationInfo; }
 private:
     ShaderModule*                       m_pModule = nullptr;
-    //specialization info
+    std::shared_ptr<const VkSpecializationInfo> m_pSpecialization;
 };
 
 class ComputePipelineCreateInfo: public VkComputePipelineCreateInfo {
@@ -126,7 +140,7 @@ public:
         std::string                         name;
         std::shared_ptr<const CreateInfo>   pInfo;
         const Device*                       pDevice;
-        PipelineCache*                      pPipelineCache;
+        PipelineCache*                      pPipelineCache  = nullptr;
     };
 
                 ComputePipeline(Initializer initializer);
@@ -140,6 +154,10 @@ public:
     bool        isValid(void) const;
     VkPipeline  getHandle(void) const;
 
+protected:
+    const Device*   getPipelineDevice(void) const override { return m_pDevice; }
+    VkPipeline      getPipelineHandle(void) const override { return getHandle(); }
+
 private:
     Result          m_result;
     VkPipeline      m_handle            = VK_NULL_HANDLE;
@@ -156,11 +174,11 @@ inline ComputePipeline::ComputePipeline(Initializer initializer):
     m_pDevice(initializer.pDevice),
     m_pPipelineCache(initializer.pPipelineCache)
 {
-    m_result = vkCreateComputePipelines(m_pDevice, m_pPipelineCache, 1, m_pInfo.get(), nullptr, &m_handle);
+    m_result = vkCreateComputePipelines(m_pDevice->getHandle(), m_pPipelineCache? m_pPipelineCache->getHandle() : VK_NULL_HANDLE, 1, m_pInfo.get(), m_pDevice->getAllocationCallbacks(), &m_handle);
 }
 
 inline ComputePipeline::~ComputePipeline(void) {
-    vkDestroyPipeline(m_pDevice, getHandle(), nullptr);
+    vkDestroyPipeline(m_pDevice->getHandle(), getHandle(), m_pDevice->getAllocationCallbacks());
 }
 
 inline ComputePipeline::operator VkPipeline() const { return getHandle(); }
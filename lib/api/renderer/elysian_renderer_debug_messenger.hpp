@@ -115,11 +115,11 @@ inline DebugUtilsMessengerEXT::DebugUtilsMessengerEXT(DebugUtilsMessengerEXTCrea
     m_pCreateInfo(pInfo),
     m_pInstance(pInstance)
 {
-    m_result = createDebugUtilsMessengerEXT(m_pInstance->getHandle(), m_pCreateInfo, nullptr, &m_handle);
+    m_result = createDebugUtilsMessengerEXT(m_pInstance->getHandle(), m_pCreateInfo, m_pInstance->getAllocationCallbacks(), &m_handle);
 }
 
 inline DebugUtilsMessengerEXT::~DebugUtilsMessengerEXT(void) {
-    destroyDebugUtilsMessengerEXT(m_pInstance->getHandle(), m_handle, nullptr);
+    destroyDebugUtilsMessengerEXT(m_pInstance->getHandle(), m_handle, m_pInstance->getAllocationCallbacks());
 }
 
 inline auto DebugUtilsMessengerEXT::getCreateInfo(void) const -> const DebugUtilsMessengerEXTCreateInfo& { return *m_pCreateInfo; }
@@ -1,10 +1,19 @@
 #ifndef ELYSIAN_RENDERER_DESCRIPTOR_HPP
 #define ELYSIAN_RENDERER_DESCRIPTOR_HPP
 
+#include <cassert>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 #include "elysian_renderer_object.hpp"
 
 namespace elysian::renderer {
 
+class Device;
+class DescriptorSetLayout;
+class DescriptorSetLayoutBinding;
+
 class DescriptorPoolCreateInfo: public VkDescriptorPoolCreateInfo {
 public:
     DescriptorPoolCreateInfo(VkDescriptorPoolCreateFlags  flags,
@@ -15,7 +24,7 @@ public:
             nullptr,
             flags,
             maxSets,
-            poolSizes.size(),
+            static_cast<uint32_t>(poolSizes.size()),
             poolSizes.data()
         }),
         m_poolSizes(std::move(poolSizes))
@@ -30,102 +39,119 @@ private:
 };
 
 
-class DescriptorPool {
+class DescriptorPool: public HandleObject<VkDescriptorPool, VK_OBJECT_TYPE_DESCRIPTOR_POOL> {
 public:
 
     struct Initializer {
-        std::string name;
-        CreateInfo  info;
-        Device*     pDevice;
+        std::string                 name;
+        DescriptorPoolCreateInfo    info;
+        const Device*               pDevice = nullptr;
     };
 
                         DescriptorPool(Initializer initializer);
                         ~DescriptorPool(void);
 
-    operator            VkDescriptorPool() const;
-
     bool                isValid(void) const;
     Result              getResult(void) const;
-    VkDescriptorPool    getHandle(void) const;
 
     const char*         getName(void) const;
-    const CreateInfo&   getCreateInfo(void) const;
-
-    Result              reset(VkDescriptorPoolResetFlags flags) const;
+    auto                getCreateInfo(void) const -> const DescriptorPoolCreateInfo&;
 
+    // every set allocated from it goes back at once, none of them may still be in use
+    Result              reset(VkDescriptorPoolResetFlags flags=0) const;
+    // VK_ERROR_OUT_OF_POOL_MEMORY/VK_ERROR_FRAGMENTED_POOL once it's full
+    Result              allocate(uint32_t count, const VkDescriptorSetLayout* pLayouts, VkDescriptorSet* pSets,
+                                 const void* pNext=nullptr) const;
 
 private:
     Initializer         m_initializer;
-    VkDescriptorPool    m_handle = VK_INVALID_HANDLE;
     Result              m_result;
 };
 
-inline Result DescriptorPool::reset(VkDescriptorPoolResetFlags flags) const {
-    return vkResetDescriptorPool(m_pDevice->getHandle(), getHandle(), flags);
-}
+inline bool DescriptorPool::isValid(void) const { return getResult() && getHandle() != VK_NULL_HANDLE; }
+inline Result DescriptorPool::getResult(void) const { return m_result; }
+inline const char* DescriptorPool::getName(void) const { return m_initializer.name.c_str(); }
+inline auto DescriptorPool::getCreateInfo(void) const -> const DescriptorPoolCreateInfo& { return m_initializer.info; }
 
 //======= DESCRIPTOR SETS ==========
-// Provided by VK_VERSION_1_0
-
-
-
-// Provided by VK_VERSION_1_0
-typedef struct VkDescriptorSetAllocateInfo {
-    VkStructureType                 sType;
-    const void*                     pNext;
-    VkDescriptorPool                descriptorPool;
-    uint32_t                        descriptorSetCount;
-    const VkDescriptorSetLayout*    pSetLayouts;
-} VkDescriptorSetAllocateInfo;
-
-// Provided by VK_VERSION_1_0
-VkResult vkFreeDescriptorSets(
-    VkDevice                                    device,
-    VkDescriptorPool                            descriptorPool,
-    uint32_t                                    descriptorSetCount,
-    const VkDescriptorSet*                      pDescriptorSets);
-
-#if 1
-// Provided by VK_VERSION_1_1
-VkResult vkCreateDescriptorUpdateTemplate(
-    VkDevice                                    device,
-    const VkDescriptorUpdateTemplateCreateInfo* pCreateInfo,
-    const VkAllocationCallbacks*                pAllocator,
-    VkDescriptorUpdateTemplate*                 pDescriptorUpdateTemplate);
-
-// Provided by VK_VERSION_1_1
-void vkDestroyDescriptorUpdateTemplate(
-    VkDevice                                    device,
-    VkDescriptorUpdateTemplate                  descriptorUpdateTemplate,
-    const VkAllocationCallbacks*                pAllocator);
-
-// Provided by VK_VERSION_1_1
-typedef struct VkDescriptorUpdateTemplateCreateInfo {
-    VkStructureType                           sType;
-    const void*                               pNext;
-    VkDescriptorUpdateTemplateCreateFlags     flags;
-    uint32_t                                  descriptorUpdateEntryCount;
-    const VkDescriptorUpdateTemplateEntry*    pDescriptorUpdateEntries;
-    VkDescriptorUpdateTemplateType            templateType;
-    VkDescriptorSetLayout                     descriptorSetLayout;
-    VkPipelineBindPoint                       pipelineBindPoint;
-    VkPipelineLayout                          pipelineLayout;
-    uint32_t                                  set;
-} VkDescriptorUpdateTemplateCreateInfo;
-#endif
 
+// Writes a whole set in one vkUpdateDescriptorSetWithTemplate() call, the driver pulls the
+// infos straight out of a blob at the entries' offsets/strides instead of walking
+// VkWriteDescriptorSets. Entries come from either
+//  - makeEntries(layout): every binding packed in binding order, write into the blob at
+//    findEntry(binding)->offset, or
+//  - DescriptorTemplateLayout<Struct, ...>::getEntries(): a plain struct of infos, offsets
+//    and strides worked out at compile time (see elysian_renderer_descriptor_template.hpp).
+// Image, texel buffer, buffer and acceleration structure descriptors only, a template with
+// entries of any other type (inline uniform blocks, ...) fails with
+// VK_ERROR_INITIALIZATION_FAILED.
 class DescriptorUpdateTemplate:
         public HandleObject<VkDescriptorUpdateTemplate,
                             VK_OBJECT_TYPE_DESCRIPTOR_UPDATE_TEMPLATE>
 {
 public:
+    struct Initializer {
+        std::string                                     name;
+        const Device*                                   pDevice         = nullptr;
+        std::vector<VkDescriptorUpdateTemplateEntry>    entries;
+        VkDescriptorSetLayout                           setLayout       = VK_NULL_HANDLE;
+        // push descriptor templates go by pipeline layout and set instead
+        VkDescriptorUpdateTemplateType                  type            = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+        VkPipelineBindPoint                             bindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        VkPipelineLayout                                pipelineLayout  = VK_NULL_HANDLE;
+        uint32_t                                        set             = 0;
+    };
+
+                        DescriptorUpdateTemplate(Initializer initializer);
+                        ~DescriptorUpdateTemplate(void);
+
+    bool                isValid(void) const;
+    Result              getResult(void) const;
+
+    const char*         getName(void) const;
+    auto                getEntries(void) const -> const std::vector<VkDescriptorUpdateTemplateEntry>&;
+    auto                findEntry(uint32_t binding, uint32_t arrayElement=0) const -> const VkDescriptorUpdateTemplateEntry*;
+    // bytes pData has to cover
+    size_t              getDataSize(void) const;
+
+    void                update(VkDescriptorSet set, const void* pData) const;
+    // pointers go to the overload above
+    template<typename T, typename = std::enable_if_t<!std::is_pointer_v<T>>>
+    void                update(VkDescriptorSet set, const T& data) const;
+
+    // One entry per binding, tightly packed in binding order, descriptorCount 0 bindings
+    // skipped. VK_ERROR_INITIALIZATION_FAILED (and no entries) when a binding's type can't
+    // be written through a template.
+    static Result       makeEntries(const VkDescriptorSetLayoutBinding* pBindings, uint32_t count,
+                                    std::vector<VkDescriptorUpdateTemplateEntry>* pEntries);
+    static Result       makeEntries(const DescriptorSetLayout& layout, std::vector<VkDescriptorUpdateTemplateEntry>* pEntries);
+    static Result       makeEntries(const std::vector<DescriptorSetLayoutBinding>& bindings,
+                                    std::vector<VkDescriptorUpdateTemplateEntry>* pEntries);
 
 private:
+    Initializer         m_initializer;
+    Result              m_result;
+    size_t              m_dataSize = 0;
 };
 
+inline bool DescriptorUpdateTemplate::isValid(void) const { return getResult() && getHandle() != VK_NULL_HANDLE; }
+inline Result DescriptorUpdateTemplate::getResult(void) const { return m_result; }
+inline const char* DescriptorUpdateTemplate::getName(void) const { return m_initializer.name.c_str(); }
+inline auto DescriptorUpdateTemplate::getEntries(void) const -> const std::vector<VkDescriptorUpdateTemplateEntry>& {
+    return m_initializer.entries;
+}
+inline size_t DescriptorUpdateTemplate::getDataSize(void) const { return m_dataSize; }
+
+template<typename T, typename>
+inline void DescriptorUpdateTemplate::update(VkDescriptorSet set, const T& data) const {
+    static_assert(std::is_trivially_copyable_v<T>, "template data is read bytewise");
+    assert(sizeof(T) >= getDataSize());
+    update(set, static_cast<const void*>(&data));
+}
+
 class DescriptorSet: public HandleObject<VkDescriptorSet, VK_OBJECT_TYPE_DESCRIPTOR_SET>  {
 public:
-                            DescriptorSet(VkDescriptorSet handle, const DescriptorSetLayout* pLayout);
+                            DescriptorSet(VkDescriptorSet handle, const DescriptorSetLayout* pLayout, Device* pDevice);
 
 
     auto                    getLayout(void) const -> const DescriptorSetLayout*;
@@ -156,9 +182,11 @@ public:
         uint32_t           descriptorCount;
     } VkCopyDescriptorSet;
 #endif
+    // dstSet is always this set
     void                    write(const VkWriteDescriptorSet& write) const;
     void                    copy(const VkCopyDescriptorSet& copy) const;
-    void        `           updateWithTemplate(VkDescriptorUpdateTemplate descriptorUpdateTemplate, const void* pData);
+    void                    updateWithTemplate(VkDescriptorUpdateTemplate descriptorUpdateTemplate, const void* pData) const;
+    void                    updateWithTemplate(const DescriptorUpdateTemplate& updateTemplate, const void* pData) const;
 
 
 #if 0
@@ -183,10 +211,12 @@ private:
     const DescriptorSetLayout*  m_pLayout   = nullptr;
 };
 
-inline DescriptorSet::DescriptorSet(VkDescriptorSet handle, const DescriptorSetLayout *pLayout):
-    m_handle(handle),
+inline DescriptorSet::DescriptorSet(VkDescriptorSet handle, const DescriptorSetLayout *pLayout, Device* pDevice):
+    HandleObject(pDevice, handle),
     m_pLayout(pLayout)
-{}
+{
+    assert(pDevice); //write/copy/updateWithTemplate go through it
+}
 
 inline const DescriptorSetLayout* DescriptorSet::getLayout(void) const { return m_pLayout; }
 
@@ -264,9 +294,7 @@ inline DescriptorSetGroup::DescriptorSetGroup(const char *pName, std::shared_ptr
 }
 
 inline DescriptorSetGroup::~DescriptorSetGroup(void) {
-    //MAYBE delete? Need a flag for this?
-    //To delete with destructor versus waiting and only deleting shit
-    //when DescriptorPool is destroyed?
+    // never freed one by one, sets go back with their pool's reset (see DescriptorAllocator)
 }
 
 
@@ -295,7 +323,7 @@ public:
         m_name(pName)
     {}
 
-    const char* getName(void) const { return m_name; }
+    const char* getName(void) const { return m_name.c_str(); }
     uint32_t    getBinding(void) const;
     auto        getStageFlags(void) const -> VkShaderStageFlags;
     auto        getDescriptorType(void) const -> VkDescriptorType;
@@ -307,6 +335,12 @@ private:
     std::string            m_name;
 };
 
+inline uint32_t DescriptorSetLayoutBinding::getBinding(void) const { return binding; }
+inline auto DescriptorSetLayoutBinding::getStageFlags(void) const -> VkShaderStageFlags { return stageFlags; }
+inline auto DescriptorSetLayoutBinding::getDescriptorType(void) const -> VkDescriptorType { return descriptorType; }
+inline uint32_t DescriptorSetLayoutBinding::getDescriptorCount(void) const { return descriptorCount; }
+inline auto DescriptorSetLayoutBinding::getImmutableSamplers(void) const -> const std::vector<VkSampler>& { return m_immutableSamplers; }
+
 class DescriptorSetLayout: public VkDescriptorSetLayoutCreateInfo {
 #if 0
     typedef struct VkDescriptorSetLayoutCreateInfo {
@@ -327,53 +361,41 @@ public:
             VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
             nullptr,
             flags,
-            bindings.size(),
-            bindings.data() //not going to fucking work...
+            static_cast<uint32_t>(bindings.size()),
+            nullptr
         }),
+        m_set(set),
         m_name(pName),
-        m_set(set)
-    {}
+        m_bindings(std::move(bindings)),
+        m_vkBindings(m_bindings.begin(), m_bindings.end())
+    {
+        // pBindings points into our own copy, hence no copying
+        pBindings = m_vkBindings.data();
+    }
+    DescriptorSetLayout(const DescriptorSetLayout& rhs) = delete;
     ~DescriptorSetLayout(void);
 
+    DescriptorSetLayout& operator=(const DescriptorSetLayout& rhs) = delete;
+
     const char*                 getName(void) const;
     uint32_t                    getSet(void) const;
 
-    DescriptorSetLayoutBinding* getBinding(uint32_t binding) const;
-    DescriptorSetLayoutBinding* getBinding(const char* pName) const;
+    // nullptr when the layout has no such binding. Names go by string_view so a literal 0
+    // still picks the binding number.
+    auto                        getBinding(uint32_t binding) const -> const DescriptorSetLayoutBinding*;
+    auto                        getBinding(std::string_view name) const -> const DescriptorSetLayoutBinding*;
+    auto                        getBindings(void) const -> const std::vector<DescriptorSetLayoutBinding>&;
 
 private:
-    uint32_t    m_set = 0;
-    std::string m_name;
-
+    uint32_t                                    m_set = 0;
+    std::string                                 m_name;
+    std::vector<DescriptorSetLayoutBinding>     m_bindings;
+    std::vector<VkDescriptorSetLayoutBinding>   m_vkBindings;
 };
 
-inline DescriptorPool::DescriptorPool(Initializer initializer):
-    m_initializer(std::move(initializer))
-{
-    m_result = vkCreateDescriptorPool(initializer.pDevice,
-                                      &initializer.info,
-                                      nullptr,
-                                      &m_handle);
-}
-
-inline DescriptorPool::~DescriptorPool(void) {
-    vkDestroyDescriptorPool(m_initializer.pDevice, getHandle(), nullptr);
-}
-
-inline bool DescriptorPool::isValid(void) const {
-    return m_result && getHandle() != VK_INVALID_HANDLE;
-}
-
-inline Result DescriptorPool::getResult(void) const {
-    return m_result;
-}
-
-inline const char* DescriptorPool::getName(void) const { return m_initializer.name.c_str(); }
-inline VkDescriptorPool DescriptorPool::getHandle(void) const { return m_handle; }
-inline DescriptorPool::operator VkDescriptorPool() const { return getHandle(); }
-inline auto DescriptorPool::getCreateInfo(void) const -> const CreateInfo& {
-    return m_initializer.info;
-}
+inline const char* DescriptorSetLayout::getName(void) const { return m_name.c_str(); }
+inline uint32_t DescriptorSetLayout::getSet(void) const { return m_set; }
+inline auto DescriptorSetLayout::getBindings(void) const -> const std::vector<DescriptorSetLayoutBinding>& { return m_bindings; }
 
 
 }
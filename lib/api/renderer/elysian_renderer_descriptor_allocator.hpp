@@ -0,0 +1,121 @@
+#ifndef ELYSIAN_RENDERER_DESCRIPTOR_ALLOCATOR_HPP
+#define ELYSIAN_RENDERER_DESCRIPTOR_ALLOCATOR_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "elysian_renderer_descriptor.hpp"
+#include "elysian_renderer_thread_registry.hpp"
+
+namespace elysian::renderer {
+
+class DebugLog;
+
+// Hands out transient descriptor sets from pools owned by the calling thread, the same way
+// CommandPoolManager does command buffers, so workers never serialize on a pool.
+//
+// Every thread gets a list of pools per frame per profile. A profile is a ratio of
+// descriptor types per set that pools get sized by (say image heavy material sets vs.
+// buffer only per-draw sets). When a pool reports VK_ERROR_OUT_OF_POOL_MEMORY or
+// VK_ERROR_FRAGMENTED_POOL the next one in the list is used, a new (bigger) one created
+// when there is none. Sets are never freed: the first allocate() of a thread in a new frame
+// resets all the pools it used in that frame slot with DescriptorPool::reset().
+//
+// Per frame:
+//      waitForFence(frame);                    //frame's last submission has to be done
+//      allocator.beginFrame();
+//      ...on any worker: allocator.allocate(layout);
+//
+// allocate() is safe to call concurrently, beginFrame() is not.
+class DescriptorAllocator {
+public:
+    struct PoolRatio {
+        VkDescriptorType    type;
+        float               ratio;          //descriptors of the type per set
+    };
+
+    struct Initializer {
+        std::string                             name;
+        const Device*                           pDevice         = nullptr;
+        uint32_t                                frameCount      = 3;
+        uint32_t                                setsPerPool     = 128;  //first pool, doubles with each one added
+        uint32_t                                maxSetsPerPool  = 4096;
+        // empty gets one general purpose profile
+        std::vector<std::vector<PoolRatio>>     profiles;
+    };
+
+    struct Statistics {
+        uint32_t    threadCount     = 0;
+        uint32_t    poolCount       = 0;
+        uint64_t    allocationCount = 0;    //sets
+        uint64_t    overflowCount   = 0;    //pool full/fragmented, moved on to the next
+        uint64_t    resetCount      = 0;    //pools reset
+        uint64_t    failedCount     = 0;
+    };
+
+                        DescriptorAllocator(Initializer initializer);
+                        ~DescriptorAllocator(void);
+
+    const char*         getName(void) const;
+    uint32_t            getFrameIndex(void) const;
+    uint32_t            getFrameCount(void) const;
+    uint32_t            getProfileCount(void) const;
+    // the general purpose profile
+    static auto         getDefaultRatios(void) -> const std::vector<PoolRatio>&;
+
+    // moves on to the next frame, its pools get reset lazily by their threads
+    void                beginFrame(void);
+
+    // valid until this frame slot comes around again, VK_NULL_HANDLE with the reason in pResult
+    VkDescriptorSet     allocate(VkDescriptorSetLayout layout, uint32_t profile=0, Result* pResult=nullptr);
+    // variableCounts is for layouts ending in a variable sized binding, null otherwise
+    Result              allocate(uint32_t count, const VkDescriptorSetLayout* pLayouts, VkDescriptorSet* pSets,
+                                 uint32_t profile=0, const uint32_t* pVariableCounts=nullptr);
+
+    Statistics          getStatistics(void) const;
+    void                log(DebugLog* pLog) const;
+
+private:
+    struct ProfilePools {
+        std::vector<std::unique_ptr<DescriptorPool>>    pools;
+        uint32_t                                        current = 0;        //pool allocating from
+        bool                                            used    = false;    //since the last reset
+    };
+
+    struct FrameContext {
+        std::vector<ProfilePools>   profiles;
+        uint64_t                    frame   = 0; //last beginFrame() this was reset for
+    };
+
+    // only ever written by the owning thread, read by getStatistics()
+    struct ThreadContext {
+        std::vector<FrameContext>   frames;
+        std::atomic<uint32_t>       poolCount       = { 0 };
+        std::atomic<uint64_t>       allocationCount = { 0 };
+        std::atomic<uint64_t>       overflowCount   = { 0 };
+        std::atomic<uint64_t>       resetCount      = { 0 };
+        std::atomic<uint64_t>       failedCount     = { 0 };
+    };
+
+    ThreadContext*      getThreadContext(void);
+    auto                createPool(uint32_t profile, uint32_t index) const -> std::unique_ptr<DescriptorPool>;
+
+    Initializer                                 m_initializer;
+    ThreadRegistry<ThreadContext>               m_registry;
+    std::atomic<uint64_t>                       m_frame     = { 0 };
+
+    mutable std::mutex                          m_mutex;
+    std::vector<std::unique_ptr<ThreadContext>> m_threads;
+};
+
+inline const char* DescriptorAllocator::getName(void) const { return m_initializer.name.c_str(); }
+inline uint32_t DescriptorAllocator::getFrameIndex(void) const { return m_frame.load(std::memory_order_relaxed) % m_initializer.frameCount; }
+inline uint32_t DescriptorAllocator::getFrameCount(void) const { return m_initializer.frameCount; }
+inline uint32_t DescriptorAllocator::getProfileCount(void) const { return static_cast<uint32_t>(m_initializer.profiles.size()); }
+inline void DescriptorAllocator::beginFrame(void) { m_frame.fetch_add(1, std::memory_order_relaxed); }
+
+}
+
+#endif // ELYSIAN_RENDERER_DESCRIPTOR_ALLOCATOR_HPP
@@ -0,0 +1,165 @@
+#ifndef ELYSIAN_RENDERER_DESCRIPTOR_SET_CACHE_HPP
+#define ELYSIAN_RENDERER_DESCRIPTOR_SET_CACHE_HPP
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "elysian_renderer_descriptor_allocator.hpp"
+
+namespace elysian::renderer {
+
+class DebugLog;
+
+// What a descriptor set points at, binding by binding. Kept sorted by binding and array
+// element so the order things are set in doesn't change the key.
+class DescriptorSetContents {
+public:
+    // all 32/64 bit members, no padding, so they hash and compare bytewise
+    struct Resource {
+        uint32_t            binding;
+        uint32_t            arrayElement;
+        VkDescriptorType    type;
+        VkImageLayout       imageLayout;
+        VkBuffer            buffer;
+        VkDeviceSize        offset;
+        VkDeviceSize        range;
+        VkSampler           sampler;
+        VkImageView         imageView;
+        VkBufferView        texelBufferView;
+    };
+
+    DescriptorSetContents& setBuffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer,
+                                     VkDeviceSize offset=0, VkDeviceSize range=VK_WHOLE_SIZE, uint32_t arrayElement=0);
+    DescriptorSetContents& setImage(uint32_t binding, VkDescriptorType type, VkImageView imageView,
+                                    VkImageLayout imageLayout=VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                    VkSampler sampler=VK_NULL_HANDLE, uint32_t arrayElement=0);
+    DescriptorSetContents& setSampler(uint32_t binding, VkSampler sampler, uint32_t arrayElement=0);
+    DescriptorSetContents& setTexelBuffer(uint32_t binding, VkDescriptorType type, VkBufferView view, uint32_t arrayElement=0);
+    void                   clear(void);
+
+    auto                getResources(void) const -> const std::vector<Resource>&;
+    uint64_t            getHash(VkDescriptorSetLayout layout) const;
+
+private:
+    DescriptorSetContents& set(const Resource& resource);
+
+    std::vector<Resource>   m_resources;
+};
+
+// Descriptor sets by layout and contents: steady state frames that bind the same buffers and
+// images get the set they had last frame back, without an allocation or an update.
+//
+// Sets live in the cache's own pools. Only the least recently used sets past maxSets get
+// evicted, and only once the last frame using them has retired (frameCount beginFrame()s
+// ago, so the caller has waited on its fence). An evicted set isn't freed: it goes on a
+// free list for its layout, and only a miss writing the same bindings and array elements
+// gets to rewrite it, so nothing of its old contents survives.
+//
+// Contents can hold buffers, texel buffers, images and samplers. Acceleration structures and
+// inline uniform blocks need their own pNext writes, sets with those fail.
+//
+// getSet() is thread safe, misses update the new set under the lock.
+//
+// Sets are keyed by raw handles, so destroying a buffer, view, sampler or layout that's still
+// cached has to be followed by the matching invalidate*() (or clear()) before the handle
+// value can come back from the driver for something else.
+class DescriptorSetCache {
+public:
+    struct Initializer {
+        std::string                                     name;
+        const Device*                                   pDevice     = nullptr;
+        uint32_t                                        frameCount  = 3;
+        uint32_t                                        maxSets     = 4096; //soft, sets still in flight are never evicted
+        uint32_t                                        setsPerPool = 256;
+        // empty gets DescriptorAllocator's general purpose ratios
+        std::vector<DescriptorAllocator::PoolRatio>     ratios;
+    };
+
+    struct Statistics {
+        uint32_t    setCount        = 0;    //cached
+        uint32_t    freeCount       = 0;    //evicted, waiting to be rewritten
+        uint32_t    poolCount       = 0;
+        uint64_t    hitCount        = 0;
+        uint64_t    missCount       = 0;
+        uint64_t    recycleCount    = 0;    //misses served from the free list
+        uint64_t    evictCount      = 0;
+        uint64_t    invalidateCount = 0;
+        uint64_t    failedCount     = 0;
+    };
+
+                        DescriptorSetCache(Initializer initializer);
+                        ~DescriptorSetCache(void);
+
+    const char*         getName(void) const;
+
+    // once the fence of the frame slot about to be reused has been waited on
+    void                beginFrame(void);
+
+    // VK_NULL_HANDLE with the reason in pResult when a new set couldn't be allocated,
+    // VK_ERROR_INITIALIZATION_FAILED for a descriptor type the contents can't describe
+    VkDescriptorSet     getSet(VkDescriptorSetLayout layout, const DescriptorSetContents& contents, Result* pResult=nullptr);
+
+    // drops the sets pointing at the handle, right after it was destroyed. Sets a frame in
+    // flight may still bind are only recycled once that frame has retired.
+    void                invalidateBuffer(VkBuffer buffer);
+    void                invalidateBufferView(VkBufferView view);
+    void                invalidateImageView(VkImageView imageView);
+    void                invalidateSampler(VkSampler sampler);
+    // sets of the layout stay allocated in their pool until clear()
+    void                invalidateLayout(VkDescriptorSetLayout layout);
+
+    // drops every set, none of them may be in use anymore
+    void                clear(void);
+    Statistics          getStatistics(void) const;
+    void                log(DebugLog* pLog) const;
+
+private:
+    struct Entry {
+        uint64_t                                    hash;
+        VkDescriptorSetLayout                       layout;
+        std::vector<DescriptorSetContents::Resource> resources;
+        VkDescriptorSet                             set;
+        uint64_t                                    lastUse;    //frame
+    };
+
+    struct FreeSet {
+        uint64_t                                    shape;      //of the slots its last contents wrote
+        std::vector<DescriptorSetContents::Resource> resources;
+        VkDescriptorSet                             set;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    // a recycled set only for contents writing the same slots
+    Result              allocateLocked(VkDescriptorSetLayout layout, const std::vector<DescriptorSetContents::Resource>& resources,
+                                       VkDescriptorSet* pSet);
+    void                evictLocked(void);
+    template<typename F>
+    void                invalidateLocked(F&& matches);
+    void                recycleLocked(Entry& entry); //takes its resources
+    void                updateSet(VkDescriptorSet set, const std::vector<DescriptorSetContents::Resource>& resources) const;
+
+    Initializer                                                         m_initializer;
+    mutable std::mutex                                                  m_mutex;
+    uint64_t                                                            m_frame     = 0;
+    EntryList                                                           m_entries;  //most recently used first
+    std::unordered_multimap<uint64_t, EntryList::iterator>              m_lookup;   //by hash, collisions chain
+    std::unordered_map<VkDescriptorSetLayout, std::vector<FreeSet>>     m_freeSets;
+    uint32_t                                                            m_freeCount = 0;
+    std::vector<Entry>                                                  m_retired;  //invalidated, still in flight
+    std::vector<std::unique_ptr<DescriptorPool>>                        m_pools;
+    uint32_t                                                            m_currentPool = 0; //earlier ones are full
+    Statistics                                                          m_statistics;
+};
+
+inline auto DescriptorSetContents::getResources(void) const -> const std::vector<Resource>& { return m_resources; }
+inline void DescriptorSetContents::clear(void) { m_resources.clear(); }
+
+inline const char* DescriptorSetCache::getName(void) const { return m_initializer.name.c_str(); }
+
+}
+
+#endif // ELYSIAN_RENDERER_DESCRIPTOR_SET_CACHE_HPP
@@ -0,0 +1,110 @@
+#ifndef ELYSIAN_RENDERER_DESCRIPTOR_TEMPLATE_HPP
+#define ELYSIAN_RENDERER_DESCRIPTOR_TEMPLATE_HPP
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+#include "elysian_renderer_descriptor.hpp"
+
+namespace elysian::renderer {
+
+namespace detail {
+    // the info struct vkUpdateDescriptorSetWithTemplate() expects for each descriptor type
+    template<typename Info>
+    constexpr bool isDescriptorInfoFor(VkDescriptorType type) {
+        switch(type) {
+        case VK_DESCRIPTOR_TYPE_SAMPLER:
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+        case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+            return std::is_same_v<Info, VkDescriptorImageInfo>;
+        case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+            return std::is_same_v<Info, VkBufferView>;
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+            return std::is_same_v<Info, VkDescriptorBufferInfo>;
+#ifdef VK_KHR_acceleration_structure
+        case VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR:
+            return std::is_same_v<Info, VkAccelerationStructureKHR>;
+#endif
+        default:
+            return false;
+        }
+    }
+
+    template<size_t Count>
+    constexpr bool hasOverlappingEntries(const std::array<VkDescriptorUpdateTemplateEntry, Count>& entries) {
+        for(size_t e = 0; e < Count; ++e) {
+            for(size_t o = e + 1; o < Count; ++o) {
+                if(entries[e].dstBinding != entries[o].dstBinding) continue;
+                if(entries[e].dstArrayElement < entries[o].dstArrayElement + entries[o].descriptorCount &&
+                   entries[o].dstArrayElement < entries[e].dstArrayElement + entries[e].descriptorCount)
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+}
+
+// One member of a template struct: an info (or an array of them, one per array element)
+// going to binding. Spelled through ELYSIAN_DESCRIPTOR_BINDING, which fills in the offset.
+template<uint32_t Binding, VkDescriptorType Type, size_t Offset, typename Member, uint32_t ArrayElement=0>
+struct DescriptorTemplateBinding {
+    using Info = std::remove_all_extents_t<Member>;
+    static_assert(detail::isDescriptorInfoFor<Info>(Type), "member can't hold this descriptor type");
+
+    static constexpr VkDescriptorUpdateTemplateEntry kEntry = {
+        Binding,
+        ArrayElement,
+        static_cast<uint32_t>(sizeof(Member) / sizeof(Info)),
+        Type,
+        Offset,
+        sizeof(Info)
+    };
+};
+
+#define ELYSIAN_DESCRIPTOR_BINDING(Struct, member, binding, type) \
+    ::elysian::renderer::DescriptorTemplateBinding<binding, type, offsetof(Struct, member), decltype(Struct::member)>
+
+// Maps a plain struct of descriptor infos onto a set's bindings, entries are constants:
+//
+//     struct MaterialDescriptors {
+//         VkDescriptorBufferInfo  constants;
+//         VkDescriptorImageInfo   textures[4];
+//     };
+//     using MaterialTemplate = DescriptorTemplateLayout<MaterialDescriptors,
+//         ELYSIAN_DESCRIPTOR_BINDING(MaterialDescriptors, constants, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER),
+//         ELYSIAN_DESCRIPTOR_BINDING(MaterialDescriptors, textures, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)>;
+//
+//     DescriptorUpdateTemplate updateTemplate({ "material", pDevice, MaterialTemplate::getEntries(), setLayout });
+//     updateTemplate.update(set, materialDescriptors);     //one call for the whole set
+template<typename Struct, typename... Bindings>
+class DescriptorTemplateLayout {
+public:
+    static_assert(std::is_standard_layout_v<Struct> && std::is_trivially_copyable_v<Struct>,
+                  "template data is read bytewise at member offsets");
+    static_assert(sizeof...(Bindings), "no bindings, nothing to update");
+
+    static constexpr uint32_t   kEntryCount = sizeof...(Bindings);
+    static constexpr std::array<VkDescriptorUpdateTemplateEntry, sizeof...(Bindings)> kEntries = { Bindings::kEntry... };
+
+    static_assert(!detail::hasOverlappingEntries(kEntries), "descriptor written by two members");
+
+    static auto getEntries(void) -> std::vector<VkDescriptorUpdateTemplateEntry>;
+};
+
+template<typename Struct, typename... Bindings>
+inline auto DescriptorTemplateLayout<Struct, Bindings...>::getEntries(void) -> std::vector<VkDescriptorUpdateTemplateEntry> {
+    return std::vector<VkDescriptorUpdateTemplateEntry>(kEntries.begin(), kEntries.end());
+}
+
+}
+
+#endif // ELYSIAN_RENDERER_DESCRIPTOR_TEMPLATE_HPP
@@ -0,0 +1,92 @@
+#ifndef ELYSIAN_RENDERER_DESCRIPTOR_WRITE_BATCH_HPP
+#define ELYSIAN_RENDERER_DESCRIPTOR_WRITE_BATCH_HPP
+
+#include <string_view>
+#include <vector>
+#include "elysian_renderer_descriptor.hpp"
+
+namespace elysian::renderer {
+
+// Collects descriptor writes and copies for any number of sets and hands them all to the
+// driver in one vkUpdateDescriptorSets() on flush(), instead of one call per binding like
+// DescriptorSet::write() does.
+//
+// Bindings are given by number or by name and looked up in the set's DescriptorSetLayout,
+// which also supplies the descriptor type. A binding the layout doesn't have, or an info
+// that doesn't match its type, fails with VK_ERROR_INITIALIZATION_FAILED and nothing is
+// queued.
+//
+// The infos are copied into arrays owned by the batch and only pointed at on flush(), so
+// the caller's can be temporaries. flush() keeps the arrays' capacity: one batch reused
+// every frame stops allocating once it has seen the biggest frame.
+//
+// Not thread safe, one per thread/pass.
+class DescriptorWriteBatch {
+public:
+                        DescriptorWriteBatch(const Device* pDevice);
+
+    Result              writeBuffer(const DescriptorSet& set, uint32_t binding, VkBuffer buffer,
+                                    VkDeviceSize offset=0, VkDeviceSize range=VK_WHOLE_SIZE, uint32_t arrayElement=0);
+    Result              writeBuffer(const DescriptorSet& set, std::string_view binding, VkBuffer buffer,
+                                    VkDeviceSize offset=0, VkDeviceSize range=VK_WHOLE_SIZE, uint32_t arrayElement=0);
+    Result              writeImage(const DescriptorSet& set, uint32_t binding, VkImageView imageView,
+                                   VkImageLayout imageLayout=VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                   VkSampler sampler=VK_NULL_HANDLE, uint32_t arrayElement=0);
+    Result              writeImage(const DescriptorSet& set, std::string_view binding, VkImageView imageView,
+                                   VkImageLayout imageLayout=VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                   VkSampler sampler=VK_NULL_HANDLE, uint32_t arrayElement=0);
+    Result              writeTexelBuffer(const DescriptorSet& set, uint32_t binding, VkBufferView view, uint32_t arrayElement=0);
+    Result              writeTexelBuffer(const DescriptorSet& set, std::string_view binding, VkBufferView view, uint32_t arrayElement=0);
+
+    // consecutive array elements starting at arrayElement
+    Result              writeBuffers(const DescriptorSet& set, uint32_t binding, const VkDescriptorBufferInfo* pInfos,
+                                     uint32_t count, uint32_t arrayElement=0);
+    Result              writeImages(const DescriptorSet& set, uint32_t binding, const VkDescriptorImageInfo* pInfos,
+                                    uint32_t count, uint32_t arrayElement=0);
+
+    Result              copy(const DescriptorSet& srcSet, uint32_t srcBinding, const DescriptorSet& dstSet, uint32_t dstBinding,
+                             uint32_t count=1, uint32_t srcArrayElement=0, uint32_t dstArrayElement=0);
+    Result              copy(const DescriptorSet& srcSet, std::string_view srcBinding, const DescriptorSet& dstSet, std::string_view dstBinding,
+                             uint32_t count=1, uint32_t srcArrayElement=0, uint32_t dstArrayElement=0);
+
+    // one vkUpdateDescriptorSets() for everything queued, none of the sets may be in use
+    void                flush(void);
+    // drops everything queued
+    void                clear(void);
+
+    bool                isEmpty(void) const;
+    uint32_t            getWriteCount(void) const;
+    uint32_t            getCopyCount(void) const;
+
+private:
+    // where a queued write's infos start in the array matching its type
+    struct PendingWrite {
+        VkWriteDescriptorSet    write;
+        uint32_t                infoIndex;
+    };
+
+    template<typename Info>
+    Result              queue(const DescriptorSet& set, const DescriptorSetLayoutBinding* pBinding,
+                              const Info* pInfos, uint32_t count, uint32_t arrayElement);
+    template<typename Info>
+    Result              queue(const DescriptorSet& set, uint32_t binding, const Info* pInfos, uint32_t count, uint32_t arrayElement);
+    template<typename Info>
+    Result              queue(const DescriptorSet& set, std::string_view binding, const Info* pInfos, uint32_t count, uint32_t arrayElement);
+
+    const Device*                       m_pDevice = nullptr;
+    std::vector<PendingWrite>           m_pendingWrites;
+    std::vector<VkCopyDescriptorSet>    m_copies;
+    std::vector<VkDescriptorBufferInfo> m_bufferInfos;
+    std::vector<VkDescriptorImageInfo>  m_imageInfos;
+    std::vector<VkBufferView>           m_texelBufferViews;
+    std::vector<VkWriteDescriptorSet>   m_writes;   //resolved on flush
+};
+
+inline DescriptorWriteBatch::DescriptorWriteBatch(const Device* pDevice): m_pDevice(pDevice) {}
+inline bool DescriptorWriteBatch::isEmpty(void) const { return m_pendingWrites.empty() && m_copies.empty(); }
+inline uint32_t DescriptorWriteBatch::getWriteCount(void) const { return static_cast<uint32_t>(m_pendingWrites.size()); }
+inline uint32_t DescriptorWriteBatch::getCopyCount(void) const { return static_cast<uint32_t>(m_copies.size()); }
+
+}
+
+#endif // ELYSIAN_RENDERER_DESCRIPTOR_WRITE_BATCH_HPP
@@ -9,6 +9,7 @@ namespace elysian::renderer {
 class PhysicalDevice;
 class CommandPool;
 class CommandPoolCreateInfo;
+class PipelineCache;
 
 #if 0
 struct PhysicalDeviceSelector {
@@ -92,10 +93,24 @@ public:
 
     Result getResult(void) const { return m_result; }
 
+    //host allocator from the Renderer, pass to every vkCreate*/vkDestroy* on this device
+    const VkAllocationCallbacks* getAllocationCallbacks(void) const;
+
     PFN_vkVoidFunction getProcAddr(const char* pName) const;
     VkPeerMemoryFeatureFlags getPeerMemoryFeatures(uint32_t heapIndex, uint32_t localDeviceIndex, uint32_t remoteDeviceIndex) const;
 
-    CommandPool* createCommandPool(const CommandPoolCreateInfo* pInfo) const;
+    auto createCommandPool(const CommandPoolCreateInfo* pInfo) const -> std::unique_ptr<CommandPool>;
+
+    // Batched vkCreate*Pipelines, the driver gets to spread the whole lot over its own threads.
+    // Infos with a basePipelineIndex >= 0 become derivatives of that entry, with the flags on
+    // both ends fixed up, and may come in any order: parents get moved ahead of their children
+    // for the call and everything is mapped back afterwards. Out of range indices are treated
+    // as no base, a cycle fails the whole batch with VK_ERROR_INITIALIZATION_FAILED. Failed
+    // pipelines are VK_NULL_HANDLE, pResults (optional, count entries) says why for each one.
+    Result createGraphicsPipelines(uint32_t count, const VkGraphicsPipelineCreateInfo* pInfos, VkPipeline* pPipelines,
+                                   Result* pResults=nullptr, const PipelineCache* pPipelineCache=nullptr) const;
+    Result createComputePipelines(uint32_t count, const VkComputePipelineCreateInfo* pInfos, VkPipeline* pPipelines,
+                                  Result* pResults=nullptr, const PipelineCache* pPipelineCache=nullptr) const;
 
 #if 0
     void vkGetDescriptorSetLayoutSupport(
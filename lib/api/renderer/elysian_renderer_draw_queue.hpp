@@ -0,0 +1,136 @@
+#ifndef ELYSIAN_RENDERER_DRAW_QUEUE_HPP
+#define ELYSIAN_RENDERER_DRAW_QUEUE_HPP
+
+#include <unordered_map>
+#include <vector>
+#include "elysian_renderer_object.hpp"
+
+namespace elysian::renderer {
+
+class CommandBuffer;
+class CommandStream;
+class DebugLog;
+
+// Collects a frame's draws, radix sorts them by a 64 bit state key and emits them with
+// as few binds as possible. Runs of draws sharing all state are merged: draws whose
+// instance ranges line up become one instanced draw, and what's left of the run goes
+// out as one indirect draw when an IndirectTarget is given.
+//
+// Key, high to low: layer (8) | pipeline (16) | descriptor sets (16) | geometry (16) | sortBits (8).
+// Pipeline/descriptor/geometry are small ids handed out in submission order, so equal
+// state sorts together. Past 64k distinct ones they wrap, which costs batching, never
+// correctness: emission always compares the real state.
+//
+// Not thread safe, give every recording thread its own queue.
+class DrawQueue {
+public:
+    static constexpr uint32_t kMaxDescriptorSets    = 4;
+    static constexpr uint32_t kMaxVertexBuffers     = 4;
+    static constexpr uint32_t kMaxPushConstantSize  = 128; //the guaranteed minimum
+
+    struct DrawPacket {
+        VkPipeline          pipeline                                = VK_NULL_HANDLE;
+        VkPipelineLayout    layout                                  = VK_NULL_HANDLE;
+        uint32_t            descriptorSetCount                      = 0; //bound starting at set 0
+        VkDescriptorSet     descriptorSets[kMaxDescriptorSets]      = {};
+        uint32_t            vertexBufferCount                       = 0; //bound starting at binding 0
+        VkBuffer            vertexBuffers[kMaxVertexBuffers]        = {};
+        VkDeviceSize        vertexOffsets[kMaxVertexBuffers]        = {};
+        VkBuffer            indexBuffer                             = VK_NULL_HANDLE; //null draws non-indexed
+        VkDeviceSize        indexOffset                             = 0;
+        VkIndexType         indexType                               = VK_INDEX_TYPE_UINT16;
+        VkShaderStageFlags  pushConstantStages                      = 0;
+        uint32_t            pushConstantSize                        = 0;
+        const void*         pPushConstants                          = nullptr; //copied in by submit()
+        uint32_t            count                                   = 0; //index or vertex count
+        uint32_t            instanceCount                           = 1;
+        uint32_t            first                                   = 0; //firstIndex or firstVertex
+        int32_t             vertexOffset                            = 0; //indexed only
+        uint32_t            firstInstance                           = 0;
+        uint8_t             layer                                   = 0; //sorts before anything else, eg. opaque < transparent
+        uint8_t             sortBits                                = 0; //sorts after all state, eg. coarse depth
+    };
+
+    // Where merged runs get their indirect commands written. The memory has to be host
+    // visible and mapped, and flushed by the caller before submission if it isn't coherent.
+    // Leave maxDrawCount at 1 without the multiDrawIndirect feature. Commands carry each
+    // packet's firstInstance, so submitting packets with a nonzero one needs the
+    // drawIndirectFirstInstance feature too (or maxDrawCount at 1).
+    //
+    // emit() appends at used and advances it, so one target can take several emits per frame.
+    struct IndirectTarget {
+        VkBuffer            buffer          = VK_NULL_HANDLE;
+        VkDeviceSize        offset          = 0;        //of pMapped within buffer, multiple of 4
+        void*               pMapped         = nullptr;
+        VkDeviceSize        size            = 0;        //bytes available
+        VkDeviceSize        used            = 0;        //bytes written so far
+        uint32_t            maxDrawCount    = 1;
+    };
+
+    struct Statistics {
+        uint32_t            packetCount         = 0;
+        uint32_t            drawCallCount       = 0;    //direct and indirect
+        uint32_t            indirectCallCount   = 0;
+        uint32_t            instancedMergeCount = 0;    //packets folded into another packet's instance range
+        uint32_t            pipelineBindCount   = 0;
+        uint32_t            descriptorBindCount = 0;
+        uint32_t            geometryBindCount   = 0;
+        VkDeviceSize        indirectBytes       = 0;    //written into the target by this emit
+    };
+
+    void                clear(void); //keeps the memory around
+    void                reserve(uint32_t packetCount);
+
+    void                submit(const DrawPacket& packet);
+    void                sort(void); //emit() sorts if needed, this is just to do it somewhere else
+
+    // Emits everything into a recording command buffer (or a stream replayed into one).
+    // The render pass and any dynamic state are up to the caller.
+    void                emit(CommandBuffer* pCmdBuffer, IndirectTarget* pIndirect=nullptr);
+    void                emit(CommandStream* pStream, IndirectTarget* pIndirect=nullptr);
+
+    uint32_t            getPacketCount(void) const;
+    bool                isEmpty(void) const;
+    const Statistics&   getStatistics(void) const; //of the last emit()
+
+    void                log(DebugLog* pLog) const;
+
+private:
+    struct Entry {
+        DrawPacket          packet;
+        uint64_t            stateHash;      //everything but the draw arguments and sort bits
+        uint32_t            pushOffset;     //into m_pushData
+    };
+
+    struct Draw {
+        uint32_t            entry;
+        uint32_t            instanceCount;
+    };
+
+    uint16_t            getId(std::unordered_map<uint64_t, uint16_t>& ids, uint64_t hash);
+    bool                isSameState(const Entry& lhs, const Entry& rhs) const;
+
+    template<typename Recorder>
+    void                emitTo(Recorder* pRecorder, IndirectTarget* pIndirect);
+
+    std::vector<Entry>                      m_entries;
+    std::vector<uint8_t>                    m_pushData;
+    std::vector<uint64_t>                   m_keys;
+    std::vector<uint32_t>                   m_order;
+    std::vector<uint64_t>                   m_sortKeys[2]; //radix sort scratch
+    std::vector<uint32_t>                   m_sortOrder[2];
+    std::vector<Draw>                       m_run;
+    std::unordered_map<uint64_t, uint16_t>  m_pipelineIds;
+    std::unordered_map<uint64_t, uint16_t>  m_descriptorIds;
+    std::unordered_map<uint64_t, uint16_t>  m_geometryIds;
+    bool                                    m_sorted        = true;
+    Statistics                              m_statistics;
+};
+
+inline uint32_t DrawQueue::getPacketCount(void) const { return static_cast<uint32_t>(m_entries.size()); }
+inline bool DrawQueue::isEmpty(void) const { return m_entries.empty(); }
+inline auto DrawQueue::getStatistics(void) const -> const Statistics& { return m_statistics; }
+
+}
+
+#endif // ELYSIAN_RENDERER_DRAW_QUEUE_HPP
@@ -63,11 +63,11 @@ inline Framebuffer::Framebuffer(Initializer initializer):
     m_pDevice(initializer.pDevice),
     m_pInfo(std::move(initializer.pInfo))
 {
-    m_result = vkCreateFramebuffer(m_pDevice, m_pInfo.get(), nullptr, &m_handle);
+    m_result = vkCreateFramebuffer(m_pDevice->getHandle(), m_pInfo.get(), m_pDevice->getAllocationCallbacks(), &m_handle);
 }
 
 inline Framebuffer::~Framebuffer(void) {
-    vkDestroyFramebuffer(m_pDevice, getHandle(), nullptr);
+    vkDestroyFramebuffer(m_pDevice->getHandle(), getHandle(), m_pDevice->getAllocationCallbacks());
 }
 
 inline Result Framebuffer::getResult(void) const { return m_result; }
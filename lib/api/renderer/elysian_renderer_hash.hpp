@@ -0,0 +1,52 @@
+#ifndef ELYSIAN_RENDERER_HASH_HPP
+#define ELYSIAN_RENDERER_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace elysian::renderer {
+
+// 64 bit FNV-1a, cheap and good enough for content keys (command streams, create infos).
+// Anything hashed bytewise shouldn't have padding, hash those field by field instead.
+constexpr uint64_t kHashSeed    = 0xcbf29ce484222325ull;
+constexpr uint64_t kHashPrime   = 0x100000001b3ull;
+
+inline uint64_t hashBytes(const void* pData, size_t size, uint64_t hash=kHashSeed) {
+    const auto* pBytes = static_cast<const uint8_t*>(pData);
+    for(size_t b = 0; b < size; ++b) {
+        hash ^= pBytes[b];
+        hash *= kHashPrime;
+    }
+    return hash;
+}
+
+template<typename T>
+inline uint64_t hashValue(const T& value, uint64_t hash=kHashSeed) {
+    static_assert(std::is_trivially_copyable_v<T>, "hash non-trivial types field by field");
+    return hashBytes(&value, sizeof(T), hash);
+}
+
+template<typename T>
+inline uint64_t hashArray(const T* pValues, size_t count, uint64_t hash=kHashSeed) {
+    static_assert(std::is_trivially_copyable_v<T>, "hash non-trivial types field by field");
+    hash = hashValue(count, hash);
+    return pValues? hashBytes(pValues, sizeof(T) * count, hash) : hash;
+}
+
+inline uint64_t hashString(const char* pString, uint64_t hash=kHashSeed) {
+    if(!pString) return hash;
+    for(; *pString; ++pString) {
+        hash ^= static_cast<uint8_t>(*pString);
+        hash *= kHashPrime;
+    }
+    return hash;
+}
+
+inline uint64_t hashCombine(uint64_t hash, uint64_t value) {
+    return hashValue(value, hash);
+}
+
+}
+
+#endif // ELYSIAN_RENDERER_HASH_HPP
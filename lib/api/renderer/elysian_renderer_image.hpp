@@ -1,6 +1,9 @@
 #ifndef ELYSIAN_RENDERER_IMAGE_HPP
 #define ELYSIAN_RENDERER_IMAGE_HPP
 
+#include "elysian_renderer_memory.hpp"
+#include "elysian_renderer_vma.hpp"
+
 namespace elysian::renderer {
 
 class Image {
@@ -46,6 +49,9 @@ public:
         std::shared_ptr<const CreateInfo>
                         pInfo;
         const Device*   pDevice;
+        //OPTIONAL: creates, allocates and binds memory in one shot
+        const VmaBackend*                   pVmaBackend = nullptr;
+        VmaBackend::AllocationCreateInfo    vmaInfo;
     };
 
                 Image(Initializer initializer);
@@ -62,7 +68,9 @@ public:
     auto        getMemoryOffset(void) const -> VkDeviceSize;
 
     auto        getMemoryRequirements(void) const -> VkMemoryRequirements;
-    VkResult    bindDeviceMemory(std::shared_ptr<DeviceMemory> pMemory, VkDeviceSize offset=0) const;
+    VkResult    bindDeviceMemory(std::shared_ptr<DeviceMemory> pMemory, VkDeviceSize offset=0);
+
+    auto        getVmaAllocation(void) const -> const VmaBackend::Allocation&;
 
 
 private:
@@ -72,7 +80,9 @@ private:
     std::shared_ptr<const CreateInfo>
                     m_pInfo = nullptr;
     std::shared_ptr<DeviceMemory> m_pMemory;
-    VkDeviceSize    m_offset;
+    VkDeviceSize    m_offset = 0;
+    const VmaBackend*       m_pVmaBackend = nullptr;
+    VmaBackend::Allocation  m_vmaAllocation;
     Result          m_result;
 
 };
@@ -242,11 +252,11 @@ inline Sampler::Sampler(Initializer initializer):
     m_pInfo(std::move(initializer.pInfo)),
     m_pDevice(initializer.pDevice)
 {
-    m_result = vkCreateSampler(m_pDevice, m_pInfo.get(), nullptr, &m_handle);
+    m_result = vkCreateSampler(m_pDevice->getHandle(), m_pInfo.get(), m_pDevice->getAllocationCallbacks(), &m_handle);
 }
 
 inline Sampler::~Sampler(void) {
-    vkDestroySampler(m_pDevice, getHandle(), nullptr);
+    vkDestroySampler(m_pDevice->getHandle(), getHandle(), m_pDevice->getAllocationCallbacks());
 }
 
 inline Sampler::operator VkSampler() const { return getHandle(); }
@@ -260,11 +270,11 @@ inline ImageView::ImageView(Initializer initializer):
     m_pInfo(std::move(initializer.pInfo)),
     m_pDevice(initializer.pDevice)
 {
-    m_result = vkCreateImageView(m_pDevice, &viewInfo, nullptr, &m_handle);
+    m_result = vkCreateImageView(m_pDevice->getHandle(), m_pInfo.get(), m_pDevice->getAllocationCallbacks(), &m_handle);
 }
 
 inline ImageView::~ImageView(void) {
-    vkDestroyImageView(m_pDevice, getHandle(), nullptr);
+    vkDestroyImageView(m_pDevice->getHandle(), getHandle(), m_pDevice->getAllocationCallbacks());
 }
 
 inline ImageView::operator VkImageView() const { return getHandle(); }
@@ -277,16 +287,28 @@ inline bool ImageView::isValid(void) const { return getResult() && getHandle() !
 inline Image::Image(Initializer initializer):
     m_name(std::move(initializer.name)),
     m_pInfo(std::move(initializer.pInfo)),
-    m_pDevice(initializer.pDevice)
+    m_pDevice(initializer.pDevice),
+    m_pVmaBackend(initializer.pVmaBackend)
 {
-    std::assert(m_pDevice);
-    m_reuslt = vkCreateImage(m_pDevice, m_pInfo.get(), nullptr, &m_handle);
+    assert(m_pDevice);
+    if(m_pVmaBackend) {
+        m_result = m_pVmaBackend->createImage(*m_pInfo, initializer.vmaInfo, &m_handle, &m_vmaAllocation);
+        m_offset = m_vmaAllocation.offset;
+    } else {
+        m_result = vkCreateImage(m_pDevice->getHandle(), m_pInfo.get(), m_pDevice->getAllocationCallbacks(), &m_handle);
+    }
 }
 
 inline Image::~Image(void) {
-    vkDestroyImage(m_pDevice, getHandle(), nullptr);
+    if(m_vmaAllocation.isValid()) {
+        m_pVmaBackend->destroyImage(getHandle(), m_vmaAllocation);
+    } else {
+        vkDestroyImage(m_pDevice->getHandle(), getHandle(), m_pDevice->getAllocationCallbacks());
+    }
 }
 
+inline auto Image::getVmaAllocation(void) const -> const VmaBackend::Allocation& { return m_vmaAllocation; }
+
 inline Image::operator VkImage() const { return getHandle(); }
 inline const char* Image::getName(void) const { return m_name.c_cstr(); }
 inline Result Image::getResult(void) const { return m_result; }
@@ -297,14 +319,15 @@ inline VkDeviceSize Image::getMemoryOffset(void) const { return m_offset; }
 
 inline VkMemoryRequirements Image::getMemoryRequirements(void) const {
     VkMemoryRequirements req;
-    vkGetImageMemoryRequirements(m_pDevice, getHandle(), &req);
+    vkGetImageMemoryRequirements(m_pDevice->getHandle(), getHandle(), &req);
     return req;
 }
 
-VkResult Image::bindDeviceMemory(std::shared_ptr<DeviceMemory> pMemory, VkDeviceSize offset) const {
+inline VkResult Image::bindDeviceMemory(std::shared_ptr<DeviceMemory> pMemory, VkDeviceSize offset) {
+    assert(!m_vmaAllocation.isValid()); //VMA already bound it
     m_pMemory = std::move(pMemory);
     m_offset = offset;
-    return vkBindImageMemory(m_pDevice, getHandle(), m_pMemory.get()->getHandle(), m_offset);
+    return vkBindImageMemory(m_pDevice->getHandle(), getHandle(), m_pMemory.get()->getHandle(), m_offset);
 }
 
 
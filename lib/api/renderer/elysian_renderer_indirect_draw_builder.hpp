@@ -0,0 +1,149 @@
+#ifndef ELYSIAN_RENDERER_INDIRECT_DRAW_BUILDER_HPP
+#define ELYSIAN_RENDERER_INDIRECT_DRAW_BUILDER_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "elysian_renderer_buffer.hpp"
+
+namespace elysian::renderer {
+
+class CommandBuffer;
+class DrawQueue;
+class Fence;
+
+// Packs indirect draw arguments into one persistently mapped buffer, split into per-frame
+// regions the same way StagingRing is. Batches are either filled on the CPU through their
+// mapped pointer or reserved for a compute pass (cmdCull()) that writes the commands and a
+// draw count on the GPU. Either way a batch goes out as a single indirect draw.
+//
+// Per frame:
+//      builder.beginFrame();                           //before resetting this frame's fence!
+//      auto batch = builder.allocateCulled(objectCount);
+//      builder.cmdCull(pCmdBuffer, batch, cull);       //outside the render pass
+//      ...begin render pass, bind...
+//      builder.cmdDraw(pCmdBuffer, batch);
+//      builder.flush();
+//      ...submit with pFence...
+//      builder.endFrame(pFence);                       //only once the submission went through
+class IndirectDrawBuilder {
+public:
+
+    struct Initializer {
+        std::string     name;
+        const Device*   pDevice             = nullptr;
+        uint32_t        frameCount          = 3;
+        VkDeviceSize    frameSize           = 1024 * 1024;
+        // whatever was enabled on the device, not what it supports
+        bool            multiDrawIndirect   = false;
+        bool            drawIndirectCount   = false;
+    };
+
+    struct Batch {
+        VkDrawIndexedIndirectCommand*   pCommands   = nullptr;  //host pointer to write through
+        VkBuffer                        buffer      = VK_NULL_HANDLE;
+        VkDeviceSize                    offset      = 0;        //of the first command
+        VkDeviceSize                    countOffset = 0;        //uint32_t draw count, culled batches only
+        uint32_t                        drawCount   = 0;        //upper bound for culled batches
+        bool                            culled      = false;
+
+        bool isValid(void) const { return pCommands != nullptr; }
+    };
+
+    // Compute pass writing a culled batch. The shader gets the batch through
+    // getCommandBufferInfo()/getCountBufferInfo() in one of the sets, appends surviving
+    // draws with an atomicAdd on the count and never touches more than drawCount slots.
+    struct CullDispatch {
+        VkPipeline              pipeline            = VK_NULL_HANDLE;
+        VkPipelineLayout        layout              = VK_NULL_HANDLE;
+        uint32_t                firstSet            = 0;
+        uint32_t                descriptorSetCount  = 0;
+        const VkDescriptorSet*  pDescriptorSets     = nullptr;
+        uint32_t                pushConstantSize    = 0;
+        const void*             pPushConstants      = nullptr;
+        uint32_t                groupCountX         = 1;
+        uint32_t                groupCountY         = 1;
+        uint32_t                groupCountZ         = 1;
+    };
+
+    struct Statistics {
+        uint32_t        batchCount          = 0;
+        uint32_t        commandCount        = 0;    //slots handed out
+        uint32_t        indirectCallCount   = 0;
+        VkDeviceSize    usedSize            = 0;
+    };
+
+                    IndirectDrawBuilder(Initializer initializer);
+                    ~IndirectDrawBuilder(void);
+
+    const char*     getName(void) const;
+    Result          getResult(void) const;
+    bool            isValid(void) const;
+
+    uint32_t        getFrameIndex(void) const;
+    VkDeviceSize    getFrameSize(void) const;
+    const Buffer*   getBuffer(void) const;
+    const Statistics& getStatistics(void) const; //of the current frame
+
+    // moves on to the next region, blocking until its last submission is done with it
+    Result          beginFrame(uint64_t timeout=UINT64_MAX);
+    // makes this frame's host writes visible to the device, before submitting
+    Result          flush(void);
+    // ties the region to the fence its draws were submitted with
+    void            endFrame(const Fence* pFence);
+
+    // invalid when the frame's region is full
+    Batch           allocate(uint32_t drawCount);
+    Batch           add(const VkDrawIndexedIndirectCommand* pCommands, uint32_t drawCount);
+    // zeroed count and commands, so slots the GPU doesn't write draw nothing
+    Batch           allocateCulled(uint32_t maxDrawCount);
+
+    VkDescriptorBufferInfo getCommandBufferInfo(const Batch& batch) const;
+    VkDescriptorBufferInfo getCountBufferInfo(const Batch& batch) const;
+
+    // Records the cull dispatch, then (unless told not to, to batch several) the barrier
+    // making its writes visible to indirect draws. Not inside a render pass.
+    void            cmdCull(CommandBuffer* pCmdBuffer, const Batch& batch, const CullDispatch& dispatch, bool barrier=true) const;
+    void            cmdCullBarrier(CommandBuffer* pCmdBuffer) const;
+
+    // With drawIndirectCount a culled batch only draws what the GPU counted, without it
+    // every slot is drawn and culled ones are empty. Split up as the device requires.
+    void            cmdDraw(CommandBuffer* pCmdBuffer, const Batch& batch);
+
+    // Lets the queue write its merged runs into what's left of this frame's region.
+    void            emit(DrawQueue* pQueue, CommandBuffer* pCmdBuffer);
+
+private:
+    struct Frame {
+        VkDeviceSize    usedSize    = 0;
+        const Fence*    pFence      = nullptr;
+    };
+
+    VkDeviceSize    reserve(VkDeviceSize size, VkDeviceSize alignment); //~0 when full
+
+    Initializer                     m_initializer;
+    std::unique_ptr<Buffer>         m_pBuffer;
+    std::shared_ptr<DeviceMemory>   m_pMemory;
+    char*                           m_pMappedData       = nullptr;
+    std::vector<Frame>              m_frames;
+    uint32_t                        m_frameIndex        = 0;
+    VkDeviceSize                    m_storageAlignment  = 16;
+    VkDeviceSize                    m_atomSize          = 1;
+    uint32_t                        m_maxDrawCount      = 1;    //per indirect call
+    uint32_t                        m_drawIndirectCountLimit = 1;
+    bool                            m_coherent          = true;
+    Statistics                      m_statistics;
+    Result                          m_result;
+};
+
+inline const char* IndirectDrawBuilder::getName(void) const { return m_initializer.name.c_str(); }
+inline Result IndirectDrawBuilder::getResult(void) const { return m_result; }
+inline bool IndirectDrawBuilder::isValid(void) const { return getResult() && m_pMappedData; }
+inline uint32_t IndirectDrawBuilder::getFrameIndex(void) const { return m_frameIndex; }
+inline VkDeviceSize IndirectDrawBuilder::getFrameSize(void) const { return m_initializer.frameSize; }
+inline const Buffer* IndirectDrawBuilder::getBuffer(void) const { return m_pBuffer.get(); }
+inline auto IndirectDrawBuilder::getStatistics(void) const -> const Statistics& { return m_statistics; }
+
+}
+
+#endif // ELYSIAN_RENDERER_INDIRECT_DRAW_BUILDER_HPP
@@ -110,6 +110,8 @@ public:
 
     PFN_vkVoidFunction getProcAddr(const char* pName) const;
 
+    const VkAllocationCallbacks* getAllocationCallbacks(void) const;
+
 protected:
     Instance(const InstanceCreateInfo& info, Renderer& renderer);
 
@@ -2,6 +2,7 @@
 #define ELYSIAN_RENDERER_MEMORY_HPP
 
 #include "elysian_renderer_object.hpp"
+#include "elysian_renderer_device.hpp"
 
 namespace elysian::renderer {
 
@@ -21,8 +22,8 @@ class DeviceMemory: public HandleObject<VkDeviceMemory, VK_OBJECT_TYPE_DEVICE_ME
 public:
 
     struct Initializer {
-        AllocateInfo    info;
-        const Device*   pDevice;
+        DeviceMemoryAllocateInfo    info;
+        const Device*               pDevice;
     };
 
                    DeviceMemory(Initializer initializer);
@@ -42,6 +43,11 @@ public:
 
     void           unmapMemory(void) const;
 
+    // only needed for memory without VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    // ranges have to be aligned to nonCoherentAtomSize
+    Result         flush(VkDeviceSize offset=0, VkDeviceSize size=VK_WHOLE_SIZE) const;
+    Result         invalidate(VkDeviceSize offset=0, VkDeviceSize size=VK_WHOLE_SIZE) const;
+
 private:
     Initializer     m_initializer;
     Result          m_result;
@@ -51,31 +57,55 @@ private:
 inline DeviceMemory::DeviceMemory(Initializer Initializer):
     m_initializer(std::move(Initializer))
 {
-    m_result = vkAllocateMemory(m_initializer.pDevice,
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    m_result = vkAllocateMemory(m_initializer.pDevice->getHandle(),
                                 &m_initializer.info,
-                                nullptr,
-                                &m_handle);
+                                m_initializer.pDevice->getAllocationCallbacks(),
+                                &memory);
+    setHandle(memory);
 }
 
 inline DeviceMemory::~DeviceMemory(void) {
-    vkFreeMemory(m_initializer.pDevice, getHandle(), nullptr);
+    vkFreeMemory(m_initializer.pDevice->getHandle(), getHandle(), m_initializer.pDevice->getAllocationCallbacks());
 }
 
 inline Result DeviceMemory::getResult(void) const { return m_result; }
 inline uint32_t DeviceMemory::getMemoryTypeIndex(void) const { return m_initializer.info.memoryTypeIndex; }
-inline VkDeviceSize DeviceMemory::getAllocationSize(void) const { return m_initializer.info.memoryAllocSize; }
+inline VkDeviceSize DeviceMemory::getAllocationSize(void) const { return m_initializer.info.allocationSize; }
 inline VkDeviceSize DeviceMemory::getMemoryCommitment(void) const {
     VkDeviceSize size = 0;
-    vkGetDeviceMemoryCommitment(m_initializer.pDevice, getHandle(), &size);
+    vkGetDeviceMemoryCommitment(m_initializer.pDevice->getHandle(), getHandle(), &size);
     return size;
 }
 
-inline DeviceMemory::mapMemory(VkDeviceSize offset, VkDeviceSize size, VkMemoryMapFlags flags, void **ppData) const {
-    return vkMapMemory(m_initializer.pDevice, getHandle(), offset, size, flags, ppData);
+inline Result DeviceMemory::mapMemory(VkDeviceSize offset, VkDeviceSize size, VkMemoryMapFlags flags, void **ppData) const {
+    return vkMapMemory(m_initializer.pDevice->getHandle(), getHandle(), offset, size, flags, ppData);
+}
+
+inline void DeviceMemory::unmapMemory(void) const {
+    vkUnmapMemory(m_initializer.pDevice->getHandle(), getHandle());
 }
 
-inline DeviceMemory::unmapMemory(void) const {
-    vkUnmapMemory(m_initializer.pDevice, getHandle());
+inline Result DeviceMemory::flush(VkDeviceSize offset, VkDeviceSize size) const {
+    const auto range = VkMappedMemoryRange {
+        VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+        nullptr,
+        getHandle(),
+        offset,
+        size
+    };
+    return vkFlushMappedMemoryRanges(m_initializer.pDevice->getHandle(), 1, &range);
+}
+
+inline Result DeviceMemory::invalidate(VkDeviceSize offset, VkDeviceSize size) const {
+    const auto range = VkMappedMemoryRange {
+        VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+        nullptr,
+        getHandle(),
+        offset,
+        size
+    };
+    return vkInvalidateMappedMemoryRanges(m_initializer.pDevice->getHandle(), 1, &range);
 }
 
 
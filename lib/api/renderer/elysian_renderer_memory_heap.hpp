@@ -0,0 +1,245 @@
+#ifndef ELYSIAN_RENDERER_MEMORY_HEAP_HPP
+#define ELYSIAN_RENDERER_MEMORY_HEAP_HPP
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "elysian_renderer_memory.hpp"
+
+namespace elysian::renderer {
+
+class Device;
+class DebugLog;
+
+// Carves aligned sub-ranges out of one contiguous range of device memory.
+// Pure CPU bookkeeping, never touches Vulkan, so it can be driven standalone.
+class DeviceMemorySubAllocator {
+public:
+    static constexpr VkDeviceSize kInvalidOffset = ~VkDeviceSize(0);
+
+    struct Statistics {
+        VkDeviceSize    size                = 0;
+        VkDeviceSize    usedSize            = 0;
+        VkDeviceSize    largestFreeRange    = 0;
+        uint32_t        allocationCount     = 0;
+        uint32_t        freeRangeCount      = 0;
+    };
+
+    virtual                 ~DeviceMemorySubAllocator(void) = default;
+
+    // returns kInvalidOffset when the range can't fit the request
+    virtual VkDeviceSize    allocate(VkDeviceSize size, VkDeviceSize alignment) = 0;
+    virtual void            free(VkDeviceSize offset) = 0;
+
+    virtual Statistics      getStatistics(void) const = 0;
+    virtual bool            isEmpty(void) const = 0;
+};
+
+// Two-Level Segregated Fit: O(1) allocate/free with good fragmentation behavior
+// for mixed sizes.
+class TlsfSubAllocator: public DeviceMemorySubAllocator {
+public:
+                            TlsfSubAllocator(VkDeviceSize size);
+
+    virtual VkDeviceSize    allocate(VkDeviceSize size, VkDeviceSize alignment) override;
+    virtual void            free(VkDeviceSize offset) override;
+
+    virtual Statistics      getStatistics(void) const override;
+    virtual bool            isEmpty(void) const override;
+
+private:
+    static constexpr uint32_t       kSlLog2         = 4;
+    static constexpr uint32_t       kSlCount        = 1u << kSlLog2;
+    static constexpr uint32_t       kFlCount        = 64 - kSlLog2 + 1;
+    static constexpr VkDeviceSize   kGranularity    = 16;
+    static constexpr uint32_t       kNil            = ~0u;
+
+    struct Range {
+        VkDeviceSize    offset      = 0;
+        VkDeviceSize    size        = 0;
+        uint32_t        prevPhys    = kNil;
+        uint32_t        nextPhys    = kNil;
+        uint32_t        prevFree    = kNil;
+        uint32_t        nextFree    = kNil;
+        bool            isFree      = false;
+    };
+
+    static void             mapping(VkDeviceSize size, uint32_t* pFl, uint32_t* pSl);
+    uint32_t                findFree(VkDeviceSize size) const;
+    uint32_t                newRange(void);
+    void                    releaseRange(uint32_t index);
+    void                    insertFree(uint32_t index);
+    void                    removeFree(uint32_t index);
+    uint32_t                split(uint32_t index, VkDeviceSize size);
+    void                    merge(uint32_t index, uint32_t next);
+
+    std::vector<Range>      m_ranges;
+    std::vector<uint32_t>   m_unusedRanges;
+    std::unordered_map<VkDeviceSize, uint32_t>
+                            m_allocations;
+    uint64_t                m_flBitmap          = 0;
+    uint32_t                m_slBitmaps[kFlCount] = {};
+    uint32_t                m_freeHeads[kFlCount][kSlCount];
+    VkDeviceSize            m_size              = 0;
+    VkDeviceSize            m_usedSize          = 0;
+    uint32_t                m_freeRangeCount    = 0;
+};
+
+// Binary buddy system: power-of-two ranges which are naturally aligned to their size.
+// Cheaper bookkeeping than TLSF at the cost of internal fragmentation.
+class BuddySubAllocator: public DeviceMemorySubAllocator {
+public:
+                            BuddySubAllocator(VkDeviceSize size);
+
+    virtual VkDeviceSize    allocate(VkDeviceSize size, VkDeviceSize alignment) override;
+    virtual void            free(VkDeviceSize offset) override;
+
+    virtual Statistics      getStatistics(void) const override;
+    virtual bool            isEmpty(void) const override;
+
+private:
+    static constexpr uint32_t   kMinOrder = 8; //256 bytes
+
+    std::vector<std::unordered_set<VkDeviceSize>>
+                                m_freeLists;
+    std::unordered_map<VkDeviceSize, uint32_t>
+                                m_allocations;
+    uint32_t                    m_maxOrder      = kMinOrder;
+    VkDeviceSize                m_size          = 0;
+    VkDeviceSize                m_usedSize      = 0;
+};
+
+// Grabs big VkDeviceMemory blocks per memory type and sub-allocates resources out of them,
+// so we stay well below maxMemoryAllocationCount and off the vkAllocateMemory slow path.
+// Bind the result with Buffer/Image::bindDeviceMemory(allocation.pMemory, allocation.offset).
+//
+// Constructing without a Device simulates the heap entirely on the CPU, which is what
+// simulate() uses to measure allocator throughput without a GPU.
+class DeviceMemoryHeap {
+public:
+
+    enum class Strategy: uint8_t {
+        Tlsf,
+        Buddy
+    };
+
+    struct Initializer {
+        std::string     name;
+        const Device*   pDevice                 = nullptr; //nullptr simulates on the CPU
+        Strategy        strategy                = Strategy::Tlsf;
+        VkDeviceSize    blockSize               = 64 * 1024 * 1024;
+        VkDeviceSize    bufferImageGranularity  = 0;       //0 pulls it from the device limits
+        const VkPhysicalDeviceMemoryProperties*
+                        pMemoryProperties       = nullptr; //nullptr pulls them from the device
+    };
+
+    struct Allocation {
+        std::shared_ptr<DeviceMemory>   pMemory;           //nullptr when simulated
+        VkDeviceSize                    offset          = 0;
+        VkDeviceSize                    size            = 0;
+        uint32_t                        memoryTypeIndex = ~0u;
+        uint32_t                        blockId         = ~0u;
+
+        bool isValid(void) const { return size != 0; }
+    };
+
+    struct Statistics {
+        VkDeviceSize    reservedSize        = 0; //sum of VkDeviceMemory blocks
+        VkDeviceSize    usedSize            = 0; //sum of live sub-allocations
+        VkDeviceSize    largestFreeRange    = 0;
+        uint32_t        blockCount          = 0;
+        uint32_t        allocationCount     = 0;
+        uint32_t        freeRangeCount      = 0;
+
+        float           getUtilization(void) const;
+        float           getFragmentation(void) const;   // 1 - largestFree/totalFree
+    };
+
+    struct SimulationSettings {
+        uint32_t        operationCount  = 100000;
+        VkDeviceSize    minSize         = 256;
+        VkDeviceSize    maxSize         = 4 * 1024 * 1024;
+        VkDeviceSize    maxAlignment    = 4096;
+        float           freeChance      = 0.45f;
+        uint32_t        memoryTypeBits  = 0x1;
+        uint32_t        seed            = 0;
+    };
+
+    struct SimulationResult {
+        uint64_t        allocations         = 0;
+        uint64_t        frees               = 0;
+        uint64_t        failures            = 0;
+        double          seconds             = 0.0;
+        double          operationsPerSecond = 0.0;
+        bool            consistent          = true;  //no overlapping or misaligned ranges
+        Statistics      statistics;
+    };
+
+                            DeviceMemoryHeap(Initializer initializer);
+                            ~DeviceMemoryHeap(void);
+
+    const char*             getName(void) const;
+    bool                    isSimulated(void) const;
+    auto                    getMemoryProperties(void) const -> const VkPhysicalDeviceMemoryProperties&;
+
+    // first memory type allowed by typeBits which has all of the required flags, ~0u if none
+    uint32_t                findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags requiredFlags) const;
+
+    // linear = buffers and linear-tiled images, false = optimal-tiled images
+    Result                  allocate(const VkMemoryRequirements& requirements,
+                                     VkMemoryPropertyFlags      requiredFlags,
+                                     Allocation*                pAllocation,
+                                     bool                       linear=true);
+    void                    free(Allocation& allocation);
+
+    Statistics              getStatistics(void) const;
+    Statistics              getStatistics(uint32_t memoryTypeIndex) const;
+
+    void                    log(DebugLog* pLog) const;
+
+    static SimulationResult simulate(Initializer initializer, const SimulationSettings& settings);
+
+private:
+    struct Block {
+        std::shared_ptr<DeviceMemory>               pMemory;
+        std::unique_ptr<DeviceMemorySubAllocator>   pAllocator;
+        VkDeviceSize                                size        = 0;
+        uint32_t                                    id          = 0;
+        bool                                        dedicated   = false; //one allocation, freed with it
+    };
+
+    struct MemoryType {
+        std::vector<Block> blocks;
+    };
+
+    Result                  createBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated, Block* pBlock);
+    Statistics              gatherStatistics(const MemoryType& type) const;
+
+    Initializer                         m_initializer;
+    VkPhysicalDeviceMemoryProperties    m_memoryProperties;
+    std::vector<MemoryType>             m_memoryTypes;
+    uint32_t                            m_nextBlockId   = 0;
+    mutable std::mutex                  m_mutex;
+};
+
+inline const char* DeviceMemoryHeap::getName(void) const { return m_initializer.name.c_str(); }
+inline bool DeviceMemoryHeap::isSimulated(void) const { return !m_initializer.pDevice; }
+inline auto DeviceMemoryHeap::getMemoryProperties(void) const -> const VkPhysicalDeviceMemoryProperties& {
+    return m_memoryProperties;
+}
+
+inline float DeviceMemoryHeap::Statistics::getUtilization(void) const {
+    return reservedSize? static_cast<float>(usedSize) / static_cast<float>(reservedSize) : 0.0f;
+}
+
+inline float DeviceMemoryHeap::Statistics::getFragmentation(void) const {
+    const VkDeviceSize freeSize = reservedSize - usedSize;
+    return freeSize? 1.0f - static_cast<float>(largestFreeRange) / static_cast<float>(freeSize) : 0.0f;
+}
+
+}
+
+#endif // ELYSIAN_RENDERER_MEMORY_HEAP_HPP
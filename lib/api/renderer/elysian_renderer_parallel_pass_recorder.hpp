@@ -0,0 +1,75 @@
+#ifndef ELYSIAN_RENDERER_PARALLEL_PASS_RECORDER_HPP
+#define ELYSIAN_RENDERER_PARALLEL_PASS_RECORDER_HPP
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "elysian_renderer_command.hpp"
+
+namespace elysian::renderer {
+
+class CommandPoolManager;
+class WorkerPool;
+
+// Splits the items of a render pass (or of a compute/transfer batch) into K chunks, records
+// each chunk into its own secondary command buffer on a WorkerPool and executes them into the
+// primary in chunk order, so the result doesn't depend on which worker finished first.
+//
+// Secondaries come from the CommandPoolManager of the recording thread and are recorded with
+// ONE_TIME_SUBMIT into exactly one primary, which sidesteps the SIMULTANEOUS_USE invalidation
+// rules entirely.
+class ParallelPassRecorder {
+public:
+
+    struct Initializer {
+        std::string             name;
+        CommandPoolManager*     pPoolManager        = nullptr;
+        WorkerPool*             pWorkers            = nullptr;
+        uint32_t                queueFamilyIndex    = 0;
+    };
+
+    // what the secondaries inherit, renderPass = VK_NULL_HANDLE records outside of a render pass
+    struct PassInfo {
+        VkRenderPass                    renderPass              = VK_NULL_HANDLE;
+        uint32_t                        subpass                 = 0;
+        VkFramebuffer                   framebuffer             = VK_NULL_HANDLE; //optional, but helps some drivers
+        VkBool32                        occlusionQueryEnable    = VK_FALSE;
+        VkQueryControlFlags             queryFlags              = 0;
+        VkQueryPipelineStatisticFlags   pipelineStatistics      = 0;
+    };
+
+    // records items [first, first + count) into pCmdBuffer, called concurrently for different chunks
+    using RecordFunction = std::function<void(CommandBuffer* pCmdBuffer, uint32_t chunk, uint32_t first, uint32_t count)>;
+
+    struct Statistics {
+        uint32_t    chunkCount  = 0;
+        uint32_t    itemCount   = 0;
+        double      seconds     = 0.0; //wall time of the last record()
+    };
+
+                        ParallelPassRecorder(Initializer initializer);
+
+    const char*         getName(void) const;
+    const Statistics&   getStatistics(void) const;
+
+    // pPrimary has to be recording, and inside pass.renderPass begun with
+    // VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS when there is one.
+    // chunkCount = 0 makes one chunk per worker plus one for the calling thread.
+    Result              record(CommandBuffer*           pPrimary,
+                               const PassInfo&          pass,
+                               uint32_t                 itemCount,
+                               uint32_t                 chunkCount,
+                               const RecordFunction&    recordFunction);
+
+private:
+    Initializer                         m_initializer;
+    std::vector<const CommandBuffer*>   m_secondaries;
+    Statistics                          m_statistics;
+};
+
+inline const char* ParallelPassRecorder::getName(void) const { return m_initializer.name.c_str(); }
+inline auto ParallelPassRecorder::getStatistics(void) const -> const Statistics& { return m_statistics; }
+
+}
+
+#endif // ELYSIAN_RENDERER_PARALLEL_PASS_RECORDER_HPP
@@ -61,6 +61,11 @@ private:
 };
 
 inline const VkPhysicalDeviceProperties& PhysicalDevice::getProperties(void) const { return m_properties; }
+inline const VkPhysicalDeviceFeatures& PhysicalDevice::getFeatures(void) const { return m_features; }
+inline const VkPhysicalDeviceMemoryProperties& PhysicalDevice::getMemoryProperties(void) const { return m_memoryProperties; }
+inline auto PhysicalDevice::getQueueFamilyProperties(void) const -> const std::vector<VkQueueFamilyProperties>& {
+    return m_queueFamilyProperties;
+}
 
 
 }
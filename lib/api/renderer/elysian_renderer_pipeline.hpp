@@ -2,30 +2,11 @@
 #define ELYSIAN_RENDERER_PIPELINE_HPP
 
 #include "elysian_renderer_render_pass.hpp"
+#include "elysian_renderer_pipeline_cache.hpp"
+#include "elysian_renderer_pipeline_statistics.hpp"
 
 namespace elysian::renderer::pipeline {
 
-#if 0
-VkResult vkGetPipelineExecutablePropertiesKHR(
-    VkDevice                                    device,
-    const VkPipelineInfoKHR*                    pPipelineInfo,
-    uint32_t*                                   pExecutableCount,
-    VkPipelineExecutablePropertiesKHR*          pProperties);
-
-VkResult vkGetPipelineExecutableStatisticsKHR(
-    VkDevice                                    device,
-    const VkPipelineExecutableInfoKHR*          pExecutableInfo,
-    uint32_t*                                   pStatisticCount,
-    VkPipelineExecutableStatisticKHR*           pStatistics);
-
-VkResult vkGetPipelineExecutableInternalRepresentationsKHR(
-    VkDevice                                    device,
-    const VkPipelineExecutableInfoKHR*          pExecutableInfo,
-    uint32_t*                                   pInternalRepresentationCount,
-    VkPipelineExecutableInternalRepresentationKHR* pInternalRepresentations);
-
-#endif
-
 class VertexInputBindingDescription: public VkVertexInputBindingDescription {
 public:
     constexpr static const uint32_t kAutoBinding = 0xffffffff;
@@ -324,11 +305,23 @@ public:
     {}
 
     const char* getName(void) const;
+
+    // per executable register/spill/instruction counts, see getPipelineExecutableStatistics()
+    Result      getExecutableStatistics(std::vector<PipelineExecutableStatistics>* pExecutables) const;
+
+protected:
+    virtual const Device*   getPipelineDevice(void) const = 0;
+    virtual VkPipeline      getPipelineHandle(void) const = 0;
+
 private:
 
     std::string        m_name;
 };
 
+inline Result Pipeline::getExecutableStatistics(std::vector<PipelineExecutableStatistics>* pExecutables) const {
+    return getPipelineExecutableStatistics(getPipelineDevice(), getPipelineHandle(), pExecutables);
+}
+
 //layout should be a shared pointer or some shit so other pipelines can use it!
 class GraphicsPipeline: public Pipeline {
 public:
@@ -408,7 +401,6 @@ public:
         CreateInfo      info;
         Device*         pDevice;
         PipelineCache*  pPipelineCache = nullptr;
-        Allocator*      pAllocator     = nullptr;
     };
 
                               GraphicsPipeline(Initializer initializer);
@@ -432,6 +424,10 @@ public:
     Result                    getResult(void) const;
     bool                      isValid(void) const;
 
+protected:
+    const Device*             getPipelineDevice(void) const override { return m_initializer.pDevice; }
+    VkPipeline                getPipelineHandle(void) const override { return m_pipeline; }
+
 private:
     Initializer               m_initializer;
     Result                    m_result;
@@ -443,18 +439,18 @@ inline GraphicsPipeline::GraphicsPipeline(Initializer initializer):
     Pipeline(std::move(initializer.pName)),
     m_initializer(std::move(initializer))
 {
-    m_result = vkCreateGraphicsPipelines(m_initializer.pDevice,
-                                         m_initializer.pPipelineCache,
+    m_result = vkCreateGraphicsPipelines(m_initializer.pDevice->getHandle(),
+                                         m_initializer.pPipelineCache? m_initializer.pPipelineCache->getHandle() : VK_NULL_HANDLE,
                                          1,
                                          &m_initializer.createInfo,
-                                         m_initializer.pAllocator,
+                                         m_initializer.pDevice->getAllocationCallbacks(),
                                          &m_pipeline);
 }
 
 inline GraphicsPipeline::~GraphicsPipeline(void) {
-    vkDestroyPipeline(m_initializer.pDevice,
+    vkDestroyPipeline(m_initializer.pDevice->getHandle(),
                       m_pipeline,
-                      m_initializer.pAllocator);
+                      m_initializer.pDevice->getAllocationCallbacks());
     //layout is going to be leaking like this!!!!
 }
 
@@ -0,0 +1,104 @@
+#ifndef ELYSIAN_RENDERER_PIPELINE_CACHE_HPP
+#define ELYSIAN_RENDERER_PIPELINE_CACHE_HPP
+
+#include <string>
+#include <vector>
+#include "elysian_renderer_object.hpp"
+
+#if 0
+// Provided by VK_VERSION_1_0
+typedef struct VkPipelineCacheHeaderVersionOne {
+    uint32_t                        headerSize;
+    VkPipelineCacheHeaderVersion    headerVersion;
+    uint32_t                        vendorID;
+    uint32_t                        deviceID;
+    uint8_t                         pipelineCacheUUID[VK_UUID_SIZE];
+} VkPipelineCacheHeaderVersionOne;
+#endif
+
+namespace elysian::renderer {
+
+class Device;
+class PhysicalDevice;
+class DebugLog;
+
+// VkPipelineCache which persists to disk between runs. The driver's blob is stored behind
+// our own header, which also pins the driver version (the blob's header doesn't) and
+// carries a hash of the data, so a blob from another GPU, driver or a torn write is
+// dropped on load instead of handed to the driver. Saving goes through a temporary file
+// and a rename, so a crash mid-write never leaves a truncated cache behind.
+//
+// Pipeline creation on several threads: give each one its own cache (no internal locking
+// on the driver's side) and merge() them into the main one once they're done.
+class PipelineCache: public HandleObject<VkPipelineCache, VK_OBJECT_TYPE_PIPELINE_CACHE> {
+public:
+
+    struct Initializer {
+        std::string                 name;
+        const Device*               pDevice     = nullptr;
+        std::string                 filePath;               //empty keeps it in memory only
+        VkPipelineCacheCreateFlags  flags       = 0;
+    };
+
+    enum class LoadStatus: uint8_t {
+        None,           //no file given or none there yet
+        Loaded,
+        Corrupt,        //short, bad magic/version or hash mismatch
+        Incompatible    //different vendor, device, driver or cache UUID
+    };
+
+    struct FileHeader {
+        uint32_t    magic;
+        uint32_t    version;
+        uint32_t    vendorID;
+        uint32_t    deviceID;
+        uint32_t    driverVersion;
+        uint8_t     pipelineCacheUUID[VK_UUID_SIZE];
+        uint32_t    reserved;
+        uint64_t    dataSize;
+        uint64_t    dataHash;
+    };
+
+    static constexpr uint32_t kFileMagic    = 0x43504c45; //"ELPC"
+    static constexpr uint32_t kFileVersion  = 1;
+
+                    PipelineCache(Initializer initializer);
+    virtual         ~PipelineCache(void);
+
+    const char*     getName(void) const;
+    const char*     getFilePath(void) const;
+    Result          getResult(void) const;
+    bool            isValid(void) const;
+    LoadStatus      getLoadStatus(void) const;
+    size_t          getLoadedSize(void) const;
+
+    Result          getData(std::vector<uint8_t>* pData) const;
+    // Writes to filePath (or the one from the initializer). Skipped when the data is
+    // unchanged since the last load or save.
+    Result          save(const char* pFilePath=nullptr);
+    Result          merge(const std::vector<const PipelineCache*>& sources);
+
+    // checks a whole file's contents against a device, LoadStatus::None is never returned
+    static LoadStatus validate(const PhysicalDevice& physicalDevice, const void* pFileData, size_t fileSize);
+    static const char* getLoadStatusName(LoadStatus status);
+
+    void            log(DebugLog* pLog) const;
+
+private:
+    Initializer     m_initializer;
+    Result          m_result;
+    LoadStatus      m_loadStatus    = LoadStatus::None;
+    size_t          m_loadedSize    = 0;
+    uint64_t        m_savedHash     = 0; //of the driver data as last loaded or saved
+};
+
+inline const char* PipelineCache::getName(void) const { return m_initializer.name.c_str(); }
+inline const char* PipelineCache::getFilePath(void) const { return m_initializer.filePath.c_str(); }
+inline Result PipelineCache::getResult(void) const { return m_result; }
+inline bool PipelineCache::isValid(void) const { return getResult() && getHandle() != VK_NULL_HANDLE; }
+inline auto PipelineCache::getLoadStatus(void) const -> LoadStatus { return m_loadStatus; }
+inline size_t PipelineCache::getLoadedSize(void) const { return m_loadedSize; }
+
+}
+
+#endif // ELYSIAN_RENDERER_PIPELINE_CACHE_HPP
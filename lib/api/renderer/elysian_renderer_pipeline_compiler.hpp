@@ -0,0 +1,177 @@
+#ifndef ELYSIAN_RENDERER_PIPELINE_COMPILER_HPP
+#define ELYSIAN_RENDERER_PIPELINE_COMPILER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "elysian_renderer_pipeline_variant_cache.hpp"
+
+namespace elysian::renderer {
+
+class WorkerPool;
+
+// Compiles pipelines on a WorkerPool instead of stalling whoever asked for them.
+// compile() hands back a Handle right away; until the pipeline is there getPipeline()
+// returns the fallback given with the request (VK_NULL_HANDLE meaning "skip the draw")
+// and bumps the request to the front of the queue, since a frame is now waiting on it.
+//
+// Only maxConcurrentCompiles run at once so background warm-up never eats every worker
+// the frame itself needs. Graphics pipelines go through (and end up owned by) the
+// PipelineVariantCache, so ones it already has come back ready without queueing and the
+// same state requested twice is only compiled once. Compute pipelines are owned here.
+class PipelineCompiler {
+public:
+    struct Initializer {
+        std::string             name;
+        const Device*           pDevice                 = nullptr;
+        WorkerPool*             pWorkerPool             = nullptr;
+        PipelineVariantCache*   pVariantCache           = nullptr;  //needed for graphics pipelines
+        PipelineCache*          pPipelineCache          = nullptr;  //compute pipelines, optional
+        uint32_t                maxConcurrentCompiles   = 2;
+    };
+
+    enum class Priority: uint8_t {
+        Background,     //warm-up, nobody's waiting
+        Prefetch,       //likely needed in the next few frames
+        CurrentFrame    //a draw is using the fallback right now
+    };
+
+    enum class Status: uint8_t {
+        Pending,
+        Compiling,
+        Ready,
+        Failed
+    };
+
+    struct Statistics {
+        uint32_t    queuedCount     = 0;
+        uint32_t    compilingCount  = 0;
+        uint64_t    requestCount    = 0;
+        uint64_t    readyOnRequest  = 0;    //already in the variant cache
+        uint64_t    compiledCount   = 0;
+        uint64_t    failedCount     = 0;
+        uint64_t    promotedCount   = 0;
+        uint64_t    fallbackCount   = 0;    //lookups answered with the fallback
+        uint64_t    skipCount       = 0;    //lookups answered with VK_NULL_HANDLE
+        uint64_t    compileTime     = 0;    //microseconds, summed over workers
+    };
+
+private:
+    struct ComputeState {
+        VkShaderModule                          module;
+        std::string                             entryPoint;
+        std::vector<VkSpecializationMapEntry>   mapEntries;
+        std::vector<uint8_t>                    specializationData;
+        bool                                    specialized;
+        VkPipelineLayout                        layout;
+        VkPipelineCreateFlags                   flags;
+    };
+
+    struct Job {
+        GraphicsPipelineState                   graphics;
+        std::unique_ptr<ComputeState>           pCompute;   //null for graphics
+        uint64_t                                key         = 0;
+        VkPipeline                              fallback    = VK_NULL_HANDLE;
+        Priority                                priority    = Priority::Background; //guarded by m_mutex
+        std::atomic<Status>                     status      = { Status::Pending };
+        // only read once status is Ready or Failed
+        VkPipeline                              pipeline    = VK_NULL_HANDLE;
+        Result                                  result;
+        std::promise<VkPipeline>                promise;
+        std::shared_future<VkPipeline>          future;
+    };
+
+public:
+    class Handle {
+    public:
+        bool            isValid(void) const;
+        Status          getStatus(void) const;
+        bool            isReady(void) const;
+        Result          getResult(void) const;      //only meaningful once Ready or Failed
+        // blocks until it's compiled (or failed, giving VK_NULL_HANDLE)
+        VkPipeline      wait(void) const;
+        auto            getFuture(void) const -> const std::shared_future<VkPipeline>&;
+
+    private:
+        friend class PipelineCompiler;
+        std::shared_ptr<Job>    m_pJob;
+    };
+
+                        PipelineCompiler(Initializer initializer);
+                        // cancels what's still queued, waits for what's compiling
+                        ~PipelineCompiler(void);
+
+    const char*         getName(void) const;
+
+    // asking for a state that's already queued hands back that request, first fallback sticks
+    Handle              compile(const GraphicsPipelineState& state, Priority priority=Priority::Prefetch,
+                                VkPipeline fallback=VK_NULL_HANDLE);
+    // takes a copy of the stage, entry point and specialization data
+    Handle              compile(const VkComputePipelineCreateInfo& info, Priority priority=Priority::Prefetch,
+                                VkPipeline fallback=VK_NULL_HANDLE);
+
+    // The pipeline when it's ready, otherwise the request's fallback. Pending requests get
+    // promoted to CurrentFrame, since somebody clearly needs them now.
+    VkPipeline          getPipeline(const Handle& handle);
+    void                promote(const Handle& handle, Priority priority=Priority::CurrentFrame);
+
+    void                waitIdle(void);
+    Statistics          getStatistics(void) const;
+    void                log(DebugLog* pLog) const;
+
+private:
+    struct QueueEntry {
+        Priority                priority;
+        uint64_t                sequence;   //FIFO within a priority
+        std::shared_ptr<Job>    pJob;
+        bool operator<(const QueueEntry& rhs) const;
+    };
+
+    static std::shared_ptr<Job> makeJob(VkPipeline fallback);
+
+    Handle              enqueue(std::shared_ptr<Job> pJob, Priority priority);
+    void                pushLocked(const std::shared_ptr<Job>& pJob);
+    void                promoteLocked(const std::shared_ptr<Job>& pJob, Priority priority);
+    auto                takeLocked(void) -> std::vector<std::shared_ptr<Job>>;   //whatever fits under the cap
+    void                dispatch(void);
+    void                submit(std::vector<std::shared_ptr<Job>> jobs);
+    // both return the jobs taken once this one's slot freed up, for the caller to submit
+    auto                execute(const std::shared_ptr<Job>& pJob) -> std::vector<std::shared_ptr<Job>>;
+    auto                finish(const std::shared_ptr<Job>& pJob, VkPipeline pipeline, Result result, uint64_t time)
+                            -> std::vector<std::shared_ptr<Job>>;
+    Result              createComputePipeline(const ComputeState& state, VkPipeline* pPipeline) const;
+
+    Initializer                                         m_initializer;
+    mutable std::mutex                                  m_mutex;
+    std::condition_variable                             m_idle;
+    std::vector<QueueEntry>                             m_queue;        //max heap
+    std::unordered_map<uint64_t, std::shared_ptr<Job>>  m_inFlight;     //graphics jobs by state key
+    std::vector<VkPipeline>                             m_computePipelines;
+    uint64_t                                            m_sequence      = 0;
+    uint32_t                                            m_compiling     = 0;
+    bool                                                m_stopping      = false;
+    Statistics                                          m_statistics;
+};
+
+inline const char* PipelineCompiler::getName(void) const { return m_initializer.name.c_str(); }
+
+inline bool PipelineCompiler::Handle::isValid(void) const { return m_pJob != nullptr; }
+inline auto PipelineCompiler::Handle::getStatus(void) const -> Status { return m_pJob->status.load(std::memory_order_acquire); }
+inline bool PipelineCompiler::Handle::isReady(void) const { return isValid() && getStatus() == Status::Ready; }
+inline Result PipelineCompiler::Handle::getResult(void) const { return m_pJob->result; }
+inline VkPipeline PipelineCompiler::Handle::wait(void) const { return m_pJob->future.get(); }
+inline auto PipelineCompiler::Handle::getFuture(void) const -> const std::shared_future<VkPipeline>& { return m_pJob->future; }
+
+inline bool PipelineCompiler::QueueEntry::operator<(const QueueEntry& rhs) const {
+    if(priority != rhs.priority) return priority < rhs.priority;
+    return sequence > rhs.sequence;
+}
+
+}
+
+#endif // ELYSIAN_RENDERER_PIPELINE_COMPILER_HPP
@@ -0,0 +1,87 @@
+#ifndef ELYSIAN_RENDERER_PIPELINE_STATISTICS_HPP
+#define ELYSIAN_RENDERER_PIPELINE_STATISTICS_HPP
+
+#include <string>
+#include <vector>
+#include "elysian_renderer_object.hpp"
+
+namespace elysian::renderer {
+
+class Device;
+class DebugLog;
+class PipelineVariantCache;
+
+// What the driver reports about one executable (roughly one compiled shader stage) of a
+// pipeline through VK_KHR_pipeline_executable_properties. Statistic names are the
+// driver's own ("VGPRs", "Spilled SGPRs", "Instruction Count", ...), so they're kept as is.
+struct PipelineExecutableStatistics {
+    struct Statistic {
+        std::string                             name;
+        std::string                             description;
+        VkPipelineExecutableStatisticFormatKHR  format;
+        VkPipelineExecutableStatisticValueKHR   value;
+
+        double          toDouble(void) const;
+    };
+
+    std::string             name;
+    std::string             description;
+    VkShaderStageFlags      stages          = 0;
+    uint32_t                subgroupSize    = 0;
+    std::vector<Statistic>  statistics;
+
+    // first statistic with pName in its name, case insensitive
+    const Statistic*        find(const char* pName) const;
+};
+
+// Needs the extension (and its pipelineExecutableInfo feature) enabled on the device and the
+// pipeline created with VK_PIPELINE_CREATE_CAPTURE_STATISTICS_BIT_KHR, otherwise
+// VK_ERROR_EXTENSION_NOT_PRESENT or whatever the driver says.
+Result getPipelineExecutableStatistics(const Device* pDevice, VkPipeline pipeline,
+                                       std::vector<PipelineExecutableStatistics>* pExecutables);
+
+// Tool mode: gathers the statistics of a set of pipelines and writes them out for diffing,
+// e.g. in CI against lavapipe to catch register or spill regressions before they ship.
+//
+// JSON is nested pipeline -> executables -> statistics. CSV has one row per statistic
+// (pipeline,executable,stages,subgroupSize,statistic,value) since every driver reports
+// a different set.
+class PipelineStatisticsReport {
+public:
+    enum class Format: uint8_t {
+        Json,
+        Csv
+    };
+
+    struct Entry {
+        std::string                                 pipeline;
+        std::vector<PipelineExecutableStatistics>   executables;
+    };
+
+                        PipelineStatisticsReport(const Device* pDevice);
+
+    Result              add(const char* pName, VkPipeline pipeline);
+    // every variant in the cache, named by its state key
+    Result              add(const PipelineVariantCache& cache);
+
+    auto                getEntries(void) const -> const std::vector<Entry>&;
+    void                clear(void);
+
+    std::string         write(Format format) const;
+    // VK_ERROR_INITIALIZATION_FAILED when the file can't be written
+    Result              write(const char* pFilePath, Format format) const;
+
+    void                log(DebugLog* pLog) const;
+
+private:
+    const Device*       m_pDevice   = nullptr;
+    std::vector<Entry>  m_entries;
+};
+
+inline PipelineStatisticsReport::PipelineStatisticsReport(const Device* pDevice): m_pDevice(pDevice) {}
+inline auto PipelineStatisticsReport::getEntries(void) const -> const std::vector<Entry>& { return m_entries; }
+inline void PipelineStatisticsReport::clear(void) { m_entries.clear(); }
+
+}
+
+#endif // ELYSIAN_RENDERER_PIPELINE_STATISTICS_HPP
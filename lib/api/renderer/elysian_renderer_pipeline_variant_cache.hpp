@@ -0,0 +1,241 @@
+#ifndef ELYSIAN_RENDERER_PIPELINE_VARIANT_CACHE_HPP
+#define ELYSIAN_RENDERER_PIPELINE_VARIANT_CACHE_HPP
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include "elysian_renderer_object.hpp"
+#include "elysian_renderer_specialization.hpp"
+
+namespace elysian::renderer {
+
+class Device;
+class DebugLog;
+class PipelineCache;
+
+// Everything that goes into a graphics pipeline, kept as padding free blocks that each
+// carry their own hash. Mutators rehash the block they touch right away and recombine the
+// rest, so deriving a variant from another one (copy, enableDepthTest()) never walks the
+// whole create info again, and getKey() is a plain read that's safe from any thread.
+class GraphicsPipelineState {
+public:
+    enum class Block: uint8_t {
+        Stages,
+        VertexInput,
+        InputAssembly,
+        Tessellation,
+        Viewport,
+        Rasterization,
+        Multisample,
+        DepthStencil,
+        ColorBlend,
+        Dynamic,
+        Target,         //layout, render pass, subpass and flags
+        Count
+    };
+
+                    GraphicsPipelineState(void);
+    // takes a copy of everything the create info points at, pNext chains aren't followed
+    explicit        GraphicsPipelineState(const VkGraphicsPipelineCreateInfo& info);
+
+    uint64_t        getKey(void) const;
+    uint64_t        getBlockHash(Block block) const;
+    bool            operator==(const GraphicsPipelineState& rhs) const;
+    bool            operator!=(const GraphicsPipelineState& rhs) const;
+
+    // Stages
+    GraphicsPipelineState& setShaderStage(VkShaderStageFlagBits stage, VkShaderModule module, const char* pEntryPoint="main",
+                                          const VkSpecializationInfo* pSpecializationInfo=nullptr);
+    template<typename... Constants>
+    GraphicsPipelineState& setShaderStage(VkShaderStageFlagBits stage, VkShaderModule module, const char* pEntryPoint,
+                                          const SpecializationSet<Constants...>& specialization);
+    GraphicsPipelineState& removeShaderStage(VkShaderStageFlagBits stage);
+    // Vertex input / assembly
+    GraphicsPipelineState& setVertexInput(std::vector<VkVertexInputBindingDescription> bindings,
+                                          std::vector<VkVertexInputAttributeDescription> attributes);
+    GraphicsPipelineState& setTopology(VkPrimitiveTopology topology, bool primitiveRestartEnable=false);
+    GraphicsPipelineState& setPatchControlPoints(uint32_t patchControlPoints);
+    // Viewport, only counts when they're dynamic
+    GraphicsPipelineState& setViewportCount(uint32_t count);
+    GraphicsPipelineState& setViewports(std::vector<VkViewport> viewports, std::vector<VkRect2D> scissors);
+    // Rasterization
+    GraphicsPipelineState& setPolygonMode(VkPolygonMode polygonMode);
+    GraphicsPipelineState& setCullMode(VkCullModeFlags cullMode, VkFrontFace frontFace=VK_FRONT_FACE_COUNTER_CLOCKWISE);
+    GraphicsPipelineState& setDepthClamp(bool enable);
+    GraphicsPipelineState& setRasterizerDiscard(bool enable);
+    GraphicsPipelineState& setDepthBias(bool enable, float constantFactor=0.0f, float clamp=0.0f, float slopeFactor=0.0f);
+    GraphicsPipelineState& setLineWidth(float lineWidth);
+    // Multisample
+    GraphicsPipelineState& setSampleCount(VkSampleCountFlagBits samples);
+    GraphicsPipelineState& setSampleShading(bool enable, float minSampleShading=1.0f);
+    GraphicsPipelineState& setAlphaToCoverage(bool alphaToCoverage, bool alphaToOne=false);
+    GraphicsPipelineState& setSampleMask(bool enable, uint64_t sampleMask=~0ull);
+    // Depth/stencil
+    GraphicsPipelineState& enableDepthTest(bool depthWrite=true, VkCompareOp compareOp=VK_COMPARE_OP_LESS_OR_EQUAL);
+    GraphicsPipelineState& disableDepthTest(void);
+    GraphicsPipelineState& setDepthBounds(bool enable, float minBounds=0.0f, float maxBounds=1.0f);
+    GraphicsPipelineState& setStencilTest(bool enable, const VkStencilOpState& front={}, const VkStencilOpState& back={});
+    // Color blend
+    GraphicsPipelineState& setLogicOp(bool enable, VkLogicOp logicOp=VK_LOGIC_OP_COPY);
+    GraphicsPipelineState& setBlendAttachments(std::vector<VkPipelineColorBlendAttachmentState> attachments);
+    GraphicsPipelineState& setBlendAttachment(uint32_t index, const VkPipelineColorBlendAttachmentState& attachment);
+    GraphicsPipelineState& setBlendConstants(float r, float g, float b, float a);
+    // Dynamic
+    GraphicsPipelineState& setDynamicStates(std::vector<VkDynamicState> dynamicStates);
+    // Target
+    GraphicsPipelineState& setLayout(VkPipelineLayout layout);
+    GraphicsPipelineState& setRenderPass(VkRenderPass renderPass, uint32_t subpass=0);
+    GraphicsPipelineState& setFlags(VkPipelineCreateFlags flags);
+
+private:
+    friend class PipelineVariantCache;
+
+    // all 32/64 bit members, no padding, so they hash and compare bytewise
+    struct Stage {
+        VkShaderStageFlagBits   stage;
+        uint32_t                reserved;
+        VkShaderModule          module;
+        uint64_t                specializationHash; //0 without specialization
+    };
+
+    struct Specialization {
+        std::vector<VkSpecializationMapEntry>   mapEntries;
+        std::vector<uint8_t>                    data;
+    };
+
+    struct InputAssembly    { VkPrimitiveTopology topology; VkBool32 primitiveRestartEnable; };
+    struct Rasterization    { VkBool32 depthClampEnable; VkBool32 rasterizerDiscardEnable; VkPolygonMode polygonMode;
+                              VkCullModeFlags cullMode; VkFrontFace frontFace; VkBool32 depthBiasEnable;
+                              float depthBiasConstantFactor; float depthBiasClamp; float depthBiasSlopeFactor; float lineWidth; };
+    struct Multisample      { VkSampleCountFlagBits rasterizationSamples; VkBool32 sampleShadingEnable; float minSampleShading;
+                              VkBool32 alphaToCoverageEnable; VkBool32 alphaToOneEnable;
+                              VkBool32 sampleMaskEnable; VkSampleMask sampleMask[2]; }; //up to 64 samples
+    struct DepthStencil     { VkBool32 depthTestEnable; VkBool32 depthWriteEnable; VkCompareOp depthCompareOp;
+                              VkBool32 depthBoundsTestEnable; VkBool32 stencilTestEnable; VkStencilOpState front; VkStencilOpState back;
+                              float minDepthBounds; float maxDepthBounds; };
+    struct ColorBlend       { VkBool32 logicOpEnable; VkLogicOp logicOp; float blendConstants[4]; };
+    struct Target           { VkPipelineLayout layout; VkRenderPass renderPass; uint32_t subpass; VkPipelineCreateFlags flags; };
+
+    void            rehash(Block block); //that block's hash and the key
+    uint64_t        hashBlock(Block block) const;
+
+    std::vector<Stage>                              m_stages;
+    std::vector<std::string>                        m_entryPoints;      //parallel to m_stages
+    std::vector<Specialization>                     m_specializations;  //parallel to m_stages
+    std::vector<VkVertexInputBindingDescription>    m_vertexBindings;
+    std::vector<VkVertexInputAttributeDescription>  m_vertexAttributes;
+    InputAssembly                                   m_inputAssembly;
+    uint32_t                                        m_patchControlPoints = 0; //0 = no tessellation state
+    uint32_t                                        m_viewportCount = 1;
+    std::vector<VkViewport>                         m_viewports;
+    std::vector<VkRect2D>                           m_scissors;
+    Rasterization                                   m_rasterization;
+    Multisample                                     m_multisample;
+    DepthStencil                                    m_depthStencil;
+    ColorBlend                                      m_colorBlend;
+    std::vector<VkPipelineColorBlendAttachmentState> m_blendAttachments;
+    std::vector<VkDynamicState>                     m_dynamicStates;
+    Target                                          m_target;
+
+    uint64_t                                        m_blockHashes[static_cast<size_t>(Block::Count)] = {};
+    uint64_t                                        m_key           = 0;
+};
+
+// Hands out VkPipelines for GraphicsPipelineStates, creating only the ones it hasn't seen.
+// Lookups go through an open addressing table keyed by the state's hash and confirmed
+// with a full compare, so a hash collision can't hand back the wrong pipeline.
+// Safe to call from several threads, creation happens outside the lock.
+class PipelineVariantCache {
+public:
+    struct Initializer {
+        std::string         name;
+        const Device*       pDevice         = nullptr;
+        PipelineCache*      pPipelineCache  = nullptr;  //optional
+        uint32_t            initialCapacity = 256;
+        // tool mode, every pipeline gets VK_PIPELINE_CREATE_CAPTURE_STATISTICS_BIT_KHR (the
+        // extension has to be enabled) so PipelineStatisticsReport can read them back
+        bool                captureStatistics = false;
+    };
+
+    struct Variant {
+        uint64_t            key;
+        VkPipeline          pipeline;
+    };
+
+    struct Statistics {
+        uint64_t            lookupCount     = 0;
+        uint64_t            hitCount        = 0;
+        uint64_t            createCount     = 0;
+        uint64_t            batchCount      = 0;        //getPipelines() calls that had to create
+        uint64_t            probeCount      = 0;        //slots visited over all lookups
+        uint32_t            variantCount    = 0;
+        uint32_t            capacity        = 0;
+    };
+
+                        PipelineVariantCache(Initializer initializer);
+                        ~PipelineVariantCache(void);
+
+    const char*         getName(void) const;
+
+    // creates the pipeline on a miss, VK_NULL_HANDLE and the failure otherwise
+    Result              getPipeline(const GraphicsPipelineState& state, VkPipeline* pPipeline);
+    VkPipeline          findPipeline(const GraphicsPipelineState& state) const; //never creates
+    // Loading screen path: every miss among the states is created in one batched call, with
+    // variants sharing shaders and layout derived from each other. Failed ones come back as
+    // VK_NULL_HANDLE, pResults (optional) has each one's result.
+    Result              getPipelines(uint32_t count, const GraphicsPipelineState* pStates, VkPipeline* pPipelines,
+                                     Result* pResults=nullptr);
+
+    void                clear(void); //destroys every pipeline, none may be in use anymore
+    auto                getVariants(void) const -> std::vector<Variant>;
+    Statistics          getStatistics(void) const;
+    void                log(DebugLog* pLog) const;
+
+private:
+    struct Entry {
+        GraphicsPipelineState   state;
+        VkPipeline              pipeline;
+    };
+
+    struct Slot {
+        uint64_t                key;
+        uint32_t                entry;      //kEmptySlot when unused
+    };
+
+    // everything a VkGraphicsPipelineCreateInfo points at, mustn't move once filled
+    struct CreateInfo;
+
+    static constexpr uint32_t kEmptySlot = ~0u;
+
+    uint32_t            findLocked(const GraphicsPipelineState& state, uint64_t key, uint64_t* pProbeCount) const; //entry or kEmptySlot
+    void                insertLocked(uint64_t key, uint32_t entry);
+    void                growLocked(void);
+    // returns what's cached for the state from now on, ours gets destroyed if someone was quicker
+    VkPipeline          addLocked(const GraphicsPipelineState& state, uint64_t key, VkPipeline pipeline);
+    static void         fillCreateInfo(const GraphicsPipelineState& state, CreateInfo* pInfo);
+    Result              createPipeline(const GraphicsPipelineState& state, VkPipeline* pPipeline) const;
+
+    Initializer             m_initializer;
+    mutable std::mutex      m_mutex;
+    std::vector<Slot>       m_slots;        //power of two, at most half full
+    std::vector<Entry>      m_entries;
+    mutable Statistics      m_statistics;
+};
+
+inline bool GraphicsPipelineState::operator!=(const GraphicsPipelineState& rhs) const { return !(*this == rhs); }
+
+template<typename... Constants>
+inline GraphicsPipelineState& GraphicsPipelineState::setShaderStage(VkShaderStageFlagBits stage, VkShaderModule module, const char* pEntryPoint,
+                                                                    const SpecializationSet<Constants...>& specialization)
+{
+    const VkSpecializationInfo info = specialization.getInfo();
+    return setShaderStage(stage, module, pEntryPoint, &info);
+}
+inline uint64_t GraphicsPipelineState::getKey(void) const { return m_key; }
+inline uint64_t GraphicsPipelineState::getBlockHash(Block block) const { return m_blockHashes[static_cast<size_t>(block)]; }
+
+inline const char* PipelineVariantCache::getName(void) const { return m_initializer.name.c_str(); }
+
+}
+
+#endif // ELYSIAN_RENDERER_PIPELINE_VARIANT_CACHE_HPP
@@ -2,6 +2,7 @@
 #define ELYSIAN_RENDERER_QUERY_HPP
 
 #include "elysian_renderer_object.hpp"
+#include "elysian_renderer_device.hpp"
 
 namespace elysian::renderer {
 
@@ -45,12 +46,12 @@ inline QueryPool::QueryPool(const Device *pDevice, std::shared_ptr<const QueryPo
     m_pDevice(pDevice)
 {
     VkQueryPool pool = VK_NULL_HANDLE;
-    m_result = vkCreateQueryPool(m_pDevice->getHandle(), m_pInfo->get(), nullptr, &pool);
+    m_result = vkCreateQueryPool(m_pDevice->getHandle(), m_pInfo->get(), m_pDevice->getAllocationCallbacks(), &pool);
     setHandle(pool);
 }
 
 inline QueryPool::~QueryPool(void) {
-    vkDestroyQueryPool(m_pDevice->getHandle(), getHandle(), nullptr);
+    vkDestroyQueryPool(m_pDevice->getHandle(), getHandle(), m_pDevice->getAllocationCallbacks());
 }
 
 inline std::shared_ptr<const QueryPoolCreateInfo> QueryPool::getCreateInfo(void) const {
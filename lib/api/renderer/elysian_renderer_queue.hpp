@@ -90,7 +90,8 @@ public:
     const QueueGroup& getQueueGroup(void) const { return m_group; }
 
     Result waitIdle(void) const;
-    Result submit(std::vector<SubmitInfo> submitInfo, VkFence fence=VK_NULL_HANDLE) const;
+    Result submit(std::vector<VkSubmitInfo> submitInfo, VkFence fence=VK_NULL_HANDLE) const;
+    Result submit(uint32_t submitCount, const VkSubmitInfo* pSubmits, VkFence fence=VK_NULL_HANDLE) const;
 
     void beginDebugUtilsLabel(const char* pLabelName, float r=0.0f, float g=0.0f, float b=0.0f, float a=0.0f) const;
     void endDebugUtilsLabel(void) const;
@@ -163,8 +164,12 @@ inline void Queue::insertDebugUtilsLabel(const char* pLabelName, float r, float
 inline Result Queue::waitIdle(void) const {
     return vkQueueWaitIdle(getHandle());
 }
-inline Result Queue::submit(std::vector<SubmitInfo> submitInfo, VkFence fence) const {
-    return vkQueueSubmit(getHandle(), submitInfo.size(), submitInfo.data(), fence);
+inline Result Queue::submit(std::vector<VkSubmitInfo> submitInfo, VkFence fence) const {
+    return submit(static_cast<uint32_t>(submitInfo.size()), submitInfo.data(), fence);
+}
+
+inline Result Queue::submit(uint32_t submitCount, const VkSubmitInfo* pSubmits, VkFence fence) const {
+    return vkQueueSubmit(getHandle(), submitCount, pSubmits, fence);
 }
 
 
@@ -2,6 +2,7 @@
 #define ELYSIAN_RENDERER_SEMAPHORE_HPP
 
 #include "elysian_renderer_object.hpp"
+#include "elysian_renderer_device.hpp"
 
 namespace elysian::renderer {
 
@@ -14,8 +15,40 @@ public:
                 VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
                 nullptr,
                 flags
+            }),
+            m_typeInfo({
+                VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+                nullptr,
+                VK_SEMAPHORE_TYPE_BINARY,
+                0
             })
         {}
+
+        // Provided by VK_VERSION_1_2
+        CreateInfo(VkSemaphoreType type, uint64_t initialValue, VkSemaphoreCreateFlags flags=0):
+            CreateInfo(flags)
+        {
+            m_typeInfo.semaphoreType = type;
+            m_typeInfo.initialValue = initialValue;
+            pNext = &m_typeInfo;
+        }
+
+        // pNext points into ourselves, has to follow the copy
+        CreateInfo(const CreateInfo& rhs):
+            VkSemaphoreCreateInfo(rhs),
+            m_typeInfo(rhs.m_typeInfo)
+        {
+            if(rhs.pNext == &rhs.m_typeInfo) pNext = &m_typeInfo;
+        }
+
+        CreateInfo& operator=(const CreateInfo& rhs) = delete;
+
+        bool isTimeline(void) const {
+            return pNext == &m_typeInfo && m_typeInfo.semaphoreType == VK_SEMAPHORE_TYPE_TIMELINE;
+        }
+
+    private:
+        VkSemaphoreTypeCreateInfo m_typeInfo;
     };
 
     struct Initializer {
@@ -28,25 +61,12 @@ public:
 
     Result      getResult(void) const;
     auto        getCreateInfo(void) const -> std::shared_ptr<const CreateInfo>;
+    bool        isTimeline(void) const;
 
-#if 0
-    VkResult
-      vkGetSemaphoreCounterValue( VkDevice device, VkSemaphore semaphore, uint64_t * pValue ) const VULKAN_HPP_NOEXCEPT
-    {
-      return ::vkGetSemaphoreCounterValue( device, semaphore, pValue );
-    }
-
-    VkResult vkSignalSemaphore(
-        VkDevice                                    device,
-        const VkSemaphoreSignalInfo*                pSignalInfo);
-
-    // Provided by VK_VERSION_1_2
-    VkResult vkWaitSemaphores(
-        VkDevice                                    device,
-        const VkSemaphoreWaitInfo*                  pWaitInfo,
-        uint64_t                                    timeout);
-
-#endif
+    // Provided by VK_VERSION_1_2, timeline semaphores only
+    Result      getCounterValue(uint64_t* pValue) const;
+    Result      signal(uint64_t value) const; //from the host
+    Result      wait(uint64_t value, uint64_t timeout=UINT64_MAX) const;
 
 
 private:
@@ -83,6 +103,9 @@ public:
     Result          getStatus(void) const;
     auto            getCreateInfo(void) const -> std::shared_ptr<const CreateInfo>;
 
+    Result          wait(uint64_t timeout=UINT64_MAX) const; //VK_TIMEOUT if it didn't signal in time
+    Result          reset(void) const;
+
 private:
 
     Result          m_result;
@@ -117,13 +140,13 @@ inline Event::Event(const Device *pDevice) :
     VkEvent event = VK_NULL_HANDLE;
     m_result =  vkCreateEvent(m_pDevice->getHandle(),
                 &info,
-                nullptr,
+                m_pDevice->getAllocationCallbacks(),
                 &event);
     setHandle(event);
 }
 
 inline Event::~Event(void) {
-    vkDestroyEvent(m_pDevice->getHandle(), getHandle(), nullptr);
+    vkDestroyEvent(m_pDevice->getHandle(), getHandle(), m_pDevice->getAllocationCallbacks());
 }
 
 inline Result Event::getResult(void) const { return m_result; }
@@ -144,14 +167,47 @@ inline Semaphore::Semaphore(Initializer initializer):
     m_pCreateInfo(std::move(initializer.pCreateInfo)),
     m_pDevice(initializer.pDevice)
 {
-    m_result = vkCreateSemaphore(m_pDevice, m_pCreateInfo.get(), nullptr, &m_handle);
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+    m_result = vkCreateSemaphore(m_pDevice->getHandle(), m_pCreateInfo.get(), m_pDevice->getAllocationCallbacks(), &semaphore);
+    setHandle(semaphore);
 }
 
 inline Semaphore::~Semaphore(void) {
-    vkDestroySemaphore(m_pDevice, nullptr, getHandle());
+    vkDestroySemaphore(m_pDevice->getHandle(), getHandle(), m_pDevice->getAllocationCallbacks());
 }
 
 inline Result Semaphore::getResult(void) const { return m_result; }
+inline bool Semaphore::isTimeline(void) const { return m_pCreateInfo->isTimeline(); }
+
+inline Result Semaphore::getCounterValue(uint64_t* pValue) const {
+    assert(isTimeline());
+    return vkGetSemaphoreCounterValue(m_pDevice->getHandle(), getHandle(), pValue);
+}
+
+inline Result Semaphore::signal(uint64_t value) const {
+    assert(isTimeline());
+    const auto info = VkSemaphoreSignalInfo {
+        VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO,
+        nullptr,
+        getHandle(),
+        value
+    };
+    return vkSignalSemaphore(m_pDevice->getHandle(), &info);
+}
+
+inline Result Semaphore::wait(uint64_t value, uint64_t timeout) const {
+    assert(isTimeline());
+    const VkSemaphore semaphore = getHandle();
+    const auto info = VkSemaphoreWaitInfo {
+        VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        nullptr,
+        0,
+        1,
+        &semaphore,
+        &value
+    };
+    return vkWaitSemaphores(m_pDevice->getHandle(), &info, timeout);
+}
 inline std::shared_ptr<const Semaphore::CreateInfo> Semaphore::getCreateInfo(void) const { return m_pCreateInfo; }
 
 
@@ -159,7 +215,9 @@ inline Fence::Fence(Initializer initializer):
     m_pInfo(std::move(initializer.pInfo)),
     m_pDevice(initializer.pDevice)
 {
-    m_result = vkCreateFence(m_pDevice, m_pInfo.get(), nullptr, &m_handle);
+    VkFence fence = VK_NULL_HANDLE;
+    m_result = vkCreateFence(m_pDevice->getHandle(), m_pInfo.get(), m_pDevice->getAllocationCallbacks(), &fence);
+    setHandle(fence);
 }
 
 inline Result Fence::getStatus(void) const {
@@ -167,7 +225,17 @@ inline Result Fence::getStatus(void) const {
 }
 
 inline Fence::~Fence(void) {
-    vkDestroyFence(m_pDevice, nullptr, getHandle());
+    vkDestroyFence(m_pDevice->getHandle(), getHandle(), m_pDevice->getAllocationCallbacks());
+}
+
+inline Result Fence::wait(uint64_t timeout) const {
+    const VkFence fence = getHandle();
+    return vkWaitForFences(m_pDevice->getHandle(), 1, &fence, VK_TRUE, timeout);
+}
+
+inline Result Fence::reset(void) const {
+    const VkFence fence = getHandle();
+    return vkResetFences(m_pDevice->getHandle(), 1, &fence);
 }
 
 inline Result Fence::getResult(void) const { return m_result; }
@@ -1,81 +1,196 @@
 #ifndef ELYSIAN_RENDERER_SHADER_HPP
 #define ELYSIAN_RENDERER_SHADER_HPP
 
-#include "renderer/elysian_renderer_object.hpp"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "elysian_renderer_object.hpp"
 
-namespace elysian {
+namespace elysian::renderer {
 
+class Device;
+class DebugLog;
+struct ShaderReflection;
+class ShaderReflectionCache;
+
+// Non-owning view of SPIR-V words.
 class ShaderBinary {
 public:
-    uint32_t*   getData(void) const;
-    size_t      getSize(void) const;
-private:
-    uint32_t*   m_pData  = nullptr;
-    size_t      m_size   = 0;
-};
+    static constexpr uint32_t kSpirvMagic = 0x07230203;
 
+                    ShaderBinary(void) = default;
+                    ShaderBinary(const uint32_t* pData, size_t size);
 
-class ShaderBinaryFile: public ShaderBinary {
-public:
+    const uint32_t* getData(void) const;
+    size_t          getSize(void) const;        //bytes
+    size_t          getWordCount(void) const;
+    // non-empty, whole words and starting with the SPIR-V magic
+    bool            isValid(void) const;
+    uint64_t        computeHash(void) const;
 
-    const char* getFilePath(void) const;
-private:
-    std::string     m_filePath;
+protected:
+    const uint32_t* m_pData  = nullptr;
+    size_t          m_size   = 0;
 };
 
-class ShaderModule: public HandleObject {
+// SPIR-V file mapped straight into memory, so module creation reads it from the page cache
+// without a copy in between. Move only, unmapped when it goes away.
+class ShaderBinaryFile: public ShaderBinary {
+public:
+                    ShaderBinaryFile(void) = default;
+                    ShaderBinaryFile(const char* pFilePath);
+                    ShaderBinaryFile(ShaderBinaryFile&& rhs);
+                    ~ShaderBinaryFile(void);
 
-};
+                    ShaderBinaryFile(const ShaderBinaryFile&) = delete;
+    ShaderBinaryFile& operator=(const ShaderBinaryFile&) = delete;
+    ShaderBinaryFile& operator=(ShaderBinaryFile&& rhs);
 
-//cache pool size?
-//mark certain shit persistent?
-class ShaderModuleCache {
-public:
-    ShaderModule* acquireModule(const char* pFilePath);
+    const char*     getFilePath(void) const;
+    bool            isMapped(void) const;
+    int64_t         getModifiedTime(void) const;    //when it was mapped, in the platform's units
+
+    // size and last write time without mapping anything, false when it isn't there
+    static bool     getFileStamp(const char* pFilePath, size_t* pSize, int64_t* pModifiedTime);
 
-    void reset(void) const;
 private:
-    std::map<std::string, ShaderBinaryFile> m_binaries;
-};
+    void            unmap(void);
 
-class ShaderModule: public VkShaderModuleCreateInfo {
-#if 0
-    // Provided by VK_VERSION_1_0
-    typedef struct VkShaderModuleCreateInfo {
-        VkStructureType              sType;
-        const void*                  pNext;
-        VkShaderModuleCreateFlags    flags;
-        size_t                       codeSize;
-        const uint32_t*              pCode;
-    } VkShaderModuleCreateInfo;
+    std::string     m_filePath;
+    int64_t         m_modifiedTime  = 0;
+#ifdef _WIN32
+    void*           m_hFile     = nullptr;
+    void*           m_hMapping  = nullptr;
 #endif
+};
+
+class ShaderModule: public HandleObject<VkShaderModule, VK_OBJECT_TYPE_SHADER_MODULE> {
 public:
-    ShaderModule(size_t codeSize, const uint32_t* pCode):
-        VkShaderModuleCreateInfo({
-            VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-            nullptr,
-            0,
-            codeSize,
-            pCode
-        })
-    {}
-    ~ShaderModule(void);
-
-    size_t getCodeSize(void) const;
-    const char* getFilePath(void) const;
+    struct Initializer {
+        std::string         name;
+        const Device*       pDevice = nullptr;
+        ShaderBinary        binary;             //only needs to live through the constructor
+        std::shared_ptr<const ShaderReflection> pReflection;
+        uint64_t            hash    = 0;        //binary.computeHash(), computed when left at 0
+    };
+
+                    ShaderModule(Initializer initializer);
+    virtual         ~ShaderModule(void);
+
+    const char*     getName(void) const;
+    size_t          getCodeSize(void) const;
+    uint64_t        getHash(void) const;        //of the SPIR-V it was created from
+    Result          getResult(void) const;
+    bool            isValid(void) const;
+    // null unless it came out of a ShaderModuleCache with a reflection cache
+    auto            getReflection(void) const -> const std::shared_ptr<const ShaderReflection>&;
+
 private:
-    std::string m_filePath;
+    std::string     m_name;
+    const Device*   m_pDevice   = nullptr;
+    size_t          m_codeSize  = 0;
+    uint64_t        m_hash      = 0;
+    Result          m_result;
+    std::shared_ptr<const ShaderReflection> m_pReflection;
 };
 
+// Hands out ShaderModules by file path or code, deduplicated by the SPIR-V's content hash:
+// materials pointing at different copies of the same shader share one VkShaderModule.
+// A match is the 64 bit hash plus the code size, nothing of the SPIR-V stays around after
+// creation. Set keepCode to also confirm matches bytewise, at the price of a copy per module.
+// References are shared_ptrs, a module only the cache still holds is unused and the least
+// recently used of those get destroyed whenever the resident code goes over budget.
+// Paths remember the file's size and write time, a file changed on disk gets mapped again.
 class ShaderModuleCache {
 public:
-    const ShaderModule* fetchModule(const char* pFilePath);
+    struct Initializer {
+        std::string     name;
+        const Device*   pDevice     = nullptr;
+        size_t          budget      = 16 * 1024 * 1024; //bytes of SPIR-V kept resident
+        // reflects every module it creates while its SPIR-V is still mapped, optional
+        ShaderReflectionCache* pReflectionCache = nullptr;
+        bool            keepCode    = false;            //copy of each module's SPIR-V for bytewise matching
+    };
+
+    struct Statistics {
+        uint32_t        moduleCount     = 0;
+        uint32_t        unusedCount     = 0;
+        size_t          residentSize    = 0;
+        uint64_t        pathHitCount    = 0;    //file seen before and its module still resident
+        uint64_t        staleCount      = 0;    //file seen before but changed since
+        uint64_t        dedupCount      = 0;    //new path or code, but identical SPIR-V was resident
+        uint64_t        createCount     = 0;
+        uint64_t        evictCount      = 0;
+    };
+
+                        ShaderModuleCache(Initializer initializer);
+                        ~ShaderModuleCache(void);
+
+    const char*         getName(void) const;
+
+    // null with the reason in pResult when the file's missing, not SPIR-V or creation failed
+    auto                acquireModule(const char* pFilePath, Result* pResult=nullptr) -> std::shared_ptr<ShaderModule>;
+    auto                acquireModule(const ShaderBinary& binary, const char* pName, Result* pResult=nullptr)
+                            -> std::shared_ptr<ShaderModule>;
+
+    void                setBudget(size_t budget);
+    // destroys every unused module (all of them with a budget of 0)
+    void                reset(void);
+    Statistics          getStatistics(void) const;
+    void                log(DebugLog* pLog) const;
+
 private:
-    std::vector<ShaderModule> m_modules;
+    struct Entry {
+        std::shared_ptr<ShaderModule>   pModule;
+        std::vector<uint32_t>           code;       //only with keepCode
+        std::vector<std::string>        paths;      //in m_paths pointing here
+        uint64_t                        lastUse = 0;
+    };
+
+    struct PathEntry {
+        uint64_t                        hash;
+        size_t                          size;
+        int64_t                         modifiedTime;
+    };
+
+    // pFile's path gets pointed at the module it ends up with, when it's cached
+    auto                acquireLocked(const ShaderBinary& binary, uint64_t hash, const char* pName, Result* pResult,
+                                      const ShaderBinaryFile* pFile=nullptr) -> std::shared_ptr<ShaderModule>;
+    bool                matchesLocked(const Entry& entry, const ShaderBinary& binary) const;
+    void                addPathLocked(const ShaderBinaryFile& file, uint64_t hash, Entry* pEntry);
+    void                trimLocked(size_t budget);
+
+    Initializer                                 m_initializer;
+    mutable std::mutex                          m_mutex;
+    std::unordered_map<uint64_t, Entry>         m_modules;      //by content hash
+    std::unordered_map<std::string, PathEntry>  m_paths;        //only ones whose module is resident
+    uint64_t                                    m_useCounter    = 0;
+    size_t                                      m_residentSize  = 0;
+    Statistics                                  m_statistics;
 };
 
+inline ShaderBinary::ShaderBinary(const uint32_t* pData, size_t size): m_pData(pData), m_size(size) {}
+inline const uint32_t* ShaderBinary::getData(void) const { return m_pData; }
+inline size_t ShaderBinary::getSize(void) const { return m_size; }
+inline size_t ShaderBinary::getWordCount(void) const { return m_size / sizeof(uint32_t); }
+inline bool ShaderBinary::isValid(void) const {
+    return m_pData && m_size >= sizeof(uint32_t) && !(m_size % sizeof(uint32_t)) && m_pData[0] == kSpirvMagic;
+}
+
+inline const char* ShaderBinaryFile::getFilePath(void) const { return m_filePath.c_str(); }
+inline bool ShaderBinaryFile::isMapped(void) const { return m_pData != nullptr; }
+inline int64_t ShaderBinaryFile::getModifiedTime(void) const { return m_modifiedTime; }
 
+inline const char* ShaderModule::getName(void) const { return m_name.c_str(); }
+inline size_t ShaderModule::getCodeSize(void) const { return m_codeSize; }
+inline uint64_t ShaderModule::getHash(void) const { return m_hash; }
+inline Result ShaderModule::getResult(void) const { return m_result; }
+inline bool ShaderModule::isValid(void) const { return getResult() && getHandle() != VK_NULL_HANDLE; }
+inline auto ShaderModule::getReflection(void) const -> const std::shared_ptr<const ShaderReflection>& { return m_pReflection; }
 
+inline const char* ShaderModuleCache::getName(void) const { return m_initializer.name.c_str(); }
 
 }
 
@@ -0,0 +1,139 @@
+#ifndef ELYSIAN_RENDERER_SHADER_REFLECTION_HPP
+#define ELYSIAN_RENDERER_SHADER_REFLECTION_HPP
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "elysian_renderer_object.hpp"
+
+namespace elysian::renderer {
+
+class Device;
+class DebugLog;
+class ShaderBinary;
+class DescriptorSetLayoutBinding;
+
+// Resource interface of one SPIR-V module, read straight off its words in a single pass:
+// descriptor bindings, the push constant block, entry points and the compute workgroup
+// size. Stage flags are the union of every entry point's, modules are expected to carry
+// one (or at least share their resources).
+struct ShaderReflection {
+    struct Binding {
+        std::string         name;           //variable, or its block's type name when it has none
+        uint32_t            set;
+        uint32_t            binding;
+        VkDescriptorType    type;
+        uint32_t            count;          //array size, 0 for runtime sized (bindless) arrays
+        uint32_t            blockSize;      //uniform/storage blocks, without a trailing runtime array
+    };
+
+    struct PushConstantBlock {
+        std::string         name;
+        uint32_t            offset  = 0;    //of the first member
+        uint32_t            size    = 0;    //0 without push constants
+    };
+
+    struct EntryPoint {
+        std::string             name;
+        VkShaderStageFlagBits   stage;
+    };
+
+    uint64_t                    hash            = 0;    //of the SPIR-V words
+    size_t                      codeSize        = 0;    //bytes
+    VkShaderStageFlags          stages          = 0;
+    std::vector<EntryPoint>     entryPoints;
+    std::vector<Binding>        bindings;               //sorted by set, then binding
+    PushConstantBlock           pushConstants;
+    uint32_t                    localSize[3]    = { 0, 0, 0 }; //compute/task/mesh only
+
+    const Binding*  findBinding(uint32_t set, uint32_t binding) const;
+    const Binding*  findBinding(const char* pName) const;
+
+    // VK_ERROR_INITIALIZATION_FAILED for anything that isn't well formed SPIR-V
+    static Result   reflect(const ShaderBinary& binary, ShaderReflection* pReflection);
+};
+
+// Merges the reflections of a pipeline's stages into what its layouts are built from.
+// Bindings used by several stages get their stage flags combined. Reflection can't tell a
+// dynamic buffer from a plain one, setDescriptorType() overrides it per binding, and runtime
+// sized arrays come out with a count of 0 until setDescriptorCount() gives them their bound.
+class PipelineReflection {
+public:
+                    PipelineReflection(void) = default;
+                    PipelineReflection(const std::vector<const ShaderReflection*>& stages);
+
+    void            add(const ShaderReflection& stage);
+    // false when no stage uses the binding
+    bool            setDescriptorType(uint32_t set, uint32_t binding, VkDescriptorType type);
+    bool            setDescriptorCount(uint32_t set, uint32_t binding, uint32_t count);
+
+    uint32_t        getSetCount(void) const;                //highest set used + 1
+    auto            getBindings(uint32_t set) const -> std::vector<VkDescriptorSetLayoutBinding>;
+    // named, for building a DescriptorSetLayout
+    auto            getSetLayoutBindings(uint32_t set) const -> std::vector<DescriptorSetLayoutBinding>;
+    auto            getPushConstantRanges(void) const -> const std::vector<VkPushConstantRange>&;
+    // same set/binding declared differently by two stages, the first one won
+    bool            hasConflicts(void) const;
+
+    // One layout per set up to getSetCount(), unused sets in between get empty ones.
+    // The caller owns the handles.
+    Result          createSetLayouts(const Device* pDevice, std::vector<VkDescriptorSetLayout>* pSetLayouts,
+                                     VkDescriptorSetLayoutCreateFlags flags=0) const;
+    Result          createPipelineLayout(const Device* pDevice, const std::vector<VkDescriptorSetLayout>& setLayouts,
+                                         VkPipelineLayout* pLayout) const;
+
+    void            log(DebugLog* pLog) const;
+
+private:
+    struct Binding {
+        std::string                     name;
+        uint32_t                        set;
+        VkDescriptorSetLayoutBinding    layout;
+    };
+
+    Binding*        findBinding(uint32_t set, uint32_t binding);
+
+    std::vector<Binding>                m_bindings;     //sorted by set, then binding
+    std::vector<VkPushConstantRange>    m_pushConstantRanges;
+    bool                                m_conflicts = false;
+};
+
+// Reflections by content hash, so a module shared by thousands of materials (or reloaded)
+// is only ever parsed once. Matches on hash and code size, the same as ShaderModuleCache.
+class ShaderReflectionCache {
+public:
+    struct Statistics {
+        uint32_t    entryCount      = 0;
+        uint64_t    reflectCount    = 0;
+        uint64_t    hitCount        = 0;
+        uint64_t    failedCount     = 0;
+    };
+
+    // null with the result in pResult when it isn't valid SPIR-V
+    auto            reflect(const ShaderBinary& binary, Result* pResult=nullptr) -> std::shared_ptr<const ShaderReflection>;
+    auto            reflect(const ShaderBinary& binary, uint64_t hash, Result* pResult=nullptr)
+                        -> std::shared_ptr<const ShaderReflection>;
+    auto            find(uint64_t hash) const -> std::shared_ptr<const ShaderReflection>;
+
+    void            clear(void);
+    Statistics      getStatistics(void) const;
+    void            log(DebugLog* pLog) const;
+
+private:
+    mutable std::mutex                                                  m_mutex;
+    std::unordered_map<uint64_t, std::shared_ptr<const ShaderReflection>> m_reflections;
+    Statistics                                                          m_statistics;
+};
+
+inline PipelineReflection::PipelineReflection(const std::vector<const ShaderReflection*>& stages) {
+    for(const ShaderReflection* pStage : stages) add(*pStage);
+}
+
+inline auto PipelineReflection::getPushConstantRanges(void) const -> const std::vector<VkPushConstantRange>& { return m_pushConstantRanges; }
+inline bool PipelineReflection::hasConflicts(void) const { return m_conflicts; }
+
+}
+
+#endif // ELYSIAN_RENDERER_SHADER_REFLECTION_HPP
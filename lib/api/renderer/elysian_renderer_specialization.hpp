@@ -0,0 +1,192 @@
+#ifndef ELYSIAN_RENDERER_SPECIALIZATION_HPP
+#define ELYSIAN_RENDERER_SPECIALIZATION_HPP
+
+#include <array>
+#include <cstring>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include "elysian_renderer_object.hpp"
+#include "elysian_renderer_hash.hpp"
+
+namespace elysian::renderer {
+
+// One constant_id of a shader and the type its value is given as. bools are passed as a
+// VkBool32, which is what the driver reads for OpSpecConstantTrue/False.
+template<uint32_t ID, typename T>
+struct SpecializationConstant {
+    static_assert(std::is_same_v<T, bool> || std::is_same_v<T, int32_t> || std::is_same_v<T, uint32_t> ||
+                  std::is_same_v<T, int64_t> || std::is_same_v<T, uint64_t> ||
+                  std::is_same_v<T, float> || std::is_same_v<T, double>,
+                  "specialization constants are scalars");
+
+    static constexpr uint32_t   id = ID;
+    using Type                  = T;
+    using Storage               = std::conditional_t<std::is_same_v<T, bool>, VkBool32, T>;
+};
+
+// same as what GraphicsPipelineState folds into its Stages block
+inline uint64_t hashSpecializationInfo(const VkSpecializationInfo& info) {
+    const uint64_t hash = hashArray(info.pMapEntries, info.mapEntryCount);
+    return hashArray(static_cast<const uint8_t*>(info.pData), info.dataSize, hash);
+}
+
+namespace detail {
+    template<size_t Count>
+    struct SpecializationLayout {
+        std::array<VkSpecializationMapEntry, Count> mapEntries;
+        size_t                                      dataSize;
+    };
+
+    // packed in declaration order, each value at its natural alignment
+    template<size_t Count>
+    constexpr auto layoutSpecialization(const std::array<uint32_t, Count>& ids, const std::array<size_t, Count>& sizes) {
+        SpecializationLayout<Count> layout {};
+        size_t offset = 0;
+        for(size_t c = 0; c < Count; ++c) {
+            offset = (offset + sizes[c] - 1) / sizes[c] * sizes[c];
+            layout.mapEntries[c] = VkSpecializationMapEntry { ids[c], static_cast<uint32_t>(offset), sizes[c] };
+            offset += sizes[c];
+        }
+        layout.dataSize = offset;
+        return layout;
+    }
+
+    template<size_t Count>
+    constexpr size_t findSpecializationConstant(const std::array<uint32_t, Count>& ids, uint32_t id) {
+        for(size_t c = 0; c < Count; ++c) {
+            if(ids[c] == id) return c;
+        }
+        return Count;
+    }
+
+    template<size_t Count>
+    constexpr bool hasUniqueIds(const std::array<uint32_t, Count>& ids) {
+        for(size_t c = 0; c < Count; ++c) {
+            if(findSpecializationConstant(ids, ids[c]) != c) return false;
+        }
+        return true;
+    }
+}
+
+// Typed values for a shader's specialization constants. The map entries are worked out at
+// compile time from the constant list, setting a value is a store into the packed data:
+//
+//     using LightingSpecialization = SpecializationSet<SpecializationConstant<0, uint32_t>,  //light count
+//                                                      SpecializationConstant<1, bool>>;     //shadows
+//     LightingSpecialization specialization(4u, true);
+//     state.setShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT, module, "main", specialization);
+//
+// One module with a handful of these replaces a SPIR-V permutation per combination, and the
+// values end up in the variant key like any other pipeline state.
+template<typename... Constants>
+class SpecializationSet {
+    static constexpr std::array<uint32_t, sizeof...(Constants)> kIds = { Constants::id... };
+    static constexpr std::array<size_t, sizeof...(Constants)>   kSizes = { sizeof(typename Constants::Storage)... };
+    static constexpr auto                                       kLayout = detail::layoutSpecialization(kIds, kSizes);
+
+    static_assert(sizeof...(Constants), "no constants, no specialization");
+    static_assert(detail::hasUniqueIds(kIds), "constant_id used twice");
+
+    template<uint32_t ID>
+    static constexpr size_t kIndex = detail::findSpecializationConstant(kIds, ID);
+
+    template<uint32_t ID>
+    using Constant = std::tuple_element_t<kIndex<ID>, std::tuple<Constants...>>;
+
+public:
+    static constexpr uint32_t   kConstantCount  = sizeof...(Constants);
+    static constexpr size_t     kDataSize       = kLayout.dataSize;
+    static constexpr auto       kMapEntries     = kLayout.mapEntries;
+
+                    SpecializationSet(void) = default;              //zero/false
+    explicit        SpecializationSet(typename Constants::Type... values);
+
+    template<uint32_t ID>
+    SpecializationSet& set(typename Constant<ID>::Type value);
+    template<uint32_t ID>
+    auto            get(void) const -> typename Constant<ID>::Type;
+
+    // points into the set, it has to stay where it is for as long as the info's used
+    VkSpecializationInfo getInfo(void) const;
+    // a copy owning its data, for create infos that outlive the set
+    auto            makeInfo(void) const -> std::shared_ptr<const VkSpecializationInfo>;
+    uint64_t        getHash(void) const;
+
+    bool            operator==(const SpecializationSet& rhs) const;
+    bool            operator!=(const SpecializationSet& rhs) const;
+
+private:
+    template<typename T>
+    void            store(size_t offset, T value);
+
+    alignas(8) uint8_t  m_data[kDataSize] = {};
+};
+
+template<typename... Constants>
+inline SpecializationSet<Constants...>::SpecializationSet(typename Constants::Type... values) {
+    size_t c = 0;
+    (store<typename Constants::Storage>(kMapEntries[c++].offset, static_cast<typename Constants::Storage>(values)), ...);
+}
+
+template<typename... Constants>
+template<typename T>
+inline void SpecializationSet<Constants...>::store(size_t offset, T value) {
+    std::memcpy(m_data + offset, &value, sizeof(T));
+}
+
+template<typename... Constants>
+template<uint32_t ID>
+inline SpecializationSet<Constants...>& SpecializationSet<Constants...>::set(typename Constant<ID>::Type value) {
+    static_assert(kIndex<ID> < kConstantCount, "constant_id isn't in the set");
+    using Storage = typename Constant<ID>::Storage;
+    store<Storage>(kMapEntries[kIndex<ID>].offset, static_cast<Storage>(value));
+    return *this;
+}
+
+template<typename... Constants>
+template<uint32_t ID>
+inline auto SpecializationSet<Constants...>::get(void) const -> typename Constant<ID>::Type {
+    static_assert(kIndex<ID> < kConstantCount, "constant_id isn't in the set");
+    typename Constant<ID>::Storage value;
+    std::memcpy(&value, m_data + kMapEntries[kIndex<ID>].offset, sizeof(value));
+    return static_cast<typename Constant<ID>::Type>(value);
+}
+
+template<typename... Constants>
+inline VkSpecializationInfo SpecializationSet<Constants...>::getInfo(void) const {
+    return VkSpecializationInfo {
+        kConstantCount,
+        kMapEntries.data(),
+        kDataSize,
+        m_data
+    };
+}
+
+template<typename... Constants>
+inline auto SpecializationSet<Constants...>::makeInfo(void) const -> std::shared_ptr<const VkSpecializationInfo> {
+    struct Owned {
+        SpecializationSet       set;
+        VkSpecializationInfo    info;
+    };
+    auto pOwned = std::make_shared<Owned>(Owned{ *this, {} });
+    pOwned->info = pOwned->set.getInfo();
+    return std::shared_ptr<const VkSpecializationInfo>(pOwned, &pOwned->info);
+}
+
+template<typename... Constants>
+inline uint64_t SpecializationSet<Constants...>::getHash(void) const {
+    return hashSpecializationInfo(getInfo());
+}
+
+template<typename... Constants>
+inline bool SpecializationSet<Constants...>::operator==(const SpecializationSet& rhs) const {
+    return std::memcmp(m_data, rhs.m_data, sizeof(m_data)) == 0;
+}
+
+template<typename... Constants>
+inline bool SpecializationSet<Constants...>::operator!=(const SpecializationSet& rhs) const { return !(*this == rhs); }
+
+}
+
+#endif // ELYSIAN_RENDERER_SPECIALIZATION_HPP
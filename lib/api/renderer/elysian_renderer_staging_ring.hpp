@@ -0,0 +1,112 @@
+#ifndef ELYSIAN_RENDERER_STAGING_RING_HPP
+#define ELYSIAN_RENDERER_STAGING_RING_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "elysian_renderer_buffer.hpp"
+
+namespace elysian::renderer {
+
+class CommandBuffer;
+class Fence;
+
+// One persistently mapped host-visible buffer split into N per-frame regions which are
+// bump-allocated linearly. A region is only rewound once the fence of the submission which
+// last consumed it has signaled, so there's no map/unmap or allocation per upload.
+//
+// Per frame:
+//      ring.beginFrame();                      //before resetting this frame's fence!
+//      ring.uploadBuffer(pCmdBuffer, ...);
+//      ring.flush();
+//      ...submit with pFence...
+//      ring.endFrame(pFence);                  //only once the submission went through
+//
+// A frame that never gets submitted just isn't ended, nothing waits on its fence then.
+class StagingRing {
+public:
+
+    struct Initializer {
+        std::string     name;
+        const Device*   pDevice     = nullptr;
+        uint32_t        frameCount  = 3;
+        VkDeviceSize    frameSize   = 16 * 1024 * 1024;
+    };
+
+    struct Allocation {
+        void*           pData   = nullptr;  //host pointer to write through
+        VkBuffer        buffer  = VK_NULL_HANDLE;
+        VkDeviceSize    offset  = 0;        //within buffer
+        VkDeviceSize    size    = 0;
+
+        bool isValid(void) const { return pData != nullptr; }
+    };
+
+                    StagingRing(Initializer initializer);
+                    ~StagingRing(void);
+
+    const char*     getName(void) const;
+    Result          getResult(void) const;
+    bool            isValid(void) const;
+
+    uint32_t        getFrameIndex(void) const;
+    uint32_t        getFrameCount(void) const;
+    VkDeviceSize    getFrameSize(void) const;
+    VkDeviceSize    getFrameUsedSize(void) const;
+    const Buffer*   getBuffer(void) const;
+
+    // moves on to the next region, blocking until its last submission is done with it
+    Result          beginFrame(uint64_t timeout=UINT64_MAX);
+    // makes this frame's writes visible to the device, before submitting the copies
+    Result          flush(void);
+    // ties the region to the fence its copies were submitted with
+    void            endFrame(const Fence* pFence);
+
+    // invalid when the frame's region is full, 0 alignment = optimalBufferCopyOffsetAlignment
+    Allocation      allocate(VkDeviceSize size, VkDeviceSize alignment=0);
+
+    bool            uploadBuffer(CommandBuffer*     pCmdBuffer,
+                                 VkBuffer           dstBuffer,
+                                 VkDeviceSize       dstOffset,
+                                 const void*        pData,
+                                 VkDeviceSize       size);
+
+    // region.bufferOffset gets filled in, alignment has to respect the texel block size
+    bool            uploadImage(CommandBuffer*              pCmdBuffer,
+                                VkImage                     dstImage,
+                                VkImageLayout               dstImageLayout,
+                                VkBufferImageCopy           region,
+                                const void*                 pData,
+                                VkDeviceSize                size,
+                                VkDeviceSize                alignment=0);
+
+private:
+    struct Frame {
+        VkDeviceSize    usedSize    = 0;
+        const Fence*    pFence      = nullptr;
+    };
+
+    Initializer                     m_initializer;
+    std::unique_ptr<Buffer>         m_pBuffer;
+    std::shared_ptr<DeviceMemory>   m_pMemory;
+    char*                           m_pMappedData   = nullptr;
+    std::vector<Frame>              m_frames;
+    uint32_t                        m_frameIndex    = 0;
+    VkDeviceSize                    m_alignment     = 16;
+    VkDeviceSize                    m_atomSize      = 1;
+    bool                            m_coherent      = true;
+    Result                          m_result;
+};
+
+inline const char* StagingRing::getName(void) const { return m_initializer.name.c_str(); }
+inline Result StagingRing::getResult(void) const { return m_result; }
+inline bool StagingRing::isValid(void) const { return getResult() && m_pMappedData; }
+inline uint32_t StagingRing::getFrameIndex(void) const { return m_frameIndex; }
+inline uint32_t StagingRing::getFrameCount(void) const { return m_initializer.frameCount; }
+inline VkDeviceSize StagingRing::getFrameSize(void) const { return m_initializer.frameSize; }
+inline VkDeviceSize StagingRing::getFrameUsedSize(void) const { return m_frames[m_frameIndex].usedSize; }
+inline const Buffer* StagingRing::getBuffer(void) const { return m_pBuffer.get(); }
+
+}
+
+#endif // ELYSIAN_RENDERER_STAGING_RING_HPP
@@ -97,18 +97,18 @@ inline Swapchain::Swapchain(Initializer initializer):
     m_pDevice(initializer.pDevice),
     m_pInfo(std::move(initializer.pInfo))
 {
-    m_result = vkCreateSwapchainKHR(m_pDevice, m_pInfo.get(), nullptr, &m_handle);
+    m_result = vkCreateSwapchainKHR(m_pDevice->getHandle(), m_pInfo.get(), m_pDevice->getAllocationCallbacks(), &m_handle);
     uint32_t imageCount;
 
     if(m_result) {
-        vkGetSwapchainImagesKHR(m_pDevice, m_handle, &imageCount, nullptr);
+        vkGetSwapchainImagesKHR(m_pDevice->getHandle(), m_handle, &imageCount, nullptr);
         m_images.resize(imageCount);
-        vkGetSwapchainImagesKHR(m_pDevice, m_handle, &imageCount, m_images.data());
+        vkGetSwapchainImagesKHR(m_pDevice->getHandle(), m_handle, &imageCount, m_images.data());
     }
 }
 
 inline Swapchain::~Swapchain(void) {
-    vkDestroySwapchainKHR(m_pDevice, getHandle(), nullptr);
+    vkDestroySwapchainKHR(m_pDevice->getHandle(), getHandle(), m_pDevice->getAllocationCallbacks());
 }
 
 inline Swapchain::operator VkSwapChainKHR() const { return getHandle(); }
@@ -0,0 +1,75 @@
+#ifndef ELYSIAN_RENDERER_THREAD_REGISTRY_HPP
+#define ELYSIAN_RENDERER_THREAD_REGISTRY_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace elysian::renderer {
+
+// Finds the calling thread's Context for one owner (a CommandPoolManager, a
+// DescriptorAllocator...) without taking a lock. The owner keeps the contexts alive, this
+// only remembers which one belongs to the current thread.
+//
+// Every thread keeps a short list of (owner id, context) per Context type. A thread only
+// ever talks to a handful of owners, linear search beats hashing. Entries of destroyed
+// owners expire with them and get pruned whenever a new one is added, so the list never
+// outgrows the owners that are alive.
+template<typename Context>
+class ThreadRegistry {
+public:
+                ThreadRegistry(void);
+                ThreadRegistry(const ThreadRegistry&) = delete;
+    ThreadRegistry& operator=(const ThreadRegistry&) = delete;
+
+    Context*    find(void) const;               //null until this thread add()ed one
+    void        add(Context* pContext);         //has to outlive the registry
+
+private:
+    struct Entry {
+        uint64_t            registryId;
+        Context*            pContext;
+        std::weak_ptr<bool> lifetime;           //expired once the registry is gone
+    };
+
+    static auto getThreadEntries(void) -> std::vector<Entry>&;
+
+    uint64_t                m_id;               //unique per Context type
+    std::shared_ptr<bool>   m_pLifetime = std::make_shared<bool>(true);
+};
+
+template<typename Context>
+inline ThreadRegistry<Context>::ThreadRegistry(void) {
+    static std::atomic<uint64_t> idCounter = { 0 };
+    m_id = ++idCounter;
+}
+
+template<typename Context>
+inline auto ThreadRegistry<Context>::getThreadEntries(void) -> std::vector<Entry>& {
+    thread_local std::vector<Entry> entries;
+    return entries;
+}
+
+template<typename Context>
+inline Context* ThreadRegistry<Context>::find(void) const {
+    for(const Entry& entry : getThreadEntries()) {
+        if(entry.registryId == m_id) return entry.pContext;
+    }
+    return nullptr;
+}
+
+template<typename Context>
+inline void ThreadRegistry<Context>::add(Context* pContext) {
+    auto& entries = getThreadEntries();
+    entries.erase(std::remove_if(entries.begin(), entries.end(), [](const Entry& entry) {
+                      return entry.lifetime.expired();
+                  }),
+                  entries.end());
+    entries.push_back({ m_id, pContext, m_pLifetime });
+}
+
+}
+
+#endif // ELYSIAN_RENDERER_THREAD_REGISTRY_HPP
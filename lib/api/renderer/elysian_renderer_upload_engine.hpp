@@ -0,0 +1,186 @@
+#ifndef ELYSIAN_RENDERER_UPLOAD_ENGINE_HPP
+#define ELYSIAN_RENDERER_UPLOAD_ENGINE_HPP
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "elysian_renderer_staging_ring.hpp"
+
+namespace elysian::renderer {
+
+class Queue;
+class CommandPool;
+class CommandBuffer;
+class CommandBufferGroup;
+class Semaphore;
+class Fence;
+
+// Streams buffer/image data to the GPU on a dedicated transfer queue so uploads stop
+// stalling graphics/compute. upload() can be called from any thread; it copies the data
+// into a StagingRing right away and queues the copy, flush() batches everything queued
+// into a single command buffer submission.
+//
+// Each batch signals a Token: a timeline semaphore value when available, otherwise the
+// batch's fence. Resources handed to another queue family get a release barrier at the
+// end of the batch, the consumer records the matching acquire with cmdAcquire() and
+// waits on the token it returns.
+//
+// NOTE: on a transfer-only family every upload needs a destination family, either its own
+// dstQueueFamilyIndex or Initializer::dstQueueFamilyIndex, otherwise it's refused. Without
+// one an EXCLUSIVE resource would never be released to the queue that reads it. Resources
+// created with VK_SHARING_MODE_CONCURRENT don't need the transfer: pass the engine's own
+// getQueueFamilyIndex() to skip the barriers.
+//
+// The engine owns its queue, nothing else may submit to it concurrently.
+class UploadEngine {
+public:
+
+    struct Initializer {
+        std::string     name;
+        const Device*   pDevice                 = nullptr;
+        const Queue*    pQueue                  = nullptr;  //nullptr picks a transfer-only family
+        uint32_t        batchCount              = 3;        //batches in flight
+        VkDeviceSize    batchSize               = 32 * 1024 * 1024;
+        bool            timelineSemaphore       = true;     //needs the 1.2 timelineSemaphore feature
+        uint32_t        dstQueueFamilyIndex     = VK_QUEUE_FAMILY_IGNORED; //for uploads which don't pick their own
+    };
+
+    struct Token {
+        uint64_t    value = 0; //0 = nothing to wait on
+
+        bool isValid(void) const { return value != 0; }
+    };
+
+    struct BufferUpload {
+        VkBuffer        buffer                  = VK_NULL_HANDLE;
+        VkDeviceSize    offset                  = 0;
+        const void*     pData                   = nullptr;
+        VkDeviceSize    size                    = 0;
+        uint32_t        dstQueueFamilyIndex     = VK_QUEUE_FAMILY_IGNORED; //ignored = Initializer::dstQueueFamilyIndex
+    };
+
+    // whole subresources only, previous contents are discarded
+    struct ImageUpload {
+        VkImage             image               = VK_NULL_HANDLE;
+        VkBufferImageCopy   region              = {};   //bufferOffset is filled in
+        const void*         pData               = nullptr;
+        VkDeviceSize        size                = 0;
+        VkDeviceSize        alignment           = 0;    //texel block size, 0 = ring default
+        VkImageLayout       finalLayout         = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        uint32_t            dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED; //ignored = Initializer::dstQueueFamilyIndex
+    };
+
+    struct Statistics {
+        uint64_t        batchCount      = 0;
+        uint64_t        bufferCopyCount = 0;
+        uint64_t        imageCopyCount  = 0;
+        uint64_t        bytesUploaded   = 0;
+    };
+
+                        UploadEngine(Initializer initializer);
+                        ~UploadEngine(void);
+
+    const char*         getName(void) const;
+    Result              getResult(void) const;
+    bool                isValid(void) const;
+    const Queue*        getQueue(void) const;
+    uint32_t            getQueueFamilyIndex(void) const;
+    const Semaphore*    getTimelineSemaphore(void) const; //nullptr in fence mode
+    Statistics          getStatistics(void) const;
+
+    // invalid token when the data doesn't fit into a batch or there's no destination family
+    Token               upload(const BufferUpload& request);
+    Token               upload(const ImageUpload& request);
+
+    // submits everything queued so far, returns the token of the last submitted batch.
+    // When the submission fails the uploads stay queued for the next flush(),
+    // getSubmitResult() holds the error until a submission goes through again and wait()
+    // on their tokens returns it.
+    Token               flush(void);
+    Result              getSubmitResult(void) const;
+
+    bool                isComplete(Token token) const;
+    Result              wait(Token token, uint64_t timeout=UINT64_MAX);
+
+    // records acquire barriers for everything released to queueFamilyIndex so far,
+    // the returned token has to be waited on before pCmdBuffer executes
+    Token               cmdAcquire(CommandBuffer*       pCmdBuffer,
+                                   uint32_t             queueFamilyIndex,
+                                   VkPipelineStageFlags dstStageMask);
+
+    void                log(DebugLog* pLog) const;
+
+private:
+    struct PendingBuffer {
+        VkBuffer            buffer;
+        VkBufferCopy        copy;
+        uint32_t            dstQueueFamilyIndex;
+    };
+
+    struct PendingImage {
+        VkImage             image;
+        VkBufferImageCopy   copy;
+        VkDeviceSize        size;
+        VkImageLayout       finalLayout;
+        uint32_t            dstQueueFamilyIndex;
+    };
+
+    struct Acquire {
+        uint32_t                queueFamilyIndex;
+        uint64_t                value;
+        bool                    isImage;
+        VkBufferMemoryBarrier   bufferBarrier;
+        VkImageMemoryBarrier    imageBarrier;
+    };
+
+    struct Batch {
+        std::unique_ptr<Fence>  pFence;
+        CommandBuffer*          pCmdBuffer  = nullptr;
+        uint64_t                value       = 0; //submitted and not reopened yet, 0 = nothing in flight
+        uint32_t                waiters     = 0; //wait() calls blocked on pFence outside the lock
+    };
+
+    static const Queue* findTransferQueue(const Device* pDevice);
+
+    uint32_t                getDstQueueFamilyIndex(uint32_t requested) const;
+    StagingRing::Allocation reserve(std::unique_lock<std::mutex>& lock, VkDeviceSize size, VkDeviceSize alignment);
+    void                    release(void);
+    Token                   flushLocked(std::unique_lock<std::mutex>& lock);
+    Result                  recordAndSubmit(Batch& batch, uint64_t value, std::vector<Acquire>* pAcquires);
+    void                    nextBatch(std::unique_lock<std::mutex>& lock);
+    bool                    isCompleteLocked(uint64_t value) const;
+
+    Initializer                             m_initializer;
+    const Queue*                            m_pQueue            = nullptr;
+    bool                                    m_transferOnly      = false;
+    std::unique_ptr<StagingRing>            m_pRing;
+    std::unique_ptr<CommandPool>            m_pCommandPool;
+    std::unique_ptr<CommandBufferGroup>     m_pCommandGroup;
+    std::unique_ptr<Semaphore>              m_pTimeline;
+    std::vector<Batch>                      m_batches;
+
+    mutable std::mutex                      m_mutex;
+    std::condition_variable                 m_flushReady;
+    uint32_t                                m_writers           = 0; //memcpy into the ring outside the lock
+    bool                                    m_opening           = false; //waiting for the next region unlocked
+    std::vector<PendingBuffer>              m_pendingBuffers;
+    std::vector<PendingImage>               m_pendingImages;
+    std::vector<Acquire>                    m_acquires;
+    uint64_t                                m_submittedValue    = 0;
+    uint64_t                                m_completedValue    = 0;
+    Statistics                              m_statistics;
+    Result                                  m_submitResult      = VK_SUCCESS;
+    Result                                  m_result;
+};
+
+inline const char* UploadEngine::getName(void) const { return m_initializer.name.c_str(); }
+inline Result UploadEngine::getResult(void) const { return m_result; }
+inline bool UploadEngine::isValid(void) const { return getResult() && m_pQueue && m_pRing && m_pRing->isValid(); }
+inline const Queue* UploadEngine::getQueue(void) const { return m_pQueue; }
+inline const Semaphore* UploadEngine::getTimelineSemaphore(void) const { return m_pTimeline.get(); }
+
+}
+
+#endif // ELYSIAN_RENDERER_UPLOAD_ENGINE_HPP
@@ -0,0 +1,117 @@
+#ifndef ELYSIAN_RENDERER_VMA_HPP
+#define ELYSIAN_RENDERER_VMA_HPP
+
+#include <vector>
+#include "elysian_renderer_result.hpp"
+
+// Same opaque handles vk_mem_alloc.h declares, so we don't drag it into every header
+struct VmaAllocator_T;
+struct VmaAllocation_T;
+
+namespace elysian::renderer {
+
+class Instance;
+class Device;
+class DebugLog;
+
+// Resource creation backed by AMD's Vulkan Memory Allocator (lib/lib/vma).
+// Create + allocate + bind is one call, memory comes out of VMA's pooled blocks
+// instead of one vkAllocateMemory per resource.
+class VmaBackend {
+public:
+
+    enum class MemoryUsage: uint8_t {
+        GpuOnly,    // device local, never touched by the host
+        Upload,     // host writes sequentially, device reads (staging, per-frame uniforms)
+        Readback,   // device writes, host reads randomly
+        Auto        // let VMA decide from the resource usage flags
+    };
+
+    struct AllocationCreateInfo {
+        MemoryUsage             usage               = MemoryUsage::GpuOnly;
+        bool                    persistentlyMapped  = false;
+        bool                    dedicated           = false; //force a dedicated VkDeviceMemory
+        bool                    withinBudget        = false; //fail instead of going over budget
+        VkMemoryPropertyFlags   requiredFlags       = 0;
+        float                   priority            = 0.5f;  //VK_EXT_memory_priority
+    };
+
+    struct Allocation {
+        VmaAllocation_T*    pHandle         = nullptr;
+        VkDeviceMemory      memory          = VK_NULL_HANDLE;
+        VkDeviceSize        offset          = 0;
+        VkDeviceSize        size            = 0;
+        uint32_t            memoryTypeIndex = 0;
+        void*               pMappedData     = nullptr;
+        bool                dedicated       = false;
+
+        bool isValid(void) const { return pHandle != nullptr; }
+    };
+
+    struct Budget {
+        VkDeviceSize    blockBytes      = 0; //VkDeviceMemory owned by VMA
+        VkDeviceSize    allocationBytes = 0; //handed out to resources
+        VkDeviceSize    usage           = 0; //whole process, from VK_EXT_memory_budget if available
+        VkDeviceSize    budget          = 0;
+        uint32_t        blockCount      = 0;
+        uint32_t        allocationCount = 0;
+    };
+
+    struct Initializer {
+        const Instance*     pInstance                   = nullptr;
+        const Device*       pDevice                     = nullptr;
+        Version             apiVersion                  = Version(1, 2, 0);
+        bool                memoryBudget                = false; //VK_EXT_memory_budget is enabled
+        bool                bufferDeviceAddress         = false;
+        VkDeviceSize        preferredBlockSize          = 0;     //0 = VMA default
+        VkDeviceSize        dedicatedThreshold          = 32 * 1024 * 1024;
+    };
+
+                        VmaBackend(Initializer initializer);
+                        ~VmaBackend(void);
+
+    Result              getResult(void) const;
+    bool                isValid(void) const;
+    VmaAllocator_T*     getHandle(void) const;
+    const Device*       getDevice(void) const;
+
+    Result              createBuffer(const VkBufferCreateInfo&   bufferInfo,
+                                     const AllocationCreateInfo& allocInfo,
+                                     VkBuffer*                   pBuffer,
+                                     Allocation*                 pAllocation) const;
+    void                destroyBuffer(VkBuffer buffer, Allocation& allocation) const;
+
+    Result              createImage(const VkImageCreateInfo&     imageInfo,
+                                    const AllocationCreateInfo&  allocInfo,
+                                    VkImage*                     pImage,
+                                    Allocation*                  pAllocation) const;
+    void                destroyImage(VkImage image, Allocation& allocation) const;
+
+    Result              mapMemory(const Allocation& allocation, void** ppData) const;
+    void                unmapMemory(const Allocation& allocation) const;
+    Result              flush(const Allocation& allocation, VkDeviceSize offset=0, VkDeviceSize size=VK_WHOLE_SIZE) const;
+    Result              invalidate(const Allocation& allocation, VkDeviceSize offset=0, VkDeviceSize size=VK_WHOLE_SIZE) const;
+
+    // one entry per memory heap, refreshed from the driver at most once per frame index
+    std::vector<Budget> getBudgets(void) const;
+    void                setCurrentFrameIndex(uint32_t frameIndex) const;
+
+    void                log(DebugLog* pLog) const;
+
+private:
+    bool                shouldUseDedicated(VkDeviceSize size, bool renderTarget, const AllocationCreateInfo& allocInfo) const;
+    Result              finishAllocation(Result result, Allocation* pAllocation) const;
+
+    Initializer         m_initializer;
+    VmaAllocator_T*     m_pAllocator    = nullptr;
+    Result              m_result;
+};
+
+inline Result VmaBackend::getResult(void) const { return m_result; }
+inline bool VmaBackend::isValid(void) const { return getResult() && m_pAllocator; }
+inline VmaAllocator_T* VmaBackend::getHandle(void) const { return m_pAllocator; }
+inline const Device* VmaBackend::getDevice(void) const { return m_initializer.pDevice; }
+
+}
+
+#endif // ELYSIAN_RENDERER_VMA_HPP
@@ -0,0 +1,60 @@
+#ifndef ELYSIAN_RENDERER_WORKER_POOL_HPP
+#define ELYSIAN_RENDERER_WORKER_POOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace elysian::renderer {
+
+// Bare bones fixed size thread pool for the renderer's own fan-out work (parallel
+// recording, pipeline compilation). Workers are long lived, so anything keyed off
+// thread_local storage (CommandPoolManager) stays warm across frames.
+class WorkerPool {
+public:
+                WorkerPool(uint32_t threadCount=std::thread::hardware_concurrency());
+                ~WorkerPool(void);
+
+                WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    uint32_t    getThreadCount(void) const;
+
+    template<typename F>
+    auto        submit(F&& task) -> std::future<std::invoke_result_t<F>>;
+
+    // runs fn(0..count-1) spread across the workers and the calling thread, returns once
+    // every index is done. Safe to nest, the caller keeps pulling indices itself.
+    void        parallelFor(uint32_t count, const std::function<void(uint32_t)>& fn);
+
+private:
+    void        enqueue(std::function<void(void)> task);
+    void        run(void);
+
+    std::vector<std::thread>                m_threads;
+    std::mutex                              m_mutex;
+    std::condition_variable                 m_wakeUp;
+    std::deque<std::function<void(void)>>   m_tasks;
+    bool                                    m_stopping  = false;
+};
+
+inline uint32_t WorkerPool::getThreadCount(void) const { return static_cast<uint32_t>(m_threads.size()); }
+
+template<typename F>
+inline auto WorkerPool::submit(F&& task) -> std::future<std::invoke_result_t<F>> {
+    // std::function wants copyable callables
+    auto pTask = std::make_shared<std::packaged_task<std::invoke_result_t<F>(void)>>(std::forward<F>(task));
+    auto future = pTask->get_future();
+    enqueue([pTask]{ (*pTask)(); });
+    return future;
+}
+
+}
+
+#endif // ELYSIAN_RENDERER_WORKER_POOL_HPP
@@ -1,6 +1,6 @@
 #include <renderer/elysian_renderer.hpp>
 #include <renderer/elysian_renderer_instance.hpp>
-//#include <renderer/elysian_renderer_allocator.hpp>
+#include <renderer/elysian_renderer_allocator.hpp>
 #include <renderer/elysian_renderer_physical_device.hpp>
 #include <renderer/elysian_renderer_device.hpp>
 #include <renderer/elysian_renderer_debug_log.hpp>
@@ -64,9 +64,16 @@ bool Renderer::createInstance(const InstanceInitializer& initializer) {
 
 
 void Renderer::setAllocator(const Allocator *pAllocator) {
-#if 0
-    m_pAllocator.reset(new Allocator(pAllocator));
-#endif
+    // everything has to be freed through the same callbacks it was allocated with
+    if(m_pInstance) {
+        getLog()->error("Cannot change the allocator after the instance has been created!");
+        return;
+    }
+    m_pAllocator = pAllocator;
+}
+
+const VkAllocationCallbacks* Renderer::getAllocationCallbacks(void) const {
+    return m_pAllocator? static_cast<const VkAllocationCallbacks*>(*m_pAllocator) : nullptr;
 }
 
 const PhysicalDevice* Renderer::getPhysicalDevice(int index) const {
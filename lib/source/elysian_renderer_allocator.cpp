@@ -0,0 +1,418 @@
+#include <renderer/elysian_renderer_allocator.hpp>
+#include <renderer/elysian_renderer_debug_log.hpp>
+#include <atomic>
+#include <cassert>
+#include <cinttypes>
+#include <cstdlib>
+#include <cstring>
+
+namespace elysian::renderer {
+
+namespace {
+
+// Sits right in front of every pointer we hand to the driver
+struct BlockHeader {
+    uint64_t    size;       //requested size
+    uint8_t     route;
+    uint8_t     scope;      //kTrackedBit set when it went into the counters
+    uint16_t    sizeClass;
+    uint32_t    offset;     //user pointer - raw pointer, to get back to what we really allocated
+};
+static_assert(sizeof(BlockHeader) == Allocator::kHeaderSize, "header must keep 16 byte alignment");
+
+constexpr uint8_t kTrackedBit = 0x80;
+
+// COMMAND scope memory only lives for the duration of a single vkCmd/vkCreate call on the
+// calling thread, so a bump pointer which rewinds once everything has been freed is enough.
+struct ThreadArena {
+    char*                   pBase   = nullptr;
+    size_t                  offset  = 0;
+    std::atomic<uint32_t>   live    = 0;
+
+    ~ThreadArena(void) { std::free(pBase); }
+};
+
+thread_local ThreadArena tArena;
+
+inline BlockHeader* getHeader(const void* pMemory) {
+    return reinterpret_cast<BlockHeader*>(const_cast<char*>(static_cast<const char*>(pMemory)) - sizeof(BlockHeader));
+}
+
+inline uintptr_t alignUp(uintptr_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+}
+
+inline size_t poolCapacity(uint32_t sizeClass) { return Allocator::kPoolMinSize << sizeClass; }
+inline size_t poolStride(uint32_t sizeClass) { return poolCapacity(sizeClass) + sizeof(BlockHeader); }
+
+inline uint32_t poolClass(size_t size) {
+    uint32_t sizeClass = 0;
+    while(poolCapacity(sizeClass) < size) ++sizeClass;
+    return sizeClass;
+}
+
+inline void* finishBlock(char* pRaw, char* pUser, size_t size, Allocator::Route route, uint32_t sizeClass=0) {
+    BlockHeader* pHeader = getHeader(pUser);
+    pHeader->size = size;
+    pHeader->route = static_cast<uint8_t>(route);
+    pHeader->scope = 0;
+    pHeader->sizeClass = static_cast<uint16_t>(sizeClass);
+    pHeader->offset = static_cast<uint32_t>(pUser - pRaw);
+    return pUser;
+}
+
+}
+
+Allocator::Allocator(void):
+    VkAllocationCallbacks({
+        this,
+        &Allocator::allocationCallback,
+        &Allocator::reallocationCallback,
+        &Allocator::freeCallback,
+        &Allocator::internalAllocationNotificationCallback,
+        &Allocator::internalFreeNotificationCallback
+    })
+{}
+
+Allocator::~Allocator(void) {
+    for(auto& pool : m_pools) {
+        for(void* pSlab : pool.slabs) std::free(pSlab);
+    }
+}
+
+void* Allocator::allocate(size_t size, size_t alignment, VkSystemAllocationScope allocationScope) {
+    if(!size) return nullptr;
+    alignment = alignment > kHeaderSize? alignment : kHeaderSize;
+
+    void* pMemory = nullptr;
+    switch(allocationScope) {
+    case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND:
+        pMemory = allocateArena(size, alignment);
+        break;
+    case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT:
+        pMemory = allocatePool(size, alignment);
+        break;
+    default:
+        break;
+    }
+    // anything the arena/pools can't take falls through to the heap
+    if(!pMemory) pMemory = allocateHeap(size, alignment);
+
+    if(pMemory) {
+        // pool blocks are recycled, so always overwrite whatever the last user left behind
+        const bool tracked = isTrackingEnabled();
+        getHeader(pMemory)->scope = tracked? static_cast<uint8_t>(allocationScope) | kTrackedBit : 0;
+        if(tracked) m_scopeCounters[allocationScope].add(size);
+    }
+    return pMemory;
+}
+
+void* Allocator::reallocate(void* pOriginal, size_t size, size_t alignment, VkSystemAllocationScope allocationScope) {
+    if(!pOriginal) return allocate(size, alignment, allocationScope);
+    if(!size) {
+        free(pOriginal);
+        return nullptr;
+    }
+    alignment = alignment > kHeaderSize? alignment : kHeaderSize;
+
+    BlockHeader* pHeader = getHeader(pOriginal);
+    const size_t capacity = static_cast<Route>(pHeader->route) == Route::Pool?
+                                poolCapacity(pHeader->sizeClass) : pHeader->size;
+
+    // still fits where it is
+    if(size <= capacity && !(reinterpret_cast<uintptr_t>(pOriginal) & (alignment - 1))) {
+        if(pHeader->scope & kTrackedBit) {
+            m_scopeCounters[pHeader->scope & ~kTrackedBit].resize(pHeader->size, size);
+        }
+        pHeader->size = size;
+        return pOriginal;
+    }
+
+    // spec says the original has to stay intact if this fails
+    void* pMemory = allocate(size, alignment, allocationScope);
+    if(pMemory) {
+        std::memcpy(pMemory, pOriginal, pHeader->size < size? pHeader->size : size);
+        free(pOriginal);
+    }
+    return pMemory;
+}
+
+void Allocator::free(void* pMemory) {
+    if(!pMemory) return;
+    BlockHeader* pHeader = getHeader(pMemory);
+    char* pRaw = static_cast<char*>(pMemory) - pHeader->offset;
+
+    if(pHeader->scope & kTrackedBit) {
+        m_scopeCounters[pHeader->scope & ~kTrackedBit].remove(pHeader->size);
+    }
+
+    switch(static_cast<Route>(pHeader->route)) {
+    case Route::Heap:
+        std::free(pRaw);
+        break;
+    case Route::Pool: {
+        Pool& pool = m_pools[pHeader->sizeClass];
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        *static_cast<void**>(pMemory) = pool.pFreeList;
+        pool.pFreeList = pMemory;
+        break;
+    }
+    case Route::Arena: {
+        // owning arena is stashed right in front of the header
+        ThreadArena* pArena = *reinterpret_cast<ThreadArena**>(reinterpret_cast<char*>(pHeader) - sizeof(ThreadArena*));
+        pArena->live.fetch_sub(1, std::memory_order_release);
+        break;
+    }
+    }
+}
+
+void* Allocator::allocateHeap(size_t size, size_t alignment) {
+    char* pRaw = static_cast<char*>(std::malloc(size + alignment + kHeaderSize));
+    if(!pRaw) return nullptr;
+    char* pUser = reinterpret_cast<char*>(alignUp(reinterpret_cast<uintptr_t>(pRaw) + kHeaderSize, alignment));
+    return finishBlock(pRaw, pUser, size, Route::Heap);
+}
+
+void* Allocator::allocatePool(size_t size, size_t alignment) {
+    // slabs only guarantee the header alignment
+    if(size > kPoolMaxSize || alignment > kHeaderSize) return nullptr;
+
+    const uint32_t sizeClass = poolClass(size);
+    Pool& pool = m_pools[sizeClass];
+    std::lock_guard<std::mutex> lock(pool.mutex);
+
+    if(!pool.pFreeList) {
+        const size_t stride = poolStride(sizeClass);
+        char* pSlab = static_cast<char*>(std::malloc(kPoolSlabSize));
+        if(!pSlab) return nullptr;
+        pool.slabs.push_back(pSlab);
+
+        for(size_t offset = 0; offset + stride <= kPoolSlabSize; offset += stride) {
+            char* pUser = pSlab + offset + kHeaderSize;
+            finishBlock(pUser - kHeaderSize, pUser, 0, Route::Pool, sizeClass);
+            *reinterpret_cast<void**>(pUser) = pool.pFreeList;
+            pool.pFreeList = pUser;
+        }
+    }
+
+    void* pUser = pool.pFreeList;
+    pool.pFreeList = *static_cast<void**>(pUser);
+    getHeader(pUser)->size = size;
+    return pUser;
+}
+
+void* Allocator::allocateArena(size_t size, size_t alignment) {
+    ThreadArena& arena = tArena;
+    if(!arena.pBase) {
+        arena.pBase = static_cast<char*>(std::malloc(kArenaSize));
+        if(!arena.pBase) return nullptr;
+    }
+
+    // everything handed out so far came back, rewind
+    if(!arena.live.load(std::memory_order_acquire)) arena.offset = 0;
+
+    char* pStart = arena.pBase + arena.offset;
+    char* pUser = reinterpret_cast<char*>(alignUp(reinterpret_cast<uintptr_t>(pStart) + kHeaderSize + sizeof(ThreadArena*), alignment));
+    if(pUser + size > arena.pBase + kArenaSize) return nullptr;
+
+    *reinterpret_cast<ThreadArena**>(pUser - kHeaderSize - sizeof(ThreadArena*)) = &arena;
+    arena.offset = static_cast<size_t>(pUser + size - arena.pBase);
+    arena.live.fetch_add(1, std::memory_order_relaxed);
+    return finishBlock(pStart, pUser, size, Route::Arena);
+}
+
+// Driver memory which doesn't go through our callbacks (executable code mostly).
+// The spec pairs every free notification with an allocation notification, so no
+// tracked bit needed here, only toggling tracking mid-flight can skew these.
+void Allocator::internalAllocationNotification(size_t                   size,
+                                               VkInternalAllocationType allocationType,
+                                               VkSystemAllocationScope  allocationScope)
+{
+    if(isTrackingEnabled()) m_internalCounters[allocationType].add(size);
+}
+
+void Allocator::internalFreeNotification(size_t                     size,
+                                         VkInternalAllocationType   allocationType,
+                                         VkSystemAllocationScope    allocationScope)
+{
+    if(isTrackingEnabled()) m_internalCounters[allocationType].remove(size);
+}
+
+void Allocator::AtomicCounters::add(uint64_t size) {
+    const uint64_t live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    uint64_t peak = peakBytes.load(std::memory_order_relaxed);
+    while(live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed));
+    liveCount.fetch_add(1, std::memory_order_relaxed);
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Allocator::AtomicCounters::remove(uint64_t size) {
+    // clamp instead of wrapping, internal notifications can start mid-flight
+    uint64_t live = liveBytes.load(std::memory_order_relaxed);
+    while(!liveBytes.compare_exchange_weak(live, live > size? live - size : 0, std::memory_order_relaxed));
+    uint64_t count = liveCount.load(std::memory_order_relaxed);
+    while(count && !liveCount.compare_exchange_weak(count, count - 1, std::memory_order_relaxed));
+    freeCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+// same block, so only the bytes move, the allocation/free counts stay put
+void Allocator::AtomicCounters::resize(uint64_t oldSize, uint64_t newSize) {
+    if(newSize >= oldSize) {
+        const uint64_t growth = newSize - oldSize;
+        const uint64_t live = liveBytes.fetch_add(growth, std::memory_order_relaxed) + growth;
+        uint64_t peak = peakBytes.load(std::memory_order_relaxed);
+        while(live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed));
+    } else {
+        const uint64_t shrink = oldSize - newSize;
+        uint64_t live = liveBytes.load(std::memory_order_relaxed);
+        while(!liveBytes.compare_exchange_weak(live, live > shrink? live - shrink : 0, std::memory_order_relaxed));
+    }
+    resizeCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+// live bytes stay, outstanding blocks still have to come back out of them
+void Allocator::AtomicCounters::reset(void) {
+    peakBytes.store(liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    allocationCount.store(0, std::memory_order_relaxed);
+    freeCount.store(0, std::memory_order_relaxed);
+    resizeCount.store(0, std::memory_order_relaxed);
+}
+
+Allocator::Counters Allocator::AtomicCounters::load(void) const {
+    Counters counters;
+    counters.liveBytes = liveBytes.load(std::memory_order_relaxed);
+    counters.peakBytes = peakBytes.load(std::memory_order_relaxed);
+    counters.liveCount = liveCount.load(std::memory_order_relaxed);
+    counters.allocationCount = allocationCount.load(std::memory_order_relaxed);
+    counters.freeCount = freeCount.load(std::memory_order_relaxed);
+    counters.resizeCount = resizeCount.load(std::memory_order_relaxed);
+    return counters;
+}
+
+void Allocator::setTrackingEnabled(bool enabled) {
+    if(enabled && !isTrackingEnabled()) {
+        m_trackingStart.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    }
+    m_tracking.store(enabled, std::memory_order_relaxed);
+}
+
+void Allocator::resetStatistics(void) {
+    for(auto& counters : m_scopeCounters) counters.reset();
+    for(auto& counters : m_internalCounters) counters.reset();
+    m_trackingStart.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+Allocator::Statistics Allocator::getStatistics(const Statistics* pPrevious) const {
+    Statistics stats;
+    const auto start = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(m_trackingStart.load(std::memory_order_relaxed)));
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const double interval = pPrevious? stats.seconds - pPrevious->seconds : stats.seconds;
+    auto finish = [&](Counters& counters, const Counters* pPrev) {
+        const uint64_t allocations = counters.allocationCount - (pPrev && pPrev->allocationCount <= counters.allocationCount? pPrev->allocationCount : 0);
+        counters.allocationRate = interval > 0.0? static_cast<double>(allocations) / interval : 0.0;
+    };
+
+    for(size_t s = 0; s < kScopeCount; ++s) {
+        stats.scopes[s] = m_scopeCounters[s].load();
+        finish(stats.scopes[s], pPrevious? &pPrevious->scopes[s] : nullptr);
+
+        stats.total.liveBytes += stats.scopes[s].liveBytes;
+        stats.total.peakBytes += stats.scopes[s].peakBytes; //upper bound, scopes don't peak together
+        stats.total.liveCount += stats.scopes[s].liveCount;
+        stats.total.allocationCount += stats.scopes[s].allocationCount;
+        stats.total.freeCount += stats.scopes[s].freeCount;
+        stats.total.resizeCount += stats.scopes[s].resizeCount;
+    }
+    finish(stats.total, pPrevious? &pPrevious->total : nullptr);
+
+    for(size_t t = 0; t < kInternalTypeCount; ++t) {
+        stats.internalTypes[t] = m_internalCounters[t].load();
+        finish(stats.internalTypes[t], pPrevious? &pPrevious->internalTypes[t] : nullptr);
+    }
+    return stats;
+}
+
+void Allocator::log(DebugLog* pLog, const Statistics* pPrevious) const {
+    static const char* scopeNames[kScopeCount] = { "Command", "Object", "Cache", "Device", "Instance" };
+    static const char* internalTypeNames[kInternalTypeCount] = { "Executable" };
+
+    auto logCounters = [&](const char* pName, const Counters& counters) {
+        pLog->verbose("%-10s live: %" PRIu64 " KB (%" PRIu64 " blocks), peak: %" PRIu64 " KB, allocs: %" PRIu64 ", frees: %" PRIu64 ", resizes: %" PRIu64 ", rate: %.1f/s",
+                      pName,
+                      counters.liveBytes / 1024,
+                      counters.liveCount,
+                      counters.peakBytes / 1024,
+                      counters.allocationCount,
+                      counters.freeCount,
+                      counters.resizeCount,
+                      counters.allocationRate);
+    };
+
+    pLog->verbose("Host Allocator");
+    pLog->push();
+    if(!isTrackingEnabled()) {
+        pLog->warn("Tracking is disabled!");
+    } else {
+        const Statistics stats = getStatistics(pPrevious);
+        pLog->verbose("Tracked for %.2f seconds", stats.seconds);
+        pLog->verbose("Scopes");
+        pLog->push();
+        for(size_t s = 0; s < kScopeCount; ++s) logCounters(scopeNames[s], stats.scopes[s]);
+        logCounters("Total", stats.total);
+        pLog->pop();
+        pLog->verbose("Internal");
+        pLog->push();
+        for(size_t t = 0; t < kInternalTypeCount; ++t) logCounters(internalTypeNames[t], stats.internalTypes[t]);
+        pLog->pop();
+    }
+    pLog->pop();
+}
+
+size_t Allocator::getAllocationSize(const void* pMemory) {
+    return pMemory? getHeader(pMemory)->size : 0;
+}
+
+Allocator::Route Allocator::getAllocationRoute(const void* pMemory) {
+    assert(pMemory);
+    return static_cast<Route>(getHeader(pMemory)->route);
+}
+
+VKAPI_ATTR void* VKAPI_CALL Allocator::allocationCallback(void*                   pUserData,
+                                                          size_t                  size,
+                                                          size_t                  alignment,
+                                                          VkSystemAllocationScope allocationScope)
+{
+    return static_cast<Allocator*>(pUserData)->allocate(size, alignment, allocationScope);
+}
+
+VKAPI_ATTR void* VKAPI_CALL Allocator::reallocationCallback(void*                   pUserData,
+                                                            void*                   pOriginal,
+                                                            size_t                  size,
+                                                            size_t                  alignment,
+                                                            VkSystemAllocationScope allocationScope)
+{
+    return static_cast<Allocator*>(pUserData)->reallocate(pOriginal, size, alignment, allocationScope);
+}
+
+VKAPI_ATTR void VKAPI_CALL Allocator::freeCallback(void* pUserData, void* pMemory) {
+    static_cast<Allocator*>(pUserData)->free(pMemory);
+}
+
+VKAPI_ATTR void VKAPI_CALL Allocator::internalAllocationNotificationCallback(void*                      pUserData,
+                                                                             size_t                     size,
+                                                                             VkInternalAllocationType   allocationType,
+                                                                             VkSystemAllocationScope    allocationScope)
+{
+    static_cast<Allocator*>(pUserData)->internalAllocationNotification(size, allocationType, allocationScope);
+}
+
+VKAPI_ATTR void VKAPI_CALL Allocator::internalFreeNotificationCallback(void*                        pUserData,
+                                                                       size_t                       size,
+                                                                       VkInternalAllocationType     allocationType,
+                                                                       VkSystemAllocationScope      allocationScope)
+{
+    static_cast<Allocator*>(pUserData)->internalFreeNotification(size, allocationType, allocationScope);
+}
+
+}
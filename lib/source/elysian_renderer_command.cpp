@@ -1,5 +1,6 @@
 #include <renderer/elysian_renderer_command.hpp>
 #include <renderer/elysian_renderer_device.hpp>
+#include <algorithm>
 
 namespace elysian::renderer {
 
@@ -16,12 +17,12 @@ CommandPool::CommandPool(const Device* pDevice, const CommandPoolCreateInfo* pIn
     m_pDevice(pDevice)
 {
     VkCommandPool pool = VK_NULL_HANDLE;
-    m_result = vkCreateCommandPool(m_pDevice->getHandle(), pInfo, nullptr, &pool);
+    m_result = vkCreateCommandPool(m_pDevice->getHandle(), pInfo, m_pDevice->getAllocationCallbacks(), &pool);
     setHandle(pool);
 }
 
 CommandPool::~CommandPool(void) {
-    vkDestroyCommandPool(m_pDevice->getHandle(), getHandle(), nullptr);
+    vkDestroyCommandPool(m_pDevice->getHandle(), getHandle(), m_pDevice->getAllocationCallbacks());
 }
 
 CommandBufferGroup::CommandBufferGroup(const Device* pDevice, const CommandBufferAllocateInfo* pInfo):
@@ -50,6 +51,183 @@ CommandBufferGroup::~CommandBufferGroup(void) {
                          vkBuffers.data());
 }
 
+uint64_t CommandBuffer::dryRun(const VkCommandBufferBeginInfo& info, const std::function<void(CommandBuffer*)>& record) {
+    assert(getState() != State::Recording && getState() != State::Pending);
+
+    // pretend to be recording so the commands go through track() and nowhere else
+    const State state = m_state;
+    const uint32_t cmdCount = m_cmdCount;
+    const uint32_t elidedCount = m_elidedCount;
+    const uint64_t contentHash = m_contentHash;
+    const ShadowState shadow = m_shadow;
+    const VkRenderPassBeginInfo renderPassBeginInfo = m_renderPassBeginInfo;
+
+    // same starting point as begin() so the same commands get elided and the hashes match
+    m_state = State::Recording;
+    m_dryRun = true;
+    m_cmdCount = 0;
+    m_elidedCount = 0;
+    m_contentHash = hashBeginInfo(info);
+    resetShadowState();
+
+    record(this);
+    const uint64_t hash = m_contentHash;
+
+    m_state = state;
+    m_dryRun = false;
+    m_cmdCount = cmdCount;
+    m_elidedCount = elidedCount;
+    m_contentHash = contentHash;
+    m_shadow = shadow;
+    m_renderPassBeginInfo = renderPassBeginInfo;
+    return hash;
+}
+
+void CommandBuffer::cmdBindVertexBuffers(uint32_t firstBinding, uint32_t bindingCount, const VkBuffer* pBuffers, const VkDeviceSize* pOffsets) {
+    if(m_trackState && firstBinding + bindingCount <= ShadowState::kMaxVertexBindings) {
+        // only send the changed range, bindings around it stay as they were
+        uint32_t first = bindingCount, last = 0;
+        for(uint32_t b = 0; b < bindingCount; ++b) {
+            const uint32_t binding = firstBinding + b;
+            if(pBuffers[b] == VK_NULL_HANDLE ||
+               m_shadow.vertexBuffers[binding] != pBuffers[b] ||
+               m_shadow.vertexOffsets[binding] != pOffsets[b])
+            {
+                first = std::min(first, b);
+                last = b;
+                m_shadow.vertexBuffers[binding] = pBuffers[b];
+                m_shadow.vertexOffsets[binding] = pOffsets[b];
+            }
+        }
+        if(first == bindingCount && elide()) return;
+        firstBinding += first;
+        pBuffers += first;
+        pOffsets += first;
+        bindingCount = last - first + 1;
+    } else if(m_trackState) {
+        for(uint32_t b = firstBinding; b < ShadowState::kMaxVertexBindings; ++b)
+            m_shadow.vertexBuffers[b] = VK_NULL_HANDLE;
+    }
+
+    if(track(Op::BindVertexBuffers, firstBinding, hashArray(pBuffers, bindingCount), hashArray(pOffsets, bindingCount)))
+        vkCmdBindVertexBuffers(getHandle(), firstBinding, bindingCount, pBuffers, pOffsets);
+}
+
+void CommandBuffer::cmdBindDescriptorSets(VkPipelineBindPoint pipelineBindPoint, VkPipelineLayout layout, uint32_t firstSet, uint32_t descriptorSetCount, const VkDescriptorSet* pDescriptorSets, uint32_t dynamicOffsetCount, const uint32_t* pDynamicOffsets) {
+    const uint32_t p = ShadowState::getBindPointIndex(pipelineBindPoint);
+    if(m_trackState && p < ShadowState::kBindPointCount) {
+        auto& sets = m_shadow.sets[p];
+        // a different layout may disturb every set, so forget them rather than reason about compatibility
+        if(m_shadow.layouts[p] != layout) {
+            std::fill(std::begin(sets), std::end(sets), VK_NULL_HANDLE);
+            m_shadow.layouts[p] = layout;
+        }
+
+        if(firstSet + descriptorSetCount > ShadowState::kMaxSets) {
+            std::fill(std::begin(sets) + std::min(firstSet, ShadowState::kMaxSets), std::end(sets), VK_NULL_HANDLE);
+        } else if(dynamicOffsetCount) {
+            // the offsets can't be attributed to sets without the layout, rebind as asked
+            std::copy(pDescriptorSets, pDescriptorSets + descriptorSetCount, sets + firstSet);
+        } else {
+            uint32_t first = descriptorSetCount, last = 0;
+            for(uint32_t s = 0; s < descriptorSetCount; ++s) {
+                if(pDescriptorSets[s] == VK_NULL_HANDLE || sets[firstSet + s] != pDescriptorSets[s]) {
+                    first = std::min(first, s);
+                    last = s;
+                    sets[firstSet + s] = pDescriptorSets[s];
+                }
+            }
+            if(first == descriptorSetCount && elide()) return;
+            firstSet += first;
+            pDescriptorSets += first;
+            descriptorSetCount = last - first + 1;
+        }
+    }
+
+    if(track(Op::BindDescriptorSets, pipelineBindPoint, layout, firstSet,
+             hashArray(pDescriptorSets, descriptorSetCount), hashArray(pDynamicOffsets, dynamicOffsetCount)))
+    {
+        vkCmdBindDescriptorSets(getHandle(), pipelineBindPoint, layout, firstSet, descriptorSetCount, pDescriptorSets, dynamicOffsetCount, pDynamicOffsets);
+    }
+}
+
+void CommandBuffer::cmdSetViewport(uint32_t firstViewport, uint32_t viewportCount, const VkViewport* pViewports) {
+    if(m_trackState && firstViewport + viewportCount <= ShadowState::kMaxViewports) {
+        uint32_t first = viewportCount, last = 0;
+        for(uint32_t v = 0; v < viewportCount; ++v) {
+            const uint32_t index = firstViewport + v;
+            if(!(m_shadow.viewportValid & (1u << index)) ||
+               memcmp(&m_shadow.viewports[index], &pViewports[v], sizeof(VkViewport)))
+            {
+                first = std::min(first, v);
+                last = v;
+                m_shadow.viewports[index] = pViewports[v];
+                m_shadow.viewportValid |= 1u << index;
+            }
+        }
+        if(first == viewportCount && elide()) return;
+        firstViewport += first;
+        pViewports += first;
+        viewportCount = last - first + 1;
+    }
+
+    if(track(Op::SetViewport, firstViewport, hashArray(pViewports, viewportCount)))
+        vkCmdSetViewport(getHandle(), firstViewport, viewportCount, pViewports);
+}
+
+void CommandBuffer::cmdSetScissor(uint32_t firstScissor, uint32_t scissorCount, const VkRect2D* pScissors) {
+    if(m_trackState && firstScissor + scissorCount <= ShadowState::kMaxViewports) {
+        uint32_t first = scissorCount, last = 0;
+        for(uint32_t s = 0; s < scissorCount; ++s) {
+            const uint32_t index = firstScissor + s;
+            if(!(m_shadow.scissorValid & (1u << index)) ||
+               memcmp(&m_shadow.scissors[index], &pScissors[s], sizeof(VkRect2D)))
+            {
+                first = std::min(first, s);
+                last = s;
+                m_shadow.scissors[index] = pScissors[s];
+                m_shadow.scissorValid |= 1u << index;
+            }
+        }
+        if(first == scissorCount && elide()) return;
+        firstScissor += first;
+        pScissors += first;
+        scissorCount = last - first + 1;
+    }
+
+    if(track(Op::SetScissor, firstScissor, hashArray(pScissors, scissorCount)))
+        vkCmdSetScissor(getHandle(), firstScissor, scissorCount, pScissors);
+}
+
+Result CommandBufferGroup::recordCached(uint32_t                        index,
+                                        const VkCommandBufferBeginInfo& info,
+                                        const RecordFunction&           record,
+                                        bool*                           pRecorded)
+{
+    assert(index < m_buffers.size());
+    assert(!(info.flags & VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT)); //would be invalid after one submit
+    CommandBuffer& buffer = m_buffers[index];
+    if(pRecorded) *pRecorded = false;
+
+    if(buffer.getState() == CommandBuffer::State::Executable && buffer.getContentHash()) {
+        if(buffer.dryRun(info, record) == buffer.getContentHash()) {
+            ++m_reuseCount;
+            return VK_SUCCESS;
+        }
+    }
+
+    // begin() implicitly resets, the pool has to allow it
+    Result result = buffer.begin(info);
+    if(!result) return result;
+    record(&buffer);
+    result = buffer.end();
+    if(!result) return result;
+
+    ++m_recordCount;
+    if(pRecorded) *pRecorded = true;
+    return VK_SUCCESS;
+}
+
 CommandBufferGroup* CommandPool::createGroup(VkCommandBufferLevel level, uint32_t commandBufferCount) {
     const auto info = CommandBufferAllocateInfo(getHandle(), level, commandBufferCount);
     auto* pBufferGroup = new CommandBufferGroup(m_pDevice, &info);
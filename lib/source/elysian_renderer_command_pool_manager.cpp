@@ -0,0 +1,142 @@
+#include <renderer/elysian_renderer_command_pool_manager.hpp>
+#include <renderer/elysian_renderer_physical_device.hpp>
+#include <renderer/elysian_renderer_device.hpp>
+#include <renderer/elysian_renderer_debug_log.hpp>
+#include <cassert>
+
+namespace elysian::renderer {
+
+namespace {
+
+inline uint32_t levelIndex(VkCommandBufferLevel level) {
+    return level == VK_COMMAND_BUFFER_LEVEL_SECONDARY? 1 : 0;
+}
+
+}
+
+CommandPoolManager::CommandPoolManager(Initializer initializer):
+    m_initializer(std::move(initializer))
+{
+    assert(m_initializer.pDevice && m_initializer.frameCount && m_initializer.groupSize);
+    m_familyCount = static_cast<uint32_t>(m_initializer.pDevice->getPhysicalDevice().getQueueFamilyProperties().size());
+}
+
+CommandPoolManager::~CommandPoolManager(void) {
+    // groups have to go before the pools they were allocated from
+    for(auto& pThread : m_threads) {
+        for(auto& frame : pThread->frames) {
+            for(auto& family : frame.families) {
+                family.groups[0].clear();
+                family.groups[1].clear();
+            }
+        }
+    }
+}
+
+uint32_t CommandPoolManager::getThreadCount(void) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<uint32_t>(m_threads.size());
+}
+
+CommandPoolManager::ThreadContext* CommandPoolManager::getThreadContext(void) {
+    if(ThreadContext* pContext = m_registry.find()) return pContext;
+
+    // first time this thread records through us
+    auto pContext = std::make_unique<ThreadContext>();
+    pContext->frames.resize(m_initializer.frameCount);
+    for(auto& frame : pContext->frames) frame.families.resize(m_familyCount);
+
+    ThreadContext* pRaw = pContext.get();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_threads.push_back(std::move(pContext));
+    }
+    m_registry.add(pRaw);
+    return pRaw;
+}
+
+CommandPoolManager::FamilyPool* CommandPoolManager::getFamilyPool(uint32_t queueFamilyIndex) {
+    assert(queueFamilyIndex < m_familyCount);
+    const uint64_t currentFrame = m_frame.load(std::memory_order_relaxed);
+    FrameContext& frame = getThreadContext()->frames[currentFrame % m_initializer.frameCount];
+
+    if(frame.frame != currentFrame) {
+        // slot came around again, everything recorded into it last time is done
+        for(auto& family : frame.families) {
+            if(!family.pPool || !(family.used[0] || family.used[1])) continue;
+            family.pPool->reset(0);
+            for(auto& groups : family.groups) {
+                for(auto& pGroup : groups) pGroup->onPoolReset();
+            }
+            family.used[0] = family.used[1] = 0;
+        }
+        frame.frame = currentFrame;
+    }
+
+    FamilyPool& family = frame.families[queueFamilyIndex];
+    if(!family.pPool) {
+        const auto info = CommandPoolCreateInfo(queueFamilyIndex, m_initializer.flags);
+        family.pPool = m_initializer.pDevice->createCommandPool(&info);
+        if(!family.pPool->getResult()) {
+            family.pPool.reset();
+            return nullptr;
+        }
+    }
+    return &family;
+}
+
+const CommandPool* CommandPoolManager::getThreadPool(uint32_t queueFamilyIndex) {
+    FamilyPool* pFamily = getFamilyPool(queueFamilyIndex);
+    return pFamily? pFamily->pPool.get() : nullptr;
+}
+
+CommandBuffer* CommandPoolManager::acquire(uint32_t queueFamilyIndex, VkCommandBufferLevel level) {
+    FamilyPool* pFamily = getFamilyPool(queueFamilyIndex);
+    if(!pFamily) return nullptr;
+
+    const uint32_t l = levelIndex(level);
+    auto& groups = pFamily->groups[l];
+    const uint32_t index = pFamily->used[l];
+    const uint32_t groupIndex = index / m_initializer.groupSize;
+
+    if(groupIndex == groups.size()) {
+        std::unique_ptr<CommandBufferGroup> pGroup(pFamily->pPool->createGroup(level, m_initializer.groupSize));
+        if(!pGroup->getResult()) return nullptr;
+        groups.push_back(std::move(pGroup));
+    }
+
+    ++pFamily->used[l];
+    return groups[groupIndex]->getBuffer(index % m_initializer.groupSize);
+}
+
+void CommandPoolManager::trim(void) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for(auto& pThread : m_threads) {
+        for(auto& frame : pThread->frames) {
+            for(auto& family : frame.families) {
+                if(family.pPool) family.pPool->trim(0);
+            }
+        }
+    }
+}
+
+void CommandPoolManager::log(DebugLog* pLog) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    pLog->verbose("Command Pool Manager: %s", getName());
+    pLog->push();
+    pLog->verbose("Frame: %u / %u", getFrameIndex(), getFrameCount());
+    for(size_t t = 0; t < m_threads.size(); ++t) {
+        uint32_t poolCount = 0, bufferCount = 0;
+        for(const auto& frame : m_threads[t]->frames) {
+            for(const auto& family : frame.families) {
+                if(!family.pPool) continue;
+                ++poolCount;
+                bufferCount += static_cast<uint32_t>(family.groups[0].size() + family.groups[1].size()) * m_initializer.groupSize;
+            }
+        }
+        pLog->verbose("Thread[%zu]: %u pools, %u buffers", t, poolCount, bufferCount);
+    }
+    pLog->pop();
+}
+
+}
@@ -0,0 +1,559 @@
+#include <renderer/elysian_renderer_command_stream.hpp>
+#include <renderer/elysian_renderer_command.hpp>
+#include <renderer/elysian_renderer_debug_log.hpp>
+#include <cassert>
+#include <cstring>
+
+namespace elysian::renderer {
+
+namespace {
+
+using detail::alignPacket;
+
+constexpr size_t kHeaderSize = alignPacket(sizeof(CommandStream::Header));
+
+// payload size and byte size of every trailing array, the one place that knows the layout
+struct Layout {
+    size_t      payloadSize     = 0;
+    uint32_t    arrayCount      = 0;
+    size_t      arrayBytes[3]   = {};
+};
+
+Layout getLayout(CommandStream::Op op, const void* pPayload) {
+    using S = CommandStream;
+    Layout layout;
+    auto set = [&](size_t payloadSize, std::initializer_list<size_t> arrays) {
+        layout.payloadSize = payloadSize;
+        for(size_t bytes : arrays) layout.arrayBytes[layout.arrayCount++] = bytes;
+    };
+
+    switch(op) {
+    case S::Op::BindPipeline:           set(sizeof(S::BindPipeline), {}); break;
+    case S::Op::BindIndexBuffer:        set(sizeof(S::BindIndexBuffer), {}); break;
+    case S::Op::BindVertexBuffers: {
+        auto* p = static_cast<const S::BindVertexBuffers*>(pPayload);
+        set(sizeof(*p), { sizeof(VkBuffer) * p->bindingCount, sizeof(VkDeviceSize) * p->bindingCount });
+        break;
+    }
+    case S::Op::BindDescriptorSets: {
+        auto* p = static_cast<const S::BindDescriptorSets*>(pPayload);
+        set(sizeof(*p), { sizeof(VkDescriptorSet) * p->setCount, sizeof(uint32_t) * p->dynamicOffsetCount });
+        break;
+    }
+    case S::Op::PushConstants: {
+        auto* p = static_cast<const S::PushConstants*>(pPayload);
+        set(sizeof(*p), { p->size });
+        break;
+    }
+    case S::Op::SetViewport: {
+        auto* p = static_cast<const S::SetViewport*>(pPayload);
+        set(sizeof(*p), { sizeof(VkViewport) * p->viewportCount });
+        break;
+    }
+    case S::Op::SetScissor: {
+        auto* p = static_cast<const S::SetScissor*>(pPayload);
+        set(sizeof(*p), { sizeof(VkRect2D) * p->scissorCount });
+        break;
+    }
+    case S::Op::Draw:                   set(sizeof(S::Draw), {}); break;
+    case S::Op::DrawIndexed:            set(sizeof(S::DrawIndexed), {}); break;
+    case S::Op::DrawIndirect:
+    case S::Op::DrawIndexedIndirect:    set(sizeof(S::DrawIndirect), {}); break;
+    case S::Op::Dispatch:               set(sizeof(S::Dispatch), {}); break;
+    case S::Op::DispatchIndirect:       set(sizeof(S::DispatchIndirect), {}); break;
+    case S::Op::PipelineBarrier: {
+        auto* p = static_cast<const S::PipelineBarrier*>(pPayload);
+        set(sizeof(*p), { sizeof(VkMemoryBarrier) * p->memoryBarrierCount,
+                          sizeof(VkBufferMemoryBarrier) * p->bufferMemoryBarrierCount,
+                          sizeof(VkImageMemoryBarrier) * p->imageMemoryBarrierCount });
+        break;
+    }
+    case S::Op::CopyBuffer: {
+        auto* p = static_cast<const S::CopyBuffer*>(pPayload);
+        set(sizeof(*p), { sizeof(VkBufferCopy) * p->regionCount });
+        break;
+    }
+    case S::Op::CopyBufferToImage: {
+        auto* p = static_cast<const S::CopyBufferToImage*>(pPayload);
+        set(sizeof(*p), { sizeof(VkBufferImageCopy) * p->regionCount });
+        break;
+    }
+    case S::Op::BeginRenderPass: {
+        auto* p = static_cast<const S::BeginRenderPass*>(pPayload);
+        set(sizeof(*p), { sizeof(VkClearValue) * p->clearValueCount });
+        break;
+    }
+    case S::Op::EndRenderPass:          set(sizeof(S::EndRenderPass), {}); break;
+    case S::Op::ExecuteCommands: {
+        auto* p = static_cast<const S::ExecuteCommands*>(pPayload);
+        set(sizeof(*p), { sizeof(VkCommandBuffer) * p->commandBufferCount });
+        break;
+    }
+    default: assert(false);
+    }
+    return layout;
+}
+
+}
+
+const void* CommandStream::Packet::getArrayData(uint32_t index) const {
+    const auto* pPayload = reinterpret_cast<const uint8_t*>(m_pHeader) + kHeaderSize;
+    const Layout layout = getLayout(getOp(), pPayload);
+    assert(index < layout.arrayCount);
+
+    size_t offset = alignPacket(layout.payloadSize);
+    for(uint32_t a = 0; a < index; ++a) offset += alignPacket(layout.arrayBytes[a]);
+    return pPayload + offset;
+}
+
+CommandStream::DispatchTable CommandStream::DispatchTable::global(void) {
+    DispatchTable table;
+    table.pfnBindPipeline           = vkCmdBindPipeline;
+    table.pfnBindIndexBuffer        = vkCmdBindIndexBuffer;
+    table.pfnBindVertexBuffers      = vkCmdBindVertexBuffers;
+    table.pfnBindDescriptorSets     = vkCmdBindDescriptorSets;
+    table.pfnPushConstants          = vkCmdPushConstants;
+    table.pfnSetViewport            = vkCmdSetViewport;
+    table.pfnSetScissor             = vkCmdSetScissor;
+    table.pfnDraw                   = vkCmdDraw;
+    table.pfnDrawIndexed            = vkCmdDrawIndexed;
+    table.pfnDrawIndirect           = vkCmdDrawIndirect;
+    table.pfnDrawIndexedIndirect    = vkCmdDrawIndexedIndirect;
+    table.pfnDispatch               = vkCmdDispatch;
+    table.pfnDispatchIndirect       = vkCmdDispatchIndirect;
+    table.pfnPipelineBarrier        = vkCmdPipelineBarrier;
+    table.pfnCopyBuffer             = vkCmdCopyBuffer;
+    table.pfnCopyBufferToImage      = vkCmdCopyBufferToImage;
+    table.pfnBeginRenderPass        = vkCmdBeginRenderPass;
+    table.pfnEndRenderPass          = vkCmdEndRenderPass;
+    table.pfnExecuteCommands        = vkCmdExecuteCommands;
+    return table;
+}
+
+void CommandStream::clear(void) {
+    m_size = 0;
+    m_statistics = {};
+}
+
+void* CommandStream::writePacket(Op op, const void* pPayload, size_t payloadSize, std::initializer_list<Array> arrays) {
+    size_t size = kHeaderSize + alignPacket(payloadSize);
+    for(const Array& array : arrays) size += alignPacket(array.size);
+
+    // grow in words, vector takes care of the amortization
+    const size_t offset = m_size;
+    m_size += size;
+    if(m_data.size() * sizeof(uint64_t) < m_size) m_data.resize(m_size / sizeof(uint64_t));
+
+    auto* pPacket = reinterpret_cast<uint8_t*>(m_data.data()) + offset;
+    std::memset(pPacket, 0, size); //keeps padding deterministic for dumps/hashing
+
+    auto* pHeader = reinterpret_cast<Header*>(pPacket);
+    pHeader->op = op;
+    pHeader->reserved = 0;
+    pHeader->size = static_cast<uint32_t>(size);
+
+    uint8_t* pCursor = pPacket + kHeaderSize;
+    std::memcpy(pCursor, pPayload, payloadSize);
+    pCursor += alignPacket(payloadSize);
+    for(const Array& array : arrays) {
+        if(array.size) std::memcpy(pCursor, array.pData, array.size);
+        pCursor += alignPacket(array.size);
+    }
+
+    ++m_statistics.packetCount;
+    m_statistics.byteSize = m_size;
+    return pPacket;
+}
+
+void CommandStream::cmdBindPipeline(VkPipelineBindPoint pipelineBindPoint, VkPipeline pipeline) {
+    write(Op::BindPipeline, BindPipeline { pipelineBindPoint, pipeline });
+}
+
+void CommandStream::cmdBindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType) {
+    write(Op::BindIndexBuffer, BindIndexBuffer { buffer, offset, indexType });
+}
+
+void CommandStream::cmdBindVertexBuffers(uint32_t firstBinding, uint32_t bindingCount, const VkBuffer* pBuffers, const VkDeviceSize* pOffsets) {
+    write(Op::BindVertexBuffers,
+          BindVertexBuffers { firstBinding, bindingCount },
+          { { pBuffers, sizeof(VkBuffer) * bindingCount },
+            { pOffsets, sizeof(VkDeviceSize) * bindingCount } });
+}
+
+void CommandStream::cmdBindDescriptorSets(VkPipelineBindPoint    pipelineBindPoint,
+                                          VkPipelineLayout       layout,
+                                          uint32_t               firstSet,
+                                          uint32_t               descriptorSetCount,
+                                          const VkDescriptorSet* pDescriptorSets,
+                                          uint32_t               dynamicOffsetCount,
+                                          const uint32_t*        pDynamicOffsets)
+{
+    write(Op::BindDescriptorSets,
+          BindDescriptorSets { pipelineBindPoint, layout, firstSet, descriptorSetCount, dynamicOffsetCount },
+          { { pDescriptorSets, sizeof(VkDescriptorSet) * descriptorSetCount },
+            { pDynamicOffsets, sizeof(uint32_t) * dynamicOffsetCount } });
+}
+
+void CommandStream::cmdPushConstants(VkPipelineLayout layout, VkShaderStageFlags stageFlags, uint32_t offset, uint32_t size, const void* pValues) {
+    write(Op::PushConstants, PushConstants { layout, stageFlags, offset, size }, { { pValues, size } });
+}
+
+void CommandStream::cmdSetViewport(uint32_t firstViewport, uint32_t viewportCount, const VkViewport* pViewports) {
+    write(Op::SetViewport, SetViewport { firstViewport, viewportCount }, { { pViewports, sizeof(VkViewport) * viewportCount } });
+}
+
+void CommandStream::cmdSetScissor(uint32_t firstScissor, uint32_t scissorCount, const VkRect2D* pScissors) {
+    write(Op::SetScissor, SetScissor { firstScissor, scissorCount }, { { pScissors, sizeof(VkRect2D) * scissorCount } });
+}
+
+void CommandStream::cmdDraw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance) {
+    write(Op::Draw, Draw { vertexCount, instanceCount, firstVertex, firstInstance });
+}
+
+void CommandStream::cmdDrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance) {
+    write(Op::DrawIndexed, DrawIndexed { indexCount, instanceCount, firstIndex, vertexOffset, firstInstance });
+}
+
+void CommandStream::cmdDrawIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride) {
+    write(Op::DrawIndirect, DrawIndirect { buffer, offset, drawCount, stride });
+}
+
+void CommandStream::cmdDrawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride) {
+    write(Op::DrawIndexedIndirect, DrawIndirect { buffer, offset, drawCount, stride });
+}
+
+void CommandStream::cmdDispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) {
+    write(Op::Dispatch, Dispatch { groupCountX, groupCountY, groupCountZ });
+}
+
+void CommandStream::cmdDispatchIndirect(VkBuffer buffer, VkDeviceSize offset) {
+    write(Op::DispatchIndirect, DispatchIndirect { buffer, offset });
+}
+
+void CommandStream::cmdPipelineBarrier(VkPipelineStageFlags            srcStageMask,
+                                       VkPipelineStageFlags            dstStageMask,
+                                       VkDependencyFlags               dependencyFlags,
+                                       uint32_t                        memoryBarrierCount,
+                                       const VkMemoryBarrier*          pMemoryBarriers,
+                                       uint32_t                        bufferMemoryBarrierCount,
+                                       const VkBufferMemoryBarrier*    pBufferMemoryBarriers,
+                                       uint32_t                        imageMemoryBarrierCount,
+                                       const VkImageMemoryBarrier*     pImageMemoryBarriers)
+{
+#ifndef NDEBUG
+    for(uint32_t b = 0; b < memoryBarrierCount; ++b) assert(!pMemoryBarriers[b].pNext);
+    for(uint32_t b = 0; b < bufferMemoryBarrierCount; ++b) assert(!pBufferMemoryBarriers[b].pNext);
+    for(uint32_t b = 0; b < imageMemoryBarrierCount; ++b) assert(!pImageMemoryBarriers[b].pNext);
+#endif
+    write(Op::PipelineBarrier,
+          PipelineBarrier { srcStageMask, dstStageMask, dependencyFlags, memoryBarrierCount, bufferMemoryBarrierCount, imageMemoryBarrierCount },
+          { { pMemoryBarriers, sizeof(VkMemoryBarrier) * memoryBarrierCount },
+            { pBufferMemoryBarriers, sizeof(VkBufferMemoryBarrier) * bufferMemoryBarrierCount },
+            { pImageMemoryBarriers, sizeof(VkImageMemoryBarrier) * imageMemoryBarrierCount } });
+}
+
+void CommandStream::cmdCopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, uint32_t regionCount, const VkBufferCopy* pRegions) {
+    write(Op::CopyBuffer, CopyBuffer { srcBuffer, dstBuffer, regionCount }, { { pRegions, sizeof(VkBufferCopy) * regionCount } });
+}
+
+void CommandStream::cmdCopyBufferToImage(VkBuffer srcBuffer, VkImage dstImage, VkImageLayout dstImageLayout, uint32_t regionCount, const VkBufferImageCopy* pRegions) {
+    write(Op::CopyBufferToImage,
+          CopyBufferToImage { srcBuffer, dstImage, dstImageLayout, regionCount },
+          { { pRegions, sizeof(VkBufferImageCopy) * regionCount } });
+}
+
+void CommandStream::cmdBeginRenderPass(const VkRenderPassBeginInfo& info, VkSubpassContents subpassContents) {
+    assert(!info.pNext);
+    write(Op::BeginRenderPass,
+          BeginRenderPass { info.renderPass, info.framebuffer, info.renderArea, subpassContents, info.clearValueCount },
+          { { info.pClearValues, sizeof(VkClearValue) * info.clearValueCount } });
+}
+
+void CommandStream::cmdEndRenderPass(void) {
+    write(Op::EndRenderPass, EndRenderPass {});
+}
+
+void CommandStream::cmdExecuteCommands(uint32_t commandBufferCount, const VkCommandBuffer* pCommandBuffers) {
+    write(Op::ExecuteCommands, ExecuteCommands { commandBufferCount }, { { pCommandBuffers, sizeof(VkCommandBuffer) * commandBufferCount } });
+}
+
+void CommandStream::forEach(const std::function<void(const Packet& packet)>& visitor) const {
+    const auto* pData = reinterpret_cast<const uint8_t*>(m_data.data());
+    Packet packet;
+    for(size_t offset = 0; offset < m_size; offset += packet.getSize()) {
+        packet.m_pHeader = reinterpret_cast<const Header*>(pData + offset);
+        visitor(packet);
+    }
+}
+
+void CommandStream::replay(VkCommandBuffer cmd, const DispatchTable& table) const {
+    forEach([&](const Packet& packet) {
+        switch(packet.getOp()) {
+        case Op::BindPipeline: {
+            auto* p = packet.getPayload<BindPipeline>();
+            if(table.pfnBindPipeline) table.pfnBindPipeline(cmd, p->bindPoint, p->pipeline);
+            break;
+        }
+        case Op::BindIndexBuffer: {
+            auto* p = packet.getPayload<BindIndexBuffer>();
+            if(table.pfnBindIndexBuffer) table.pfnBindIndexBuffer(cmd, p->buffer, p->offset, p->indexType);
+            break;
+        }
+        case Op::BindVertexBuffers: {
+            auto* p = packet.getPayload<BindVertexBuffers>();
+            if(table.pfnBindVertexBuffers) table.pfnBindVertexBuffers(cmd, p->firstBinding, p->bindingCount,
+                                                                      packet.getArray<VkBuffer>(0),
+                                                                      packet.getArray<VkDeviceSize>(1));
+            break;
+        }
+        case Op::BindDescriptorSets: {
+            auto* p = packet.getPayload<BindDescriptorSets>();
+            if(table.pfnBindDescriptorSets) table.pfnBindDescriptorSets(cmd, p->bindPoint, p->layout, p->firstSet,
+                                                                        p->setCount, packet.getArray<VkDescriptorSet>(0),
+                                                                        p->dynamicOffsetCount, packet.getArray<uint32_t>(1));
+            break;
+        }
+        case Op::PushConstants: {
+            auto* p = packet.getPayload<PushConstants>();
+            if(table.pfnPushConstants) table.pfnPushConstants(cmd, p->layout, p->stageFlags, p->offset, p->size, packet.getArray<void>(0));
+            break;
+        }
+        case Op::SetViewport: {
+            auto* p = packet.getPayload<SetViewport>();
+            if(table.pfnSetViewport) table.pfnSetViewport(cmd, p->firstViewport, p->viewportCount, packet.getArray<VkViewport>(0));
+            break;
+        }
+        case Op::SetScissor: {
+            auto* p = packet.getPayload<SetScissor>();
+            if(table.pfnSetScissor) table.pfnSetScissor(cmd, p->firstScissor, p->scissorCount, packet.getArray<VkRect2D>(0));
+            break;
+        }
+        case Op::Draw: {
+            auto* p = packet.getPayload<Draw>();
+            if(table.pfnDraw) table.pfnDraw(cmd, p->vertexCount, p->instanceCount, p->firstVertex, p->firstInstance);
+            break;
+        }
+        case Op::DrawIndexed: {
+            auto* p = packet.getPayload<DrawIndexed>();
+            if(table.pfnDrawIndexed) table.pfnDrawIndexed(cmd, p->indexCount, p->instanceCount, p->firstIndex, p->vertexOffset, p->firstInstance);
+            break;
+        }
+        case Op::DrawIndirect: {
+            auto* p = packet.getPayload<DrawIndirect>();
+            if(table.pfnDrawIndirect) table.pfnDrawIndirect(cmd, p->buffer, p->offset, p->drawCount, p->stride);
+            break;
+        }
+        case Op::DrawIndexedIndirect: {
+            auto* p = packet.getPayload<DrawIndirect>();
+            if(table.pfnDrawIndexedIndirect) table.pfnDrawIndexedIndirect(cmd, p->buffer, p->offset, p->drawCount, p->stride);
+            break;
+        }
+        case Op::Dispatch: {
+            auto* p = packet.getPayload<Dispatch>();
+            if(table.pfnDispatch) table.pfnDispatch(cmd, p->groupCountX, p->groupCountY, p->groupCountZ);
+            break;
+        }
+        case Op::DispatchIndirect: {
+            auto* p = packet.getPayload<DispatchIndirect>();
+            if(table.pfnDispatchIndirect) table.pfnDispatchIndirect(cmd, p->buffer, p->offset);
+            break;
+        }
+        case Op::PipelineBarrier: {
+            auto* p = packet.getPayload<PipelineBarrier>();
+            if(table.pfnPipelineBarrier) table.pfnPipelineBarrier(cmd, p->srcStageMask, p->dstStageMask, p->dependencyFlags,
+                                                                  p->memoryBarrierCount, packet.getArray<VkMemoryBarrier>(0),
+                                                                  p->bufferMemoryBarrierCount, packet.getArray<VkBufferMemoryBarrier>(1),
+                                                                  p->imageMemoryBarrierCount, packet.getArray<VkImageMemoryBarrier>(2));
+            break;
+        }
+        case Op::CopyBuffer: {
+            auto* p = packet.getPayload<CopyBuffer>();
+            if(table.pfnCopyBuffer) table.pfnCopyBuffer(cmd, p->srcBuffer, p->dstBuffer, p->regionCount, packet.getArray<VkBufferCopy>(0));
+            break;
+        }
+        case Op::CopyBufferToImage: {
+            auto* p = packet.getPayload<CopyBufferToImage>();
+            if(table.pfnCopyBufferToImage) table.pfnCopyBufferToImage(cmd, p->srcBuffer, p->dstImage, p->dstImageLayout,
+                                                                      p->regionCount, packet.getArray<VkBufferImageCopy>(0));
+            break;
+        }
+        case Op::BeginRenderPass: {
+            auto* p = packet.getPayload<BeginRenderPass>();
+            const auto info = VkRenderPassBeginInfo {
+                VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+                nullptr,
+                p->renderPass,
+                p->framebuffer,
+                p->renderArea,
+                p->clearValueCount,
+                packet.getArray<VkClearValue>(0)
+            };
+            if(table.pfnBeginRenderPass) table.pfnBeginRenderPass(cmd, &info, p->contents);
+            break;
+        }
+        case Op::EndRenderPass:
+            if(table.pfnEndRenderPass) table.pfnEndRenderPass(cmd);
+            break;
+        case Op::ExecuteCommands: {
+            auto* p = packet.getPayload<ExecuteCommands>();
+            if(table.pfnExecuteCommands) table.pfnExecuteCommands(cmd, p->commandBufferCount, packet.getArray<VkCommandBuffer>(0));
+            break;
+        }
+        default: assert(false);
+        }
+    });
+}
+
+void CommandStream::replay(CommandBuffer* pCmdBuffer) const {
+    forEach([&](const Packet& packet) {
+        switch(packet.getOp()) {
+        case Op::BindPipeline: {
+            auto* p = packet.getPayload<BindPipeline>();
+            pCmdBuffer->cmdBindPipeline(p->bindPoint, p->pipeline);
+            break;
+        }
+        case Op::BindIndexBuffer: {
+            auto* p = packet.getPayload<BindIndexBuffer>();
+            pCmdBuffer->cmdBindIndexBuffer(p->buffer, p->offset, p->indexType);
+            break;
+        }
+        case Op::BindVertexBuffers: {
+            auto* p = packet.getPayload<BindVertexBuffers>();
+            pCmdBuffer->cmdBindVertexBuffers(p->firstBinding, p->bindingCount, packet.getArray<VkBuffer>(0), packet.getArray<VkDeviceSize>(1));
+            break;
+        }
+        case Op::BindDescriptorSets: {
+            auto* p = packet.getPayload<BindDescriptorSets>();
+            pCmdBuffer->cmdBindDescriptorSets(p->bindPoint, p->layout, p->firstSet,
+                                              p->setCount, packet.getArray<VkDescriptorSet>(0),
+                                              p->dynamicOffsetCount, packet.getArray<uint32_t>(1));
+            break;
+        }
+        case Op::PushConstants: {
+            auto* p = packet.getPayload<PushConstants>();
+            pCmdBuffer->cmdPushConstants(p->layout, p->stageFlags, p->offset, p->size, packet.getArray<void>(0));
+            break;
+        }
+        case Op::SetViewport: {
+            auto* p = packet.getPayload<SetViewport>();
+            pCmdBuffer->cmdSetViewport(p->firstViewport, p->viewportCount, packet.getArray<VkViewport>(0));
+            break;
+        }
+        case Op::SetScissor: {
+            auto* p = packet.getPayload<SetScissor>();
+            pCmdBuffer->cmdSetScissor(p->firstScissor, p->scissorCount, packet.getArray<VkRect2D>(0));
+            break;
+        }
+        case Op::Draw: {
+            auto* p = packet.getPayload<Draw>();
+            pCmdBuffer->cmdDraw(p->vertexCount, p->instanceCount, p->firstVertex, p->firstInstance);
+            break;
+        }
+        case Op::DrawIndexed: {
+            auto* p = packet.getPayload<DrawIndexed>();
+            pCmdBuffer->cmdDrawIndexed(p->indexCount, p->instanceCount, p->firstIndex, p->vertexOffset, p->firstInstance);
+            break;
+        }
+        case Op::DrawIndirect: {
+            auto* p = packet.getPayload<DrawIndirect>();
+            pCmdBuffer->cmdDrawIndirect(p->buffer, p->offset, p->drawCount, p->stride);
+            break;
+        }
+        case Op::DrawIndexedIndirect: {
+            auto* p = packet.getPayload<DrawIndirect>();
+            pCmdBuffer->cmdDrawIndexedIndirect(p->buffer, p->offset, p->drawCount, p->stride);
+            break;
+        }
+        case Op::Dispatch: {
+            auto* p = packet.getPayload<Dispatch>();
+            pCmdBuffer->cmdDispatch(p->groupCountX, p->groupCountY, p->groupCountZ);
+            break;
+        }
+        case Op::DispatchIndirect: {
+            auto* p = packet.getPayload<DispatchIndirect>();
+            pCmdBuffer->cmdDispatchIndirect(p->buffer, p->offset);
+            break;
+        }
+        case Op::PipelineBarrier: {
+            auto* p = packet.getPayload<PipelineBarrier>();
+            pCmdBuffer->cmdPipelineBarrier(p->srcStageMask, p->dstStageMask, p->dependencyFlags,
+                                           p->memoryBarrierCount, packet.getArray<VkMemoryBarrier>(0),
+                                           p->bufferMemoryBarrierCount, packet.getArray<VkBufferMemoryBarrier>(1),
+                                           p->imageMemoryBarrierCount, packet.getArray<VkImageMemoryBarrier>(2));
+            break;
+        }
+        case Op::CopyBuffer: {
+            auto* p = packet.getPayload<CopyBuffer>();
+            pCmdBuffer->cmdCopyBuffer(p->srcBuffer, p->dstBuffer, p->regionCount, packet.getArray<VkBufferCopy>(0));
+            break;
+        }
+        case Op::CopyBufferToImage: {
+            auto* p = packet.getPayload<CopyBufferToImage>();
+            pCmdBuffer->cmdCopyBufferToImage(p->srcBuffer, p->dstImage, p->dstImageLayout, p->regionCount, packet.getArray<VkBufferImageCopy>(0));
+            break;
+        }
+        case Op::BeginRenderPass: {
+            auto* p = packet.getPayload<BeginRenderPass>();
+            const auto info = VkRenderPassBeginInfo {
+                VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+                nullptr,
+                p->renderPass,
+                p->framebuffer,
+                p->renderArea,
+                p->clearValueCount,
+                packet.getArray<VkClearValue>(0)
+            };
+            pCmdBuffer->cmdBeginRenderPass(info, p->contents);
+            break;
+        }
+        case Op::EndRenderPass:
+            pCmdBuffer->cmdEndRenderPass();
+            break;
+        case Op::ExecuteCommands: {
+            auto* p = packet.getPayload<ExecuteCommands>();
+            pCmdBuffer->cmdExecuteCommands(p->commandBufferCount, packet.getArray<VkCommandBuffer>(0));
+            break;
+        }
+        default: assert(false);
+        }
+    });
+}
+
+const char* CommandStream::getOpName(Op op) {
+    switch(op) {
+    case Op::BindPipeline:          return "BindPipeline";
+    case Op::BindIndexBuffer:       return "BindIndexBuffer";
+    case Op::BindVertexBuffers:     return "BindVertexBuffers";
+    case Op::BindDescriptorSets:    return "BindDescriptorSets";
+    case Op::PushConstants:         return "PushConstants";
+    case Op::SetViewport:           return "SetViewport";
+    case Op::SetScissor:            return "SetScissor";
+    case Op::Draw:                  return "Draw";
+    case Op::DrawIndexed:           return "DrawIndexed";
+    case Op::DrawIndirect:          return "DrawIndirect";
+    case Op::DrawIndexedIndirect:   return "DrawIndexedIndirect";
+    case Op::Dispatch:              return "Dispatch";
+    case Op::DispatchIndirect:      return "DispatchIndirect";
+    case Op::PipelineBarrier:       return "PipelineBarrier";
+    case Op::CopyBuffer:            return "CopyBuffer";
+    case Op::CopyBufferToImage:     return "CopyBufferToImage";
+    case Op::BeginRenderPass:       return "BeginRenderPass";
+    case Op::EndRenderPass:         return "EndRenderPass";
+    case Op::ExecuteCommands:       return "ExecuteCommands";
+    default:                        return "Unknown";
+    }
+}
+
+void CommandStream::log(DebugLog* pLog) const {
+    pLog->verbose("Command Stream: %u packets, %zu bytes",
+                  m_statistics.packetCount,
+                  m_statistics.byteSize);
+    pLog->push();
+    uint32_t index = 0;
+    forEach([&](const Packet& packet) {
+        pLog->verbose("[%4u] %-20s %3u bytes", index++, getOpName(packet.getOp()), packet.getSize());
+    });
+    pLog->pop();
+}
+
+}
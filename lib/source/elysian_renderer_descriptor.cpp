@@ -0,0 +1,203 @@
+#include <renderer/elysian_renderer_descriptor.hpp>
+#include <renderer/elysian_renderer_device.hpp>
+#include <algorithm>
+#include <cassert>
+
+namespace elysian::renderer {
+
+DescriptorPool::DescriptorPool(Initializer initializer):
+    m_initializer(std::move(initializer))
+{
+    assert(m_initializer.pDevice);
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    m_result = vkCreateDescriptorPool(m_initializer.pDevice->getHandle(), &m_initializer.info,
+                                      m_initializer.pDevice->getAllocationCallbacks(), &pool);
+    setHandle(pool);
+}
+
+DescriptorPool::~DescriptorPool(void) {
+    vkDestroyDescriptorPool(m_initializer.pDevice->getHandle(), getHandle(), m_initializer.pDevice->getAllocationCallbacks());
+}
+
+Result DescriptorPool::reset(VkDescriptorPoolResetFlags flags) const {
+    return vkResetDescriptorPool(m_initializer.pDevice->getHandle(), getHandle(), flags);
+}
+
+Result DescriptorPool::allocate(uint32_t count, const VkDescriptorSetLayout* pLayouts, VkDescriptorSet* pSets,
+                                const void* pNext) const
+{
+    const auto info = VkDescriptorSetAllocateInfo {
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        pNext,
+        getHandle(),
+        count,
+        pLayouts
+    };
+    return vkAllocateDescriptorSets(m_initializer.pDevice->getHandle(), &info, pSets);
+}
+
+void DescriptorSet::write(const VkWriteDescriptorSet& write) const {
+    VkWriteDescriptorSet descriptorWrite = write;
+    descriptorWrite.dstSet = getHandle();
+    vkUpdateDescriptorSets(getDevice()->getHandle(), 1, &descriptorWrite, 0, nullptr);
+}
+
+void DescriptorSet::copy(const VkCopyDescriptorSet& copy) const {
+    VkCopyDescriptorSet descriptorCopy = copy;
+    descriptorCopy.dstSet = getHandle();
+    vkUpdateDescriptorSets(getDevice()->getHandle(), 0, nullptr, 1, &descriptorCopy);
+}
+
+void DescriptorSet::updateWithTemplate(VkDescriptorUpdateTemplate descriptorUpdateTemplate, const void* pData) const {
+    vkUpdateDescriptorSetWithTemplate(getDevice()->getHandle(), getHandle(), descriptorUpdateTemplate, pData);
+}
+
+void DescriptorSet::updateWithTemplate(const DescriptorUpdateTemplate& updateTemplate, const void* pData) const {
+    updateWithTemplate(updateTemplate.getHandle(), pData);
+}
+
+namespace {
+
+// 0 for the types templates here can't write (inline uniform blocks, mutable, ...)
+size_t getDescriptorInfoSize(VkDescriptorType type) {
+    switch(type) {
+    case VK_DESCRIPTOR_TYPE_SAMPLER:
+    case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+    case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+    case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+    case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+        return sizeof(VkDescriptorImageInfo);
+    case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+    case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+        return sizeof(VkBufferView);
+    case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+    case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+    case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+    case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+        return sizeof(VkDescriptorBufferInfo);
+#ifdef VK_KHR_acceleration_structure
+    // the blob holds the handles themselves
+    case VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR:
+        return sizeof(VkAccelerationStructureKHR);
+#endif
+    default:
+        return 0;
+    }
+}
+
+}
+
+DescriptorUpdateTemplate::DescriptorUpdateTemplate(Initializer initializer):
+    m_initializer(std::move(initializer))
+{
+    assert(m_initializer.pDevice);
+    for(const auto& entry : m_initializer.entries) {
+        const size_t size = getDescriptorInfoSize(entry.descriptorType);
+        if(!size) {
+            m_result = VK_ERROR_INITIALIZATION_FAILED;
+            m_dataSize = 0;
+            return;
+        }
+        if(!entry.descriptorCount) continue;
+        const size_t end = entry.offset + (entry.descriptorCount - 1) * entry.stride + size;
+        m_dataSize = std::max(m_dataSize, end);
+    }
+
+    const auto info = VkDescriptorUpdateTemplateCreateInfo {
+        VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO,
+        nullptr,
+        0,
+        static_cast<uint32_t>(m_initializer.entries.size()),
+        m_initializer.entries.data(),
+        m_initializer.type,
+        m_initializer.setLayout,
+        m_initializer.bindPoint,
+        m_initializer.pipelineLayout,
+        m_initializer.set
+    };
+    VkDescriptorUpdateTemplate updateTemplate = VK_NULL_HANDLE;
+    m_result = vkCreateDescriptorUpdateTemplate(m_initializer.pDevice->getHandle(), &info,
+                                                m_initializer.pDevice->getAllocationCallbacks(), &updateTemplate);
+    setHandle(updateTemplate);
+}
+
+DescriptorUpdateTemplate::~DescriptorUpdateTemplate(void) {
+    vkDestroyDescriptorUpdateTemplate(m_initializer.pDevice->getHandle(), getHandle(), m_initializer.pDevice->getAllocationCallbacks());
+}
+
+auto DescriptorUpdateTemplate::findEntry(uint32_t binding, uint32_t arrayElement) const -> const VkDescriptorUpdateTemplateEntry* {
+    for(const auto& entry : m_initializer.entries) {
+        if(entry.dstBinding == binding && arrayElement >= entry.dstArrayElement &&
+           arrayElement < entry.dstArrayElement + entry.descriptorCount)
+        {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+void DescriptorUpdateTemplate::update(VkDescriptorSet set, const void* pData) const {
+    vkUpdateDescriptorSetWithTemplate(m_initializer.pDevice->getHandle(), set, getHandle(), pData);
+}
+
+Result DescriptorUpdateTemplate::makeEntries(const VkDescriptorSetLayoutBinding* pBindings, uint32_t count,
+                                             std::vector<VkDescriptorUpdateTemplateEntry>* pEntries)
+{
+    pEntries->clear();
+    std::vector<const VkDescriptorSetLayoutBinding*> bindings;
+    for(uint32_t b = 0; b < count; ++b) {
+        if(pBindings[b].descriptorCount) bindings.push_back(&pBindings[b]);
+    }
+    std::sort(bindings.begin(), bindings.end(), [](const auto* pLhs, const auto* pRhs) {
+        return pLhs->binding < pRhs->binding;
+    });
+
+    // every info is a multiple of 8 bytes, packing them back to back keeps them aligned
+    std::vector<VkDescriptorUpdateTemplateEntry> entries;
+    entries.reserve(bindings.size());
+    size_t offset = 0;
+    for(const auto* pBinding : bindings) {
+        const size_t stride = getDescriptorInfoSize(pBinding->descriptorType);
+        if(!stride) return VK_ERROR_INITIALIZATION_FAILED;
+        entries.push_back({
+            pBinding->binding,
+            0,
+            pBinding->descriptorCount,
+            pBinding->descriptorType,
+            offset,
+            stride
+        });
+        offset += stride * pBinding->descriptorCount;
+    }
+    *pEntries = std::move(entries);
+    return VK_SUCCESS;
+}
+
+Result DescriptorUpdateTemplate::makeEntries(const DescriptorSetLayout& layout, std::vector<VkDescriptorUpdateTemplateEntry>* pEntries) {
+    return makeEntries(layout.getBindings(), pEntries);
+}
+
+Result DescriptorUpdateTemplate::makeEntries(const std::vector<DescriptorSetLayoutBinding>& bindings,
+                                             std::vector<VkDescriptorUpdateTemplateEntry>* pEntries)
+{
+    const std::vector<VkDescriptorSetLayoutBinding> vkBindings(bindings.begin(), bindings.end());
+    return makeEntries(vkBindings.data(), static_cast<uint32_t>(vkBindings.size()), pEntries);
+}
+
+DescriptorSetLayout::~DescriptorSetLayout(void) = default;
+
+auto DescriptorSetLayout::getBinding(uint32_t binding) const -> const DescriptorSetLayoutBinding* {
+    for(const auto& layoutBinding : m_bindings) {
+        if(layoutBinding.getBinding() == binding) return &layoutBinding;
+    }
+    return nullptr;
+}
+
+auto DescriptorSetLayout::getBinding(std::string_view name) const -> const DescriptorSetLayoutBinding* {
+    for(const auto& layoutBinding : m_bindings) {
+        if(layoutBinding.getName() == name) return &layoutBinding;
+    }
+    return nullptr;
+}
+
+}
@@ -0,0 +1,179 @@
+#include <renderer/elysian_renderer_descriptor_allocator.hpp>
+#include <renderer/elysian_renderer_device.hpp>
+#include <renderer/elysian_renderer_debug_log.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace elysian::renderer {
+
+namespace {
+
+const std::vector<DescriptorAllocator::PoolRatio> kDefaultRatios = {
+    { VK_DESCRIPTOR_TYPE_SAMPLER,                   0.5f },
+    { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,    4.0f },
+    { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,             4.0f },
+    { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,             1.0f },
+    { VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER,      1.0f },
+    { VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER,      1.0f },
+    { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,            2.0f },
+    { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,            2.0f },
+    { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,    1.0f },
+    { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,    1.0f },
+    { VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,          0.5f }
+};
+
+inline bool isPoolExhausted(const Result& result) {
+    return result.getCode() == VK_ERROR_OUT_OF_POOL_MEMORY || result.getCode() == VK_ERROR_FRAGMENTED_POOL;
+}
+
+}
+
+DescriptorAllocator::DescriptorAllocator(Initializer initializer):
+    m_initializer(std::move(initializer))
+{
+    assert(m_initializer.pDevice && m_initializer.frameCount && m_initializer.setsPerPool);
+    if(m_initializer.profiles.empty()) m_initializer.profiles.push_back(kDefaultRatios);
+    m_initializer.maxSetsPerPool = std::max(m_initializer.maxSetsPerPool, m_initializer.setsPerPool);
+}
+
+// pools take every set allocated from them along
+DescriptorAllocator::~DescriptorAllocator(void) = default;
+
+auto DescriptorAllocator::getDefaultRatios(void) -> const std::vector<PoolRatio>& {
+    return kDefaultRatios;
+}
+
+DescriptorAllocator::ThreadContext* DescriptorAllocator::getThreadContext(void) {
+    if(ThreadContext* pContext = m_registry.find()) return pContext;
+
+    // first time this thread allocates through us
+    auto pContext = std::make_unique<ThreadContext>();
+    pContext->frames.resize(m_initializer.frameCount);
+    for(auto& frame : pContext->frames) frame.profiles.resize(m_initializer.profiles.size());
+
+    ThreadContext* pRaw = pContext.get();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_threads.push_back(std::move(pContext));
+    }
+    m_registry.add(pRaw);
+    return pRaw;
+}
+
+auto DescriptorAllocator::createPool(uint32_t profile, uint32_t index) const -> std::unique_ptr<DescriptorPool> {
+    // threads that burn through their pools get bigger ones, the busy ones settle quickly
+    const uint32_t shift = std::min(index, 16u);
+    const uint32_t maxSets = std::min<uint64_t>(uint64_t(m_initializer.setsPerPool) << shift, m_initializer.maxSetsPerPool);
+
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for(const PoolRatio& ratio : m_initializer.profiles[profile]) {
+        const auto count = static_cast<uint32_t>(std::ceil(ratio.ratio * static_cast<float>(maxSets)));
+        if(count) poolSizes.push_back({ ratio.type, count });
+    }
+
+    return std::make_unique<DescriptorPool>(DescriptorPool::Initializer{
+        m_initializer.name,
+        DescriptorPoolCreateInfo(0, maxSets, std::move(poolSizes)),
+        m_initializer.pDevice
+    });
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout, uint32_t profile, Result* pResult) {
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    const Result result = allocate(1, &layout, &set, profile);
+    if(pResult) *pResult = result;
+    return set;
+}
+
+Result DescriptorAllocator::allocate(uint32_t count, const VkDescriptorSetLayout* pLayouts, VkDescriptorSet* pSets,
+                                     uint32_t profile, const uint32_t* pVariableCounts)
+{
+    assert(profile < m_initializer.profiles.size());
+    ThreadContext* pThread = getThreadContext();
+    const uint64_t currentFrame = m_frame.load(std::memory_order_relaxed);
+    FrameContext& frame = pThread->frames[currentFrame % m_initializer.frameCount];
+
+    if(frame.frame != currentFrame) {
+        // slot came around again, nothing still bound to its sets is in flight
+        for(auto& profilePools : frame.profiles) {
+            if(!profilePools.used) continue;
+            for(uint32_t p = 0; p <= profilePools.current && p < profilePools.pools.size(); ++p) {
+                profilePools.pools[p]->reset();
+                pThread->resetCount.fetch_add(1, std::memory_order_relaxed);
+            }
+            profilePools.current = 0;
+            profilePools.used = false;
+        }
+        frame.frame = currentFrame;
+    }
+
+    const auto variableCounts = VkDescriptorSetVariableDescriptorCountAllocateInfo {
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO,
+        nullptr,
+        count,
+        pVariableCounts
+    };
+
+    ProfilePools& profilePools = frame.profiles[profile];
+    profilePools.used = true;
+    for(;;) {
+        bool fresh = false;
+        if(profilePools.current == profilePools.pools.size()) {
+            auto pPool = createPool(profile, profilePools.current);
+            if(!pPool->isValid()) {
+                pThread->failedCount.fetch_add(1, std::memory_order_relaxed);
+                return pPool->getResult();
+            }
+            profilePools.pools.push_back(std::move(pPool));
+            pThread->poolCount.fetch_add(1, std::memory_order_relaxed);
+            fresh = true;
+        }
+
+        const Result result = profilePools.pools[profilePools.current]->allocate(count, pLayouts, pSets,
+                                                                                 pVariableCounts? &variableCounts : nullptr);
+        if(result) {
+            pThread->allocationCount.fetch_add(count, std::memory_order_relaxed);
+            return result;
+        }
+
+        // an empty pool that can't take it never will, the layouts don't fit the profile
+        if(!isPoolExhausted(result) || fresh) {
+            pThread->failedCount.fetch_add(1, std::memory_order_relaxed);
+            return result;
+        }
+        pThread->overflowCount.fetch_add(1, std::memory_order_relaxed);
+        ++profilePools.current;
+    }
+}
+
+DescriptorAllocator::Statistics DescriptorAllocator::getStatistics(void) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Statistics statistics;
+    statistics.threadCount = static_cast<uint32_t>(m_threads.size());
+    for(const auto& pThread : m_threads) {
+        statistics.poolCount += pThread->poolCount.load(std::memory_order_relaxed);
+        statistics.allocationCount += pThread->allocationCount.load(std::memory_order_relaxed);
+        statistics.overflowCount += pThread->overflowCount.load(std::memory_order_relaxed);
+        statistics.resetCount += pThread->resetCount.load(std::memory_order_relaxed);
+        statistics.failedCount += pThread->failedCount.load(std::memory_order_relaxed);
+    }
+    return statistics;
+}
+
+void DescriptorAllocator::log(DebugLog* pLog) const {
+    const Statistics statistics = getStatistics();
+    pLog->verbose("Descriptor Allocator: %s", getName());
+    pLog->push();
+    pLog->verbose("%-16s %u / %u", "Frame:", getFrameIndex(), getFrameCount());
+    pLog->verbose("%-16s %u", "Profiles:", getProfileCount());
+    pLog->verbose("%-16s %u", "Threads:", statistics.threadCount);
+    pLog->verbose("%-16s %u", "Pools:", statistics.poolCount);
+    pLog->verbose("%-16s %llu", "Sets:", static_cast<unsigned long long>(statistics.allocationCount));
+    pLog->verbose("%-16s %llu", "Overflows:", static_cast<unsigned long long>(statistics.overflowCount));
+    pLog->verbose("%-16s %llu", "Resets:", static_cast<unsigned long long>(statistics.resetCount));
+    pLog->verbose("%-16s %llu", "Failed:", static_cast<unsigned long long>(statistics.failedCount));
+    pLog->pop();
+}
+
+}
@@ -0,0 +1,412 @@
+#include <renderer/elysian_renderer_descriptor_set_cache.hpp>
+#include <renderer/elysian_renderer_device.hpp>
+#include <renderer/elysian_renderer_debug_log.hpp>
+#include <renderer/elysian_renderer_hash.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace elysian::renderer {
+
+static_assert(sizeof(DescriptorSetContents::Resource) == 4 * sizeof(uint32_t) + 6 * sizeof(uint64_t),
+              "padding would end up in the hash");
+
+namespace {
+
+inline bool isPoolExhausted(const Result& result) {
+    return result.getCode() == VK_ERROR_OUT_OF_POOL_MEMORY || result.getCode() == VK_ERROR_FRAGMENTED_POOL;
+}
+
+inline bool isImageDescriptor(VkDescriptorType type) {
+    return type == VK_DESCRIPTOR_TYPE_SAMPLER || type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ||
+           type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE || type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ||
+           type == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+}
+
+inline bool isTexelBufferDescriptor(VkDescriptorType type) {
+    return type == VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER;
+}
+
+inline bool isBufferDescriptor(VkDescriptorType type) {
+    return type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ||
+           type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+}
+
+// Acceleration structures and inline uniform blocks are written through pNext structs
+// (VkWriteDescriptorSetAccelerationStructureKHR, VkWriteDescriptorSetInlineUniformBlock)
+// that a Resource has nothing to fill in with, anything not listed here gets refused.
+inline bool isSupportedDescriptor(VkDescriptorType type) {
+    return isImageDescriptor(type) || isTexelBufferDescriptor(type) || isBufferDescriptor(type);
+}
+
+// which slots the contents write, whatever they point at
+uint64_t hashShape(const std::vector<DescriptorSetContents::Resource>& resources) {
+    uint64_t hash = hashValue(resources.size());
+    for(const auto& resource : resources) {
+        hash = hashValue(resource.binding, hash);
+        hash = hashValue(resource.arrayElement, hash);
+        hash = hashValue(resource.type, hash);
+    }
+    return hash;
+}
+
+bool isSameShape(const std::vector<DescriptorSetContents::Resource>& lhs, const std::vector<DescriptorSetContents::Resource>& rhs) {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                      [](const DescriptorSetContents::Resource& l, const DescriptorSetContents::Resource& r) {
+        return l.binding == r.binding && l.arrayElement == r.arrayElement && l.type == r.type;
+    });
+}
+
+}
+
+DescriptorSetContents& DescriptorSetContents::set(const Resource& resource) {
+    const auto position = std::lower_bound(m_resources.begin(), m_resources.end(), resource,
+                                           [](const Resource& lhs, const Resource& rhs) {
+        return lhs.binding != rhs.binding? lhs.binding < rhs.binding : lhs.arrayElement < rhs.arrayElement;
+    });
+    if(position != m_resources.end() && position->binding == resource.binding && position->arrayElement == resource.arrayElement)
+        *position = resource;
+    else
+        m_resources.insert(position, resource);
+    return *this;
+}
+
+DescriptorSetContents& DescriptorSetContents::setBuffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer,
+                                                        VkDeviceSize offset, VkDeviceSize range, uint32_t arrayElement)
+{
+    Resource resource = {};
+    resource.binding = binding;
+    resource.arrayElement = arrayElement;
+    resource.type = type;
+    resource.buffer = buffer;
+    resource.offset = offset;
+    resource.range = range;
+    return set(resource);
+}
+
+DescriptorSetContents& DescriptorSetContents::setImage(uint32_t binding, VkDescriptorType type, VkImageView imageView,
+                                                       VkImageLayout imageLayout, VkSampler sampler, uint32_t arrayElement)
+{
+    Resource resource = {};
+    resource.binding = binding;
+    resource.arrayElement = arrayElement;
+    resource.type = type;
+    resource.imageLayout = imageLayout;
+    resource.sampler = sampler;
+    resource.imageView = imageView;
+    return set(resource);
+}
+
+DescriptorSetContents& DescriptorSetContents::setSampler(uint32_t binding, VkSampler sampler, uint32_t arrayElement) {
+    return setImage(binding, VK_DESCRIPTOR_TYPE_SAMPLER, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED, sampler, arrayElement);
+}
+
+DescriptorSetContents& DescriptorSetContents::setTexelBuffer(uint32_t binding, VkDescriptorType type, VkBufferView view,
+                                                             uint32_t arrayElement)
+{
+    Resource resource = {};
+    resource.binding = binding;
+    resource.arrayElement = arrayElement;
+    resource.type = type;
+    resource.texelBufferView = view;
+    return set(resource);
+}
+
+uint64_t DescriptorSetContents::getHash(VkDescriptorSetLayout layout) const {
+    return hashArray(m_resources.data(), m_resources.size(), hashValue(layout));
+}
+
+DescriptorSetCache::DescriptorSetCache(Initializer initializer):
+    m_initializer(std::move(initializer))
+{
+    assert(m_initializer.pDevice && m_initializer.frameCount && m_initializer.setsPerPool);
+    if(m_initializer.ratios.empty()) m_initializer.ratios = DescriptorAllocator::getDefaultRatios();
+}
+
+// the pools take every set along
+DescriptorSetCache::~DescriptorSetCache(void) = default;
+
+void DescriptorSetCache::beginFrame(void) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_frame;
+
+    // invalidated sets whose last frame has retired can be rewritten now
+    const auto retired = std::partition(m_retired.begin(), m_retired.end(), [this](const Entry& entry) {
+        return entry.lastUse + m_initializer.frameCount > m_frame;
+    });
+    for(auto it = retired; it != m_retired.end(); ++it) recycleLocked(*it);
+    m_retired.erase(retired, m_retired.end());
+}
+
+VkDescriptorSet DescriptorSetCache::getSet(VkDescriptorSetLayout layout, const DescriptorSetContents& contents, Result* pResult) {
+    const auto& resources = contents.getResources();
+    const uint64_t hash = contents.getHash(layout);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto range = m_lookup.equal_range(hash);
+    for(auto it = range.first; it != range.second; ++it) {
+        Entry& entry = *it->second;
+        if(entry.layout != layout || entry.resources.size() != resources.size() ||
+           std::memcmp(entry.resources.data(), resources.data(), resources.size() * sizeof(resources[0])) != 0)
+        {
+            continue;
+        }
+        entry.lastUse = m_frame;
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        ++m_statistics.hitCount;
+        if(pResult) *pResult = VK_SUCCESS;
+        return entry.set;
+    }
+
+    ++m_statistics.missCount;
+    const bool supported = std::all_of(resources.begin(), resources.end(), [](const DescriptorSetContents::Resource& resource) {
+        return isSupportedDescriptor(resource.type);
+    });
+    if(!supported) {
+        ++m_statistics.failedCount;
+        if(pResult) *pResult = VK_ERROR_INITIALIZATION_FAILED;
+        return VK_NULL_HANDLE;
+    }
+    evictLocked();
+
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    const Result result = allocateLocked(layout, resources, &set);
+    if(pResult) *pResult = result;
+    if(!result) {
+        ++m_statistics.failedCount;
+        return VK_NULL_HANDLE;
+    }
+
+    updateSet(set, resources);
+    m_entries.push_front(Entry{ hash, layout, resources, set, m_frame });
+    m_lookup.emplace(hash, m_entries.begin());
+    return set;
+}
+
+void DescriptorSetCache::evictLocked(void) {
+    // least recently used first, anything a frame in flight may still bind has to stay
+    while(m_entries.size() >= m_initializer.maxSets && !m_entries.empty()) {
+        Entry& entry = m_entries.back();
+        if(entry.lastUse + m_initializer.frameCount > m_frame) return;
+
+        const auto range = m_lookup.equal_range(entry.hash);
+        for(auto it = range.first; it != range.second; ++it) {
+            if(it->second == std::prev(m_entries.end())) {
+                m_lookup.erase(it);
+                break;
+            }
+        }
+        recycleLocked(entry);
+        ++m_statistics.evictCount;
+        m_entries.pop_back();
+    }
+}
+
+void DescriptorSetCache::recycleLocked(Entry& entry) {
+    const uint64_t shape = hashShape(entry.resources);
+    m_freeSets[entry.layout].push_back({ shape, std::move(entry.resources), entry.set });
+    ++m_freeCount;
+}
+
+template<typename F>
+void DescriptorSetCache::invalidateLocked(F&& matches) {
+    for(auto entry = m_entries.begin(); entry != m_entries.end();) {
+        if(!matches(*entry)) {
+            ++entry;
+            continue;
+        }
+
+        const auto range = m_lookup.equal_range(entry->hash);
+        for(auto it = range.first; it != range.second; ++it) {
+            if(it->second == entry) {
+                m_lookup.erase(it);
+                break;
+            }
+        }
+        if(entry->lastUse + m_initializer.frameCount > m_frame) m_retired.push_back(std::move(*entry));
+        else recycleLocked(*entry);
+        ++m_statistics.invalidateCount;
+        entry = m_entries.erase(entry);
+    }
+}
+
+void DescriptorSetCache::invalidateBuffer(VkBuffer buffer) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    invalidateLocked([buffer](const Entry& entry) {
+        return std::any_of(entry.resources.begin(), entry.resources.end(), [buffer](const DescriptorSetContents::Resource& resource) {
+            return resource.buffer == buffer;
+        });
+    });
+}
+
+void DescriptorSetCache::invalidateBufferView(VkBufferView view) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    invalidateLocked([view](const Entry& entry) {
+        return std::any_of(entry.resources.begin(), entry.resources.end(), [view](const DescriptorSetContents::Resource& resource) {
+            return resource.texelBufferView == view;
+        });
+    });
+}
+
+void DescriptorSetCache::invalidateImageView(VkImageView imageView) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    invalidateLocked([imageView](const Entry& entry) {
+        return std::any_of(entry.resources.begin(), entry.resources.end(), [imageView](const DescriptorSetContents::Resource& resource) {
+            return resource.imageView == imageView;
+        });
+    });
+}
+
+void DescriptorSetCache::invalidateSampler(VkSampler sampler) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    invalidateLocked([sampler](const Entry& entry) {
+        return std::any_of(entry.resources.begin(), entry.resources.end(), [sampler](const DescriptorSetContents::Resource& resource) {
+            return resource.sampler == sampler;
+        });
+    });
+}
+
+void DescriptorSetCache::invalidateLayout(VkDescriptorSetLayout layout) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    invalidateLocked([layout](const Entry& entry) { return entry.layout == layout; });
+
+    // no other layout can take these sets, they just sit in their pool until clear()
+    m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(), [layout](const Entry& entry) {
+                        return entry.layout == layout;
+                    }),
+                    m_retired.end());
+    const auto free = m_freeSets.find(layout);
+    if(free != m_freeSets.end()) {
+        m_freeCount -= static_cast<uint32_t>(free->second.size());
+        m_freeSets.erase(free);
+    }
+}
+
+Result DescriptorSetCache::allocateLocked(VkDescriptorSetLayout layout, const std::vector<DescriptorSetContents::Resource>& resources,
+                                          VkDescriptorSet* pSet)
+{
+    // The update only writes the slots the new contents name. Whatever else the previous
+    // owner wrote would stay behind, so a set is only taken over by contents of its shape.
+    const auto free = m_freeSets.find(layout);
+    if(free != m_freeSets.end()) {
+        auto& sets = free->second;
+        const uint64_t shape = hashShape(resources);
+        for(auto it = sets.rbegin(); it != sets.rend(); ++it) {
+            if(it->shape != shape || !isSameShape(it->resources, resources)) continue;
+            *pSet = it->set;
+            std::swap(*it, sets.back());
+            sets.pop_back();
+            --m_freeCount;
+            ++m_statistics.recycleCount;
+            return VK_SUCCESS;
+        }
+    }
+
+    for(;;) {
+        // only kept once something fits into it
+        std::unique_ptr<DescriptorPool> pFresh;
+        if(m_currentPool == m_pools.size()) {
+            std::vector<VkDescriptorPoolSize> poolSizes;
+            for(const auto& ratio : m_initializer.ratios) {
+                const auto count = static_cast<uint32_t>(std::ceil(ratio.ratio * static_cast<float>(m_initializer.setsPerPool)));
+                if(count) poolSizes.push_back({ ratio.type, count });
+            }
+            pFresh = std::make_unique<DescriptorPool>(DescriptorPool::Initializer{
+                m_initializer.name,
+                DescriptorPoolCreateInfo(0, m_initializer.setsPerPool, std::move(poolSizes)),
+                m_initializer.pDevice
+            });
+            if(!pFresh->isValid()) return pFresh->getResult();
+        }
+
+        DescriptorPool* pPool = pFresh? pFresh.get() : m_pools[m_currentPool].get();
+        const Result result = pPool->allocate(1, &layout, pSet);
+        if(result) {
+            if(pFresh) m_pools.push_back(std::move(pFresh));
+            return result;
+        }
+
+        // an empty pool that can't take it never will, the layout doesn't fit the ratios
+        if(!isPoolExhausted(result) || pFresh) return result;
+        ++m_currentPool;
+    }
+}
+
+void DescriptorSetCache::updateSet(VkDescriptorSet set, const std::vector<DescriptorSetContents::Resource>& resources) const {
+    if(resources.empty()) return;
+
+    // reserved up front, the writes point into these
+    std::vector<VkWriteDescriptorSet>   writes;
+    std::vector<VkDescriptorBufferInfo> bufferInfos;
+    std::vector<VkDescriptorImageInfo>  imageInfos;
+    writes.reserve(resources.size());
+    bufferInfos.reserve(resources.size());
+    imageInfos.reserve(resources.size());
+
+    for(const DescriptorSetContents::Resource& resource : resources) {
+        VkWriteDescriptorSet write = {
+            VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            nullptr,
+            set,
+            resource.binding,
+            resource.arrayElement,
+            1,
+            resource.type,
+            nullptr,
+            nullptr,
+            nullptr
+        };
+        if(isImageDescriptor(resource.type)) {
+            imageInfos.push_back({ resource.sampler, resource.imageView, resource.imageLayout });
+            write.pImageInfo = &imageInfos.back();
+        } else if(isTexelBufferDescriptor(resource.type)) {
+            write.pTexelBufferView = &resource.texelBufferView;
+        } else {
+            assert(isBufferDescriptor(resource.type)); //getSet() refused everything else
+            bufferInfos.push_back({ resource.buffer, resource.offset, resource.range });
+            write.pBufferInfo = &bufferInfos.back();
+        }
+        writes.push_back(write);
+    }
+
+    vkUpdateDescriptorSets(m_initializer.pDevice->getHandle(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void DescriptorSetCache::clear(void) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_lookup.clear();
+    m_freeSets.clear();
+    m_freeCount = 0;
+    m_retired.clear();
+    for(auto& pPool : m_pools) pPool->reset();
+    m_currentPool = 0;
+}
+
+DescriptorSetCache::Statistics DescriptorSetCache::getStatistics(void) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Statistics statistics = m_statistics;
+    statistics.setCount = static_cast<uint32_t>(m_entries.size());
+    statistics.freeCount = m_freeCount;
+    statistics.poolCount = static_cast<uint32_t>(m_pools.size());
+    return statistics;
+}
+
+void DescriptorSetCache::log(DebugLog* pLog) const {
+    const Statistics statistics = getStatistics();
+    pLog->verbose("Descriptor Set Cache: %s", getName());
+    pLog->push();
+    pLog->verbose("%-16s %u / %u (%u free)", "Sets:", statistics.setCount, m_initializer.maxSets, statistics.freeCount);
+    pLog->verbose("%-16s %u", "Pools:", statistics.poolCount);
+    pLog->verbose("%-16s %llu", "Hits:", static_cast<unsigned long long>(statistics.hitCount));
+    pLog->verbose("%-16s %llu", "Misses:", static_cast<unsigned long long>(statistics.missCount));
+    pLog->verbose("%-16s %llu", "Recycled:", static_cast<unsigned long long>(statistics.recycleCount));
+    pLog->verbose("%-16s %llu", "Evicted:", static_cast<unsigned long long>(statistics.evictCount));
+    pLog->verbose("%-16s %llu", "Invalidated:", static_cast<unsigned long long>(statistics.invalidateCount));
+    pLog->verbose("%-16s %llu", "Failed:", static_cast<unsigned long long>(statistics.failedCount));
+    pLog->pop();
+}
+
+}
@@ -0,0 +1,179 @@
+#include <renderer/elysian_renderer_descriptor_write_batch.hpp>
+#include <renderer/elysian_renderer_descriptor_template.hpp>
+#include <renderer/elysian_renderer_device.hpp>
+#include <cassert>
+
+namespace elysian::renderer {
+
+template<typename Info>
+Result DescriptorWriteBatch::queue(const DescriptorSet& set, const DescriptorSetLayoutBinding* pBinding,
+                                   const Info* pInfos, uint32_t count, uint32_t arrayElement)
+{
+    // no spilling over into the next binding, even where Vulkan would allow it
+    if(!pBinding || !detail::isDescriptorInfoFor<Info>(pBinding->getDescriptorType()) ||
+       arrayElement + count > pBinding->getDescriptorCount())
+    {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    if(!count) return VK_SUCCESS;
+
+    uint32_t infoIndex = 0;
+    if constexpr(std::is_same_v<Info, VkDescriptorBufferInfo>) {
+        infoIndex = static_cast<uint32_t>(m_bufferInfos.size());
+        m_bufferInfos.insert(m_bufferInfos.end(), pInfos, pInfos + count);
+    } else if constexpr(std::is_same_v<Info, VkDescriptorImageInfo>) {
+        infoIndex = static_cast<uint32_t>(m_imageInfos.size());
+        m_imageInfos.insert(m_imageInfos.end(), pInfos, pInfos + count);
+    } else {
+        infoIndex = static_cast<uint32_t>(m_texelBufferViews.size());
+        m_texelBufferViews.insert(m_texelBufferViews.end(), pInfos, pInfos + count);
+    }
+
+    m_pendingWrites.push_back({
+        VkWriteDescriptorSet {
+            VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            nullptr,
+            set.getHandle(),
+            pBinding->getBinding(),
+            arrayElement,
+            count,
+            pBinding->getDescriptorType(),
+            nullptr,
+            nullptr,
+            nullptr
+        },
+        infoIndex
+    });
+    return VK_SUCCESS;
+}
+
+template<typename Info>
+Result DescriptorWriteBatch::queue(const DescriptorSet& set, uint32_t binding, const Info* pInfos, uint32_t count, uint32_t arrayElement) {
+    if(!set.getLayout()) return VK_ERROR_INITIALIZATION_FAILED;
+    return queue(set, set.getLayout()->getBinding(binding), pInfos, count, arrayElement);
+}
+
+template<typename Info>
+Result DescriptorWriteBatch::queue(const DescriptorSet& set, std::string_view binding, const Info* pInfos, uint32_t count, uint32_t arrayElement) {
+    if(!set.getLayout()) return VK_ERROR_INITIALIZATION_FAILED;
+    return queue(set, set.getLayout()->getBinding(binding), pInfos, count, arrayElement);
+}
+
+Result DescriptorWriteBatch::writeBuffer(const DescriptorSet& set, uint32_t binding, VkBuffer buffer,
+                                         VkDeviceSize offset, VkDeviceSize range, uint32_t arrayElement)
+{
+    const VkDescriptorBufferInfo info = { buffer, offset, range };
+    return queue(set, binding, &info, 1, arrayElement);
+}
+
+Result DescriptorWriteBatch::writeBuffer(const DescriptorSet& set, std::string_view binding, VkBuffer buffer,
+                                         VkDeviceSize offset, VkDeviceSize range, uint32_t arrayElement)
+{
+    const VkDescriptorBufferInfo info = { buffer, offset, range };
+    return queue(set, binding, &info, 1, arrayElement);
+}
+
+Result DescriptorWriteBatch::writeImage(const DescriptorSet& set, uint32_t binding, VkImageView imageView,
+                                        VkImageLayout imageLayout, VkSampler sampler, uint32_t arrayElement)
+{
+    const VkDescriptorImageInfo info = { sampler, imageView, imageLayout };
+    return queue(set, binding, &info, 1, arrayElement);
+}
+
+Result DescriptorWriteBatch::writeImage(const DescriptorSet& set, std::string_view binding, VkImageView imageView,
+                                        VkImageLayout imageLayout, VkSampler sampler, uint32_t arrayElement)
+{
+    const VkDescriptorImageInfo info = { sampler, imageView, imageLayout };
+    return queue(set, binding, &info, 1, arrayElement);
+}
+
+Result DescriptorWriteBatch::writeTexelBuffer(const DescriptorSet& set, uint32_t binding, VkBufferView view, uint32_t arrayElement) {
+    return queue(set, binding, &view, 1, arrayElement);
+}
+
+Result DescriptorWriteBatch::writeTexelBuffer(const DescriptorSet& set, std::string_view binding, VkBufferView view, uint32_t arrayElement) {
+    return queue(set, binding, &view, 1, arrayElement);
+}
+
+Result DescriptorWriteBatch::writeBuffers(const DescriptorSet& set, uint32_t binding, const VkDescriptorBufferInfo* pInfos,
+                                          uint32_t count, uint32_t arrayElement)
+{
+    return queue(set, binding, pInfos, count, arrayElement);
+}
+
+Result DescriptorWriteBatch::writeImages(const DescriptorSet& set, uint32_t binding, const VkDescriptorImageInfo* pInfos,
+                                         uint32_t count, uint32_t arrayElement)
+{
+    return queue(set, binding, pInfos, count, arrayElement);
+}
+
+Result DescriptorWriteBatch::copy(const DescriptorSet& srcSet, uint32_t srcBinding, const DescriptorSet& dstSet, uint32_t dstBinding,
+                                  uint32_t count, uint32_t srcArrayElement, uint32_t dstArrayElement)
+{
+    if(!srcSet.getLayout() || !dstSet.getLayout()) return VK_ERROR_INITIALIZATION_FAILED;
+    const DescriptorSetLayoutBinding* pSrc = srcSet.getLayout()->getBinding(srcBinding);
+    const DescriptorSetLayoutBinding* pDst = dstSet.getLayout()->getBinding(dstBinding);
+    if(!pSrc || !pDst || pSrc->getDescriptorType() != pDst->getDescriptorType() ||
+       srcArrayElement + count > pSrc->getDescriptorCount() || dstArrayElement + count > pDst->getDescriptorCount())
+    {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    if(!count) return VK_SUCCESS;
+
+    m_copies.push_back({
+        VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET,
+        nullptr,
+        srcSet.getHandle(),
+        srcBinding,
+        srcArrayElement,
+        dstSet.getHandle(),
+        dstBinding,
+        dstArrayElement,
+        count
+    });
+    return VK_SUCCESS;
+}
+
+Result DescriptorWriteBatch::copy(const DescriptorSet& srcSet, std::string_view srcBinding, const DescriptorSet& dstSet, std::string_view dstBinding,
+                                  uint32_t count, uint32_t srcArrayElement, uint32_t dstArrayElement)
+{
+    if(!srcSet.getLayout() || !dstSet.getLayout()) return VK_ERROR_INITIALIZATION_FAILED;
+    const DescriptorSetLayoutBinding* pSrc = srcSet.getLayout()->getBinding(srcBinding);
+    const DescriptorSetLayoutBinding* pDst = dstSet.getLayout()->getBinding(dstBinding);
+    if(!pSrc || !pDst) return VK_ERROR_INITIALIZATION_FAILED;
+    return copy(srcSet, pSrc->getBinding(), dstSet, pDst->getBinding(), count, srcArrayElement, dstArrayElement);
+}
+
+void DescriptorWriteBatch::flush(void) {
+    if(isEmpty()) return;
+
+    // the info arrays are done growing, safe to point into them now
+    m_writes.clear();
+    m_writes.reserve(m_pendingWrites.size());
+    for(const PendingWrite& pending : m_pendingWrites) {
+        VkWriteDescriptorSet write = pending.write;
+        if(detail::isDescriptorInfoFor<VkDescriptorBufferInfo>(write.descriptorType))
+            write.pBufferInfo = &m_bufferInfos[pending.infoIndex];
+        else if(detail::isDescriptorInfoFor<VkDescriptorImageInfo>(write.descriptorType))
+            write.pImageInfo = &m_imageInfos[pending.infoIndex];
+        else
+            write.pTexelBufferView = &m_texelBufferViews[pending.infoIndex];
+        m_writes.push_back(write);
+    }
+
+    vkUpdateDescriptorSets(m_pDevice->getHandle(),
+                           static_cast<uint32_t>(m_writes.size()), m_writes.data(),
+                           static_cast<uint32_t>(m_copies.size()), m_copies.data());
+    clear();
+}
+
+void DescriptorWriteBatch::clear(void) {
+    m_pendingWrites.clear();
+    m_copies.clear();
+    m_bufferInfos.clear();
+    m_imageInfos.clear();
+    m_texelBufferViews.clear();
+    m_writes.clear();
+}
+
+}
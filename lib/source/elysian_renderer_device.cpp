@@ -3,9 +3,85 @@
 #include <renderer/elysian_renderer.hpp>
 #include <renderer/elysian_renderer_debug_log.hpp>
 #include <renderer/elysian_renderer_command.hpp>
+#include <renderer/elysian_renderer_pipeline_cache.hpp>
 
 namespace elysian::renderer {
 
+namespace {
+
+// Shared by both pipeline types, their create infos agree on flags/basePipelineHandle/basePipelineIndex.
+template<typename Info, typename Create>
+Result createPipelineBatch(uint32_t count, const Info* pInfos, VkPipeline* pPipelines, Result* pResults, Create&& create) {
+    if(!count) return VK_SUCCESS;
+
+    // out of range isn't a derivative at all, pointing at itself is a cycle like any other
+    const auto getBase = [&](uint32_t i) -> int32_t {
+        const int32_t base = pInfos[i].basePipelineIndex;
+        return (base >= 0 && base < static_cast<int32_t>(count))? base : -1;
+    };
+
+    // the spec wants a parent ahead of its children, place each chain root first
+    enum : uint8_t { Unplaced, Visiting, Placed };
+    std::vector<uint8_t> state(count, Unplaced);
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> slots(count);     //caller's index -> index in the call
+    std::vector<uint32_t> chain;
+    order.reserve(count);
+
+    for(uint32_t i = 0; i < count; ++i) {
+        chain.clear();
+        for(int32_t p = static_cast<int32_t>(i); p >= 0 && state[p] == Unplaced; p = getBase(p)) {
+            state[p] = Visiting;
+            chain.push_back(p);
+            const int32_t base = getBase(p);
+            if(base >= 0 && state[base] == Visiting) {
+                // no order puts every parent first, so none of it gets created
+                for(uint32_t f = 0; f < count; ++f) {
+                    pPipelines[f] = VK_NULL_HANDLE;
+                    if(pResults) pResults[f] = VK_ERROR_INITIALIZATION_FAILED;
+                }
+                return VK_ERROR_INITIALIZATION_FAILED;
+            }
+        }
+        for(auto c = chain.rbegin(); c != chain.rend(); ++c) {
+            slots[*c] = static_cast<uint32_t>(order.size());
+            order.push_back(*c);
+            state[*c] = Placed;
+        }
+    }
+
+    std::vector<Info> infos(count);
+    for(uint32_t s = 0; s < count; ++s) {
+        const uint32_t i = order[s];
+        infos[s] = pInfos[i];
+        const int32_t base = getBase(i);
+        if(base >= 0) {
+            infos[s].flags |= VK_PIPELINE_CREATE_DERIVATIVE_BIT;
+            infos[s].basePipelineHandle = VK_NULL_HANDLE;
+            infos[s].basePipelineIndex = static_cast<int32_t>(slots[base]);
+        } else if(pInfos[i].basePipelineIndex >= 0) {
+            // out of range, a derivative of nothing is invalid unless there's a handle to go by
+            infos[s].basePipelineIndex = -1;
+            if(!infos[s].basePipelineHandle) infos[s].flags &= ~VK_PIPELINE_CREATE_DERIVATIVE_BIT;
+        }
+    }
+    for(uint32_t s = 0; s < count; ++s) {
+        if(infos[s].basePipelineIndex >= 0) infos[infos[s].basePipelineIndex].flags |= VK_PIPELINE_CREATE_ALLOW_DERIVATIVES_BIT;
+    }
+
+    std::vector<VkPipeline> pipelines(count, VK_NULL_HANDLE);
+    const Result result = create(count, infos.data(), pipelines.data());
+
+    // only the call's result comes back, the null handles tell which ones it applies to
+    for(uint32_t i = 0; i < count; ++i) {
+        pPipelines[i] = pipelines[slots[i]];
+        if(pResults) pResults[i] = pPipelines[i]? Result(VK_SUCCESS) : result;
+    }
+    return result;
+}
+
+}
+
 Device::Device(const char* pName, const PhysicalDevice* pDevice, std::shared_ptr<const DeviceCreateInfo> pCreateInfo, Renderer* pRenderer):
     HandleObject<VkDevice, VK_OBJECT_TYPE_DEVICE>(nullptr, VK_NULL_HANDLE, pName),
     m_pCreateInfo(std::move(pCreateInfo)),
@@ -51,8 +127,7 @@ Device::Device(const char* pName, const PhysicalDevice* pDevice, std::shared_ptr
     m_result = vkCreateDevice(
         m_pPhysicalDevice->getHandle(),
         &deviceCreateInfo,
-        nullptr,
-        //m_pRenderer.getAllocator(),
+        getAllocationCallbacks(),
         &device);
     setHandle(device);
 
@@ -69,7 +144,11 @@ Device::Device(const char* pName, const PhysicalDevice* pDevice, std::shared_ptr
 
 Device::~Device(void) {
     waitIdle();
-    vkDestroyDevice(getHandle(), nullptr);
+    vkDestroyDevice(getHandle(), getAllocationCallbacks());
+}
+
+const VkAllocationCallbacks* Device::getAllocationCallbacks(void) const {
+    return m_pRenderer? m_pRenderer->getAllocationCallbacks() : nullptr;
 }
 
 PFN_vkVoidFunction Device::getProcAddr(const char* pName) const {
@@ -107,8 +186,28 @@ void Device::log(DebugLog* pLog) const {
     }
 }
 
-CommandPool* Device::createCommandPool(const CommandPoolCreateInfo* pInfo) const {
-    return new CommandPool(this, pInfo);
+std::unique_ptr<CommandPool> Device::createCommandPool(const CommandPoolCreateInfo* pInfo) const {
+    return std::make_unique<CommandPool>(this, pInfo);
+}
+
+Result Device::createGraphicsPipelines(uint32_t count, const VkGraphicsPipelineCreateInfo* pInfos, VkPipeline* pPipelines,
+                                       Result* pResults, const PipelineCache* pPipelineCache) const
+{
+    const VkPipelineCache cache = pPipelineCache? pPipelineCache->getHandle() : VK_NULL_HANDLE;
+    return createPipelineBatch(count, pInfos, pPipelines, pResults,
+        [&](uint32_t callCount, const VkGraphicsPipelineCreateInfo* pCallInfos, VkPipeline* pCallPipelines) {
+            return vkCreateGraphicsPipelines(getHandle(), cache, callCount, pCallInfos, getAllocationCallbacks(), pCallPipelines);
+        });
+}
+
+Result Device::createComputePipelines(uint32_t count, const VkComputePipelineCreateInfo* pInfos, VkPipeline* pPipelines,
+                                      Result* pResults, const PipelineCache* pPipelineCache) const
+{
+    const VkPipelineCache cache = pPipelineCache? pPipelineCache->getHandle() : VK_NULL_HANDLE;
+    return createPipelineBatch(count, pInfos, pPipelines, pResults,
+        [&](uint32_t callCount, const VkComputePipelineCreateInfo* pCallInfos, VkPipeline* pCallPipelines) {
+            return vkCreateComputePipelines(getHandle(), cache, callCount, pCallInfos, getAllocationCallbacks(), pCallPipelines);
+        });
 }
 
 }
@@ -0,0 +1,295 @@
+#include <renderer/elysian_renderer_draw_queue.hpp>
+#include <renderer/elysian_renderer_command.hpp>
+#include <renderer/elysian_renderer_command_stream.hpp>
+#include <renderer/elysian_renderer_debug_log.hpp>
+#include <renderer/elysian_renderer_hash.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <numeric>
+
+namespace elysian::renderer {
+
+void DrawQueue::clear(void) {
+    m_entries.clear();
+    m_pushData.clear();
+    m_keys.clear();
+    m_order.clear();
+    m_pipelineIds.clear();
+    m_descriptorIds.clear();
+    m_geometryIds.clear();
+    m_sorted = true;
+}
+
+void DrawQueue::reserve(uint32_t packetCount) {
+    m_entries.reserve(packetCount);
+    m_keys.reserve(packetCount);
+    m_order.reserve(packetCount);
+}
+
+uint16_t DrawQueue::getId(std::unordered_map<uint64_t, uint16_t>& ids, uint64_t hash) {
+    // value is evaluated before the insert, so ids count up from 0 and wrap past 64k
+    return ids.try_emplace(hash, static_cast<uint16_t>(ids.size())).first->second;
+}
+
+void DrawQueue::submit(const DrawPacket& packet) {
+    assert(packet.pipeline != VK_NULL_HANDLE);
+    assert(packet.descriptorSetCount <= kMaxDescriptorSets);
+    assert(packet.vertexBufferCount <= kMaxVertexBuffers);
+    assert(packet.pushConstantSize <= kMaxPushConstantSize);
+    assert(!packet.pushConstantSize || packet.pPushConstants);
+
+    Entry entry;
+    entry.packet = packet;
+    entry.packet.pPushConstants = nullptr;
+    entry.pushOffset = static_cast<uint32_t>(m_pushData.size());
+    const auto* pPush = static_cast<const uint8_t*>(packet.pPushConstants);
+    m_pushData.insert(m_pushData.end(), pPush, pPush + packet.pushConstantSize);
+
+    const uint64_t pipelineHash = hashValue(packet.pipeline);
+    const uint64_t descriptorHash = hashArray(packet.descriptorSets, packet.descriptorSetCount, hashValue(packet.layout));
+    uint64_t geometryHash = hashArray(packet.vertexBuffers, packet.vertexBufferCount);
+    geometryHash = hashArray(packet.vertexOffsets, packet.vertexBufferCount, geometryHash);
+    geometryHash = hashValue(packet.indexBuffer, geometryHash);
+    if(packet.indexBuffer != VK_NULL_HANDLE) {
+        geometryHash = hashValue(packet.indexOffset, geometryHash);
+        geometryHash = hashValue(packet.indexType, geometryHash);
+    }
+
+    uint64_t stateHash = hashCombine(pipelineHash, descriptorHash);
+    stateHash = hashCombine(stateHash, geometryHash);
+    stateHash = hashValue(packet.pushConstantStages, stateHash);
+    entry.stateHash = hashArray(pPush, packet.pushConstantSize, stateHash);
+
+    const uint64_t key = (uint64_t(packet.layer)                              << 56) |
+                         (uint64_t(getId(m_pipelineIds, pipelineHash))        << 40) |
+                         (uint64_t(getId(m_descriptorIds, descriptorHash))    << 24) |
+                         (uint64_t(getId(m_geometryIds, geometryHash))        << 8)  |
+                          uint64_t(packet.sortBits);
+
+    m_entries.push_back(entry);
+    m_keys.push_back(key);
+    m_sorted = false;
+}
+
+void DrawQueue::sort(void) {
+    if(m_sorted) return;
+    const uint32_t count = getPacketCount();
+
+    // LSD radix sort on 8 bit digits, stable so equal keys keep submission order.
+    // Digits every key agrees on are skipped, with few distinct ids most of them are.
+    for(uint32_t b = 0; b < 2; ++b) {
+        m_sortKeys[b].resize(count);
+        m_sortOrder[b].resize(count);
+    }
+    std::copy(m_keys.begin(), m_keys.end(), m_sortKeys[0].begin());
+    std::iota(m_sortOrder[0].begin(), m_sortOrder[0].end(), 0u);
+
+    uint32_t src = 0;
+    for(uint32_t shift = 0; shift < 64; shift += 8) {
+        uint32_t histogram[256] = {};
+        for(uint64_t key : m_sortKeys[src]) ++histogram[(key >> shift) & 0xff];
+        if(histogram[(m_sortKeys[src][0] >> shift) & 0xff] == count) continue;
+
+        uint32_t offset = 0;
+        for(uint32_t& bucket : histogram) {
+            const uint32_t size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+
+        const uint32_t dst = src ^ 1;
+        for(uint32_t i = 0; i < count; ++i) {
+            const uint64_t key = m_sortKeys[src][i];
+            const uint32_t slot = histogram[(key >> shift) & 0xff]++;
+            m_sortKeys[dst][slot] = key;
+            m_sortOrder[dst][slot] = m_sortOrder[src][i];
+        }
+        src = dst;
+    }
+
+    m_order.assign(m_sortOrder[src].begin(), m_sortOrder[src].end());
+    m_sorted = true;
+}
+
+bool DrawQueue::isSameState(const Entry& lhs, const Entry& rhs) const {
+    const DrawPacket& l = lhs.packet;
+    const DrawPacket& r = rhs.packet;
+
+    if(l.pipeline != r.pipeline || l.layout != r.layout ||
+       l.descriptorSetCount != r.descriptorSetCount ||
+       l.vertexBufferCount != r.vertexBufferCount ||
+       l.indexBuffer != r.indexBuffer ||
+       l.pushConstantStages != r.pushConstantStages ||
+       l.pushConstantSize != r.pushConstantSize)
+    {
+        return false;
+    }
+    if(l.indexBuffer != VK_NULL_HANDLE && (l.indexOffset != r.indexOffset || l.indexType != r.indexType))
+        return false;
+
+    return std::equal(l.descriptorSets, l.descriptorSets + l.descriptorSetCount, r.descriptorSets) &&
+           std::equal(l.vertexBuffers, l.vertexBuffers + l.vertexBufferCount, r.vertexBuffers) &&
+           std::equal(l.vertexOffsets, l.vertexOffsets + l.vertexBufferCount, r.vertexOffsets) &&
+           (!l.pushConstantSize || !memcmp(m_pushData.data() + lhs.pushOffset, m_pushData.data() + rhs.pushOffset, l.pushConstantSize));
+}
+
+template<typename Recorder>
+void DrawQueue::emitTo(Recorder* pRecorder, IndirectTarget* pIndirect) {
+    sort();
+    m_statistics = {};
+    m_statistics.packetCount = getPacketCount();
+
+    const uint32_t count = getPacketCount();
+    const Entry* pBound = nullptr;
+
+    for(uint32_t i = 0; i < count; ) {
+        const Entry& entry = m_entries[m_order[i]];
+        const DrawPacket& packet = entry.packet;
+        const DrawPacket* pPrev = pBound? &pBound->packet : nullptr;
+
+        // only bind what differs from the last run
+        if(!pPrev || pPrev->pipeline != packet.pipeline) {
+            pRecorder->cmdBindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, packet.pipeline);
+            ++m_statistics.pipelineBindCount;
+        }
+
+        if(packet.descriptorSetCount) {
+            uint32_t first = 0;
+            if(pPrev && pPrev->layout == packet.layout) {
+                const uint32_t common = std::min(packet.descriptorSetCount, pPrev->descriptorSetCount);
+                while(first < common && pPrev->descriptorSets[first] == packet.descriptorSets[first]) ++first;
+            }
+            if(first < packet.descriptorSetCount) {
+                pRecorder->cmdBindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, packet.layout, first,
+                                                 packet.descriptorSetCount - first, packet.descriptorSets + first,
+                                                 0, nullptr);
+                ++m_statistics.descriptorBindCount;
+            }
+        }
+
+        if(packet.vertexBufferCount) {
+            uint32_t first = 0;
+            if(pPrev) {
+                const uint32_t common = std::min(packet.vertexBufferCount, pPrev->vertexBufferCount);
+                while(first < common &&
+                      pPrev->vertexBuffers[first] == packet.vertexBuffers[first] &&
+                      pPrev->vertexOffsets[first] == packet.vertexOffsets[first]) ++first;
+            }
+            if(first < packet.vertexBufferCount) {
+                pRecorder->cmdBindVertexBuffers(first, packet.vertexBufferCount - first,
+                                                packet.vertexBuffers + first, packet.vertexOffsets + first);
+                ++m_statistics.geometryBindCount;
+            }
+        }
+
+        const bool indexed = packet.indexBuffer != VK_NULL_HANDLE;
+        if(indexed && (!pPrev ||
+                       pPrev->indexBuffer != packet.indexBuffer ||
+                       pPrev->indexOffset != packet.indexOffset ||
+                       pPrev->indexType != packet.indexType))
+        {
+            pRecorder->cmdBindIndexBuffer(packet.indexBuffer, packet.indexOffset, packet.indexType);
+            ++m_statistics.geometryBindCount;
+        }
+
+        if(packet.pushConstantSize && (!pPrev ||
+                                       pPrev->layout != packet.layout ||
+                                       pPrev->pushConstantStages != packet.pushConstantStages ||
+                                       pPrev->pushConstantSize != packet.pushConstantSize ||
+                                       memcmp(m_pushData.data() + pBound->pushOffset, m_pushData.data() + entry.pushOffset, packet.pushConstantSize)))
+        {
+            pRecorder->cmdPushConstants(packet.layout, packet.pushConstantStages, 0,
+                                        packet.pushConstantSize, &m_pushData[entry.pushOffset]);
+        }
+        pBound = &entry;
+
+        // gather the run sharing all of that state, folding adjacent instance ranges together
+        m_run.clear();
+        uint32_t next = i;
+        for(; next < count; ++next) {
+            const Entry& other = m_entries[m_order[next]];
+            if(next != i && (other.stateHash != entry.stateHash || !isSameState(entry, other))) break;
+
+            if(!m_run.empty()) {
+                Draw& last = m_run.back();
+                const DrawPacket& lastPacket = m_entries[last.entry].packet;
+                if(lastPacket.count == other.packet.count &&
+                   lastPacket.first == other.packet.first &&
+                   lastPacket.vertexOffset == other.packet.vertexOffset &&
+                   lastPacket.firstInstance + last.instanceCount == other.packet.firstInstance)
+                {
+                    last.instanceCount += other.packet.instanceCount;
+                    ++m_statistics.instancedMergeCount;
+                    continue;
+                }
+            }
+            m_run.push_back({ m_order[next], other.packet.instanceCount });
+        }
+        i = next;
+
+        // whatever is left goes out indirect in as few calls as the target allows
+        uint32_t d = 0;
+        if(pIndirect && pIndirect->pMapped && pIndirect->maxDrawCount > 1) {
+            const uint32_t stride = indexed? sizeof(VkDrawIndexedIndirectCommand) : sizeof(VkDrawIndirectCommand);
+            for(;;) {
+                const VkDeviceSize room = (pIndirect->size - std::min(pIndirect->used, pIndirect->size)) / stride;
+                const uint32_t batch = static_cast<uint32_t>(std::min<VkDeviceSize>({ m_run.size() - d, pIndirect->maxDrawCount, room }));
+                if(batch < 2) break;
+
+                auto* pDst = static_cast<uint8_t*>(pIndirect->pMapped) + pIndirect->used;
+                for(uint32_t b = 0; b < batch; ++b, pDst += stride) {
+                    const Draw& draw = m_run[d + b];
+                    const DrawPacket& args = m_entries[draw.entry].packet;
+                    if(indexed) {
+                        const auto command = VkDrawIndexedIndirectCommand { args.count, draw.instanceCount, args.first, args.vertexOffset, args.firstInstance };
+                        memcpy(pDst, &command, sizeof(command));
+                    } else {
+                        const auto command = VkDrawIndirectCommand { args.count, draw.instanceCount, args.first, args.firstInstance };
+                        memcpy(pDst, &command, sizeof(command));
+                    }
+                }
+
+                const VkDeviceSize offset = pIndirect->offset + pIndirect->used;
+                if(indexed) pRecorder->cmdDrawIndexedIndirect(pIndirect->buffer, offset, batch, stride);
+                else pRecorder->cmdDrawIndirect(pIndirect->buffer, offset, batch, stride);
+
+                pIndirect->used += VkDeviceSize(batch) * stride;
+                m_statistics.indirectBytes += VkDeviceSize(batch) * stride;
+                ++m_statistics.indirectCallCount;
+                ++m_statistics.drawCallCount;
+                d += batch;
+            }
+        }
+
+        for(; d < m_run.size(); ++d) {
+            const Draw& draw = m_run[d];
+            const DrawPacket& args = m_entries[draw.entry].packet;
+            if(indexed) pRecorder->cmdDrawIndexed(args.count, draw.instanceCount, args.first, args.vertexOffset, args.firstInstance);
+            else pRecorder->cmdDraw(args.count, draw.instanceCount, args.first, args.firstInstance);
+            ++m_statistics.drawCallCount;
+        }
+    }
+}
+
+void DrawQueue::emit(CommandBuffer* pCmdBuffer, IndirectTarget* pIndirect) {
+    emitTo(pCmdBuffer, pIndirect);
+}
+
+void DrawQueue::emit(CommandStream* pStream, IndirectTarget* pIndirect) {
+    emitTo(pStream, pIndirect);
+}
+
+void DrawQueue::log(DebugLog* pLog) const {
+    pLog->verbose("Draw Queue: %u packets -> %u draw calls", m_statistics.packetCount, m_statistics.drawCallCount);
+    pLog->push();
+    pLog->verbose("%-24s %u", "Indirect calls:", m_statistics.indirectCallCount);
+    pLog->verbose("%-24s %u", "Instanced merges:", m_statistics.instancedMergeCount);
+    pLog->verbose("%-24s %u", "Pipeline binds:", m_statistics.pipelineBindCount);
+    pLog->verbose("%-24s %u", "Descriptor set binds:", m_statistics.descriptorBindCount);
+    pLog->verbose("%-24s %u", "Geometry binds:", m_statistics.geometryBindCount);
+    pLog->verbose("%-24s %llu", "Indirect bytes:", static_cast<unsigned long long>(m_statistics.indirectBytes));
+    pLog->pop();
+}
+
+}
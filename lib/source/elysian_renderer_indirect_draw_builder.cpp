@@ -0,0 +1,261 @@
+#include <renderer/elysian_renderer_indirect_draw_builder.hpp>
+#include <renderer/elysian_renderer_physical_device.hpp>
+#include <renderer/elysian_renderer_command.hpp>
+#include <renderer/elysian_renderer_semaphore.hpp>
+#include <renderer/elysian_renderer_draw_queue.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace elysian::renderer {
+
+namespace {
+
+constexpr uint32_t kCommandStride = sizeof(VkDrawIndexedIndirectCommand);
+
+inline VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+}
+
+IndirectDrawBuilder::IndirectDrawBuilder(Initializer initializer):
+    m_initializer(std::move(initializer))
+{
+    assert(m_initializer.pDevice && m_initializer.frameCount);
+    const PhysicalDevice& physicalDevice = m_initializer.pDevice->getPhysicalDevice();
+    const VkPhysicalDeviceLimits& limits = physicalDevice.getProperties().limits;
+
+    m_storageAlignment = std::max<VkDeviceSize>(limits.minStorageBufferOffsetAlignment, 4);
+    m_atomSize = std::max<VkDeviceSize>(limits.nonCoherentAtomSize, 1);
+    m_drawIndirectCountLimit = std::max(limits.maxDrawIndirectCount, 1u);
+    m_maxDrawCount = m_initializer.multiDrawIndirect? m_drawIndirectCountLimit : 1;
+    // keep every region flushable and bindable as a storage buffer on its own
+    m_initializer.frameSize = alignUp(m_initializer.frameSize, std::max(m_storageAlignment, m_atomSize));
+    m_frames.resize(m_initializer.frameCount);
+    m_frameIndex = m_initializer.frameCount - 1;
+
+    m_pBuffer = std::make_unique<Buffer>(Buffer::Initializer{
+        m_initializer.name,
+        m_initializer.pDevice,
+        BufferCreateInfo(0, m_initializer.frameSize * m_initializer.frameCount,
+                         VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+    });
+    m_result = m_pBuffer->getResult();
+    if(!m_result) return;
+
+    // Host visible so the CPU path needs no copies. Culled batches get written by the GPU
+    // through the same memory, which is what lavapipe and integrated parts have anyway.
+    const VkMemoryRequirements requirements = m_pBuffer->getMemoryRequirements();
+    const VkPhysicalDeviceMemoryProperties& memProperties = physicalDevice.getMemoryProperties();
+    uint32_t memoryTypeIndex = ~0u;
+    for(VkMemoryPropertyFlags flags : { VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                        static_cast<VkMemoryPropertyFlags>(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) })
+    {
+        for(uint32_t t = 0; t < memProperties.memoryTypeCount && memoryTypeIndex == ~0u; ++t) {
+            if((requirements.memoryTypeBits & (1u << t)) &&
+               (memProperties.memoryTypes[t].propertyFlags & flags) == flags)
+            {
+                memoryTypeIndex = t;
+                m_coherent = memProperties.memoryTypes[t].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+            }
+        }
+    }
+
+    if(memoryTypeIndex == ~0u) {
+        m_result = VK_ERROR_FEATURE_NOT_PRESENT;
+        return;
+    }
+
+    m_pMemory = std::make_shared<DeviceMemory>(DeviceMemory::Initializer{
+        DeviceMemoryAllocateInfo(requirements.size, memoryTypeIndex),
+        m_initializer.pDevice
+    });
+    m_result = m_pMemory->getResult();
+    if(!m_result) return;
+
+    m_result = m_pBuffer->bindDeviceMemory(m_pMemory);
+    if(!m_result) return;
+
+    void* pData = nullptr;
+    m_result = m_pMemory->mapMemory(0, VK_WHOLE_SIZE, 0, &pData);
+    m_pMappedData = static_cast<char*>(pData);
+}
+
+IndirectDrawBuilder::~IndirectDrawBuilder(void) {
+    for(const auto& frame : m_frames) {
+        if(frame.pFence) frame.pFence->wait();
+    }
+    if(m_pMappedData) m_pMemory->unmapMemory();
+    m_pBuffer.reset();
+}
+
+Result IndirectDrawBuilder::beginFrame(uint64_t timeout) {
+    const uint32_t nextIndex = (m_frameIndex + 1) % m_initializer.frameCount;
+    Frame& frame = m_frames[nextIndex];
+
+    if(frame.pFence) {
+        const Result result = frame.pFence->wait(timeout);
+        if(!result) return result;
+        frame.pFence = nullptr;
+    }
+
+    frame.usedSize = 0;
+    m_frameIndex = nextIndex;
+    m_statistics = {};
+    return VK_SUCCESS;
+}
+
+Result IndirectDrawBuilder::flush(void) {
+    const Frame& frame = m_frames[m_frameIndex];
+    if(!m_coherent && frame.usedSize) {
+        const VkDeviceSize base = m_frameIndex * m_initializer.frameSize;
+        return m_pMemory->flush(base, std::min(alignUp(frame.usedSize, m_atomSize), m_initializer.frameSize));
+    }
+    return VK_SUCCESS;
+}
+
+void IndirectDrawBuilder::endFrame(const Fence* pFence) {
+    m_frames[m_frameIndex].pFence = pFence;
+}
+
+VkDeviceSize IndirectDrawBuilder::reserve(VkDeviceSize size, VkDeviceSize alignment) {
+    assert(isValid());
+    Frame& frame = m_frames[m_frameIndex];
+    const VkDeviceSize offset = alignUp(frame.usedSize, alignment);
+    if(offset + size > m_initializer.frameSize) return ~VkDeviceSize(0);
+
+    frame.usedSize = offset + size;
+    m_statistics.usedSize = frame.usedSize;
+    return m_frameIndex * m_initializer.frameSize + offset;
+}
+
+IndirectDrawBuilder::Batch IndirectDrawBuilder::allocate(uint32_t drawCount) {
+    const VkDeviceSize offset = reserve(VkDeviceSize(drawCount) * kCommandStride, 4);
+    if(offset == ~VkDeviceSize(0)) return {};
+
+    ++m_statistics.batchCount;
+    m_statistics.commandCount += drawCount;
+
+    Batch batch;
+    batch.pCommands = reinterpret_cast<VkDrawIndexedIndirectCommand*>(m_pMappedData + offset);
+    batch.buffer = m_pBuffer->getHandle();
+    batch.offset = offset;
+    batch.drawCount = drawCount;
+    return batch;
+}
+
+IndirectDrawBuilder::Batch IndirectDrawBuilder::add(const VkDrawIndexedIndirectCommand* pCommands, uint32_t drawCount) {
+    const Batch batch = allocate(drawCount);
+    if(batch.isValid()) std::memcpy(batch.pCommands, pCommands, size_t(drawCount) * kCommandStride);
+    return batch;
+}
+
+IndirectDrawBuilder::Batch IndirectDrawBuilder::allocateCulled(uint32_t maxDrawCount) {
+    // count first, then the commands, both at storage buffer alignment so each can be bound
+    const VkDeviceSize countSize = alignUp(sizeof(uint32_t), m_storageAlignment);
+    const VkDeviceSize offset = reserve(countSize + VkDeviceSize(maxDrawCount) * kCommandStride, m_storageAlignment);
+    if(offset == ~VkDeviceSize(0)) return {};
+
+    ++m_statistics.batchCount;
+    m_statistics.commandCount += maxDrawCount;
+
+    // host writes are visible to the GPU at submission, no transfer needed
+    std::memset(m_pMappedData + offset, 0, countSize + size_t(maxDrawCount) * kCommandStride);
+
+    Batch batch;
+    batch.pCommands = reinterpret_cast<VkDrawIndexedIndirectCommand*>(m_pMappedData + offset + countSize);
+    batch.buffer = m_pBuffer->getHandle();
+    batch.offset = offset + countSize;
+    batch.countOffset = offset;
+    batch.drawCount = maxDrawCount;
+    batch.culled = true;
+    return batch;
+}
+
+VkDescriptorBufferInfo IndirectDrawBuilder::getCommandBufferInfo(const Batch& batch) const {
+    return { batch.buffer, batch.offset, VkDeviceSize(batch.drawCount) * kCommandStride };
+}
+
+VkDescriptorBufferInfo IndirectDrawBuilder::getCountBufferInfo(const Batch& batch) const {
+    assert(batch.culled);
+    return { batch.buffer, batch.countOffset, sizeof(uint32_t) };
+}
+
+void IndirectDrawBuilder::cmdCull(CommandBuffer* pCmdBuffer, const Batch& batch, const CullDispatch& dispatch, bool barrier) const {
+    assert(batch.culled && dispatch.pipeline != VK_NULL_HANDLE);
+    pCmdBuffer->cmdBindPipeline(VK_PIPELINE_BIND_POINT_COMPUTE, dispatch.pipeline);
+    if(dispatch.descriptorSetCount) {
+        pCmdBuffer->cmdBindDescriptorSets(VK_PIPELINE_BIND_POINT_COMPUTE, dispatch.layout,
+                                          dispatch.firstSet, dispatch.descriptorSetCount, dispatch.pDescriptorSets,
+                                          0, nullptr);
+    }
+    if(dispatch.pushConstantSize) {
+        pCmdBuffer->cmdPushConstants(dispatch.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                                     dispatch.pushConstantSize, dispatch.pPushConstants);
+    }
+    pCmdBuffer->cmdDispatch(dispatch.groupCountX, dispatch.groupCountY, dispatch.groupCountZ);
+
+    if(barrier) cmdCullBarrier(pCmdBuffer);
+}
+
+void IndirectDrawBuilder::cmdCullBarrier(CommandBuffer* pCmdBuffer) const {
+    const auto barrier = VkMemoryBarrier {
+        VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        nullptr,
+        VK_ACCESS_SHADER_WRITE_BIT,
+        VK_ACCESS_INDIRECT_COMMAND_READ_BIT
+    };
+    pCmdBuffer->cmdPipelineBarrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                   VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                                   0,
+                                   1, &barrier,
+                                   0, nullptr,
+                                   0, nullptr);
+}
+
+void IndirectDrawBuilder::cmdDraw(CommandBuffer* pCmdBuffer, const Batch& batch) {
+    assert(batch.isValid());
+    if(batch.culled && m_initializer.drawIndirectCount) {
+        assert(batch.drawCount <= m_drawIndirectCountLimit);
+        pCmdBuffer->cmdDrawIndexedIndirectCount(batch.buffer, batch.offset,
+                                                batch.buffer, batch.countOffset,
+                                                batch.drawCount, kCommandStride);
+        ++m_statistics.indirectCallCount;
+        return;
+    }
+
+    for(uint32_t first = 0; first < batch.drawCount; first += m_maxDrawCount) {
+        const uint32_t drawCount = std::min(m_maxDrawCount, batch.drawCount - first);
+        pCmdBuffer->cmdDrawIndexedIndirect(batch.buffer, batch.offset + VkDeviceSize(first) * kCommandStride,
+                                           drawCount, kCommandStride);
+        ++m_statistics.indirectCallCount;
+    }
+}
+
+void IndirectDrawBuilder::emit(DrawQueue* pQueue, CommandBuffer* pCmdBuffer) {
+    assert(isValid());
+    Frame& frame = m_frames[m_frameIndex];
+    const VkDeviceSize offset = m_frameIndex * m_initializer.frameSize;
+
+    // the whole frame as target, appending behind whatever add() or earlier emits wrote
+    DrawQueue::IndirectTarget target;
+    target.buffer = m_pBuffer->getHandle();
+    target.offset = offset;
+    target.pMapped = m_pMappedData + offset;
+    target.size = m_initializer.frameSize;
+    target.used = std::min(alignUp(frame.usedSize, 4), m_initializer.frameSize);
+    target.maxDrawCount = m_maxDrawCount;
+
+    pQueue->emit(pCmdBuffer, &target);
+
+    const DrawQueue::Statistics& queueStatistics = pQueue->getStatistics();
+    if(queueStatistics.indirectBytes) {
+        frame.usedSize = target.used;
+        m_statistics.usedSize = frame.usedSize;
+    }
+    m_statistics.batchCount += queueStatistics.indirectCallCount;
+    m_statistics.indirectCallCount += queueStatistics.indirectCallCount;
+}
+
+}
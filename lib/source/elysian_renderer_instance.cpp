@@ -27,7 +27,7 @@ Instance::Instance(InstanceInitializer initializer, Renderer* pRenderer):
     pRenderer->getLog()->verbose("Creating Instance");
     pRenderer->getLog()->push();
     VkInstance instance;
-    m_result = vkCreateInstance(&initializer.info, nullptr, &instance);
+    m_result = vkCreateInstance(&initializer.info, pRenderer->getAllocationCallbacks(), &instance);
     setHandle(instance);
     //setObjectName("INSTANCEY");
 
@@ -49,6 +49,10 @@ PFN_vkVoidFunction Instance::getProcAddr(const char* pName) const {
     return vkGetInstanceProcAddr(getHandle(), pName);
 }
 
+const VkAllocationCallbacks* Instance::getAllocationCallbacks(void) const {
+    return m_pRenderer->getAllocationCallbacks();
+}
+
 void Instance::insertRequiredExtensions(InstanceInitializer &initializer) const {
     auto checkInsertExtension = [&](bool conditional, const char* pExtension) {
         if(conditional) {
@@ -81,7 +85,7 @@ const DebugUtilsMessengerEXT* Instance::getDebugUtilsMessengerEXT(void) const {
 Instance::~Instance(void) {
     m_dbgMessengerEXT.reset(nullptr);
     m_pRenderer->getLog()->verbose("Destroying Instance");
-    vkDestroyInstance(getHandle(), nullptr);
+    vkDestroyInstance(getHandle(), getAllocationCallbacks());
 }
 
 bool Instance::isValid(void) const {
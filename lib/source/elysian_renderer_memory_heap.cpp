@@ -0,0 +1,601 @@
+#include <renderer/elysian_renderer_memory_heap.hpp>
+#include <renderer/elysian_renderer_device.hpp>
+#include <renderer/elysian_renderer_physical_device.hpp>
+#include <renderer/elysian_renderer_debug_log.hpp>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace elysian::renderer {
+
+namespace {
+
+inline uint32_t bitScanReverse(uint64_t value) {
+    assert(value);
+    return 63u - static_cast<uint32_t>(__builtin_clzll(value));
+}
+
+inline uint32_t bitScanForward(uint64_t value) {
+    assert(value);
+    return static_cast<uint32_t>(__builtin_ctzll(value));
+}
+
+inline VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+}
+
+//======= TLSF ==========
+
+TlsfSubAllocator::TlsfSubAllocator(VkDeviceSize size):
+    m_size(size & ~(kGranularity - 1))
+{
+    for(uint32_t f = 0; f < kFlCount; ++f) {
+        for(uint32_t s = 0; s < kSlCount; ++s) {
+            m_freeHeads[f][s] = kNil;
+        }
+    }
+
+    const uint32_t index = newRange();
+    m_ranges[index].offset = 0;
+    m_ranges[index].size = m_size;
+    insertFree(index);
+}
+
+void TlsfSubAllocator::mapping(VkDeviceSize size, uint32_t* pFl, uint32_t* pSl) {
+    if(size < kSlCount) {
+        *pFl = 0;
+        *pSl = static_cast<uint32_t>(size);
+    } else {
+        const uint32_t msb = bitScanReverse(size);
+        *pFl = msb - kSlLog2 + 1;
+        *pSl = static_cast<uint32_t>(size >> (msb - kSlLog2)) - kSlCount;
+    }
+}
+
+uint32_t TlsfSubAllocator::findFree(VkDeviceSize size) const {
+    // round up to the next list boundary so anything in the list we land on is big enough
+    if(size >= kSlCount) {
+        size += (VkDeviceSize(1) << (bitScanReverse(size) - kSlLog2)) - 1;
+    }
+
+    uint32_t fl, sl;
+    mapping(size, &fl, &sl);
+    if(fl >= kFlCount) return kNil;
+
+    uint32_t slMap = m_slBitmaps[fl] & (~0u << sl);
+    if(!slMap) {
+        const uint64_t flMap = (fl + 1 < 64)? m_flBitmap & (~uint64_t(0) << (fl + 1)) : 0;
+        if(!flMap) return kNil;
+        fl = bitScanForward(flMap);
+        slMap = m_slBitmaps[fl];
+    }
+
+    sl = bitScanForward(slMap);
+    return m_freeHeads[fl][sl];
+}
+
+uint32_t TlsfSubAllocator::newRange(void) {
+    uint32_t index;
+    if(m_unusedRanges.size()) {
+        index = m_unusedRanges.back();
+        m_unusedRanges.pop_back();
+        m_ranges[index] = Range{};
+    } else {
+        index = static_cast<uint32_t>(m_ranges.size());
+        m_ranges.emplace_back();
+    }
+    return index;
+}
+
+void TlsfSubAllocator::releaseRange(uint32_t index) {
+    m_unusedRanges.push_back(index);
+}
+
+void TlsfSubAllocator::insertFree(uint32_t index) {
+    uint32_t fl, sl;
+    Range& range = m_ranges[index];
+    mapping(range.size, &fl, &sl);
+
+    const uint32_t head = m_freeHeads[fl][sl];
+    range.prevFree = kNil;
+    range.nextFree = head;
+    range.isFree = true;
+    if(head != kNil) m_ranges[head].prevFree = index;
+    m_freeHeads[fl][sl] = index;
+
+    m_slBitmaps[fl] |= 1u << sl;
+    m_flBitmap |= uint64_t(1) << fl;
+    ++m_freeRangeCount;
+}
+
+void TlsfSubAllocator::removeFree(uint32_t index) {
+    uint32_t fl, sl;
+    Range& range = m_ranges[index];
+    mapping(range.size, &fl, &sl);
+
+    if(range.prevFree != kNil) m_ranges[range.prevFree].nextFree = range.nextFree;
+    if(range.nextFree != kNil) m_ranges[range.nextFree].prevFree = range.prevFree;
+
+    if(m_freeHeads[fl][sl] == index) {
+        m_freeHeads[fl][sl] = range.nextFree;
+        if(range.nextFree == kNil) {
+            m_slBitmaps[fl] &= ~(1u << sl);
+            if(!m_slBitmaps[fl]) m_flBitmap &= ~(uint64_t(1) << fl);
+        }
+    }
+
+    range.prevFree = range.nextFree = kNil;
+    range.isFree = false;
+    --m_freeRangeCount;
+}
+
+// Splits off everything past size into a new physical neighbor, returns its index.
+uint32_t TlsfSubAllocator::split(uint32_t index, VkDeviceSize size) {
+    const uint32_t remainder = newRange();
+    Range& range = m_ranges[index];
+    Range& rest = m_ranges[remainder];
+
+    rest.offset = range.offset + size;
+    rest.size = range.size - size;
+    rest.prevPhys = index;
+    rest.nextPhys = range.nextPhys;
+    if(rest.nextPhys != kNil) m_ranges[rest.nextPhys].prevPhys = remainder;
+
+    range.size = size;
+    range.nextPhys = remainder;
+    return remainder;
+}
+
+void TlsfSubAllocator::merge(uint32_t index, uint32_t next) {
+    Range& range = m_ranges[index];
+    const Range& absorbed = m_ranges[next];
+    assert(range.nextPhys == next);
+
+    range.size += absorbed.size;
+    range.nextPhys = absorbed.nextPhys;
+    if(range.nextPhys != kNil) m_ranges[range.nextPhys].prevPhys = index;
+    releaseRange(next);
+}
+
+VkDeviceSize TlsfSubAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+    assert(!alignment || !(alignment & (alignment - 1)));
+    size = alignUp(std::max<VkDeviceSize>(size, 1), kGranularity);
+    alignment = std::max(alignment, kGranularity);
+
+    const VkDeviceSize searchSize = size + alignment - kGranularity;
+    uint32_t index = findFree(searchSize);
+    if(index == kNil) {
+        // An empty range is one free range at offset 0, which is aligned to anything, so it
+        // can still take an exact fit that the padded, rounded-up search above skips over.
+        if(!m_allocations.empty() || size > m_size) return kInvalidOffset;
+        uint32_t fl, sl;
+        mapping(m_size, &fl, &sl);
+        index = m_freeHeads[fl][sl];
+        assert(index != kNil && !m_ranges[index].offset);
+    }
+
+    removeFree(index);
+
+    const VkDeviceSize padding = alignUp(m_ranges[index].offset, alignment) - m_ranges[index].offset;
+    if(padding) {
+        // front padding stays behind as its own free range
+        const uint32_t aligned = split(index, padding);
+        insertFree(index);
+        index = aligned;
+    }
+
+    if(m_ranges[index].size - size >= kGranularity) {
+        insertFree(split(index, size));
+    }
+
+    m_usedSize += m_ranges[index].size;
+    m_allocations.emplace(m_ranges[index].offset, index);
+    return m_ranges[index].offset;
+}
+
+void TlsfSubAllocator::free(VkDeviceSize offset) {
+    const auto it = m_allocations.find(offset);
+    assert(it != m_allocations.end());
+    if(it == m_allocations.end()) return;
+
+    uint32_t index = it->second;
+    m_allocations.erase(it);
+    m_usedSize -= m_ranges[index].size;
+
+    const uint32_t prev = m_ranges[index].prevPhys;
+    if(prev != kNil && m_ranges[prev].isFree) {
+        removeFree(prev);
+        merge(prev, index);
+        index = prev;
+    }
+
+    const uint32_t next = m_ranges[index].nextPhys;
+    if(next != kNil && m_ranges[next].isFree) {
+        removeFree(next);
+        merge(index, next);
+    }
+
+    insertFree(index);
+}
+
+DeviceMemorySubAllocator::Statistics TlsfSubAllocator::getStatistics(void) const {
+    Statistics stats;
+    stats.size = m_size;
+    stats.usedSize = m_usedSize;
+    stats.allocationCount = static_cast<uint32_t>(m_allocations.size());
+    stats.freeRangeCount = m_freeRangeCount;
+
+    if(m_flBitmap) {
+        const uint32_t fl = bitScanReverse(m_flBitmap);
+        const uint32_t sl = bitScanReverse(m_slBitmaps[fl]);
+        for(uint32_t r = m_freeHeads[fl][sl]; r != kNil; r = m_ranges[r].nextFree) {
+            stats.largestFreeRange = std::max(stats.largestFreeRange, m_ranges[r].size);
+        }
+    }
+    return stats;
+}
+
+bool TlsfSubAllocator::isEmpty(void) const { return m_allocations.empty(); }
+
+//======= BUDDY ==========
+
+BuddySubAllocator::BuddySubAllocator(VkDeviceSize size) {
+    assert(size >= (VkDeviceSize(1) << kMinOrder));
+    m_maxOrder = bitScanReverse(size);
+    m_size = VkDeviceSize(1) << m_maxOrder;
+    m_freeLists.resize(m_maxOrder + 1);
+    m_freeLists[m_maxOrder].insert(0);
+}
+
+VkDeviceSize BuddySubAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+    const VkDeviceSize need = std::max({ size, alignment, VkDeviceSize(1) << kMinOrder });
+    const uint32_t order = bitScanReverse(need) + ((need & (need - 1))? 1 : 0);
+    if(order > m_maxOrder) return kInvalidOffset;
+
+    uint32_t o = order;
+    while(o <= m_maxOrder && m_freeLists[o].empty()) ++o;
+    if(o > m_maxOrder) return kInvalidOffset;
+
+    const VkDeviceSize offset = *m_freeLists[o].begin();
+    m_freeLists[o].erase(m_freeLists[o].begin());
+
+    while(o > order) {
+        --o;
+        m_freeLists[o].insert(offset + (VkDeviceSize(1) << o));
+    }
+
+    m_allocations.emplace(offset, order);
+    m_usedSize += VkDeviceSize(1) << order;
+    return offset;
+}
+
+void BuddySubAllocator::free(VkDeviceSize offset) {
+    const auto it = m_allocations.find(offset);
+    assert(it != m_allocations.end());
+    if(it == m_allocations.end()) return;
+
+    uint32_t order = it->second;
+    m_allocations.erase(it);
+    m_usedSize -= VkDeviceSize(1) << order;
+
+    while(order < m_maxOrder) {
+        const VkDeviceSize buddy = offset ^ (VkDeviceSize(1) << order);
+        if(!m_freeLists[order].erase(buddy)) break;
+        offset = std::min(offset, buddy);
+        ++order;
+    }
+
+    m_freeLists[order].insert(offset);
+}
+
+DeviceMemorySubAllocator::Statistics BuddySubAllocator::getStatistics(void) const {
+    Statistics stats;
+    stats.size = m_size;
+    stats.usedSize = m_usedSize;
+    stats.allocationCount = static_cast<uint32_t>(m_allocations.size());
+
+    for(uint32_t o = 0; o <= m_maxOrder; ++o) {
+        stats.freeRangeCount += static_cast<uint32_t>(m_freeLists[o].size());
+        if(m_freeLists[o].size()) stats.largestFreeRange = VkDeviceSize(1) << o;
+    }
+    return stats;
+}
+
+bool BuddySubAllocator::isEmpty(void) const { return m_allocations.empty(); }
+
+//======= HEAP ==========
+
+DeviceMemoryHeap::DeviceMemoryHeap(Initializer initializer):
+    m_initializer(std::move(initializer))
+{
+    if(m_initializer.pMemoryProperties) {
+        m_memoryProperties = *m_initializer.pMemoryProperties;
+    } else if(m_initializer.pDevice) {
+        m_memoryProperties = m_initializer.pDevice->getPhysicalDevice().getMemoryProperties();
+    } else {
+        // bare simulation: one big unified heap
+        memset(&m_memoryProperties, 0, sizeof(VkPhysicalDeviceMemoryProperties));
+        m_memoryProperties.memoryTypeCount = 1;
+        m_memoryProperties.memoryTypes[0].propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                                                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        m_memoryProperties.memoryTypes[0].heapIndex = 0;
+        m_memoryProperties.memoryHeapCount = 1;
+        m_memoryProperties.memoryHeaps[0].size = ~VkDeviceSize(0);
+        m_memoryProperties.memoryHeaps[0].flags = VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+    }
+
+    if(!m_initializer.bufferImageGranularity) {
+        m_initializer.bufferImageGranularity = m_initializer.pDevice?
+                    m_initializer.pDevice->getPhysicalDevice().getProperties().limits.bufferImageGranularity : 1;
+    }
+
+    m_memoryTypes.resize(m_memoryProperties.memoryTypeCount);
+}
+
+DeviceMemoryHeap::~DeviceMemoryHeap(void) = default;
+
+uint32_t DeviceMemoryHeap::findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags requiredFlags) const {
+    for(uint32_t t = 0; t < m_memoryProperties.memoryTypeCount; ++t) {
+        if((typeBits & (1u << t)) &&
+           (m_memoryProperties.memoryTypes[t].propertyFlags & requiredFlags) == requiredFlags)
+        {
+            return t;
+        }
+    }
+    return ~0u;
+}
+
+Result DeviceMemoryHeap::createBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated, Block* pBlock) {
+    // buddy ranges have to be a power of two, dedicated blocks are always exact-fit TLSF
+    const bool buddy = m_initializer.strategy == Strategy::Buddy && !dedicated;
+    if(buddy) size = VkDeviceSize(1) << (bitScanReverse(size - 1) + 1);
+
+    if(!isSimulated()) {
+        auto pMemory = std::make_shared<DeviceMemory>(DeviceMemory::Initializer {
+                                                          DeviceMemoryAllocateInfo(size, memoryTypeIndex),
+                                                          m_initializer.pDevice
+                                                      });
+        if(!pMemory->getResult()) return pMemory->getResult();
+        pBlock->pMemory = std::move(pMemory);
+    }
+
+    if(buddy) pBlock->pAllocator = std::make_unique<BuddySubAllocator>(size);
+    else      pBlock->pAllocator = std::make_unique<TlsfSubAllocator>(size);
+
+    pBlock->size = size;
+    pBlock->id = m_nextBlockId++;
+    pBlock->dedicated = dedicated;
+    return VK_SUCCESS;
+}
+
+Result DeviceMemoryHeap::allocate(const VkMemoryRequirements& requirements,
+                                  VkMemoryPropertyFlags       requiredFlags,
+                                  Allocation*                 pAllocation,
+                                  bool                        linear)
+{
+    assert(pAllocation);
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const uint32_t typeIndex = findMemoryType(requirements.memoryTypeBits, requiredFlags);
+    if(typeIndex == ~0u) return VK_ERROR_FEATURE_NOT_PRESENT;
+
+    VkDeviceSize size = requirements.size;
+    VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+
+    // Optimal-tiled images get padded out to whole granularity pages on both ends so they
+    // can never share one with a linear resource.
+    if(!linear && m_initializer.bufferImageGranularity > 1) {
+        alignment = std::max(alignment, m_initializer.bufferImageGranularity);
+        size = alignUp(size, m_initializer.bufferImageGranularity);
+    }
+
+    MemoryType& type = m_memoryTypes[typeIndex];
+    Block* pBlock = nullptr;
+    VkDeviceSize offset = DeviceMemorySubAllocator::kInvalidOffset;
+
+    if(size <= m_initializer.blockSize / 2) {
+        for(auto& block : type.blocks) {
+            offset = block.pAllocator->allocate(size, alignment);
+            if(offset != DeviceMemorySubAllocator::kInvalidOffset) {
+                pBlock = &block;
+                break;
+            }
+        }
+    }
+
+    if(!pBlock) {
+        // too big to share a block gets its own dedicated one, rounded up so TLSF's
+        // 16 byte granularity can't trim it below size
+        Block block;
+        const bool dedicated = size > m_initializer.blockSize / 2;
+        const VkDeviceSize blockSize = dedicated? alignUp(size, 256) : m_initializer.blockSize;
+
+        const Result result = createBlock(typeIndex, blockSize, dedicated, &block);
+        if(!result) return result;
+
+        // only a buddy block can still refuse here, when the alignment is bigger than the block
+        offset = block.pAllocator->allocate(size, alignment);
+        if(offset == DeviceMemorySubAllocator::kInvalidOffset) return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+        type.blocks.push_back(std::move(block));
+        pBlock = &type.blocks.back();
+    }
+
+    pAllocation->pMemory = pBlock->pMemory;
+    pAllocation->offset = offset;
+    pAllocation->size = size;
+    pAllocation->memoryTypeIndex = typeIndex;
+    pAllocation->blockId = pBlock->id;
+
+    return VK_SUCCESS;
+}
+
+void DeviceMemoryHeap::free(Allocation& allocation) {
+    if(!allocation.isValid()) return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    assert(allocation.memoryTypeIndex < m_memoryTypes.size());
+    auto& blocks = m_memoryTypes[allocation.memoryTypeIndex].blocks;
+
+    const auto it = std::find_if(blocks.begin(), blocks.end(), [&](const Block& block) {
+        return block.id == allocation.blockId;
+    });
+    assert(it != blocks.end());
+
+    if(it != blocks.end()) {
+        it->pAllocator->free(allocation.offset);
+
+        // hang onto one empty standard block so alloc/free ping-ponging doesn't thrash vkAllocateMemory
+        if(it->pAllocator->isEmpty()) {
+            const bool spareEmpty = std::any_of(blocks.begin(), blocks.end(), [&](const Block& block) {
+                return &block != &*it && !block.dedicated && block.pAllocator->isEmpty();
+            });
+            if(it->dedicated || spareEmpty) blocks.erase(it);
+        }
+    }
+
+    allocation = Allocation{};
+}
+
+DeviceMemoryHeap::Statistics DeviceMemoryHeap::gatherStatistics(const MemoryType& type) const {
+    Statistics stats;
+    for(const auto& block : type.blocks) {
+        const auto blockStats = block.pAllocator->getStatistics();
+        stats.reservedSize += blockStats.size;
+        stats.usedSize += blockStats.usedSize;
+        stats.allocationCount += blockStats.allocationCount;
+        stats.freeRangeCount += blockStats.freeRangeCount;
+        stats.largestFreeRange = std::max(stats.largestFreeRange, blockStats.largestFreeRange);
+        ++stats.blockCount;
+    }
+    return stats;
+}
+
+DeviceMemoryHeap::Statistics DeviceMemoryHeap::getStatistics(uint32_t memoryTypeIndex) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    assert(memoryTypeIndex < m_memoryTypes.size());
+    return gatherStatistics(m_memoryTypes[memoryTypeIndex]);
+}
+
+DeviceMemoryHeap::Statistics DeviceMemoryHeap::getStatistics(void) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Statistics total;
+    for(const auto& type : m_memoryTypes) {
+        const Statistics stats = gatherStatistics(type);
+        total.reservedSize += stats.reservedSize;
+        total.usedSize += stats.usedSize;
+        total.blockCount += stats.blockCount;
+        total.allocationCount += stats.allocationCount;
+        total.freeRangeCount += stats.freeRangeCount;
+        total.largestFreeRange = std::max(total.largestFreeRange, stats.largestFreeRange);
+    }
+    return total;
+}
+
+void DeviceMemoryHeap::log(DebugLog* pLog) const {
+    auto logStats = [&](const Statistics& stats) {
+        pLog->verbose("reserved: %" PRIu64 " (%" PRIu64 " MB)", stats.reservedSize, stats.reservedSize / 1024 / 1024);
+        pLog->verbose("used: %" PRIu64 " (%" PRIu64 " MB)", stats.usedSize, stats.usedSize / 1024 / 1024);
+        pLog->verbose("blocks: %u", stats.blockCount);
+        pLog->verbose("allocations: %u", stats.allocationCount);
+        pLog->verbose("free ranges: %u", stats.freeRangeCount);
+        pLog->verbose("largest free range: %" PRIu64, stats.largestFreeRange);
+        pLog->verbose("utilization: %.2f%%", stats.getUtilization() * 100.0f);
+        pLog->verbose("fragmentation: %.2f%%", stats.getFragmentation() * 100.0f);
+    };
+
+    pLog->verbose("DeviceMemoryHeap: %s%s", getName(), isSimulated()? " (simulated)" : "");
+    pLog->push();
+    logStats(getStatistics());
+
+    for(uint32_t t = 0; t < m_memoryTypes.size(); ++t) {
+        const Statistics stats = getStatistics(t);
+        if(!stats.blockCount) continue;
+        pLog->verbose("memoryType[%u]", t);
+        pLog->push();
+        logStats(stats);
+        pLog->pop();
+    }
+    pLog->pop();
+}
+
+DeviceMemoryHeap::SimulationResult DeviceMemoryHeap::simulate(Initializer initializer, const SimulationSettings& settings) {
+    struct Live {
+        Allocation      allocation;
+        VkDeviceSize    alignment;
+    };
+
+    initializer.pDevice = nullptr;
+    DeviceMemoryHeap heap(std::move(initializer));
+
+    SimulationResult results;
+    std::vector<Live> live;
+    live.reserve(settings.operationCount);
+
+    std::mt19937 rng(settings.seed);
+    std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+    std::uniform_real_distribution<double> logSize(std::log2(static_cast<double>(settings.minSize)),
+                                                   std::log2(static_cast<double>(settings.maxSize)));
+    std::uniform_int_distribution<uint32_t> logAlignment(0, bitScanReverse(std::max<VkDeviceSize>(settings.maxAlignment, 1)));
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for(uint32_t op = 0; op < settings.operationCount; ++op) {
+        if(live.size() && chance(rng) < settings.freeChance) {
+            const size_t index = std::uniform_int_distribution<size_t>(0, live.size() - 1)(rng);
+            heap.free(live[index].allocation);
+            live[index] = std::move(live.back());
+            live.pop_back();
+            ++results.frees;
+        } else {
+            const VkMemoryRequirements requirements = {
+                static_cast<VkDeviceSize>(std::exp2(logSize(rng))),
+                VkDeviceSize(1) << logAlignment(rng),
+                settings.memoryTypeBits
+            };
+
+            Live entry { {}, requirements.alignment };
+            if(heap.allocate(requirements, 0, &entry.allocation, chance(rng) < 0.5f)) {
+                live.push_back(std::move(entry));
+                ++results.allocations;
+            } else {
+                ++results.failures;
+            }
+        }
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+    results.seconds = std::chrono::duration<double>(end - start).count();
+    results.operationsPerSecond = results.seconds > 0.0?
+                (results.allocations + results.frees + results.failures) / results.seconds : 0.0;
+    results.statistics = heap.getStatistics();
+
+    // every live range has to be aligned and disjoint from its block neighbors
+    std::sort(live.begin(), live.end(), [](const Live& lhs, const Live& rhs) {
+        if(lhs.allocation.blockId != rhs.allocation.blockId) return lhs.allocation.blockId < rhs.allocation.blockId;
+        return lhs.allocation.offset < rhs.allocation.offset;
+    });
+
+    for(size_t l = 0; l < live.size(); ++l) {
+        const Allocation& alloc = live[l].allocation;
+        if(alloc.offset % live[l].alignment) results.consistent = false;
+        if(l && live[l - 1].allocation.blockId == alloc.blockId &&
+           live[l - 1].allocation.offset + live[l - 1].allocation.size > alloc.offset)
+        {
+            results.consistent = false;
+        }
+    }
+
+    for(auto& entry : live) heap.free(entry.allocation);
+    if(heap.getStatistics().usedSize) results.consistent = false;
+
+    return results;
+}
+
+}
@@ -0,0 +1,85 @@
+#include <renderer/elysian_renderer_parallel_pass_recorder.hpp>
+#include <renderer/elysian_renderer_command_pool_manager.hpp>
+#include <renderer/elysian_renderer_worker_pool.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+
+namespace elysian::renderer {
+
+ParallelPassRecorder::ParallelPassRecorder(Initializer initializer):
+    m_initializer(std::move(initializer))
+{
+    assert(m_initializer.pPoolManager && m_initializer.pWorkers);
+}
+
+Result ParallelPassRecorder::record(CommandBuffer*           pPrimary,
+                                    const PassInfo&          pass,
+                                    uint32_t                 itemCount,
+                                    uint32_t                 chunkCount,
+                                    const RecordFunction&    recordFunction)
+{
+    assert(pPrimary->getState() == CommandBuffer::State::Recording);
+    const auto start = std::chrono::steady_clock::now();
+
+    if(!chunkCount) chunkCount = m_initializer.pWorkers->getThreadCount() + 1;
+    chunkCount = std::min(chunkCount, itemCount);
+    m_statistics = { chunkCount, itemCount, 0.0 };
+    if(!chunkCount) return VK_SUCCESS;
+
+    const auto inheritanceInfo = VkCommandBufferInheritanceInfo {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        nullptr,
+        pass.renderPass,
+        pass.subpass,
+        pass.framebuffer,
+        pass.occlusionQueryEnable,
+        pass.queryFlags,
+        pass.pipelineStatistics
+    };
+    const auto beginInfo = VkCommandBufferBeginInfo {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        nullptr,
+        static_cast<VkCommandBufferUsageFlags>(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+            (pass.renderPass != VK_NULL_HANDLE? VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT : 0)),
+        &inheritanceInfo
+    };
+
+    // spread the remainder over the first chunks so sizes differ by one at most
+    const uint32_t chunkSize = itemCount / chunkCount;
+    const uint32_t remainder = itemCount % chunkCount;
+
+    m_secondaries.assign(chunkCount, nullptr);
+    std::atomic<VkResult> failure = { VK_SUCCESS };
+
+    m_initializer.pWorkers->parallelFor(chunkCount, [&](uint32_t chunk) {
+        CommandBuffer* pCmdBuffer = m_initializer.pPoolManager->acquire(m_initializer.queueFamilyIndex,
+                                                                         VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+        if(!pCmdBuffer) {
+            failure = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+            return;
+        }
+
+        Result result = pCmdBuffer->begin(beginInfo);
+        if(result) {
+            const uint32_t first = chunk * chunkSize + std::min(chunk, remainder);
+            const uint32_t count = chunkSize + (chunk < remainder? 1 : 0);
+            recordFunction(pCmdBuffer, chunk, first, count);
+            result = pCmdBuffer->end();
+        }
+
+        if(!result) failure = result.getCode();
+        else m_secondaries[chunk] = pCmdBuffer;
+    });
+
+    if(failure != VK_SUCCESS) return failure.load();
+
+    // fan-in in chunk order, no matter who finished first
+    pPrimary->cmdExecuteCommands(m_secondaries);
+
+    m_statistics.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return VK_SUCCESS;
+}
+
+}
@@ -0,0 +1,230 @@
+#include <renderer/elysian_renderer_pipeline_cache.hpp>
+#include <renderer/elysian_renderer_device.hpp>
+#include <renderer/elysian_renderer_physical_device.hpp>
+#include <renderer/elysian_renderer_debug_log.hpp>
+#include <renderer/elysian_renderer_hash.hpp>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   include <windows.h>
+#else
+#   include <unistd.h>
+#endif
+
+namespace elysian::renderer {
+
+static_assert(sizeof(PipelineCache::FileHeader) == 56, "file header has to stay padding free");
+
+namespace {
+
+bool readFile(const std::string& filePath, std::vector<uint8_t>* pData) {
+    std::FILE* pFile = std::fopen(filePath.c_str(), "rb");
+    if(!pFile) return false;
+
+    bool success = std::fseek(pFile, 0, SEEK_END) == 0;
+    const long size = success? std::ftell(pFile) : -1;
+    success = size >= 0 && std::fseek(pFile, 0, SEEK_SET) == 0;
+    if(success) {
+        pData->resize(static_cast<size_t>(size));
+        success = std::fread(pData->data(), 1, pData->size(), pFile) == pData->size();
+    }
+    std::fclose(pFile);
+    return success;
+}
+
+// everything goes to a temporary next to the target first, which then replaces it in one go
+bool writeFileAtomic(const std::string& filePath, const void* pHeader, size_t headerSize, const void* pData, size_t dataSize) {
+    const std::string tempPath = filePath + ".tmp";
+    std::FILE* pFile = std::fopen(tempPath.c_str(), "wb");
+    if(!pFile) return false;
+
+    bool success = std::fwrite(pHeader, 1, headerSize, pFile) == headerSize &&
+                   std::fwrite(pData, 1, dataSize, pFile) == dataSize &&
+                   std::fflush(pFile) == 0;
+#ifndef _WIN32
+    // make sure the contents hit the disk before the rename can
+    success = success && fsync(fileno(pFile)) == 0;
+#endif
+    success = std::fclose(pFile) == 0 && success;
+
+    if(success) {
+#ifdef _WIN32
+        success = MoveFileExA(tempPath.c_str(), filePath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+        success = std::rename(tempPath.c_str(), filePath.c_str()) == 0;
+#endif
+    }
+
+    if(!success) std::remove(tempPath.c_str());
+    return success;
+}
+
+}
+
+PipelineCache::PipelineCache(Initializer initializer):
+    m_initializer(std::move(initializer))
+{
+    assert(m_initializer.pDevice);
+
+    std::vector<uint8_t> file;
+    const void* pInitialData = nullptr;
+    size_t initialSize = 0;
+
+    if(!m_initializer.filePath.empty() && readFile(m_initializer.filePath, &file)) {
+        m_loadStatus = validate(m_initializer.pDevice->getPhysicalDevice(), file.data(), file.size());
+        if(m_loadStatus == LoadStatus::Loaded) {
+            pInitialData = file.data() + sizeof(FileHeader);
+            initialSize = file.size() - sizeof(FileHeader);
+        }
+    }
+
+    auto info = VkPipelineCacheCreateInfo {
+        VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        nullptr,
+        m_initializer.flags,
+        initialSize,
+        pInitialData
+    };
+
+    VkPipelineCache cache = VK_NULL_HANDLE;
+    m_result = vkCreatePipelineCache(m_initializer.pDevice->getHandle(), &info, m_initializer.pDevice->getAllocationCallbacks(), &cache);
+
+    // drivers are meant to ignore data they don't like, but don't count on it
+    if(!m_result && initialSize) {
+        m_loadStatus = LoadStatus::Incompatible;
+        info.initialDataSize = 0;
+        info.pInitialData = nullptr;
+        m_result = vkCreatePipelineCache(m_initializer.pDevice->getHandle(), &info, m_initializer.pDevice->getAllocationCallbacks(), &cache);
+    } else if(m_result && initialSize) {
+        m_loadedSize = initialSize;
+        m_savedHash = hashBytes(pInitialData, initialSize);
+    }
+
+    setHandle(cache);
+}
+
+PipelineCache::~PipelineCache(void) {
+    vkDestroyPipelineCache(m_initializer.pDevice->getHandle(), getHandle(), m_initializer.pDevice->getAllocationCallbacks());
+}
+
+PipelineCache::LoadStatus PipelineCache::validate(const PhysicalDevice& physicalDevice, const void* pFileData, size_t fileSize) {
+    if(fileSize < sizeof(FileHeader)) return LoadStatus::Corrupt;
+
+    FileHeader header;
+    std::memcpy(&header, pFileData, sizeof(FileHeader));
+    if(header.magic != kFileMagic || header.version != kFileVersion ||
+       header.dataSize != fileSize - sizeof(FileHeader))
+    {
+        return LoadStatus::Corrupt;
+    }
+
+    const VkPhysicalDeviceProperties& properties = physicalDevice.getProperties();
+    if(header.vendorID != properties.vendorID ||
+       header.deviceID != properties.deviceID ||
+       header.driverVersion != properties.driverVersion ||
+       std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE))
+    {
+        return LoadStatus::Incompatible;
+    }
+
+    const auto* pData = static_cast<const uint8_t*>(pFileData) + sizeof(FileHeader);
+    if(hashBytes(pData, header.dataSize) != header.dataHash) return LoadStatus::Corrupt;
+
+    // and the driver's own header, in case it was written by something else entirely
+    VkPipelineCacheHeaderVersionOne driverHeader;
+    if(header.dataSize < sizeof(driverHeader)) return LoadStatus::Corrupt;
+    std::memcpy(&driverHeader, pData, sizeof(driverHeader));
+    if(driverHeader.headerSize < sizeof(driverHeader) ||
+       driverHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+       driverHeader.vendorID != properties.vendorID ||
+       driverHeader.deviceID != properties.deviceID ||
+       std::memcmp(driverHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE))
+    {
+        return LoadStatus::Incompatible;
+    }
+
+    return LoadStatus::Loaded;
+}
+
+Result PipelineCache::getData(std::vector<uint8_t>* pData) const {
+    // the size can grow between the two calls when other threads are still creating pipelines
+    for(;;) {
+        size_t size = 0;
+        Result result = vkGetPipelineCacheData(m_initializer.pDevice->getHandle(), getHandle(), &size, nullptr);
+        if(!result) return result;
+
+        pData->resize(size);
+        result = vkGetPipelineCacheData(m_initializer.pDevice->getHandle(), getHandle(), &size, pData->data());
+        if(result.getCode() == VK_INCOMPLETE) continue;
+
+        pData->resize(size);
+        return result;
+    }
+}
+
+Result PipelineCache::save(const char* pFilePath) {
+    const std::string filePath = pFilePath? pFilePath : m_initializer.filePath;
+    // there's no VkResult for I/O, this is the closest
+    if(filePath.empty()) return VK_ERROR_INITIALIZATION_FAILED;
+
+    std::vector<uint8_t> data;
+    const Result result = getData(&data);
+    if(!result) return result;
+
+    const uint64_t dataHash = hashBytes(data.data(), data.size());
+    if(!pFilePath && dataHash == m_savedHash) return VK_SUCCESS;
+
+    const VkPhysicalDeviceProperties& properties = m_initializer.pDevice->getPhysicalDevice().getProperties();
+    FileHeader header = {};
+    header.magic = kFileMagic;
+    header.version = kFileVersion;
+    header.vendorID = properties.vendorID;
+    header.deviceID = properties.deviceID;
+    header.driverVersion = properties.driverVersion;
+    std::memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.dataSize = data.size();
+    header.dataHash = dataHash;
+
+    if(!writeFileAtomic(filePath, &header, sizeof(header), data.data(), data.size()))
+        return VK_ERROR_INITIALIZATION_FAILED;
+
+    if(!pFilePath) m_savedHash = dataHash;
+    return VK_SUCCESS;
+}
+
+Result PipelineCache::merge(const std::vector<const PipelineCache*>& sources) {
+    std::vector<VkPipelineCache> handles;
+    handles.reserve(sources.size());
+    for(const PipelineCache* pSource : sources) {
+        assert(pSource != this); //dstCache can't be one of the sources
+        handles.push_back(pSource->getHandle());
+    }
+    if(handles.empty()) return VK_SUCCESS;
+
+    return vkMergePipelineCaches(m_initializer.pDevice->getHandle(), getHandle(),
+                                 static_cast<uint32_t>(handles.size()), handles.data());
+}
+
+const char* PipelineCache::getLoadStatusName(LoadStatus status) {
+    switch(status) {
+    case LoadStatus::None:          return "None";
+    case LoadStatus::Loaded:        return "Loaded";
+    case LoadStatus::Corrupt:       return "Corrupt";
+    case LoadStatus::Incompatible:  return "Incompatible";
+    default:                        return "Unknown";
+    }
+}
+
+void PipelineCache::log(DebugLog* pLog) const {
+    pLog->verbose("Pipeline Cache [%s]", getName());
+    pLog->push();
+    pLog->verbose("%-16s %s", "File:", m_initializer.filePath.empty()? "<memory>" : getFilePath());
+    pLog->verbose("%-16s %s", "Load status:", getLoadStatusName(m_loadStatus));
+    pLog->verbose("%-16s %zu bytes", "Loaded size:", m_loadedSize);
+    pLog->pop();
+}
+
+}
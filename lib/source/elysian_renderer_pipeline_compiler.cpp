@@ -0,0 +1,311 @@
+#include <renderer/elysian_renderer_pipeline_compiler.hpp>
+#include <renderer/elysian_renderer_pipeline_cache.hpp>
+#include <renderer/elysian_renderer_worker_pool.hpp>
+#include <renderer/elysian_renderer_device.hpp>
+#include <renderer/elysian_renderer_debug_log.hpp>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iterator>
+
+namespace elysian::renderer {
+
+PipelineCompiler::PipelineCompiler(Initializer initializer):
+    m_initializer(std::move(initializer))
+{
+    assert(m_initializer.pDevice && m_initializer.pWorkerPool);
+    m_initializer.maxConcurrentCompiles = std::max(m_initializer.maxConcurrentCompiles, 1u);
+}
+
+PipelineCompiler::~PipelineCompiler(void) {
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_stopping = true;
+
+        // a promoted job sits in the queue more than once, only the first one gets to cancel it
+        for(QueueEntry& entry : m_queue) {
+            Job* pJob = entry.pJob.get();
+            if(pJob->status.load(std::memory_order_relaxed) != Status::Pending) continue;
+            pJob->result = VK_NOT_READY;
+            pJob->status.store(Status::Failed, std::memory_order_release);
+            pJob->promise.set_value(VK_NULL_HANDLE);
+        }
+        m_queue.clear();
+        m_inFlight.clear();
+        m_statistics.queuedCount = 0;
+
+        m_idle.wait(lock, [&]{ return !m_compiling; });
+    }
+
+    for(VkPipeline pipeline : m_computePipelines)
+        vkDestroyPipeline(m_initializer.pDevice->getHandle(), pipeline, m_initializer.pDevice->getAllocationCallbacks());
+}
+
+std::shared_ptr<PipelineCompiler::Job> PipelineCompiler::makeJob(VkPipeline fallback) {
+    auto pJob = std::make_shared<Job>();
+    pJob->fallback = fallback;
+    pJob->future = pJob->promise.get_future().share();
+    return pJob;
+}
+
+PipelineCompiler::Handle PipelineCompiler::compile(const GraphicsPipelineState& state, Priority priority, VkPipeline fallback) {
+    assert(m_initializer.pVariantCache);
+    auto pJob = makeJob(fallback);
+
+    // no point queueing what the cache can hand out right away
+    if(const VkPipeline pipeline = m_initializer.pVariantCache->findPipeline(state)) {
+        pJob->pipeline = pipeline;
+        pJob->result = VK_SUCCESS;
+        pJob->status.store(Status::Ready, std::memory_order_release);
+        pJob->promise.set_value(pipeline);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_statistics.requestCount;
+            ++m_statistics.readyOnRequest;
+        }
+        Handle handle;
+        handle.m_pJob = std::move(pJob);
+        return handle;
+    }
+
+    pJob->graphics = state;
+    pJob->key = state.getKey();
+    return enqueue(std::move(pJob), priority);
+}
+
+PipelineCompiler::Handle PipelineCompiler::compile(const VkComputePipelineCreateInfo& info, Priority priority, VkPipeline fallback) {
+    auto pJob = makeJob(fallback);
+    auto pCompute = std::make_unique<ComputeState>();
+    pCompute->module = info.stage.module;
+    pCompute->entryPoint = info.stage.pName? info.stage.pName : "main";
+    pCompute->specialized = info.stage.pSpecializationInfo != nullptr;
+    if(const VkSpecializationInfo* pSpecialization = info.stage.pSpecializationInfo) {
+        if(pSpecialization->pMapEntries)
+            pCompute->mapEntries.assign(pSpecialization->pMapEntries, pSpecialization->pMapEntries + pSpecialization->mapEntryCount);
+        const auto* pData = static_cast<const uint8_t*>(pSpecialization->pData);
+        if(pData) pCompute->specializationData.assign(pData, pData + pSpecialization->dataSize);
+    }
+    pCompute->layout = info.layout;
+    // the base pipeline isn't carried over, it may well be gone by the time this runs
+    pCompute->flags = info.flags & ~VK_PIPELINE_CREATE_DERIVATIVE_BIT;
+    pJob->pCompute = std::move(pCompute);
+    return enqueue(std::move(pJob), priority);
+}
+
+PipelineCompiler::Handle PipelineCompiler::enqueue(std::shared_ptr<Job> pJob, Priority priority) {
+    Handle handle;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        assert(!m_stopping);
+        ++m_statistics.requestCount;
+
+        if(!pJob->pCompute) {
+            const auto it = m_inFlight.find(pJob->key);
+            if(it != m_inFlight.end() && it->second->graphics == pJob->graphics) {
+                promoteLocked(it->second, priority);
+                handle.m_pJob = it->second;
+                return handle;
+            }
+            // on a key collision the first one keeps the slot, the other just isn't deduplicated
+            m_inFlight.emplace(pJob->key, pJob);
+        }
+
+        pJob->priority = priority;
+        pushLocked(pJob);
+        ++m_statistics.queuedCount;
+        handle.m_pJob = std::move(pJob);
+    }
+    dispatch();
+    return handle;
+}
+
+void PipelineCompiler::pushLocked(const std::shared_ptr<Job>& pJob) {
+    m_queue.push_back({ pJob->priority, m_sequence++, pJob });
+    std::push_heap(m_queue.begin(), m_queue.end());
+}
+
+void PipelineCompiler::promoteLocked(const std::shared_ptr<Job>& pJob, Priority priority) {
+    if(pJob->status.load(std::memory_order_relaxed) != Status::Pending || pJob->priority >= priority) return;
+    // the old entry stays behind and gets skipped once the job has been taken
+    pJob->priority = priority;
+    pushLocked(pJob);
+    ++m_statistics.promotedCount;
+}
+
+void PipelineCompiler::promote(const Handle& handle, Priority priority) {
+    if(!handle.isValid()) return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    promoteLocked(handle.m_pJob, priority);
+}
+
+VkPipeline PipelineCompiler::getPipeline(const Handle& handle) {
+    if(!handle.isValid()) return VK_NULL_HANDLE;
+    const std::shared_ptr<Job>& pJob = handle.m_pJob;
+    if(pJob->status.load(std::memory_order_acquire) == Status::Ready) return pJob->pipeline;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    promoteLocked(pJob, Priority::CurrentFrame);
+    if(pJob->fallback) ++m_statistics.fallbackCount;
+    else ++m_statistics.skipCount;
+    return pJob->fallback;
+}
+
+auto PipelineCompiler::takeLocked(void) -> std::vector<std::shared_ptr<Job>> {
+    std::vector<std::shared_ptr<Job>> jobs;
+    while(!m_stopping && m_compiling < m_initializer.maxConcurrentCompiles && !m_queue.empty()) {
+        std::pop_heap(m_queue.begin(), m_queue.end());
+        std::shared_ptr<Job> pJob = std::move(m_queue.back().pJob);
+        m_queue.pop_back();
+
+        // stale entry from before a promotion
+        if(pJob->status.load(std::memory_order_relaxed) != Status::Pending) continue;
+        pJob->status.store(Status::Compiling, std::memory_order_relaxed);
+        ++m_compiling;
+        --m_statistics.queuedCount;
+        jobs.push_back(std::move(pJob));
+    }
+    return jobs;
+}
+
+void PipelineCompiler::dispatch(void) {
+    std::vector<std::shared_ptr<Job>> jobs;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        jobs = takeLocked();
+    }
+    submit(std::move(jobs));
+}
+
+void PipelineCompiler::submit(std::vector<std::shared_ptr<Job>> jobs) {
+    // Nothing taken means nothing keeps m_compiling up, the destructor may already be done
+    // with us. Has to bail before touching a single member.
+    if(jobs.empty()) return;
+
+    // a pool without threads would run these inline, so never call this holding the lock
+    WorkerPool* pWorkerPool = m_initializer.pWorkerPool;
+    if(!pWorkerPool->getThreadCount()) {
+        // drain right here, going through the pool would nest one call deeper per queued job
+        while(!jobs.empty()) {
+            std::vector<std::shared_ptr<Job>> next;
+            for(auto& pJob : jobs) {
+                auto taken = execute(pJob);
+                std::move(taken.begin(), taken.end(), std::back_inserter(next));
+            }
+            jobs = std::move(next);
+        }
+        return;
+    }
+
+    // the last job may finish and free us before its submit() returns, only locals from here on
+    for(auto& pJob : jobs)
+        pWorkerPool->submit([this, pJob]{ submit(execute(pJob)); });
+}
+
+auto PipelineCompiler::execute(const std::shared_ptr<Job>& pJob) -> std::vector<std::shared_ptr<Job>> {
+    const auto start = std::chrono::steady_clock::now();
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    const Result result = pJob->pCompute?
+        createComputePipeline(*pJob->pCompute, &pipeline) :
+        m_initializer.pVariantCache->getPipeline(pJob->graphics, &pipeline);
+
+    const auto time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    return finish(pJob, pipeline, result, static_cast<uint64_t>(time.count()));
+}
+
+auto PipelineCompiler::finish(const std::shared_ptr<Job>& pJob, VkPipeline pipeline, Result result, uint64_t time)
+    -> std::vector<std::shared_ptr<Job>>
+{
+    pJob->pipeline = result? pipeline : VK_NULL_HANDLE;
+    pJob->result = result;
+
+    std::vector<std::shared_ptr<Job>> jobs;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(pJob->pCompute && result) m_computePipelines.push_back(pipeline);
+        if(!pJob->pCompute) {
+            const auto it = m_inFlight.find(pJob->key);
+            if(it != m_inFlight.end() && it->second == pJob) m_inFlight.erase(it);
+        }
+
+        if(result) ++m_statistics.compiledCount;
+        else ++m_statistics.failedCount;
+        m_statistics.compileTime += time;
+        --m_compiling;
+
+        pJob->status.store(result? Status::Ready : Status::Failed, std::memory_order_release);
+        pJob->promise.set_value(pJob->pipeline);
+
+        jobs = takeLocked();
+        // under the lock, the destructor may be waiting for exactly this and free us right after
+        m_idle.notify_all();
+    }
+    // anything taken still counts as compiling, which keeps us alive until it's submitted
+    return jobs;
+}
+
+void PipelineCompiler::waitIdle(void) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [&]{ return !m_compiling && !m_statistics.queuedCount; });
+}
+
+Result PipelineCompiler::createComputePipeline(const ComputeState& state, VkPipeline* pPipeline) const {
+    const auto specialization = VkSpecializationInfo {
+        static_cast<uint32_t>(state.mapEntries.size()),
+        state.mapEntries.data(),
+        state.specializationData.size(),
+        state.specializationData.data()
+    };
+
+    const auto info = VkComputePipelineCreateInfo {
+        VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        nullptr,
+        state.flags,
+        {
+            VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            nullptr,
+            0,
+            VK_SHADER_STAGE_COMPUTE_BIT,
+            state.module,
+            state.entryPoint.c_str(),
+            state.specialized? &specialization : nullptr
+        },
+        state.layout,
+        VK_NULL_HANDLE,
+        -1
+    };
+
+    const VkPipelineCache cache = m_initializer.pPipelineCache? m_initializer.pPipelineCache->getHandle() : VK_NULL_HANDLE;
+    return vkCreateComputePipelines(m_initializer.pDevice->getHandle(), cache, 1, &info,
+                                    m_initializer.pDevice->getAllocationCallbacks(), pPipeline);
+}
+
+PipelineCompiler::Statistics PipelineCompiler::getStatistics(void) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Statistics statistics = m_statistics;
+    statistics.compilingCount = m_compiling;
+    return statistics;
+}
+
+void PipelineCompiler::log(DebugLog* pLog) const {
+    const Statistics statistics = getStatistics();
+    pLog->verbose("Pipeline Compiler [%s]", getName());
+    pLog->push();
+    pLog->verbose("%-16s %u", "Max concurrent:", m_initializer.maxConcurrentCompiles);
+    pLog->verbose("%-16s %u", "Queued:", statistics.queuedCount);
+    pLog->verbose("%-16s %u", "Compiling:", statistics.compilingCount);
+    pLog->verbose("%-16s %llu (%llu already cached)", "Requests:",
+                  static_cast<unsigned long long>(statistics.requestCount),
+                  static_cast<unsigned long long>(statistics.readyOnRequest));
+    pLog->verbose("%-16s %llu", "Compiled:", static_cast<unsigned long long>(statistics.compiledCount));
+    pLog->verbose("%-16s %llu", "Failed:", static_cast<unsigned long long>(statistics.failedCount));
+    pLog->verbose("%-16s %llu", "Promoted:", static_cast<unsigned long long>(statistics.promotedCount));
+    pLog->verbose("%-16s %llu fallback, %llu skipped", "Not ready:",
+                  static_cast<unsigned long long>(statistics.fallbackCount),
+                  static_cast<unsigned long long>(statistics.skipCount));
+    pLog->verbose("%-16s %.2f ms", "Avg. compile:", statistics.compiledCount + statistics.failedCount?
+                  double(statistics.compileTime) / 1000.0 / double(statistics.compiledCount + statistics.failedCount) : 0.0);
+    pLog->pop();
+}
+
+}
@@ -0,0 +1,301 @@
+#include <renderer/elysian_renderer_pipeline_statistics.hpp>
+#include <renderer/elysian_renderer_pipeline_variant_cache.hpp>
+#include <renderer/elysian_renderer_device.hpp>
+#include <renderer/elysian_renderer_debug_log.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstdarg>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+namespace elysian::renderer {
+
+namespace {
+
+struct StageName {
+    VkShaderStageFlagBits   stage;
+    const char*             pName;
+};
+
+constexpr StageName kStageNames[] = {
+    { VK_SHADER_STAGE_VERTEX_BIT,                   "vertex" },
+    { VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT,     "tess_control" },
+    { VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT,  "tess_evaluation" },
+    { VK_SHADER_STAGE_GEOMETRY_BIT,                 "geometry" },
+    { VK_SHADER_STAGE_FRAGMENT_BIT,                 "fragment" },
+    { VK_SHADER_STAGE_COMPUTE_BIT,                  "compute" }
+};
+
+std::string getStageNames(VkShaderStageFlags stages) {
+    std::string names;
+    for(const StageName& stage : kStageNames) {
+        if(!(stages & stage.stage)) continue;
+        if(!names.empty()) names += '|';
+        names += stage.pName;
+    }
+    return names.empty()? "other" : names;
+}
+
+void appendf(std::string* pOut, const char* pFmt, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, pFmt);
+    const int length = std::vsnprintf(buffer, sizeof(buffer), pFmt, args);
+    va_end(args);
+    if(length > 0) pOut->append(buffer, std::min<size_t>(length, sizeof(buffer) - 1));
+}
+
+void appendValue(std::string* pOut, const PipelineExecutableStatistics::Statistic& statistic) {
+    switch(statistic.format) {
+    case VK_PIPELINE_EXECUTABLE_STATISTIC_FORMAT_BOOL32_KHR:
+        pOut->append(statistic.value.b32? "true" : "false");
+        break;
+    case VK_PIPELINE_EXECUTABLE_STATISTIC_FORMAT_INT64_KHR:
+        appendf(pOut, "%" PRId64, statistic.value.i64);
+        break;
+    case VK_PIPELINE_EXECUTABLE_STATISTIC_FORMAT_UINT64_KHR:
+        appendf(pOut, "%" PRIu64, statistic.value.u64);
+        break;
+    case VK_PIPELINE_EXECUTABLE_STATISTIC_FORMAT_FLOAT64_KHR:
+        appendf(pOut, "%.9g", statistic.value.f64);
+        break;
+    default:
+        pOut->append("null");
+    }
+}
+
+void appendJsonString(std::string* pOut, const std::string& string) {
+    pOut->push_back('"');
+    for(const char c : string) {
+        switch(c) {
+        case '"':   pOut->append("\\\""); break;
+        case '\\':  pOut->append("\\\\"); break;
+        case '\n':  pOut->append("\\n"); break;
+        case '\t':  pOut->append("\\t"); break;
+        default:
+            if(static_cast<unsigned char>(c) < 0x20) appendf(pOut, "\\u%04x", c);
+            else pOut->push_back(c);
+        }
+    }
+    pOut->push_back('"');
+}
+
+void appendCsvField(std::string* pOut, const std::string& string) {
+    if(string.find_first_of(",\"\n") == std::string::npos) {
+        pOut->append(string);
+        return;
+    }
+    pOut->push_back('"');
+    for(const char c : string) {
+        if(c == '"') pOut->push_back('"');
+        pOut->push_back(c);
+    }
+    pOut->push_back('"');
+}
+
+}
+
+double PipelineExecutableStatistics::Statistic::toDouble(void) const {
+    switch(format) {
+    case VK_PIPELINE_EXECUTABLE_STATISTIC_FORMAT_BOOL32_KHR:    return value.b32? 1.0 : 0.0;
+    case VK_PIPELINE_EXECUTABLE_STATISTIC_FORMAT_INT64_KHR:     return static_cast<double>(value.i64);
+    case VK_PIPELINE_EXECUTABLE_STATISTIC_FORMAT_UINT64_KHR:    return static_cast<double>(value.u64);
+    case VK_PIPELINE_EXECUTABLE_STATISTIC_FORMAT_FLOAT64_KHR:   return value.f64;
+    default:                                                    return 0.0;
+    }
+}
+
+auto PipelineExecutableStatistics::find(const char* pName) const -> const Statistic* {
+    const size_t length = std::strlen(pName);
+    for(const Statistic& statistic : statistics) {
+        const std::string& name = statistic.name;
+        for(size_t c = 0; c + length <= name.size(); ++c) {
+            size_t i = 0;
+            while(i < length && std::tolower(static_cast<unsigned char>(name[c + i])) ==
+                                std::tolower(static_cast<unsigned char>(pName[i])))
+            {
+                ++i;
+            }
+            if(i == length) return &statistic;
+        }
+    }
+    return nullptr;
+}
+
+Result getPipelineExecutableStatistics(const Device* pDevice, VkPipeline pipeline,
+                                       std::vector<PipelineExecutableStatistics>* pExecutables)
+{
+    pExecutables->clear();
+
+    // extension entry points, null unless it's enabled on the device
+    const auto pfnGetProperties = reinterpret_cast<PFN_vkGetPipelineExecutablePropertiesKHR>(
+                pDevice->getProcAddr("vkGetPipelineExecutablePropertiesKHR"));
+    const auto pfnGetStatistics = reinterpret_cast<PFN_vkGetPipelineExecutableStatisticsKHR>(
+                pDevice->getProcAddr("vkGetPipelineExecutableStatisticsKHR"));
+    if(!pfnGetProperties || !pfnGetStatistics) return VK_ERROR_EXTENSION_NOT_PRESENT;
+
+    const auto pipelineInfo = VkPipelineInfoKHR {
+        VK_STRUCTURE_TYPE_PIPELINE_INFO_KHR,
+        nullptr,
+        pipeline
+    };
+
+    uint32_t executableCount = 0;
+    Result result = pfnGetProperties(pDevice->getHandle(), &pipelineInfo, &executableCount, nullptr);
+    if(!result) return result;
+
+    std::vector<VkPipelineExecutablePropertiesKHR> properties(executableCount);
+    for(auto& property : properties) {
+        property.sType = VK_STRUCTURE_TYPE_PIPELINE_EXECUTABLE_PROPERTIES_KHR;
+        property.pNext = nullptr;
+    }
+    result = pfnGetProperties(pDevice->getHandle(), &pipelineInfo, &executableCount, properties.data());
+    if(!result) return result;
+
+    pExecutables->resize(executableCount);
+    for(uint32_t e = 0; e < executableCount; ++e) {
+        PipelineExecutableStatistics& executable = (*pExecutables)[e];
+        executable.name = properties[e].name;
+        executable.description = properties[e].description;
+        executable.stages = properties[e].stages;
+        executable.subgroupSize = properties[e].subgroupSize;
+
+        const auto executableInfo = VkPipelineExecutableInfoKHR {
+            VK_STRUCTURE_TYPE_PIPELINE_EXECUTABLE_INFO_KHR,
+            nullptr,
+            pipeline,
+            e
+        };
+
+        uint32_t statisticCount = 0;
+        result = pfnGetStatistics(pDevice->getHandle(), &executableInfo, &statisticCount, nullptr);
+        if(!result) return result;
+
+        std::vector<VkPipelineExecutableStatisticKHR> statistics(statisticCount);
+        for(auto& statistic : statistics) {
+            statistic.sType = VK_STRUCTURE_TYPE_PIPELINE_EXECUTABLE_STATISTIC_KHR;
+            statistic.pNext = nullptr;
+        }
+        result = pfnGetStatistics(pDevice->getHandle(), &executableInfo, &statisticCount, statistics.data());
+        if(!result) return result;
+
+        executable.statistics.reserve(statisticCount);
+        for(uint32_t s = 0; s < statisticCount; ++s) {
+            executable.statistics.push_back({
+                statistics[s].name,
+                statistics[s].description,
+                statistics[s].format,
+                statistics[s].value
+            });
+        }
+    }
+
+    return VK_SUCCESS;
+}
+
+Result PipelineStatisticsReport::add(const char* pName, VkPipeline pipeline) {
+    Entry entry;
+    entry.pipeline = pName? pName : "";
+    const Result result = getPipelineExecutableStatistics(m_pDevice, pipeline, &entry.executables);
+    if(result) m_entries.push_back(std::move(entry));
+    return result;
+}
+
+Result PipelineStatisticsReport::add(const PipelineVariantCache& cache) {
+    // keep going past failures, one pipeline without statistics shouldn't empty the report
+    Result result = VK_SUCCESS;
+    char name[64];
+    for(const PipelineVariantCache::Variant& variant : cache.getVariants()) {
+        std::snprintf(name, sizeof(name), "%s/%016" PRIx64, cache.getName(), variant.key);
+        const Result added = add(name, variant.pipeline);
+        if(!added && result) result = added;
+    }
+    return result;
+}
+
+std::string PipelineStatisticsReport::write(Format format) const {
+    std::string out;
+
+    if(format == Format::Csv) {
+        out.append("pipeline,executable,stages,subgroupSize,statistic,value\n");
+        for(const Entry& entry : m_entries) {
+            for(const PipelineExecutableStatistics& executable : entry.executables) {
+                for(const auto& statistic : executable.statistics) {
+                    appendCsvField(&out, entry.pipeline);
+                    out.push_back(',');
+                    appendCsvField(&out, executable.name);
+                    out.push_back(',');
+                    out.append(getStageNames(executable.stages));
+                    appendf(&out, ",%u,", executable.subgroupSize);
+                    appendCsvField(&out, statistic.name);
+                    out.push_back(',');
+                    appendValue(&out, statistic);
+                    out.push_back('\n');
+                }
+            }
+        }
+        return out;
+    }
+
+    out.append("{\n  \"pipelines\": [");
+    for(size_t p = 0; p < m_entries.size(); ++p) {
+        const Entry& entry = m_entries[p];
+        out.append(p? ",\n    {\n" : "\n    {\n");
+        out.append("      \"name\": ");
+        appendJsonString(&out, entry.pipeline);
+        out.append(",\n      \"executables\": [");
+        for(size_t e = 0; e < entry.executables.size(); ++e) {
+            const PipelineExecutableStatistics& executable = entry.executables[e];
+            out.append(e? ",\n        {\n" : "\n        {\n");
+            out.append("          \"name\": ");
+            appendJsonString(&out, executable.name);
+            out.append(",\n          \"description\": ");
+            appendJsonString(&out, executable.description);
+            out.append(",\n          \"stages\": ");
+            appendJsonString(&out, getStageNames(executable.stages));
+            appendf(&out, ",\n          \"subgroupSize\": %u,\n          \"statistics\": {", executable.subgroupSize);
+            for(size_t s = 0; s < executable.statistics.size(); ++s) {
+                out.append(s? ",\n            " : "\n            ");
+                appendJsonString(&out, executable.statistics[s].name);
+                out.append(": ");
+                appendValue(&out, executable.statistics[s]);
+            }
+            out.append(executable.statistics.empty()? "}\n        }" : "\n          }\n        }");
+        }
+        out.append(entry.executables.empty()? "]\n    }" : "\n      ]\n    }");
+    }
+    out.append(m_entries.empty()? "]\n}\n" : "\n  ]\n}\n");
+    return out;
+}
+
+Result PipelineStatisticsReport::write(const char* pFilePath, Format format) const {
+    const std::string out = write(format);
+    std::FILE* pFile = std::fopen(pFilePath, "wb");
+    if(!pFile) return VK_ERROR_INITIALIZATION_FAILED;
+    const bool success = std::fwrite(out.data(), 1, out.size(), pFile) == out.size();
+    return (std::fclose(pFile) == 0 && success)? VK_SUCCESS : VK_ERROR_INITIALIZATION_FAILED;
+}
+
+void PipelineStatisticsReport::log(DebugLog* pLog) const {
+    pLog->verbose("Pipeline Statistics Report");
+    pLog->push();
+    for(const Entry& entry : m_entries) {
+        pLog->verbose("%s", entry.pipeline.c_str());
+        pLog->push();
+        for(const PipelineExecutableStatistics& executable : entry.executables) {
+            pLog->verbose("%s [%s]", executable.name.c_str(), getStageNames(executable.stages).c_str());
+            pLog->push();
+            for(const auto& statistic : executable.statistics) {
+                std::string value;
+                appendValue(&value, statistic);
+                pLog->verbose("%-24s %s", statistic.name.c_str(), value.c_str());
+            }
+            pLog->pop();
+        }
+        pLog->pop();
+    }
+    pLog->pop();
+}
+
+}
@@ -0,0 +1,781 @@
+#include <renderer/elysian_renderer_pipeline_variant_cache.hpp>
+#include <renderer/elysian_renderer_pipeline_cache.hpp>
+#include <renderer/elysian_renderer_device.hpp>
+#include <renderer/elysian_renderer_debug_log.hpp>
+#include <renderer/elysian_renderer_hash.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <unordered_map>
+
+namespace elysian::renderer {
+
+namespace {
+
+template<typename T>
+inline bool equalPod(const T& lhs, const T& rhs) {
+    return !std::memcmp(&lhs, &rhs, sizeof(T));
+}
+
+template<typename T>
+inline bool equalPod(const std::vector<T>& lhs, const std::vector<T>& rhs) {
+    return lhs.size() == rhs.size() && (lhs.empty() || !std::memcmp(lhs.data(), rhs.data(), sizeof(T) * lhs.size()));
+}
+
+template<typename T>
+inline std::vector<T> copyArray(const T* pValues, uint32_t count) {
+    return pValues? std::vector<T>(pValues, pValues + count) : std::vector<T>();
+}
+
+}
+
+struct PipelineVariantCache::CreateInfo {
+    std::vector<VkSpecializationInfo>               specializationInfos;
+    std::vector<VkPipelineShaderStageCreateInfo>    stages;
+    VkPipelineVertexInputStateCreateInfo            vertexInput;
+    VkPipelineInputAssemblyStateCreateInfo          inputAssembly;
+    VkPipelineTessellationStateCreateInfo           tessellation;
+    VkPipelineViewportStateCreateInfo               viewport;
+    VkPipelineRasterizationStateCreateInfo          rasterization;
+    VkPipelineMultisampleStateCreateInfo            multisample;
+    VkPipelineDepthStencilStateCreateInfo           depthStencil;
+    VkPipelineColorBlendStateCreateInfo             colorBlend;
+    VkPipelineDynamicStateCreateInfo                dynamic;
+    VkGraphicsPipelineCreateInfo                    info;
+};
+
+GraphicsPipelineState::GraphicsPipelineState(void) {
+    m_inputAssembly = { VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE };
+    m_rasterization = { VK_FALSE, VK_FALSE, VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE,
+                        VK_FALSE, 0.0f, 0.0f, 0.0f, 1.0f };
+    m_multisample = { VK_SAMPLE_COUNT_1_BIT, VK_FALSE, 1.0f, VK_FALSE, VK_FALSE, VK_FALSE, { ~0u, ~0u } };
+    m_depthStencil = {};
+    m_depthStencil.depthCompareOp = VK_COMPARE_OP_ALWAYS;
+    m_depthStencil.maxDepthBounds = 1.0f;
+    m_colorBlend = { VK_FALSE, VK_LOGIC_OP_COPY, { 0.0f, 0.0f, 0.0f, 0.0f } };
+    m_target = { VK_NULL_HANDLE, VK_NULL_HANDLE, 0, 0 };
+    for(uint32_t b = 0; b < static_cast<uint32_t>(Block::Count); ++b) rehash(static_cast<Block>(b));
+}
+
+GraphicsPipelineState::GraphicsPipelineState(const VkGraphicsPipelineCreateInfo& info):
+    GraphicsPipelineState()
+{
+    for(uint32_t s = 0; s < info.stageCount; ++s) {
+        const VkPipelineShaderStageCreateInfo& stage = info.pStages[s];
+        setShaderStage(stage.stage, stage.module, stage.pName, stage.pSpecializationInfo);
+    }
+
+    if(const auto* pVertexInput = info.pVertexInputState) {
+        setVertexInput(copyArray(pVertexInput->pVertexBindingDescriptions, pVertexInput->vertexBindingDescriptionCount),
+                       copyArray(pVertexInput->pVertexAttributeDescriptions, pVertexInput->vertexAttributeDescriptionCount));
+    }
+    if(const auto* pInputAssembly = info.pInputAssemblyState)
+        setTopology(pInputAssembly->topology, pInputAssembly->primitiveRestartEnable);
+    if(const auto* pTessellation = info.pTessellationState)
+        setPatchControlPoints(pTessellation->patchControlPoints);
+
+    if(const auto* pViewport = info.pViewportState) {
+        if(pViewport->pViewports && pViewport->pScissors) {
+            setViewports(copyArray(pViewport->pViewports, pViewport->viewportCount),
+                         copyArray(pViewport->pScissors, pViewport->scissorCount));
+        } else {
+            setViewportCount(pViewport->viewportCount);
+        }
+    }
+
+    if(const auto* pRasterization = info.pRasterizationState) {
+        m_rasterization = {
+            pRasterization->depthClampEnable,
+            pRasterization->rasterizerDiscardEnable,
+            pRasterization->polygonMode,
+            pRasterization->cullMode,
+            pRasterization->frontFace,
+            VK_FALSE, 0.0f, 0.0f, 0.0f,
+            pRasterization->lineWidth
+        };
+        // through the setter so disabled bias factors don't make a separate variant
+        setDepthBias(pRasterization->depthBiasEnable,
+                     pRasterization->depthBiasConstantFactor,
+                     pRasterization->depthBiasClamp,
+                     pRasterization->depthBiasSlopeFactor);
+    }
+
+    if(const auto* pMultisample = info.pMultisampleState) {
+        setSampleCount(pMultisample->rasterizationSamples);
+        setSampleShading(pMultisample->sampleShadingEnable, pMultisample->minSampleShading);
+        setAlphaToCoverage(pMultisample->alphaToCoverageEnable, pMultisample->alphaToOneEnable);
+        if(pMultisample->pSampleMask) {
+            uint64_t mask = pMultisample->pSampleMask[0];
+            if(pMultisample->rasterizationSamples > VK_SAMPLE_COUNT_32_BIT)
+                mask |= uint64_t(pMultisample->pSampleMask[1]) << 32;
+            setSampleMask(true, mask);
+        }
+    }
+
+    if(const auto* pDepthStencil = info.pDepthStencilState) {
+        // through the setters too, ops and ranges of disabled tests must not split variants
+        if(pDepthStencil->depthTestEnable) enableDepthTest(pDepthStencil->depthWriteEnable, pDepthStencil->depthCompareOp);
+        else disableDepthTest();
+        setDepthBounds(pDepthStencil->depthBoundsTestEnable, pDepthStencil->minDepthBounds, pDepthStencil->maxDepthBounds);
+        setStencilTest(pDepthStencil->stencilTestEnable, pDepthStencil->front, pDepthStencil->back);
+    }
+
+    if(const auto* pColorBlend = info.pColorBlendState) {
+        setLogicOp(pColorBlend->logicOpEnable, pColorBlend->logicOp);
+        setBlendAttachments(copyArray(pColorBlend->pAttachments, pColorBlend->attachmentCount));
+        setBlendConstants(pColorBlend->blendConstants[0], pColorBlend->blendConstants[1],
+                          pColorBlend->blendConstants[2], pColorBlend->blendConstants[3]);
+    }
+
+    if(const auto* pDynamic = info.pDynamicState)
+        setDynamicStates(copyArray(pDynamic->pDynamicStates, pDynamic->dynamicStateCount));
+
+    setLayout(info.layout);
+    setRenderPass(info.renderPass, info.subpass);
+    // derivatives don't change what gets built, only how fast
+    setFlags(info.flags & ~(VK_PIPELINE_CREATE_DERIVATIVE_BIT | VK_PIPELINE_CREATE_ALLOW_DERIVATIVES_BIT));
+}
+
+uint64_t GraphicsPipelineState::hashBlock(Block block) const {
+    uint64_t hash = hashValue(block);
+    switch(block) {
+    case Block::Stages:
+        for(size_t s = 0; s < m_stages.size(); ++s) {
+            hash = hashValue(m_stages[s], hash);
+            hash = hashString(m_entryPoints[s].c_str(), hash);
+        }
+        return hash;
+    case Block::VertexInput:
+        hash = hashArray(m_vertexBindings.data(), m_vertexBindings.size(), hash);
+        return hashArray(m_vertexAttributes.data(), m_vertexAttributes.size(), hash);
+    case Block::InputAssembly:  return hashValue(m_inputAssembly, hash);
+    case Block::Tessellation:   return hashValue(m_patchControlPoints, hash);
+    case Block::Viewport:
+        hash = hashValue(m_viewportCount, hash);
+        hash = hashArray(m_viewports.data(), m_viewports.size(), hash);
+        return hashArray(m_scissors.data(), m_scissors.size(), hash);
+    case Block::Rasterization:  return hashValue(m_rasterization, hash);
+    case Block::Multisample:    return hashValue(m_multisample, hash);
+    case Block::DepthStencil:   return hashValue(m_depthStencil, hash);
+    case Block::ColorBlend:
+        hash = hashValue(m_colorBlend, hash);
+        return hashArray(m_blendAttachments.data(), m_blendAttachments.size(), hash);
+    case Block::Dynamic:        return hashArray(m_dynamicStates.data(), m_dynamicStates.size(), hash);
+    case Block::Target:         return hashValue(m_target, hash);
+    default:                    assert(false); return hash;
+    }
+}
+
+void GraphicsPipelineState::rehash(Block block) {
+    m_blockHashes[static_cast<size_t>(block)] = hashBlock(block);
+
+    uint64_t key = kHashSeed;
+    for(uint64_t blockHash : m_blockHashes) key = hashCombine(key, blockHash);
+    m_key = key;
+}
+
+bool GraphicsPipelineState::operator==(const GraphicsPipelineState& rhs) const {
+    if(m_stages.size() != rhs.m_stages.size()) return false;
+    for(size_t s = 0; s < m_stages.size(); ++s) {
+        if(!equalPod(m_stages[s], rhs.m_stages[s]) || m_entryPoints[s] != rhs.m_entryPoints[s]) return false;
+        if(m_stages[s].specializationHash &&
+           (!equalPod(m_specializations[s].mapEntries, rhs.m_specializations[s].mapEntries) ||
+            m_specializations[s].data != rhs.m_specializations[s].data))
+        {
+            return false;
+        }
+    }
+
+    return equalPod(m_vertexBindings, rhs.m_vertexBindings) &&
+           equalPod(m_vertexAttributes, rhs.m_vertexAttributes) &&
+           equalPod(m_inputAssembly, rhs.m_inputAssembly) &&
+           m_patchControlPoints == rhs.m_patchControlPoints &&
+           m_viewportCount == rhs.m_viewportCount &&
+           equalPod(m_viewports, rhs.m_viewports) &&
+           equalPod(m_scissors, rhs.m_scissors) &&
+           equalPod(m_rasterization, rhs.m_rasterization) &&
+           equalPod(m_multisample, rhs.m_multisample) &&
+           equalPod(m_depthStencil, rhs.m_depthStencil) &&
+           equalPod(m_colorBlend, rhs.m_colorBlend) &&
+           equalPod(m_blendAttachments, rhs.m_blendAttachments) &&
+           equalPod(m_dynamicStates, rhs.m_dynamicStates) &&
+           equalPod(m_target, rhs.m_target);
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setShaderStage(VkShaderStageFlagBits stage, VkShaderModule module, const char* pEntryPoint,
+                                                             const VkSpecializationInfo* pSpecializationInfo)
+{
+    // kept sorted by stage so the order they're set in doesn't make a different variant
+    size_t s = 0;
+    while(s < m_stages.size() && m_stages[s].stage < stage) ++s;
+    if(s == m_stages.size() || m_stages[s].stage != stage) {
+        m_stages.insert(m_stages.begin() + s, Stage{});
+        m_entryPoints.insert(m_entryPoints.begin() + s, std::string());
+        m_specializations.insert(m_specializations.begin() + s, Specialization{});
+    }
+
+    Specialization& specialization = m_specializations[s];
+    specialization.mapEntries.clear();
+    specialization.data.clear();
+    uint64_t specializationHash = 0;
+    if(pSpecializationInfo) {
+        specialization.mapEntries = copyArray(pSpecializationInfo->pMapEntries, pSpecializationInfo->mapEntryCount);
+        const auto* pData = static_cast<const uint8_t*>(pSpecializationInfo->pData);
+        specialization.data.assign(pData, pData + pSpecializationInfo->dataSize);
+        specializationHash = hashSpecializationInfo(*pSpecializationInfo);
+    }
+
+    m_stages[s] = { stage, 0, module, specializationHash };
+    m_entryPoints[s] = pEntryPoint? pEntryPoint : "main";
+    rehash(Block::Stages);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::removeShaderStage(VkShaderStageFlagBits stage) {
+    for(size_t s = 0; s < m_stages.size(); ++s) {
+        if(m_stages[s].stage == stage) {
+            m_stages.erase(m_stages.begin() + s);
+            m_entryPoints.erase(m_entryPoints.begin() + s);
+            m_specializations.erase(m_specializations.begin() + s);
+            rehash(Block::Stages);
+            break;
+        }
+    }
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setVertexInput(std::vector<VkVertexInputBindingDescription> bindings,
+                                                             std::vector<VkVertexInputAttributeDescription> attributes)
+{
+    m_vertexBindings = std::move(bindings);
+    m_vertexAttributes = std::move(attributes);
+    rehash(Block::VertexInput);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setTopology(VkPrimitiveTopology topology, bool primitiveRestartEnable) {
+    m_inputAssembly = { topology, primitiveRestartEnable };
+    rehash(Block::InputAssembly);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setPatchControlPoints(uint32_t patchControlPoints) {
+    m_patchControlPoints = patchControlPoints;
+    rehash(Block::Tessellation);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setViewportCount(uint32_t count) {
+    m_viewportCount = count;
+    m_viewports.clear();
+    m_scissors.clear();
+    rehash(Block::Viewport);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setViewports(std::vector<VkViewport> viewports, std::vector<VkRect2D> scissors) {
+    assert(viewports.size() == scissors.size());
+    m_viewportCount = static_cast<uint32_t>(viewports.size());
+    m_viewports = std::move(viewports);
+    m_scissors = std::move(scissors);
+    rehash(Block::Viewport);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setPolygonMode(VkPolygonMode polygonMode) {
+    m_rasterization.polygonMode = polygonMode;
+    rehash(Block::Rasterization);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setCullMode(VkCullModeFlags cullMode, VkFrontFace frontFace) {
+    m_rasterization.cullMode = cullMode;
+    m_rasterization.frontFace = frontFace;
+    rehash(Block::Rasterization);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setDepthClamp(bool enable) {
+    m_rasterization.depthClampEnable = enable;
+    rehash(Block::Rasterization);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setRasterizerDiscard(bool enable) {
+    m_rasterization.rasterizerDiscardEnable = enable;
+    rehash(Block::Rasterization);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setDepthBias(bool enable, float constantFactor, float clamp, float slopeFactor) {
+    m_rasterization.depthBiasEnable = enable;
+    // ignored when disabled, don't let them make a separate variant
+    m_rasterization.depthBiasConstantFactor = enable? constantFactor : 0.0f;
+    m_rasterization.depthBiasClamp = enable? clamp : 0.0f;
+    m_rasterization.depthBiasSlopeFactor = enable? slopeFactor : 0.0f;
+    rehash(Block::Rasterization);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setLineWidth(float lineWidth) {
+    m_rasterization.lineWidth = lineWidth;
+    rehash(Block::Rasterization);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setSampleCount(VkSampleCountFlagBits samples) {
+    m_multisample.rasterizationSamples = samples;
+    rehash(Block::Multisample);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setSampleShading(bool enable, float minSampleShading) {
+    m_multisample.sampleShadingEnable = enable;
+    m_multisample.minSampleShading = enable? minSampleShading : 1.0f;
+    rehash(Block::Multisample);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setAlphaToCoverage(bool alphaToCoverage, bool alphaToOne) {
+    m_multisample.alphaToCoverageEnable = alphaToCoverage;
+    m_multisample.alphaToOneEnable = alphaToOne;
+    rehash(Block::Multisample);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setSampleMask(bool enable, uint64_t sampleMask) {
+    m_multisample.sampleMaskEnable = enable;
+    m_multisample.sampleMask[0] = enable? static_cast<uint32_t>(sampleMask) : ~0u;
+    m_multisample.sampleMask[1] = enable? static_cast<uint32_t>(sampleMask >> 32) : ~0u;
+    rehash(Block::Multisample);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::enableDepthTest(bool depthWrite, VkCompareOp compareOp) {
+    m_depthStencil.depthTestEnable = VK_TRUE;
+    m_depthStencil.depthWriteEnable = depthWrite;
+    m_depthStencil.depthCompareOp = compareOp;
+    rehash(Block::DepthStencil);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::disableDepthTest(void) {
+    m_depthStencil.depthTestEnable = VK_FALSE;
+    m_depthStencil.depthWriteEnable = VK_FALSE;
+    m_depthStencil.depthCompareOp = VK_COMPARE_OP_ALWAYS;
+    rehash(Block::DepthStencil);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setDepthBounds(bool enable, float minBounds, float maxBounds) {
+    m_depthStencil.depthBoundsTestEnable = enable;
+    m_depthStencil.minDepthBounds = enable? minBounds : 0.0f;
+    m_depthStencil.maxDepthBounds = enable? maxBounds : 1.0f;
+    rehash(Block::DepthStencil);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setStencilTest(bool enable, const VkStencilOpState& front, const VkStencilOpState& back) {
+    m_depthStencil.stencilTestEnable = enable;
+    m_depthStencil.front = enable? front : VkStencilOpState{};
+    m_depthStencil.back = enable? back : VkStencilOpState{};
+    rehash(Block::DepthStencil);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setLogicOp(bool enable, VkLogicOp logicOp) {
+    m_colorBlend.logicOpEnable = enable;
+    m_colorBlend.logicOp = enable? logicOp : VK_LOGIC_OP_COPY;
+    rehash(Block::ColorBlend);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setBlendAttachments(std::vector<VkPipelineColorBlendAttachmentState> attachments) {
+    m_blendAttachments = std::move(attachments);
+    rehash(Block::ColorBlend);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setBlendAttachment(uint32_t index, const VkPipelineColorBlendAttachmentState& attachment) {
+    if(index >= m_blendAttachments.size()) m_blendAttachments.resize(index + 1, VkPipelineColorBlendAttachmentState{});
+    m_blendAttachments[index] = attachment;
+    rehash(Block::ColorBlend);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setBlendConstants(float r, float g, float b, float a) {
+    m_colorBlend.blendConstants[0] = r;
+    m_colorBlend.blendConstants[1] = g;
+    m_colorBlend.blendConstants[2] = b;
+    m_colorBlend.blendConstants[3] = a;
+    rehash(Block::ColorBlend);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setDynamicStates(std::vector<VkDynamicState> dynamicStates) {
+    // order doesn't matter to the driver, so it shouldn't to the key either
+    std::sort(dynamicStates.begin(), dynamicStates.end());
+    dynamicStates.erase(std::unique(dynamicStates.begin(), dynamicStates.end()), dynamicStates.end());
+    m_dynamicStates = std::move(dynamicStates);
+    rehash(Block::Dynamic);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setLayout(VkPipelineLayout layout) {
+    m_target.layout = layout;
+    rehash(Block::Target);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setRenderPass(VkRenderPass renderPass, uint32_t subpass) {
+    m_target.renderPass = renderPass;
+    m_target.subpass = subpass;
+    rehash(Block::Target);
+    return *this;
+}
+
+GraphicsPipelineState& GraphicsPipelineState::setFlags(VkPipelineCreateFlags flags) {
+    m_target.flags = flags;
+    rehash(Block::Target);
+    return *this;
+}
+
+PipelineVariantCache::PipelineVariantCache(Initializer initializer):
+    m_initializer(std::move(initializer))
+{
+    assert(m_initializer.pDevice);
+    uint32_t slotCount = 16;
+    while(slotCount < m_initializer.initialCapacity * 2) slotCount *= 2;
+    m_slots.assign(slotCount, Slot{ 0, kEmptySlot });
+    m_entries.reserve(m_initializer.initialCapacity);
+}
+
+PipelineVariantCache::~PipelineVariantCache(void) {
+    clear();
+}
+
+void PipelineVariantCache::clear(void) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for(const Entry& entry : m_entries)
+        vkDestroyPipeline(m_initializer.pDevice->getHandle(), entry.pipeline, m_initializer.pDevice->getAllocationCallbacks());
+    m_entries.clear();
+    std::fill(m_slots.begin(), m_slots.end(), Slot{ 0, kEmptySlot });
+}
+
+uint32_t PipelineVariantCache::findLocked(const GraphicsPipelineState& state, uint64_t key, uint64_t* pProbeCount) const {
+    const size_t mask = m_slots.size() - 1;
+    for(size_t s = key & mask; ; s = (s + 1) & mask) {
+        ++*pProbeCount;
+        const Slot& slot = m_slots[s];
+        if(slot.entry == kEmptySlot) return kEmptySlot;
+        if(slot.key == key && m_entries[slot.entry].state == state) return slot.entry;
+    }
+}
+
+void PipelineVariantCache::insertLocked(uint64_t key, uint32_t entry) {
+    const size_t mask = m_slots.size() - 1;
+    size_t s = key & mask;
+    while(m_slots[s].entry != kEmptySlot) s = (s + 1) & mask;
+    m_slots[s] = { key, entry };
+}
+
+void PipelineVariantCache::growLocked(void) {
+    m_slots.assign(m_slots.size() * 2, Slot{ 0, kEmptySlot });
+    for(uint32_t e = 0; e < m_entries.size(); ++e)
+        insertLocked(m_entries[e].state.getKey(), e);
+}
+
+Result PipelineVariantCache::getPipeline(const GraphicsPipelineState& state, VkPipeline* pPipeline) {
+    const uint64_t key = state.getKey();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_statistics.lookupCount;
+        const uint32_t entry = findLocked(state, key, &m_statistics.probeCount);
+        if(entry != kEmptySlot) {
+            ++m_statistics.hitCount;
+            *pPipeline = m_entries[entry].pipeline;
+            return VK_SUCCESS;
+        }
+    }
+
+    // compile without holding anyone else up
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    const Result result = createPipeline(state, &pipeline);
+    if(!result) {
+        *pPipeline = VK_NULL_HANDLE;
+        return result;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    *pPipeline = addLocked(state, key, pipeline);
+    return VK_SUCCESS;
+}
+
+VkPipeline PipelineVariantCache::addLocked(const GraphicsPipelineState& state, uint64_t key, VkPipeline pipeline) {
+    // somebody else may have beaten us to it
+    const uint32_t entry = findLocked(state, key, &m_statistics.probeCount);
+    if(entry != kEmptySlot) {
+        vkDestroyPipeline(m_initializer.pDevice->getHandle(), pipeline, m_initializer.pDevice->getAllocationCallbacks());
+        return m_entries[entry].pipeline;
+    }
+
+    m_entries.push_back({ state, pipeline });
+    if(m_entries.size() * 2 > m_slots.size()) growLocked();
+    else insertLocked(key, static_cast<uint32_t>(m_entries.size() - 1));
+    ++m_statistics.createCount;
+    return pipeline;
+}
+
+Result PipelineVariantCache::getPipelines(uint32_t count, const GraphicsPipelineState* pStates, VkPipeline* pPipelines, Result* pResults) {
+    std::vector<uint64_t> keys(count);
+    for(uint32_t i = 0; i < count; ++i) keys[i] = pStates[i].getKey();
+
+    std::vector<uint32_t> misses;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(uint32_t i = 0; i < count; ++i) {
+            ++m_statistics.lookupCount;
+            const uint32_t entry = findLocked(pStates[i], keys[i], &m_statistics.probeCount);
+            if(entry == kEmptySlot) {
+                misses.push_back(i);
+                continue;
+            }
+            ++m_statistics.hitCount;
+            pPipelines[i] = m_entries[entry].pipeline;
+            if(pResults) pResults[i] = VK_SUCCESS;
+        }
+    }
+    if(misses.empty()) return VK_SUCCESS;
+
+    // Variants sharing shaders and layout only differ in fixed function state, so they
+    // derive from the first of them. The derivative flags don't go into the cached state.
+    const uint32_t missCount = static_cast<uint32_t>(misses.size());
+    std::vector<CreateInfo> storage(missCount);
+    std::vector<VkGraphicsPipelineCreateInfo> infos(missCount);
+    std::unordered_map<uint64_t, int32_t> parents;
+    for(uint32_t m = 0; m < missCount; ++m) {
+        const GraphicsPipelineState& state = pStates[misses[m]];
+        fillCreateInfo(state, &storage[m]);
+        infos[m] = storage[m].info;
+        if(m_initializer.captureStatistics) infos[m].flags |= VK_PIPELINE_CREATE_CAPTURE_STATISTICS_BIT_KHR;
+
+        const uint64_t family = hashValue(state.m_target.layout, state.getBlockHash(GraphicsPipelineState::Block::Stages));
+        const auto parent = parents.emplace(family, static_cast<int32_t>(m));
+        if(!parent.second) infos[m].basePipelineIndex = parent.first->second;
+    }
+
+    std::vector<VkPipeline> pipelines(missCount, VK_NULL_HANDLE);
+    std::vector<Result> results(missCount);
+    const Result result = m_initializer.pDevice->createGraphicsPipelines(missCount, infos.data(), pipelines.data(),
+                                                                          results.data(), m_initializer.pPipelineCache);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_statistics.batchCount;
+    for(uint32_t m = 0; m < missCount; ++m) {
+        const uint32_t i = misses[m];
+        // the same state twice in one batch also ends up here, the second copy gets dropped
+        pPipelines[i] = pipelines[m]? addLocked(pStates[i], keys[i], pipelines[m]) : VK_NULL_HANDLE;
+        if(pResults) pResults[i] = results[m];
+    }
+    return result;
+}
+
+VkPipeline PipelineVariantCache::findPipeline(const GraphicsPipelineState& state) const {
+    const uint64_t key = state.getKey();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_statistics.lookupCount;
+    const uint32_t entry = findLocked(state, key, &m_statistics.probeCount);
+    if(entry == kEmptySlot) return VK_NULL_HANDLE;
+    ++m_statistics.hitCount;
+    return m_entries[entry].pipeline;
+}
+
+void PipelineVariantCache::fillCreateInfo(const GraphicsPipelineState& state, CreateInfo* pInfo) {
+    const size_t stageCount = state.m_stages.size();
+    auto& specializationInfos = pInfo->specializationInfos;
+    auto& stages = pInfo->stages;
+    specializationInfos.resize(stageCount);
+    stages.resize(stageCount);
+    for(size_t s = 0; s < stageCount; ++s) {
+        const auto& specialization = state.m_specializations[s];
+        specializationInfos[s] = {
+            static_cast<uint32_t>(specialization.mapEntries.size()),
+            specialization.mapEntries.data(),
+            specialization.data.size(),
+            specialization.data.data()
+        };
+        stages[s] = {
+            VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            nullptr,
+            0,
+            state.m_stages[s].stage,
+            state.m_stages[s].module,
+            state.m_entryPoints[s].c_str(),
+            state.m_stages[s].specializationHash? &specializationInfos[s] : nullptr
+        };
+    }
+
+    pInfo->vertexInput = VkPipelineVertexInputStateCreateInfo {
+        VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        nullptr,
+        0,
+        static_cast<uint32_t>(state.m_vertexBindings.size()),
+        state.m_vertexBindings.data(),
+        static_cast<uint32_t>(state.m_vertexAttributes.size()),
+        state.m_vertexAttributes.data()
+    };
+
+    pInfo->inputAssembly = VkPipelineInputAssemblyStateCreateInfo {
+        VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        nullptr,
+        0,
+        state.m_inputAssembly.topology,
+        state.m_inputAssembly.primitiveRestartEnable
+    };
+
+    pInfo->tessellation = VkPipelineTessellationStateCreateInfo {
+        VK_STRUCTURE_TYPE_PIPELINE_TESSELLATION_STATE_CREATE_INFO,
+        nullptr,
+        0,
+        state.m_patchControlPoints
+    };
+
+    pInfo->viewport = VkPipelineViewportStateCreateInfo {
+        VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        nullptr,
+        0,
+        state.m_viewportCount,
+        state.m_viewports.empty()? nullptr : state.m_viewports.data(),
+        state.m_viewportCount,
+        state.m_scissors.empty()? nullptr : state.m_scissors.data()
+    };
+
+    const auto& r = state.m_rasterization;
+    pInfo->rasterization = VkPipelineRasterizationStateCreateInfo {
+        VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        nullptr,
+        0,
+        r.depthClampEnable,
+        r.rasterizerDiscardEnable,
+        r.polygonMode,
+        r.cullMode,
+        r.frontFace,
+        r.depthBiasEnable,
+        r.depthBiasConstantFactor,
+        r.depthBiasClamp,
+        r.depthBiasSlopeFactor,
+        r.lineWidth
+    };
+
+    const auto& m = state.m_multisample;
+    pInfo->multisample = VkPipelineMultisampleStateCreateInfo {
+        VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        nullptr,
+        0,
+        m.rasterizationSamples,
+        m.sampleShadingEnable,
+        m.minSampleShading,
+        m.sampleMaskEnable? m.sampleMask : nullptr,
+        m.alphaToCoverageEnable,
+        m.alphaToOneEnable
+    };
+
+    const auto& d = state.m_depthStencil;
+    pInfo->depthStencil = VkPipelineDepthStencilStateCreateInfo {
+        VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        nullptr,
+        0,
+        d.depthTestEnable,
+        d.depthWriteEnable,
+        d.depthCompareOp,
+        d.depthBoundsTestEnable,
+        d.stencilTestEnable,
+        d.front,
+        d.back,
+        d.minDepthBounds,
+        d.maxDepthBounds
+    };
+
+    const auto& c = state.m_colorBlend;
+    pInfo->colorBlend = VkPipelineColorBlendStateCreateInfo {
+        VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        nullptr,
+        0,
+        c.logicOpEnable,
+        c.logicOp,
+        static_cast<uint32_t>(state.m_blendAttachments.size()),
+        state.m_blendAttachments.data(),
+        { c.blendConstants[0], c.blendConstants[1], c.blendConstants[2], c.blendConstants[3] }
+    };
+
+    pInfo->dynamic = VkPipelineDynamicStateCreateInfo {
+        VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        nullptr,
+        0,
+        static_cast<uint32_t>(state.m_dynamicStates.size()),
+        state.m_dynamicStates.data()
+    };
+
+    pInfo->info = VkGraphicsPipelineCreateInfo {
+        VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        nullptr,
+        state.m_target.flags,
+        static_cast<uint32_t>(stages.size()),
+        stages.data(),
+        &pInfo->vertexInput,
+        &pInfo->inputAssembly,
+        state.m_patchControlPoints? &pInfo->tessellation : nullptr,
+        &pInfo->viewport,
+        &pInfo->rasterization,
+        &pInfo->multisample,
+        &pInfo->depthStencil,
+        &pInfo->colorBlend,
+        state.m_dynamicStates.empty()? nullptr : &pInfo->dynamic,
+        state.m_target.layout,
+        state.m_target.renderPass,
+        state.m_target.subpass,
+        VK_NULL_HANDLE,
+        -1
+    };
+}
+
+Result PipelineVariantCache::createPipeline(const GraphicsPipelineState& state, VkPipeline* pPipeline) const {
+    CreateInfo info;
+    fillCreateInfo(state, &info);
+    if(m_initializer.captureStatistics) info.info.flags |= VK_PIPELINE_CREATE_CAPTURE_STATISTICS_BIT_KHR;
+    const VkPipelineCache cache = m_initializer.pPipelineCache? m_initializer.pPipelineCache->getHandle() : VK_NULL_HANDLE;
+    return vkCreateGraphicsPipelines(m_initializer.pDevice->getHandle(), cache, 1, &info.info,
+                                     m_initializer.pDevice->getAllocationCallbacks(), pPipeline);
+}
+
+auto PipelineVariantCache::getVariants(void) const -> std::vector<Variant> {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<Variant> variants;
+    variants.reserve(m_entries.size());
+    for(const Entry& entry : m_entries) variants.push_back({ entry.state.getKey(), entry.pipeline });
+    return variants;
+}
+
+PipelineVariantCache::Statistics PipelineVariantCache::getStatistics(void) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Statistics statistics = m_statistics;
+    statistics.variantCount = static_cast<uint32_t>(m_entries.size());
+    statistics.capacity = static_cast<uint32_t>(m_slots.size());
+    return statistics;
+}
+
+void PipelineVariantCache::log(DebugLog* pLog) const {
+    const Statistics statistics = getStatistics();
+    pLog->verbose("Pipeline Variant Cache [%s]", getName());
+    pLog->push();
+    pLog->verbose("%-16s %u in %u slots", "Variants:", statistics.variantCount, statistics.capacity);
+    pLog->verbose("%-16s %llu", "Lookups:", static_cast<unsigned long long>(statistics.lookupCount));
+    pLog->verbose("%-16s %llu", "Hits:", static_cast<unsigned long long>(statistics.hitCount));
+    pLog->verbose("%-16s %llu (%llu batches)", "Created:", static_cast<unsigned long long>(statistics.createCount),
+                  static_cast<unsigned long long>(statistics.batchCount));
+    pLog->verbose("%-16s %.2f", "Avg. probes:", statistics.lookupCount?
+                  double(statistics.probeCount) / double(statistics.lookupCount) : 0.0);
+    pLog->pop();
+}
+
+}
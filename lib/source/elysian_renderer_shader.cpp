@@ -0,0 +1,355 @@
+#include <renderer/elysian_renderer_shader.hpp>
+#include <renderer/elysian_renderer_shader_reflection.hpp>
+#include <renderer/elysian_renderer_device.hpp>
+#include <renderer/elysian_renderer_debug_log.hpp>
+#include <renderer/elysian_renderer_hash.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+namespace elysian::renderer {
+
+namespace {
+
+#ifdef _WIN32
+inline int64_t toModifiedTime(const FILETIME& time) {
+    return static_cast<int64_t>((uint64_t(time.dwHighDateTime) << 32) | time.dwLowDateTime);
+}
+#else
+inline int64_t toModifiedTime(const struct stat& info) {
+#   ifdef __APPLE__
+    return int64_t(info.st_mtimespec.tv_sec) * 1000000000 + info.st_mtimespec.tv_nsec;
+#   else
+    return int64_t(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#   endif
+}
+#endif
+
+}
+
+uint64_t ShaderBinary::computeHash(void) const {
+    return hashBytes(m_pData, m_size);
+}
+
+ShaderBinaryFile::ShaderBinaryFile(const char* pFilePath):
+    m_filePath(pFilePath)
+{
+    // an empty file can't be mapped, and isn't SPIR-V either, so both just stay unmapped
+#ifdef _WIN32
+    HANDLE hFile = CreateFileA(pFilePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(hFile == INVALID_HANDLE_VALUE) return;
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(hFile, &size) || !size.QuadPart) {
+        CloseHandle(hFile);
+        return;
+    }
+
+    HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* pView = hMapping? MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if(!pView) {
+        if(hMapping) CloseHandle(hMapping);
+        CloseHandle(hFile);
+        return;
+    }
+
+    FILETIME writeTime = {};
+    GetFileTime(hFile, nullptr, nullptr, &writeTime);
+
+    m_hFile = hFile;
+    m_hMapping = hMapping;
+    m_pData = static_cast<const uint32_t*>(pView);
+    m_size = static_cast<size_t>(size.QuadPart);
+    m_modifiedTime = toModifiedTime(writeTime);
+#else
+    const int fd = open(pFilePath, O_RDONLY | O_CLOEXEC);
+    if(fd < 0) return;
+
+    struct stat info;
+    if(fstat(fd, &info) != 0 || info.st_size <= 0) {
+        close(fd);
+        return;
+    }
+
+    void* pMapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference to the file
+    close(fd);
+    if(pMapping == MAP_FAILED) return;
+
+    m_pData = static_cast<const uint32_t*>(pMapping);
+    m_size = static_cast<size_t>(info.st_size);
+    m_modifiedTime = toModifiedTime(info);
+#endif
+}
+
+bool ShaderBinaryFile::getFileStamp(const char* pFilePath, size_t* pSize, int64_t* pModifiedTime) {
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if(!GetFileAttributesExA(pFilePath, GetFileExInfoStandard, &data)) return false;
+    *pSize = static_cast<size_t>((uint64_t(data.nFileSizeHigh) << 32) | data.nFileSizeLow);
+    *pModifiedTime = toModifiedTime(data.ftLastWriteTime);
+#else
+    struct stat info;
+    if(stat(pFilePath, &info) != 0) return false;
+    *pSize = static_cast<size_t>(info.st_size);
+    *pModifiedTime = toModifiedTime(info);
+#endif
+    return true;
+}
+
+ShaderBinaryFile::ShaderBinaryFile(ShaderBinaryFile&& rhs):
+    ShaderBinary(rhs.m_pData, rhs.m_size),
+    m_filePath(std::move(rhs.m_filePath)),
+    m_modifiedTime(rhs.m_modifiedTime)
+{
+#ifdef _WIN32
+    m_hFile = rhs.m_hFile;
+    m_hMapping = rhs.m_hMapping;
+    rhs.m_hFile = rhs.m_hMapping = nullptr;
+#endif
+    rhs.m_pData = nullptr;
+    rhs.m_size = 0;
+}
+
+ShaderBinaryFile& ShaderBinaryFile::operator=(ShaderBinaryFile&& rhs) {
+    if(this != &rhs) {
+        unmap();
+        m_pData = rhs.m_pData;
+        m_size = rhs.m_size;
+        m_filePath = std::move(rhs.m_filePath);
+        m_modifiedTime = rhs.m_modifiedTime;
+#ifdef _WIN32
+        m_hFile = rhs.m_hFile;
+        m_hMapping = rhs.m_hMapping;
+        rhs.m_hFile = rhs.m_hMapping = nullptr;
+#endif
+        rhs.m_pData = nullptr;
+        rhs.m_size = 0;
+    }
+    return *this;
+}
+
+ShaderBinaryFile::~ShaderBinaryFile(void) {
+    unmap();
+}
+
+void ShaderBinaryFile::unmap(void) {
+    if(!m_pData) return;
+#ifdef _WIN32
+    UnmapViewOfFile(m_pData);
+    CloseHandle(m_hMapping);
+    CloseHandle(m_hFile);
+    m_hFile = m_hMapping = nullptr;
+#else
+    munmap(const_cast<uint32_t*>(m_pData), m_size);
+#endif
+    m_pData = nullptr;
+    m_size = 0;
+}
+
+ShaderModule::ShaderModule(Initializer initializer):
+    m_name(std::move(initializer.name)),
+    m_pDevice(initializer.pDevice),
+    m_codeSize(initializer.binary.getSize()),
+    m_hash(initializer.hash? initializer.hash : initializer.binary.computeHash()),
+    m_pReflection(std::move(initializer.pReflection))
+{
+    assert(m_pDevice);
+    if(!initializer.binary.isValid()) {
+        m_result = VK_ERROR_INITIALIZATION_FAILED;
+        return;
+    }
+
+    const auto info = VkShaderModuleCreateInfo {
+        VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        nullptr,
+        0,
+        initializer.binary.getSize(),
+        initializer.binary.getData()
+    };
+
+    VkShaderModule module = VK_NULL_HANDLE;
+    m_result = vkCreateShaderModule(m_pDevice->getHandle(), &info, m_pDevice->getAllocationCallbacks(), &module);
+    setHandle(module);
+}
+
+ShaderModule::~ShaderModule(void) {
+    vkDestroyShaderModule(m_pDevice->getHandle(), getHandle(), m_pDevice->getAllocationCallbacks());
+}
+
+ShaderModuleCache::ShaderModuleCache(Initializer initializer):
+    m_initializer(std::move(initializer))
+{
+    assert(m_initializer.pDevice);
+}
+
+// modules still referenced outside outlive us, they destroy themselves
+ShaderModuleCache::~ShaderModuleCache(void) = default;
+
+auto ShaderModuleCache::acquireModule(const char* pFilePath, Result* pResult) -> std::shared_ptr<ShaderModule> {
+    // a stat per lookup is what it costs to notice the file changed under us
+    size_t size = 0;
+    int64_t modifiedTime = 0;
+    const bool exists = ShaderBinaryFile::getFileStamp(pFilePath, &size, &modifiedTime);
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    const auto path = m_paths.find(pFilePath);
+    if(path != m_paths.end()) {
+        const auto module = m_modules.find(path->second.hash);
+        if(exists && path->second.size == size && path->second.modifiedTime == modifiedTime && module != m_modules.end()) {
+            ++m_statistics.pathHitCount;
+            module->second.lastUse = ++m_useCounter;
+            if(pResult) *pResult = VK_SUCCESS;
+            return module->second.pModule;
+        }
+        ++m_statistics.staleCount;
+    }
+
+    // mapping and hashing is just I/O, nobody else needs to wait for it
+    lock.unlock();
+    const ShaderBinaryFile file(pFilePath);
+    if(!file.isValid()) {
+        if(pResult) *pResult = VK_ERROR_INITIALIZATION_FAILED;
+        return nullptr;
+    }
+    const uint64_t hash = file.computeHash();
+    lock.lock();
+
+    return acquireLocked(file, hash, pFilePath, pResult, &file);
+}
+
+auto ShaderModuleCache::acquireModule(const ShaderBinary& binary, const char* pName, Result* pResult) -> std::shared_ptr<ShaderModule> {
+    if(!binary.isValid()) {
+        if(pResult) *pResult = VK_ERROR_INITIALIZATION_FAILED;
+        return nullptr;
+    }
+    const uint64_t hash = binary.computeHash();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return acquireLocked(binary, hash, pName, pResult);
+}
+
+auto ShaderModuleCache::acquireLocked(const ShaderBinary& binary, uint64_t hash, const char* pName, Result* pResult,
+                                      const ShaderBinaryFile* pFile) -> std::shared_ptr<ShaderModule>
+{
+    const auto found = m_modules.find(hash);
+    if(found != m_modules.end() && matchesLocked(found->second, binary)) {
+        ++m_statistics.dedupCount;
+        found->second.lastUse = ++m_useCounter;
+        if(pFile) addPathLocked(*pFile, hash, &found->second);
+        if(pResult) *pResult = VK_SUCCESS;
+        return found->second.pModule;
+    }
+
+    // invalid SPIR-V just leaves it without one, module creation reports the failure
+    std::shared_ptr<const ShaderReflection> pReflection;
+    if(m_initializer.pReflectionCache) pReflection = m_initializer.pReflectionCache->reflect(binary, hash);
+
+    auto pModule = std::make_shared<ShaderModule>(ShaderModule::Initializer{
+        pName? pName : "",
+        m_initializer.pDevice,
+        binary,
+        std::move(pReflection),
+        hash
+    });
+    if(pResult) *pResult = pModule->getResult();
+    if(!pModule->isValid()) return nullptr;
+
+    // a 64 bit hash collision: keep serving the resident one by hash, this one just doesn't get cached
+    if(found != m_modules.end()) return pModule;
+
+    Entry& entry = m_modules.emplace(hash, Entry{ pModule, {}, {}, ++m_useCounter }).first->second;
+    if(m_initializer.keepCode) entry.code.assign(binary.getData(), binary.getData() + binary.getWordCount());
+    if(pFile) addPathLocked(*pFile, hash, &entry);
+    m_residentSize += binary.getSize();
+    ++m_statistics.createCount;
+    trimLocked(m_initializer.budget);
+    return pModule;
+}
+
+bool ShaderModuleCache::matchesLocked(const Entry& entry, const ShaderBinary& binary) const {
+    if(entry.pModule->getCodeSize() != binary.getSize()) return false;
+    return !m_initializer.keepCode || !std::memcmp(entry.code.data(), binary.getData(), binary.getSize());
+}
+
+void ShaderModuleCache::addPathLocked(const ShaderBinaryFile& file, uint64_t hash, Entry* pEntry) {
+    const auto inserted = m_paths.try_emplace(file.getFilePath());
+    PathEntry& path = inserted.first->second;
+    if(inserted.second || path.hash != hash) {
+        // the file changed into other code, its old module stops answering for it
+        if(!inserted.second) {
+            const auto old = m_modules.find(path.hash);
+            if(old != m_modules.end()) {
+                auto& paths = old->second.paths;
+                paths.erase(std::remove(paths.begin(), paths.end(), inserted.first->first), paths.end());
+            }
+        }
+        pEntry->paths.push_back(inserted.first->first);
+    }
+    path = { hash, file.getSize(), file.getModifiedTime() };
+}
+
+void ShaderModuleCache::trimLocked(size_t budget) {
+    while(m_residentSize > budget) {
+        // the caller's reference keeps a fresh module from being picked here
+        auto oldest = m_modules.end();
+        for(auto it = m_modules.begin(); it != m_modules.end(); ++it) {
+            if(it->second.pModule.use_count() != 1) continue;
+            if(oldest == m_modules.end() || it->second.lastUse < oldest->second.lastUse) oldest = it;
+        }
+        if(oldest == m_modules.end()) return; //everything's in use, over budget it is
+
+        for(const std::string& path : oldest->second.paths) m_paths.erase(path);
+        m_residentSize -= oldest->second.pModule->getCodeSize();
+        m_modules.erase(oldest);
+        ++m_statistics.evictCount;
+    }
+}
+
+void ShaderModuleCache::setBudget(size_t budget) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_initializer.budget = budget;
+    trimLocked(budget);
+}
+
+void ShaderModuleCache::reset(void) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    trimLocked(0);
+}
+
+ShaderModuleCache::Statistics ShaderModuleCache::getStatistics(void) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Statistics statistics = m_statistics;
+    statistics.moduleCount = static_cast<uint32_t>(m_modules.size());
+    statistics.residentSize = m_residentSize;
+    for(const auto& module : m_modules) {
+        if(module.second.pModule.use_count() == 1) ++statistics.unusedCount;
+    }
+    return statistics;
+}
+
+void ShaderModuleCache::log(DebugLog* pLog) const {
+    const Statistics statistics = getStatistics();
+    pLog->verbose("Shader Module Cache [%s]", getName());
+    pLog->push();
+    pLog->verbose("%-16s %u (%u unused)", "Modules:", statistics.moduleCount, statistics.unusedCount);
+    pLog->verbose("%-16s %zu / %zu bytes", "Resident:", statistics.residentSize, m_initializer.budget);
+    pLog->verbose("%-16s %llu", "Path hits:", static_cast<unsigned long long>(statistics.pathHitCount));
+    pLog->verbose("%-16s %llu", "Stale paths:", static_cast<unsigned long long>(statistics.staleCount));
+    pLog->verbose("%-16s %llu", "Deduplicated:", static_cast<unsigned long long>(statistics.dedupCount));
+    pLog->verbose("%-16s %llu", "Created:", static_cast<unsigned long long>(statistics.createCount));
+    pLog->verbose("%-16s %llu", "Evicted:", static_cast<unsigned long long>(statistics.evictCount));
+    pLog->pop();
+}
+
+}
@@ -0,0 +1,743 @@
+#include <renderer/elysian_renderer_shader_reflection.hpp>
+#include <renderer/elysian_renderer_shader.hpp>
+#include <renderer/elysian_renderer_descriptor.hpp>
+#include <renderer/elysian_renderer_device.hpp>
+#include <renderer/elysian_renderer_debug_log.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <unordered_map>
+
+namespace elysian::renderer {
+
+namespace {
+
+// just the parts of the SPIR-V grammar reflection cares about
+enum SpirvOp: uint32_t {
+    OpName                          = 5,
+    OpEntryPoint                    = 15,
+    OpExecutionMode                 = 16,
+    OpTypeBool                      = 20,
+    OpTypeInt                       = 21,
+    OpTypeFloat                     = 22,
+    OpTypeVector                    = 23,
+    OpTypeMatrix                    = 24,
+    OpTypeImage                     = 25,
+    OpTypeSampler                   = 26,
+    OpTypeSampledImage              = 27,
+    OpTypeArray                     = 28,
+    OpTypeRuntimeArray              = 29,
+    OpTypeStruct                    = 30,
+    OpTypePointer                   = 32,
+    OpConstant                      = 43,
+    OpConstantComposite             = 44,
+    OpSpecConstant                  = 50,
+    OpSpecConstantComposite         = 51,
+    OpFunction                      = 54,
+    OpVariable                      = 59,
+    OpDecorate                      = 71,
+    OpMemberDecorate                = 72,
+    OpExecutionModeId               = 331,
+    OpTypeAccelerationStructureKHR  = 5341
+};
+
+enum SpirvDecoration: uint32_t {
+    DecorationBlock         = 2,
+    DecorationBufferBlock   = 3,
+    DecorationRowMajor      = 4,
+    DecorationArrayStride   = 6,
+    DecorationMatrixStride  = 7,
+    DecorationBuiltIn       = 11,
+    DecorationBinding       = 33,
+    DecorationDescriptorSet = 34,
+    DecorationOffset        = 35
+};
+
+enum SpirvStorageClass: uint32_t {
+    StorageClassUniformConstant = 0,
+    StorageClassUniform         = 2,
+    StorageClassPushConstant    = 9,
+    StorageClassStorageBuffer   = 12
+};
+
+constexpr uint32_t kBuiltInWorkgroupSize    = 25;
+constexpr uint32_t kExecutionModeLocalSize  = 17;
+constexpr uint32_t kExecutionModeLocalSizeId = 38;
+constexpr uint32_t kDimBuffer               = 5;
+constexpr uint32_t kDimSubpassData          = 6;
+constexpr uint32_t kUnset                   = ~0u;
+constexpr uint32_t kMaxIdBound              = 1u << 22;
+constexpr uint32_t kMaxTypeDepth            = 32;
+
+VkShaderStageFlagBits getStage(uint32_t executionModel) {
+    switch(executionModel) {
+    case 0:     return VK_SHADER_STAGE_VERTEX_BIT;
+    case 1:     return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+    case 2:     return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+    case 3:     return VK_SHADER_STAGE_GEOMETRY_BIT;
+    case 4:     return VK_SHADER_STAGE_FRAGMENT_BIT;
+    case 5:     return VK_SHADER_STAGE_COMPUTE_BIT;
+    case 5267:
+    case 5364:  return VK_SHADER_STAGE_TASK_BIT_NV;
+    case 5268:
+    case 5365:  return VK_SHADER_STAGE_MESH_BIT_NV;
+    case 5313:  return VK_SHADER_STAGE_RAYGEN_BIT_KHR;
+    case 5314:  return VK_SHADER_STAGE_INTERSECTION_BIT_KHR;
+    case 5315:  return VK_SHADER_STAGE_ANY_HIT_BIT_KHR;
+    case 5316:  return VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR;
+    case 5317:  return VK_SHADER_STAGE_MISS_BIT_KHR;
+    case 5318:  return VK_SHADER_STAGE_CALLABLE_BIT_KHR;
+    default:    return static_cast<VkShaderStageFlagBits>(0);
+    }
+}
+
+const char* getDescriptorTypeName(VkDescriptorType type) {
+    switch(type) {
+    case VK_DESCRIPTOR_TYPE_SAMPLER:                    return "sampler";
+    case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:     return "combined image sampler";
+    case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:              return "sampled image";
+    case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:              return "storage image";
+    case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:       return "uniform texel buffer";
+    case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:       return "storage texel buffer";
+    case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:             return "uniform buffer";
+    case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:             return "storage buffer";
+    case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:     return "dynamic uniform buffer";
+    case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:     return "dynamic storage buffer";
+    case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:           return "input attachment";
+    case VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR: return "acceleration structure";
+    default:                                            return "unknown";
+    }
+}
+
+// Everything of interest is declared ahead of the first function body, so that's where the
+// scan stops: the bulk of a module is code and never even gets looked at. Ids are a flat
+// array indexed by id, names point straight into the words. The array stops at the word
+// count, a sparse module's ids past that go into a map instead.
+class SpirvParser {
+public:
+    SpirvParser(const uint32_t* pWords, size_t wordCount):
+        m_pWords(pWords), m_wordCount(wordCount) {}
+
+    Result parse(ShaderReflection* pReflection);
+
+private:
+    struct Id {
+        uint32_t        op          = 0;
+        uint32_t        operandCount = 0;
+        const uint32_t* pOperands   = nullptr;  //past the result (and result type) id
+        const char*     pName       = nullptr;
+        uint32_t        set         = kUnset;
+        uint32_t        binding     = kUnset;
+        uint32_t        arrayStride = 0;
+        uint32_t        block       = 0;        //DecorationBlock or DecorationBufferBlock
+        bool            workgroupSize = false;
+    };
+
+    struct Member {
+        uint32_t        structId;
+        uint32_t        index;
+        uint32_t        offset;
+        uint32_t        matrixStride;
+        bool            rowMajor;
+    };
+
+    struct Variable {
+        uint32_t        id;
+        uint32_t        pointerId;
+    };
+
+    const Id*   getId(uint32_t id) const;
+    Id*         getResult(uint32_t id);         //null past the bound
+    bool        getConstant(uint32_t id, uint32_t* pValue) const;
+    // matrixStride and rowMajor are the enclosing member's, for matrices and arrays of them
+    uint32_t    getSize(uint32_t typeId, uint32_t matrixStride, bool rowMajor, uint32_t depth=0) const;
+    uint32_t    getStructOffset(uint32_t structId) const;
+    void        addVariable(uint32_t variableId, uint32_t pointerId, ShaderReflection* pReflection) const;
+
+    static const char* readString(const uint32_t* pWords, uint32_t wordCount);
+
+    const uint32_t*         m_pWords;
+    size_t                  m_wordCount;
+    uint32_t                m_bound             = 0;
+    std::vector<Id>         m_ids;
+    std::unordered_map<uint32_t, Id> m_sparseIds;
+    std::vector<Member>     m_members;          //sorted by struct, then member, once parsed
+    std::vector<Variable>   m_variables;
+    uint32_t                m_localSizeIds[3]   = { 0, 0, 0 };
+};
+
+const char* SpirvParser::readString(const uint32_t* pWords, uint32_t wordCount) {
+    // literal strings are nul terminated and padded to whole words, but that's not a given
+    const char* pString = reinterpret_cast<const char*>(pWords);
+    return std::memchr(pString, '\0', wordCount * sizeof(uint32_t))? pString : nullptr;
+}
+
+auto SpirvParser::getId(uint32_t id) const -> const Id* {
+    const Id* pId = nullptr;
+    if(id < m_ids.size()) {
+        pId = &m_ids[id];
+    } else {
+        const auto found = m_sparseIds.find(id);
+        if(found != m_sparseIds.end()) pId = &found->second;
+    }
+    return (pId && pId->op)? pId : nullptr;
+}
+
+auto SpirvParser::getResult(uint32_t id) -> Id* {
+    if(id < m_ids.size()) return &m_ids[id];
+    return id < m_bound? &m_sparseIds[id] : nullptr;
+}
+
+bool SpirvParser::getConstant(uint32_t id, uint32_t* pValue) const {
+    // spec constants go by their default, the pipeline's specialization isn't known here
+    const Id* pId = getId(id);
+    if(!pId || (pId->op != OpConstant && pId->op != OpSpecConstant) || !pId->operandCount) return false;
+    *pValue = pId->pOperands[0];
+    return true;
+}
+
+uint32_t SpirvParser::getStructOffset(uint32_t structId) const {
+    const auto first = std::lower_bound(m_members.begin(), m_members.end(), structId,
+                                        [](const Member& member, uint32_t id) { return member.structId < id; });
+    uint32_t offset = kUnset;
+    for(auto it = first; it != m_members.end() && it->structId == structId; ++it) {
+        offset = std::min(offset, it->offset);
+    }
+    return offset == kUnset? 0 : offset;
+}
+
+// Bytes up to the end of the type as laid out by its decorations, runtime arrays count as 0.
+uint32_t SpirvParser::getSize(uint32_t typeId, uint32_t matrixStride, bool rowMajor, uint32_t depth) const {
+    const Id* pType = getId(typeId);
+    if(!pType || depth > kMaxTypeDepth) return 0;
+
+    const uint32_t* pOperands = pType->pOperands;
+    switch(pType->op) {
+    case OpTypeBool:
+        return 4;
+    case OpTypeInt:
+    case OpTypeFloat:
+        return pType->operandCount? pOperands[0] / 8 : 0;
+    case OpTypeVector:
+        return pType->operandCount >= 2? pOperands[1] * getSize(pOperands[0], 0, false, depth + 1) : 0;
+    case OpTypeMatrix: {
+        if(pType->operandCount < 2) return 0;
+        if(!matrixStride) return pOperands[1] * getSize(pOperands[0], 0, false, depth + 1);
+        // the stride steps from column to column, or from row to row when it's row major
+        const Id* pColumn = getId(pOperands[0]);
+        if(!rowMajor) return pOperands[1] * matrixStride;
+        return pColumn && pColumn->op == OpTypeVector && pColumn->operandCount >= 2? pColumn->pOperands[1] * matrixStride : 0;
+    }
+    case OpTypeArray: {
+        uint32_t length = 0;
+        if(pType->operandCount < 2 || !getConstant(pOperands[1], &length)) return 0;
+        const uint32_t stride = pType->arrayStride? pType->arrayStride : getSize(pOperands[0], matrixStride, rowMajor, depth + 1);
+        return length * stride;
+    }
+    case OpTypeStruct: {
+        const auto first = std::lower_bound(m_members.begin(), m_members.end(), typeId,
+                                            [](const Member& member, uint32_t id) { return member.structId < id; });
+        uint32_t size = 0;
+        for(auto it = first; it != m_members.end() && it->structId == typeId; ++it) {
+            if(it->index >= pType->operandCount) continue;
+            size = std::max(size, it->offset + getSize(pOperands[it->index], it->matrixStride, it->rowMajor, depth + 1));
+        }
+        return size;
+    }
+    default:
+        return 0;
+    }
+}
+
+void SpirvParser::addVariable(uint32_t variableId, uint32_t pointerId, ShaderReflection* pReflection) const {
+    const Id& variable = *getId(variableId);
+    const Id* pPointer = getId(pointerId);
+    if(!pPointer || pPointer->op != OpTypePointer || pPointer->operandCount < 2) return;
+
+    const uint32_t storageClass = pPointer->pOperands[0];
+    uint32_t typeId = pPointer->pOperands[1];
+
+    if(storageClass == StorageClassPushConstant) {
+        const Id* pBlock = getId(typeId);
+        if(!pBlock || pBlock->op != OpTypeStruct) return;
+        const uint32_t offset = getStructOffset(typeId);
+        const uint32_t end = getSize(typeId, 0, false);
+        pReflection->pushConstants.name = variable.pName? variable.pName : (pBlock->pName? pBlock->pName : "");
+        pReflection->pushConstants.offset = offset;
+        pReflection->pushConstants.size = end > offset? end - offset : 0;
+        return;
+    }
+
+    if(storageClass != StorageClassUniformConstant && storageClass != StorageClassUniform &&
+       storageClass != StorageClassStorageBuffer)
+    {
+        return;
+    }
+    if(variable.binding == kUnset) return;
+
+    // arrays of resources, a runtime sized one anywhere makes the whole count unbounded
+    uint32_t count = 1;
+    const Id* pType = getId(typeId);
+    for(uint32_t depth = 0; pType && depth < kMaxTypeDepth; ++depth) {
+        if(pType->op == OpTypeArray && pType->operandCount >= 2) {
+            uint32_t length = 0;
+            if(!getConstant(pType->pOperands[1], &length)) return;
+            count *= length;
+        } else if(pType->op == OpTypeRuntimeArray && pType->operandCount >= 1) {
+            count = 0;
+        } else {
+            break;
+        }
+        typeId = pType->pOperands[0];
+        pType = getId(typeId);
+    }
+    if(!pType) return;
+
+    ShaderReflection::Binding binding;
+    binding.set = variable.set == kUnset? 0 : variable.set;
+    binding.binding = variable.binding;
+    binding.count = count;
+    binding.blockSize = 0;
+
+    switch(pType->op) {
+    case OpTypeSampler:
+        binding.type = VK_DESCRIPTOR_TYPE_SAMPLER;
+        break;
+    case OpTypeSampledImage:
+        binding.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        break;
+    case OpTypeImage: {
+        if(pType->operandCount < 6) return;
+        const uint32_t dim = pType->pOperands[1];
+        const bool storage = pType->pOperands[5] == 2; //1 is sampled, 0 only known at runtime
+        if(dim == kDimBuffer)
+            binding.type = storage? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+        else if(dim == kDimSubpassData)
+            binding.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+        else
+            binding.type = storage? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        break;
+    }
+    case OpTypeAccelerationStructureKHR:
+        binding.type = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+        break;
+    case OpTypeStruct:
+        // pre-1.3 SPIR-V spells storage buffers as Uniform + BufferBlock
+        if(storageClass == StorageClassStorageBuffer || pType->block == DecorationBufferBlock)
+            binding.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        else
+            binding.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        binding.blockSize = getSize(typeId, 0, false);
+        break;
+    default:
+        return;
+    }
+
+    // anonymous blocks only have their type's name
+    if(variable.pName && *variable.pName) binding.name = variable.pName;
+    else if(pType->pName) binding.name = pType->pName;
+
+    pReflection->bindings.push_back(std::move(binding));
+}
+
+Result SpirvParser::parse(ShaderReflection* pReflection) {
+    if(m_wordCount < 5) return VK_ERROR_INITIALIZATION_FAILED;
+    m_bound = m_pWords[3];
+    if(!m_bound || m_bound > kMaxIdBound) return VK_ERROR_INITIALIZATION_FAILED;
+    // every id takes a word or more to define, so don't let a made up bound allocate past that
+    m_ids.resize(std::min<size_t>(m_bound, m_wordCount));
+
+    size_t offset = 5;
+    while(offset < m_wordCount) {
+        const uint32_t op = m_pWords[offset] & 0xffff;
+        const uint32_t wordCount = m_pWords[offset] >> 16;
+        if(!wordCount || offset + wordCount > m_wordCount) return VK_ERROR_INITIALIZATION_FAILED;
+        if(op == OpFunction) break;
+
+        const uint32_t* pWords = m_pWords + offset + 1;
+        const uint32_t operandCount = wordCount - 1;
+        offset += wordCount;
+
+        switch(op) {
+        case OpName:
+            if(operandCount >= 2) {
+                if(Id* pId = getResult(pWords[0])) pId->pName = readString(pWords + 1, operandCount - 1);
+            }
+            break;
+        case OpEntryPoint:
+            if(operandCount >= 3) {
+                const VkShaderStageFlagBits stage = getStage(pWords[0]);
+                const char* pName = readString(pWords + 2, operandCount - 2);
+                pReflection->entryPoints.push_back({ pName? pName : "", stage });
+                pReflection->stages |= stage;
+            }
+            break;
+        case OpExecutionMode:
+            if(operandCount >= 5 && pWords[1] == kExecutionModeLocalSize) {
+                std::copy(pWords + 2, pWords + 5, pReflection->localSize);
+            }
+            break;
+        case OpExecutionModeId:
+            if(operandCount >= 5 && pWords[1] == kExecutionModeLocalSizeId) {
+                std::copy(pWords + 2, pWords + 5, m_localSizeIds); //constants show up later
+            }
+            break;
+        case OpDecorate:
+            if(operandCount >= 2) {
+                Id* pId = getResult(pWords[0]);
+                if(!pId) break;
+                const uint32_t value = operandCount >= 3? pWords[2] : 0;
+                switch(pWords[1]) {
+                case DecorationBlock:
+                case DecorationBufferBlock:     pId->block = pWords[1]; break;
+                case DecorationArrayStride:     pId->arrayStride = value; break;
+                case DecorationBinding:         pId->binding = value; break;
+                case DecorationDescriptorSet:   pId->set = value; break;
+                case DecorationBuiltIn:         pId->workgroupSize = value == kBuiltInWorkgroupSize; break;
+                }
+            }
+            break;
+        case OpMemberDecorate:
+            if(operandCount >= 4) {
+                // one record per decoration, merged per member once they're all in
+                if(pWords[2] == DecorationOffset) m_members.push_back({ pWords[0], pWords[1], pWords[3], 0, false });
+                else if(pWords[2] == DecorationMatrixStride) m_members.push_back({ pWords[0], pWords[1], kUnset, pWords[3], false });
+            } else if(operandCount == 3 && pWords[2] == DecorationRowMajor) {
+                m_members.push_back({ pWords[0], pWords[1], kUnset, 0, true });
+            }
+            break;
+        case OpTypeBool:
+        case OpTypeInt:
+        case OpTypeFloat:
+        case OpTypeVector:
+        case OpTypeMatrix:
+        case OpTypeImage:
+        case OpTypeSampler:
+        case OpTypeSampledImage:
+        case OpTypeArray:
+        case OpTypeRuntimeArray:
+        case OpTypeStruct:
+        case OpTypePointer:
+        case OpTypeAccelerationStructureKHR:
+            if(operandCount >= 1) {
+                Id* pId = getResult(pWords[0]);
+                if(!pId) return VK_ERROR_INITIALIZATION_FAILED;
+                pId->op = op;
+                pId->pOperands = pWords + 1;
+                pId->operandCount = operandCount - 1;
+            }
+            break;
+        case OpConstant:
+        case OpConstantComposite:
+        case OpSpecConstant:
+        case OpSpecConstantComposite:
+        case OpVariable:
+            if(operandCount >= 2) {
+                Id* pId = getResult(pWords[1]);
+                if(!pId) return VK_ERROR_INITIALIZATION_FAILED;
+                pId->op = op;
+                pId->pOperands = pWords + 2;
+                pId->operandCount = operandCount - 2;
+                if(op == OpVariable) m_variables.push_back({ pWords[1], pWords[0] });
+            }
+            break;
+        }
+    }
+
+    std::sort(m_members.begin(), m_members.end(), [](const Member& lhs, const Member& rhs) {
+        return lhs.structId != rhs.structId? lhs.structId < rhs.structId : lhs.index < rhs.index;
+    });
+    size_t memberCount = 0;
+    for(const Member& member : m_members) {
+        Member* pLast = memberCount? &m_members[memberCount - 1] : nullptr;
+        if(!pLast || pLast->structId != member.structId || pLast->index != member.index) {
+            m_members[memberCount++] = member;
+            continue;
+        }
+        if(member.offset != kUnset) pLast->offset = member.offset;
+        pLast->matrixStride = std::max(pLast->matrixStride, member.matrixStride);
+        pLast->rowMajor = pLast->rowMajor || member.rowMajor;
+    }
+    m_members.resize(memberCount);
+    for(Member& member : m_members) {
+        if(member.offset == kUnset) member.offset = 0;
+    }
+
+    for(const Variable& variable : m_variables) {
+        addVariable(variable.id, variable.pointerId, pReflection);
+    }
+    std::sort(pReflection->bindings.begin(), pReflection->bindings.end(),
+              [](const ShaderReflection::Binding& lhs, const ShaderReflection::Binding& rhs) {
+        return lhs.set != rhs.set? lhs.set < rhs.set : lhs.binding < rhs.binding;
+    });
+
+    // the WorkgroupSize builtin wins over either execution mode
+    for(uint32_t c = 0; c < 3; ++c) {
+        if(m_localSizeIds[c]) getConstant(m_localSizeIds[c], &pReflection->localSize[c]);
+    }
+    const auto getWorkgroupSize = [&](const Id& id) {
+        if(!id.workgroupSize || (id.op != OpConstantComposite && id.op != OpSpecConstantComposite)) return;
+        for(uint32_t c = 0; c < 3 && c < id.operandCount; ++c) {
+            getConstant(id.pOperands[c], &pReflection->localSize[c]);
+        }
+    };
+    for(const Id& id : m_ids) getWorkgroupSize(id);
+    for(const auto& id : m_sparseIds) getWorkgroupSize(id.second);
+
+    return VK_SUCCESS;
+}
+
+// hashing all the words costs more than the parse, callers that already have it pass it in
+Result reflectBinary(const ShaderBinary& binary, uint64_t hash, ShaderReflection* pReflection) {
+    *pReflection = ShaderReflection();
+    if(!binary.isValid()) return VK_ERROR_INITIALIZATION_FAILED;
+    pReflection->hash = hash;
+    pReflection->codeSize = binary.getSize();
+
+    SpirvParser parser(binary.getData(), binary.getWordCount());
+    return parser.parse(pReflection);
+}
+
+}
+
+auto ShaderReflection::findBinding(uint32_t set, uint32_t binding) const -> const Binding* {
+    for(const Binding& entry : bindings) {
+        if(entry.set == set && entry.binding == binding) return &entry;
+    }
+    return nullptr;
+}
+
+auto ShaderReflection::findBinding(const char* pName) const -> const Binding* {
+    for(const Binding& entry : bindings) {
+        if(entry.name == pName) return &entry;
+    }
+    return nullptr;
+}
+
+Result ShaderReflection::reflect(const ShaderBinary& binary, ShaderReflection* pReflection) {
+    return reflectBinary(binary, binary.isValid()? binary.computeHash() : 0, pReflection);
+}
+
+auto PipelineReflection::findBinding(uint32_t set, uint32_t binding) -> Binding* {
+    for(Binding& entry : m_bindings) {
+        if(entry.set == set && entry.layout.binding == binding) return &entry;
+    }
+    return nullptr;
+}
+
+void PipelineReflection::add(const ShaderReflection& stage) {
+    for(const ShaderReflection::Binding& binding : stage.bindings) {
+        if(Binding* pExisting = findBinding(binding.set, binding.binding)) {
+            pExisting->layout.stageFlags |= stage.stages;
+            if(pExisting->layout.descriptorType != binding.type || pExisting->layout.descriptorCount != binding.count)
+                m_conflicts = true;
+            continue;
+        }
+
+        Binding entry;
+        entry.name = binding.name;
+        entry.set = binding.set;
+        entry.layout = VkDescriptorSetLayoutBinding {
+            binding.binding,
+            binding.type,
+            binding.count,
+            stage.stages,
+            nullptr
+        };
+        const auto position = std::upper_bound(m_bindings.begin(), m_bindings.end(), entry,
+                                               [](const Binding& lhs, const Binding& rhs) {
+            return lhs.set != rhs.set? lhs.set < rhs.set : lhs.layout.binding < rhs.layout.binding;
+        });
+        m_bindings.insert(position, std::move(entry));
+    }
+
+    // each stage may only show up in one range, stages sharing a block share a range
+    const ShaderReflection::PushConstantBlock& block = stage.pushConstants;
+    if(!block.size) return;
+    for(VkPushConstantRange& range : m_pushConstantRanges) {
+        if(range.stageFlags & stage.stages) {
+            m_conflicts = true;
+            return;
+        }
+    }
+    for(VkPushConstantRange& range : m_pushConstantRanges) {
+        if(range.offset == block.offset && range.size == block.size) {
+            range.stageFlags |= stage.stages;
+            return;
+        }
+    }
+    m_pushConstantRanges.push_back({ stage.stages, block.offset, block.size });
+}
+
+bool PipelineReflection::setDescriptorType(uint32_t set, uint32_t binding, VkDescriptorType type) {
+    Binding* pBinding = findBinding(set, binding);
+    if(pBinding) pBinding->layout.descriptorType = type;
+    return pBinding != nullptr;
+}
+
+bool PipelineReflection::setDescriptorCount(uint32_t set, uint32_t binding, uint32_t count) {
+    Binding* pBinding = findBinding(set, binding);
+    if(pBinding) pBinding->layout.descriptorCount = count;
+    return pBinding != nullptr;
+}
+
+uint32_t PipelineReflection::getSetCount(void) const {
+    return m_bindings.empty()? 0 : m_bindings.back().set + 1;
+}
+
+auto PipelineReflection::getBindings(uint32_t set) const -> std::vector<VkDescriptorSetLayoutBinding> {
+    std::vector<VkDescriptorSetLayoutBinding> bindings;
+    for(const Binding& binding : m_bindings) {
+        if(binding.set == set) bindings.push_back(binding.layout);
+    }
+    return bindings;
+}
+
+auto PipelineReflection::getSetLayoutBindings(uint32_t set) const -> std::vector<DescriptorSetLayoutBinding> {
+    std::vector<DescriptorSetLayoutBinding> bindings;
+    for(const Binding& binding : m_bindings) {
+        if(binding.set != set) continue;
+        bindings.emplace_back(binding.name.c_str(),
+                              binding.layout.binding,
+                              binding.layout.descriptorType,
+                              binding.layout.stageFlags,
+                              binding.layout.descriptorCount);
+    }
+    return bindings;
+}
+
+Result PipelineReflection::createSetLayouts(const Device* pDevice, std::vector<VkDescriptorSetLayout>* pSetLayouts,
+                                            VkDescriptorSetLayoutCreateFlags flags) const
+{
+    pSetLayouts->clear();
+    const uint32_t setCount = getSetCount();
+    pSetLayouts->reserve(setCount);
+
+    for(uint32_t set = 0; set < setCount; ++set) {
+        const std::vector<VkDescriptorSetLayoutBinding> bindings = getBindings(set);
+        const auto info = VkDescriptorSetLayoutCreateInfo {
+            VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+            nullptr,
+            flags,
+            static_cast<uint32_t>(bindings.size()),
+            bindings.data()
+        };
+
+        VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+        const Result result = vkCreateDescriptorSetLayout(pDevice->getHandle(), &info,
+                                                          pDevice->getAllocationCallbacks(), &layout);
+        if(!result) {
+            for(VkDescriptorSetLayout created : *pSetLayouts) {
+                vkDestroyDescriptorSetLayout(pDevice->getHandle(), created, pDevice->getAllocationCallbacks());
+            }
+            pSetLayouts->clear();
+            return result;
+        }
+        pSetLayouts->push_back(layout);
+    }
+
+    return VK_SUCCESS;
+}
+
+Result PipelineReflection::createPipelineLayout(const Device* pDevice, const std::vector<VkDescriptorSetLayout>& setLayouts,
+                                                VkPipelineLayout* pLayout) const
+{
+    const auto info = VkPipelineLayoutCreateInfo {
+        VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        nullptr,
+        0,
+        static_cast<uint32_t>(setLayouts.size()),
+        setLayouts.data(),
+        static_cast<uint32_t>(m_pushConstantRanges.size()),
+        m_pushConstantRanges.data()
+    };
+    return vkCreatePipelineLayout(pDevice->getHandle(), &info, pDevice->getAllocationCallbacks(), pLayout);
+}
+
+void PipelineReflection::log(DebugLog* pLog) const {
+    pLog->verbose("Pipeline Reflection%s", m_conflicts? " (conflicting stages)" : "");
+    pLog->push();
+    for(const Binding& binding : m_bindings) {
+        pLog->verbose("set %u binding %-4u %-24s [%u] stages 0x%x %s",
+                      binding.set,
+                      binding.layout.binding,
+                      getDescriptorTypeName(binding.layout.descriptorType),
+                      binding.layout.descriptorCount,
+                      binding.layout.stageFlags,
+                      binding.name.c_str());
+    }
+    for(const VkPushConstantRange& range : m_pushConstantRanges) {
+        pLog->verbose("%-16s %u bytes at %u, stages 0x%x", "Push Constants:", range.size, range.offset, range.stageFlags);
+    }
+    pLog->pop();
+}
+
+auto ShaderReflectionCache::reflect(const ShaderBinary& binary, Result* pResult) -> std::shared_ptr<const ShaderReflection> {
+    if(!binary.isValid()) {
+        if(pResult) *pResult = VK_ERROR_INITIALIZATION_FAILED;
+        return nullptr;
+    }
+    return reflect(binary, binary.computeHash(), pResult);
+}
+
+auto ShaderReflectionCache::reflect(const ShaderBinary& binary, uint64_t hash, Result* pResult)
+    -> std::shared_ptr<const ShaderReflection>
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto found = m_reflections.find(hash);
+        if(found != m_reflections.end() && found->second->codeSize == binary.getSize()) {
+            ++m_statistics.hitCount;
+            if(pResult) *pResult = VK_SUCCESS;
+            return found->second;
+        }
+    }
+
+    // parse outside the lock, loading threads reflect different modules at the same time
+    auto pReflection = std::make_shared<ShaderReflection>();
+    const Result result = reflectBinary(binary, hash, pReflection.get());
+    if(pResult) *pResult = result;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(!result) {
+        ++m_statistics.failedCount;
+        return nullptr;
+    }
+    ++m_statistics.reflectCount;
+    // somebody else may have beaten us to it, theirs is just as good
+    const auto inserted = m_reflections.try_emplace(hash, pReflection);
+    if(inserted.first->second->codeSize == binary.getSize()) return inserted.first->second;
+    // a hash collision, the resident one keeps the slot like in ShaderModuleCache
+    return pReflection;
+}
+
+auto ShaderReflectionCache::find(uint64_t hash) const -> std::shared_ptr<const ShaderReflection> {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto found = m_reflections.find(hash);
+    return found != m_reflections.end()? found->second : nullptr;
+}
+
+void ShaderReflectionCache::clear(void) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_reflections.clear();
+}
+
+ShaderReflectionCache::Statistics ShaderReflectionCache::getStatistics(void) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Statistics statistics = m_statistics;
+    statistics.entryCount = static_cast<uint32_t>(m_reflections.size());
+    return statistics;
+}
+
+void ShaderReflectionCache::log(DebugLog* pLog) const {
+    const Statistics statistics = getStatistics();
+    pLog->verbose("Shader Reflection Cache");
+    pLog->push();
+    pLog->verbose("%-16s %u", "Entries:", statistics.entryCount);
+    pLog->verbose("%-16s %llu", "Reflected:", static_cast<unsigned long long>(statistics.reflectCount));
+    pLog->verbose("%-16s %llu", "Hits:", static_cast<unsigned long long>(statistics.hitCount));
+    pLog->verbose("%-16s %llu", "Failed:", static_cast<unsigned long long>(statistics.failedCount));
+    pLog->pop();
+}
+
+}
@@ -0,0 +1,159 @@
+#include <renderer/elysian_renderer_staging_ring.hpp>
+#include <renderer/elysian_renderer_physical_device.hpp>
+#include <renderer/elysian_renderer_command.hpp>
+#include <renderer/elysian_renderer_semaphore.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace elysian::renderer {
+
+namespace {
+
+inline VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+}
+
+StagingRing::StagingRing(Initializer initializer):
+    m_initializer(std::move(initializer))
+{
+    assert(m_initializer.pDevice && m_initializer.frameCount);
+    const PhysicalDevice& physicalDevice = m_initializer.pDevice->getPhysicalDevice();
+    const VkPhysicalDeviceLimits& limits = physicalDevice.getProperties().limits;
+
+    m_alignment = std::max<VkDeviceSize>(limits.optimalBufferCopyOffsetAlignment, 16);
+    m_atomSize = std::max<VkDeviceSize>(limits.nonCoherentAtomSize, 1);
+    // keep every region flushable on its own
+    m_initializer.frameSize = alignUp(m_initializer.frameSize, std::max(m_alignment, m_atomSize));
+    m_frames.resize(m_initializer.frameCount);
+    m_frameIndex = m_initializer.frameCount - 1;
+
+    m_pBuffer = std::make_unique<Buffer>(Buffer::Initializer{
+        m_initializer.name,
+        m_initializer.pDevice,
+        BufferCreateInfo(0, m_initializer.frameSize * m_initializer.frameCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT)
+    });
+    m_result = m_pBuffer->getResult();
+    if(!m_result) return;
+
+    // coherent if we can get it, otherwise we flush in endFrame()
+    const VkMemoryRequirements requirements = m_pBuffer->getMemoryRequirements();
+    const VkPhysicalDeviceMemoryProperties& memProperties = physicalDevice.getMemoryProperties();
+    uint32_t memoryTypeIndex = ~0u;
+    for(VkMemoryPropertyFlags flags : { VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                        static_cast<VkMemoryPropertyFlags>(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) })
+    {
+        for(uint32_t t = 0; t < memProperties.memoryTypeCount && memoryTypeIndex == ~0u; ++t) {
+            if((requirements.memoryTypeBits & (1u << t)) &&
+               (memProperties.memoryTypes[t].propertyFlags & flags) == flags)
+            {
+                memoryTypeIndex = t;
+                m_coherent = memProperties.memoryTypes[t].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+            }
+        }
+    }
+
+    if(memoryTypeIndex == ~0u) {
+        m_result = VK_ERROR_FEATURE_NOT_PRESENT;
+        return;
+    }
+
+    m_pMemory = std::make_shared<DeviceMemory>(DeviceMemory::Initializer{
+        DeviceMemoryAllocateInfo(requirements.size, memoryTypeIndex),
+        m_initializer.pDevice
+    });
+    m_result = m_pMemory->getResult();
+    if(!m_result) return;
+
+    m_result = m_pBuffer->bindDeviceMemory(m_pMemory);
+    if(!m_result) return;
+
+    void* pData = nullptr;
+    m_result = m_pMemory->mapMemory(0, VK_WHOLE_SIZE, 0, &pData);
+    m_pMappedData = static_cast<char*>(pData);
+}
+
+StagingRing::~StagingRing(void) {
+    // everything still in flight has to land before the memory goes away, endFrame() only
+    // ever sees fences that were submitted
+    for(const auto& frame : m_frames) {
+        if(frame.pFence) frame.pFence->wait();
+    }
+    if(m_pMappedData) m_pMemory->unmapMemory();
+    m_pBuffer.reset();
+}
+
+Result StagingRing::beginFrame(uint64_t timeout) {
+    const uint32_t nextIndex = (m_frameIndex + 1) % m_initializer.frameCount;
+    Frame& frame = m_frames[nextIndex];
+
+    if(frame.pFence) {
+        const Result result = frame.pFence->wait(timeout);
+        if(!result) return result; //VK_TIMEOUT, leave everything as is
+        frame.pFence = nullptr;
+    }
+
+    frame.usedSize = 0;
+    m_frameIndex = nextIndex;
+    return VK_SUCCESS;
+}
+
+Result StagingRing::flush(void) {
+    const Frame& frame = m_frames[m_frameIndex];
+    if(!m_coherent && frame.usedSize) {
+        const VkDeviceSize base = m_frameIndex * m_initializer.frameSize;
+        return m_pMemory->flush(base, std::min(alignUp(frame.usedSize, m_atomSize), m_initializer.frameSize));
+    }
+    return VK_SUCCESS;
+}
+
+void StagingRing::endFrame(const Fence* pFence) {
+    m_frames[m_frameIndex].pFence = pFence;
+}
+
+StagingRing::Allocation StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+    assert(isValid());
+    Frame& frame = m_frames[m_frameIndex];
+    const VkDeviceSize offset = alignUp(frame.usedSize, alignment? alignment : m_alignment);
+    if(offset + size > m_initializer.frameSize) return {};
+
+    frame.usedSize = offset + size;
+    const VkDeviceSize bufferOffset = m_frameIndex * m_initializer.frameSize + offset;
+    return { m_pMappedData + bufferOffset, m_pBuffer->getHandle(), bufferOffset, size };
+}
+
+bool StagingRing::uploadBuffer(CommandBuffer*   pCmdBuffer,
+                               VkBuffer         dstBuffer,
+                               VkDeviceSize     dstOffset,
+                               const void*      pData,
+                               VkDeviceSize     size)
+{
+    const Allocation allocation = allocate(size);
+    if(!allocation.isValid()) return false;
+
+    std::memcpy(allocation.pData, pData, size);
+    const auto region = VkBufferCopy { allocation.offset, dstOffset, size };
+    pCmdBuffer->cmdCopyBuffer(allocation.buffer, dstBuffer, 1, &region);
+    return true;
+}
+
+bool StagingRing::uploadImage(CommandBuffer*        pCmdBuffer,
+                              VkImage               dstImage,
+                              VkImageLayout         dstImageLayout,
+                              VkBufferImageCopy     region,
+                              const void*           pData,
+                              VkDeviceSize          size,
+                              VkDeviceSize          alignment)
+{
+    const Allocation allocation = allocate(size, alignment);
+    if(!allocation.isValid()) return false;
+
+    std::memcpy(allocation.pData, pData, size);
+    region.bufferOffset = allocation.offset;
+    pCmdBuffer->cmdCopyBufferToImage(allocation.buffer, dstImage, dstImageLayout, 1, &region);
+    return true;
+}
+
+}
@@ -0,0 +1,506 @@
+#include <renderer/elysian_renderer_upload_engine.hpp>
+#include <renderer/elysian_renderer_physical_device.hpp>
+#include <renderer/elysian_renderer_command.hpp>
+#include <renderer/elysian_renderer_semaphore.hpp>
+#include <renderer/elysian_renderer_debug_log.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cinttypes>
+#include <cstring>
+
+namespace elysian::renderer {
+
+UploadEngine::UploadEngine(Initializer initializer):
+    m_initializer(std::move(initializer)),
+    m_pQueue(m_initializer.pQueue)
+{
+    assert(m_initializer.pDevice && m_initializer.batchCount);
+    const Device* pDevice = m_initializer.pDevice;
+
+    if(!m_pQueue) m_pQueue = findTransferQueue(pDevice);
+    if(!m_pQueue) {
+        m_result = VK_ERROR_FEATURE_NOT_PRESENT;
+        return;
+    }
+
+    const VkQueueFlags flags = pDevice->getPhysicalDevice().getQueueFamilyProperties()[getQueueFamilyIndex()].queueFlags;
+    m_transferOnly = !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT));
+
+    m_pRing = std::make_unique<StagingRing>(StagingRing::Initializer{
+        m_initializer.name + " Staging",
+        pDevice,
+        m_initializer.batchCount,
+        m_initializer.batchSize
+    });
+    m_result = m_pRing->getResult();
+    if(!m_result) return;
+
+    const auto poolInfo = CommandPoolCreateInfo(getQueueFamilyIndex(), VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+    m_pCommandPool = std::make_unique<CommandPool>(pDevice, &poolInfo);
+    m_result = m_pCommandPool->getResult();
+    if(!m_result) return;
+
+    m_pCommandGroup.reset(m_pCommandPool->createGroup(VK_COMMAND_BUFFER_LEVEL_PRIMARY, m_initializer.batchCount));
+    m_result = m_pCommandGroup->getResult();
+    if(!m_result) return;
+
+    if(m_initializer.timelineSemaphore) {
+        m_pTimeline = std::make_unique<Semaphore>(Semaphore::Initializer{
+            std::make_shared<Semaphore::CreateInfo>(VK_SEMAPHORE_TYPE_TIMELINE, 0),
+            pDevice
+        });
+        m_result = m_pTimeline->getResult();
+        if(!m_result) return;
+    }
+
+    m_batches.resize(m_initializer.batchCount);
+    for(uint32_t b = 0; b < m_initializer.batchCount; ++b) {
+        m_batches[b].pFence = std::make_unique<Fence>(Fence::Initializer{
+            std::make_shared<Fence::CreateInfo>(0),
+            pDevice
+        });
+        m_batches[b].pCmdBuffer = m_pCommandGroup->getBuffer(b);
+        m_result = m_batches[b].pFence->getResult();
+        if(!m_result) return;
+    }
+
+    // open the first region
+    m_result = m_pRing->beginFrame();
+}
+
+UploadEngine::~UploadEngine(void) {
+    for(auto& batch : m_batches) {
+        if(batch.value) batch.pFence->wait();
+    }
+    // ring keeps pointers to our fences
+    m_pRing.reset();
+}
+
+uint32_t UploadEngine::getQueueFamilyIndex(void) const {
+    return m_pQueue->getQueueGroup().getFamilyIndex();
+}
+
+UploadEngine::Statistics UploadEngine::getStatistics(void) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_statistics;
+}
+
+const Queue* UploadEngine::findTransferQueue(const Device* pDevice) {
+    const auto& families = pDevice->getPhysicalDevice().getQueueFamilyProperties();
+    const Queue* pFallback = nullptr;
+
+    for(const auto& group : pDevice->getQueueGroups()) {
+        if(group.getQueues().empty()) continue;
+        const VkQueueFlags flags = families[group.getFamilyIndex()].queueFlags;
+
+        // dedicated DMA engine
+        if((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+            return &group.getQueues()[0];
+        }
+        // graphics and compute families implicitly support transfers
+        if(!pFallback) pFallback = &group.getQueues()[0];
+    }
+    return pFallback;
+}
+
+// requests which don't name their consumer go to the engine-wide one
+uint32_t UploadEngine::getDstQueueFamilyIndex(uint32_t requested) const {
+    return requested != VK_QUEUE_FAMILY_IGNORED? requested : m_initializer.dstQueueFamilyIndex;
+}
+
+Result UploadEngine::getSubmitResult(void) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_submitResult;
+}
+
+StagingRing::Allocation UploadEngine::reserve(std::unique_lock<std::mutex>& lock, VkDeviceSize size, VkDeviceSize alignment) {
+    if(!isValid() || !size || size > m_pRing->getFrameSize()) return {};
+
+    // no region to write into while a flush waits for the next one to retire
+    m_flushReady.wait(lock, [&]{ return !m_opening; });
+
+    StagingRing::Allocation allocation = m_pRing->allocate(size, alignment);
+    if(!allocation.isValid()) {
+        // batch is full, kick it off and go again in a fresh region
+        flushLocked(lock);
+        allocation = m_pRing->allocate(size, alignment);
+    }
+    if(allocation.isValid()) ++m_writers;
+    return allocation;
+}
+
+void UploadEngine::release(void) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(!--m_writers) m_flushReady.notify_all();
+}
+
+UploadEngine::Token UploadEngine::upload(const BufferUpload& request) {
+    const uint32_t dstQueueFamilyIndex = getDstQueueFamilyIndex(request.dstQueueFamilyIndex);
+    assert(!m_transferOnly || dstQueueFamilyIndex != VK_QUEUE_FAMILY_IGNORED);
+    if(m_transferOnly && dstQueueFamilyIndex == VK_QUEUE_FAMILY_IGNORED) return {};
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const StagingRing::Allocation allocation = reserve(lock, request.size, 0);
+    if(!allocation.isValid()) return {};
+
+    m_pendingBuffers.push_back({
+        request.buffer,
+        { allocation.offset, request.offset, request.size },
+        dstQueueFamilyIndex
+    });
+    const Token token = { m_submittedValue + 1 };
+    lock.unlock();
+
+    std::memcpy(allocation.pData, request.pData, request.size);
+    release();
+    return token;
+}
+
+UploadEngine::Token UploadEngine::upload(const ImageUpload& request) {
+    const uint32_t dstQueueFamilyIndex = getDstQueueFamilyIndex(request.dstQueueFamilyIndex);
+    assert(!m_transferOnly || dstQueueFamilyIndex != VK_QUEUE_FAMILY_IGNORED);
+    if(m_transferOnly && dstQueueFamilyIndex == VK_QUEUE_FAMILY_IGNORED) return {};
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const StagingRing::Allocation allocation = reserve(lock, request.size, request.alignment);
+    if(!allocation.isValid()) return {};
+
+    VkBufferImageCopy copy = request.region;
+    copy.bufferOffset = allocation.offset;
+    m_pendingImages.push_back({
+        request.image,
+        copy,
+        request.size,
+        request.finalLayout,
+        dstQueueFamilyIndex
+    });
+    const Token token = { m_submittedValue + 1 };
+    lock.unlock();
+
+    std::memcpy(allocation.pData, request.pData, request.size);
+    release();
+    return token;
+}
+
+UploadEngine::Token UploadEngine::flush(void) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return flushLocked(lock);
+}
+
+UploadEngine::Token UploadEngine::flushLocked(std::unique_lock<std::mutex>& lock) {
+    if(m_pendingBuffers.empty() && m_pendingImages.empty()) return { m_submittedValue };
+
+    // Whoever reserved staging space has to be done copying into it, and another flush
+    // may still be opening the next region.
+    m_flushReady.wait(lock, [&]{ return !m_writers && !m_opening; });
+    if(m_pendingBuffers.empty() && m_pendingImages.empty()) return { m_submittedValue };
+
+    Batch& batch = m_batches[m_pRing->getFrameIndex()];
+    const uint64_t value = m_submittedValue + 1;
+
+    // on failure everything stays queued in the still open region, nothing half-recorded sticks
+    std::vector<Acquire> acquires;
+    Result result = m_pRing->flush();
+    if(result) result = recordAndSubmit(batch, value, &acquires);
+    m_submitResult = result;
+    if(!result) return {};
+
+    for(const auto& pending : m_pendingBuffers) m_statistics.bytesUploaded += pending.copy.size;
+    for(const auto& pending : m_pendingImages) m_statistics.bytesUploaded += pending.size;
+    m_statistics.bufferCopyCount += m_pendingBuffers.size();
+    m_statistics.imageCopyCount += m_pendingImages.size();
+    ++m_statistics.batchCount;
+    m_acquires.insert(m_acquires.end(), acquires.begin(), acquires.end());
+    m_pendingBuffers.clear();
+    m_pendingImages.clear();
+
+    batch.value = value;
+    m_submittedValue = value;
+
+    m_pRing->endFrame(batch.pFence.get());
+    nextBatch(lock);
+    return { value };
+}
+
+void UploadEngine::nextBatch(std::unique_lock<std::mutex>& lock) {
+    const uint32_t nextIndex = (m_pRing->getFrameIndex() + 1) % m_pRing->getFrameCount();
+    Batch& next = m_batches[nextIndex];
+
+    // The region just submitted is off limits until the next one is open: reserve() and
+    // flushLocked() hold off on m_opening, while wait(), isComplete() etc. keep going
+    // because the GPU wait happens without the lock.
+    m_opening = true;
+    if(next.value && next.pFence->getStatus().getCode() != VK_SUCCESS) {
+        lock.unlock();
+        next.pFence->wait();
+        lock.lock();
+    }
+
+    // signaled by now so beginFrame() doesn't block, but wait() callers on the fence have
+    // to be gone before it gets reset
+    m_flushReady.wait(lock, [&]{ return !next.waiters; });
+    m_pRing->beginFrame();
+    if(next.value) {
+        next.pFence->reset();
+        m_completedValue = std::max(m_completedValue, next.value);
+        next.value = 0;
+    }
+    m_opening = false;
+    m_flushReady.notify_all();
+}
+
+Result UploadEngine::recordAndSubmit(Batch& batch, uint64_t value, std::vector<Acquire>* pAcquires) {
+    CommandBuffer* pCmdBuffer = batch.pCmdBuffer;
+    const uint32_t familyIndex = getQueueFamilyIndex();
+    const VkBuffer stagingBuffer = m_pRing->getBuffer()->getHandle();
+
+    Result result = pCmdBuffer->reset(0);
+    if(!result) return result;
+
+    const auto beginInfo = VkCommandBufferBeginInfo {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        nullptr,
+        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        nullptr
+    };
+    result = pCmdBuffer->begin(beginInfo);
+    if(!result) return result;
+
+    auto subresourceRange = [](const VkImageSubresourceLayers& layers) {
+        return VkImageSubresourceRange {
+            layers.aspectMask,
+            layers.mipLevel,
+            1,
+            layers.baseArrayLayer,
+            layers.layerCount
+        };
+    };
+
+    // images have to be in TRANSFER_DST before anything lands in them
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+    imageBarriers.reserve(m_pendingImages.size());
+    for(const auto& pending : m_pendingImages) {
+        imageBarriers.push_back({
+            VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            nullptr,
+            0,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED,
+            pending.image,
+            subresourceRange(pending.copy.imageSubresource)
+        });
+    }
+    if(!imageBarriers.empty()) {
+        pCmdBuffer->cmdPipelineBarrier(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                       0,
+                                       0, nullptr,
+                                       0, nullptr,
+                                       static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+    }
+
+    // coalesce everything going into the same buffer into one multi-region copy
+    std::stable_sort(m_pendingBuffers.begin(), m_pendingBuffers.end(), [](const PendingBuffer& lhs, const PendingBuffer& rhs) {
+        return lhs.buffer < rhs.buffer;
+    });
+    std::vector<VkBufferCopy> regions;
+    for(size_t b = 0; b < m_pendingBuffers.size(); ) {
+        regions.clear();
+        const VkBuffer dstBuffer = m_pendingBuffers[b].buffer;
+        for(; b < m_pendingBuffers.size() && m_pendingBuffers[b].buffer == dstBuffer; ++b) {
+            regions.push_back(m_pendingBuffers[b].copy);
+        }
+        pCmdBuffer->cmdCopyBuffer(stagingBuffer, dstBuffer, static_cast<uint32_t>(regions.size()), regions.data());
+    }
+
+    for(const auto& pending : m_pendingImages) {
+        pCmdBuffer->cmdCopyBufferToImage(stagingBuffer, pending.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &pending.copy);
+    }
+
+    // release to the consuming family, the acquire half gets recorded by cmdAcquire()
+    auto isTransfer = [&](uint32_t dstFamilyIndex) {
+        return dstFamilyIndex != VK_QUEUE_FAMILY_IGNORED && dstFamilyIndex != familyIndex;
+    };
+
+    std::vector<VkBufferMemoryBarrier> bufferBarriers;
+    for(const auto& pending : m_pendingBuffers) {
+        if(!isTransfer(pending.dstQueueFamilyIndex)) continue;
+
+        VkBufferMemoryBarrier barrier = {
+            VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            nullptr,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            0,
+            familyIndex,
+            pending.dstQueueFamilyIndex,
+            pending.buffer,
+            pending.copy.dstOffset,
+            pending.copy.size
+        };
+        bufferBarriers.push_back(barrier);
+
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+        pAcquires->push_back({ pending.dstQueueFamilyIndex, value, false, barrier, {} });
+    }
+
+    imageBarriers.clear();
+    for(const auto& pending : m_pendingImages) {
+        const bool transfer = isTransfer(pending.dstQueueFamilyIndex);
+        VkImageMemoryBarrier barrier = {
+            VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            nullptr,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            0,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            pending.finalLayout,
+            transfer? familyIndex : VK_QUEUE_FAMILY_IGNORED,
+            transfer? pending.dstQueueFamilyIndex : VK_QUEUE_FAMILY_IGNORED,
+            pending.image,
+            subresourceRange(pending.copy.imageSubresource)
+        };
+        // same family: just transition here, the semaphore wait takes care of visibility
+        imageBarriers.push_back(barrier);
+
+        if(transfer) {
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+            pAcquires->push_back({ pending.dstQueueFamilyIndex, value, true, {}, barrier });
+        }
+    }
+
+    if(!bufferBarriers.empty() || !imageBarriers.empty()) {
+        pCmdBuffer->cmdPipelineBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                       VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                       0,
+                                       0, nullptr,
+                                       static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+                                       static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+    }
+
+    result = pCmdBuffer->end();
+    if(!result) return result;
+
+    const VkCommandBuffer cmdBuffer = pCmdBuffer->getHandle();
+    const VkSemaphore timeline = m_pTimeline? m_pTimeline->getHandle() : VK_NULL_HANDLE;
+    const auto timelineInfo = VkTimelineSemaphoreSubmitInfo {
+        VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        nullptr,
+        0,
+        nullptr,
+        1,
+        &value
+    };
+    const auto submitInfo = VkSubmitInfo {
+        VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        m_pTimeline? &timelineInfo : nullptr,
+        0,
+        nullptr,
+        nullptr,
+        1,
+        &cmdBuffer,
+        m_pTimeline? 1u : 0u,
+        m_pTimeline? &timeline : nullptr
+    };
+    return m_pQueue->submit(1, &submitInfo, batch.pFence->getHandle());
+}
+
+bool UploadEngine::isCompleteLocked(uint64_t value) const {
+    if(value <= m_completedValue) return true;
+    if(value > m_submittedValue) return false;
+
+    if(m_pTimeline) {
+        uint64_t counter = 0;
+        return m_pTimeline->getCounterValue(&counter) && counter >= value;
+    }
+
+    for(const auto& batch : m_batches) {
+        if(batch.value == value) return batch.pFence->getStatus().getCode() == VK_SUCCESS;
+    }
+    // its batch got recycled, which only happens once its fence signaled
+    return true;
+}
+
+bool UploadEngine::isComplete(Token token) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return isCompleteLocked(token.value);
+}
+
+Result UploadEngine::wait(Token token, uint64_t timeout) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if(token.value > m_submittedValue && !flushLocked(lock).isValid()) return m_submitResult;
+    if(isCompleteLocked(token.value)) return VK_SUCCESS;
+
+    if(m_pTimeline) {
+        lock.unlock();
+        return m_pTimeline->wait(token.value, timeout);
+    }
+
+    // Fence mode waits unlocked too, the waiter count keeps flushLocked() from recycling
+    // the batch and resetting its fence underneath us.
+    for(auto& batch : m_batches) {
+        if(batch.value != token.value) continue;
+
+        ++batch.waiters;
+        lock.unlock();
+        const Result result = batch.pFence->wait(timeout);
+        lock.lock();
+        if(!--batch.waiters) m_flushReady.notify_all();
+        return result;
+    }
+    return VK_SUCCESS;
+}
+
+UploadEngine::Token UploadEngine::cmdAcquire(CommandBuffer*         pCmdBuffer,
+                                             uint32_t               queueFamilyIndex,
+                                             VkPipelineStageFlags   dstStageMask)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    flushLocked(lock);
+
+    Token token;
+    std::vector<VkBufferMemoryBarrier> bufferBarriers;
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+
+    auto it = std::remove_if(m_acquires.begin(), m_acquires.end(), [&](const Acquire& acquire) {
+        if(acquire.queueFamilyIndex != queueFamilyIndex) return false;
+        if(acquire.isImage) imageBarriers.push_back(acquire.imageBarrier);
+        else bufferBarriers.push_back(acquire.bufferBarrier);
+        token.value = std::max(token.value, acquire.value);
+        return true;
+    });
+    m_acquires.erase(it, m_acquires.end());
+
+    if(token.isValid()) {
+        pCmdBuffer->cmdPipelineBarrier(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                       dstStageMask,
+                                       0,
+                                       0, nullptr,
+                                       static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+                                       static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+    }
+    return token;
+}
+
+void UploadEngine::log(DebugLog* pLog) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    pLog->verbose("Upload Engine: %s", getName());
+    pLog->push();
+    if(!isValid()) {
+        pLog->error("Invalid: %s", getResult().toString());
+    } else {
+        pLog->verbose("Queue Family: %u (%s)", getQueueFamilyIndex(), m_pTimeline? "timeline semaphore" : "fence");
+        pLog->verbose("Batches: %" PRIu64 " submitted, %" PRIu64 " completed", m_submittedValue, m_completedValue);
+        if(!m_submitResult) pLog->error("Last submission failed: %s", m_submitResult.toString());
+        pLog->verbose("Copies: %" PRIu64 " buffer, %" PRIu64 " image", m_statistics.bufferCopyCount, m_statistics.imageCopyCount);
+        pLog->verbose("Uploaded: %" PRIu64 " KB", m_statistics.bytesUploaded / 1024);
+        pLog->verbose("Pending copies: %zu buffer, %zu image", m_pendingBuffers.size(), m_pendingImages.size());
+        pLog->verbose("Pending acquires: %zu", m_acquires.size());
+    }
+    pLog->pop();
+}
+
+}
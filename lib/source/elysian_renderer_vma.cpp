@@ -0,0 +1,239 @@
+#define VMA_IMPLEMENTATION
+#include <vk_mem_alloc.h>
+
+#include <renderer/elysian_renderer_vma.hpp>
+#include <renderer/elysian_renderer_instance.hpp>
+#include <renderer/elysian_renderer_device.hpp>
+#include <renderer/elysian_renderer_physical_device.hpp>
+#include <renderer/elysian_renderer_debug_log.hpp>
+#include <cassert>
+#include <cinttypes>
+
+namespace elysian::renderer {
+
+namespace {
+
+VmaAllocationCreateInfo toVmaCreateInfo(const VmaBackend::AllocationCreateInfo& info, bool dedicated) {
+    VmaAllocationCreateInfo vmaInfo = {};
+    vmaInfo.requiredFlags = info.requiredFlags;
+    vmaInfo.priority = info.priority;
+
+    switch(info.usage) {
+    case VmaBackend::MemoryUsage::GpuOnly:
+        vmaInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+        break;
+    case VmaBackend::MemoryUsage::Upload:
+        vmaInfo.usage = VMA_MEMORY_USAGE_AUTO;
+        vmaInfo.flags |= VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+        break;
+    case VmaBackend::MemoryUsage::Readback:
+        vmaInfo.usage = VMA_MEMORY_USAGE_AUTO;
+        vmaInfo.flags |= VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT;
+        break;
+    case VmaBackend::MemoryUsage::Auto:
+        vmaInfo.usage = VMA_MEMORY_USAGE_AUTO;
+        break;
+    }
+
+    if(info.persistentlyMapped) {
+        // mapping needs host access, default to write-combined if the usage didn't pick one
+        if(!(vmaInfo.flags & (VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                              VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT)))
+        {
+            vmaInfo.flags |= VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+        }
+        vmaInfo.flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    }
+
+    if(dedicated)           vmaInfo.flags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+    if(info.withinBudget)   vmaInfo.flags |= VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT;
+
+    return vmaInfo;
+}
+
+}
+
+VmaBackend::VmaBackend(Initializer initializer):
+    m_initializer(std::move(initializer))
+{
+    assert(m_initializer.pInstance && m_initializer.pDevice);
+
+    VmaAllocatorCreateInfo info = {};
+    info.instance = m_initializer.pInstance->getHandle();
+    info.physicalDevice = m_initializer.pDevice->getPhysicalDevice().getHandle();
+    info.device = m_initializer.pDevice->getHandle();
+    info.vulkanApiVersion = m_initializer.apiVersion;
+    info.preferredLargeHeapBlockSize = m_initializer.preferredBlockSize;
+    info.pAllocationCallbacks = m_initializer.pDevice->getAllocationCallbacks();
+
+    if(m_initializer.memoryBudget)          info.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    if(m_initializer.bufferDeviceAddress)   info.flags |= VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+
+    VmaAllocator allocator = VK_NULL_HANDLE;
+    m_result = vmaCreateAllocator(&info, &allocator);
+    m_pAllocator = allocator;
+}
+
+VmaBackend::~VmaBackend(void) {
+    if(m_pAllocator) vmaDestroyAllocator(m_pAllocator);
+}
+
+// VMA already goes dedicated when the driver asks for it through VK_KHR_dedicated_allocation,
+// on top of that we keep render targets and huge buffers out of the shared blocks.
+bool VmaBackend::shouldUseDedicated(VkDeviceSize size, bool renderTarget, const AllocationCreateInfo& allocInfo) const {
+    return allocInfo.dedicated || renderTarget ||
+            (m_initializer.dedicatedThreshold && size >= m_initializer.dedicatedThreshold);
+}
+
+Result VmaBackend::finishAllocation(Result result, Allocation* pAllocation) const {
+    if(result) {
+        VmaAllocationInfo info;
+        vmaGetAllocationInfo(m_pAllocator, pAllocation->pHandle, &info);
+        pAllocation->memory = info.deviceMemory;
+        pAllocation->offset = info.offset;
+        pAllocation->size = info.size;
+        pAllocation->memoryTypeIndex = info.memoryType;
+        pAllocation->pMappedData = info.pMappedData;
+    } else {
+        *pAllocation = Allocation{};
+    }
+    return result;
+}
+
+Result VmaBackend::createBuffer(const VkBufferCreateInfo&   bufferInfo,
+                                const AllocationCreateInfo& allocInfo,
+                                VkBuffer*                   pBuffer,
+                                Allocation*                 pAllocation) const
+{
+    assert(pBuffer && pAllocation);
+    const bool dedicated = shouldUseDedicated(bufferInfo.size, false, allocInfo);
+    const VmaAllocationCreateInfo vmaInfo = toVmaCreateInfo(allocInfo, dedicated);
+
+    VmaAllocation allocation = VK_NULL_HANDLE;
+    const Result result = vmaCreateBuffer(m_pAllocator, &bufferInfo, &vmaInfo, pBuffer, &allocation, nullptr);
+    pAllocation->pHandle = allocation;
+    pAllocation->dedicated = dedicated;
+    return finishAllocation(result, pAllocation);
+}
+
+void VmaBackend::destroyBuffer(VkBuffer buffer, Allocation& allocation) const {
+    vmaDestroyBuffer(m_pAllocator, buffer, allocation.pHandle);
+    allocation = Allocation{};
+}
+
+Result VmaBackend::createImage(const VkImageCreateInfo&     imageInfo,
+                               const AllocationCreateInfo&  allocInfo,
+                               VkImage*                     pImage,
+                               Allocation*                  pAllocation) const
+{
+    assert(pImage && pAllocation);
+    const bool renderTarget = imageInfo.usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                                                 VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+    const VkDevice device = m_initializer.pDevice->getHandle();
+    const VkAllocationCallbacks* pCallbacks = m_initializer.pDevice->getAllocationCallbacks();
+
+    // unlike buffers the size isn't known up front, create the image first so the threshold
+    // can go by its memory requirements, then allocate and bind like vmaCreateImage() would
+    VkImage image = VK_NULL_HANDLE;
+    Result result = vkCreateImage(device, &imageInfo, pCallbacks, &image);
+    if(!result) {
+        *pImage = VK_NULL_HANDLE;
+        return finishAllocation(result, pAllocation);
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(device, image, &requirements);
+    const bool dedicated = shouldUseDedicated(requirements.size, renderTarget, allocInfo);
+    const VmaAllocationCreateInfo vmaInfo = toVmaCreateInfo(allocInfo, dedicated);
+
+    VmaAllocation allocation = VK_NULL_HANDLE;
+    result = vmaAllocateMemoryForImage(m_pAllocator, image, &vmaInfo, &allocation, nullptr);
+    if(result) {
+        result = vmaBindImageMemory(m_pAllocator, allocation, image);
+        if(!result) {
+            vmaFreeMemory(m_pAllocator, allocation);
+            allocation = VK_NULL_HANDLE;
+        }
+    }
+    if(!result) {
+        vkDestroyImage(device, image, pCallbacks);
+        image = VK_NULL_HANDLE;
+    }
+
+    *pImage = image;
+    pAllocation->pHandle = allocation;
+    pAllocation->dedicated = dedicated;
+    return finishAllocation(result, pAllocation);
+}
+
+void VmaBackend::destroyImage(VkImage image, Allocation& allocation) const {
+    vmaDestroyImage(m_pAllocator, image, allocation.pHandle);
+    allocation = Allocation{};
+}
+
+Result VmaBackend::mapMemory(const Allocation& allocation, void** ppData) const {
+    if(allocation.pMappedData) {
+        *ppData = allocation.pMappedData;
+        return VK_SUCCESS;
+    }
+    return vmaMapMemory(m_pAllocator, allocation.pHandle, ppData);
+}
+
+void VmaBackend::unmapMemory(const Allocation& allocation) const {
+    if(!allocation.pMappedData) vmaUnmapMemory(m_pAllocator, allocation.pHandle);
+}
+
+Result VmaBackend::flush(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) const {
+    return vmaFlushAllocation(m_pAllocator, allocation.pHandle, offset, size);
+}
+
+Result VmaBackend::invalidate(const Allocation& allocation, VkDeviceSize offset, VkDeviceSize size) const {
+    return vmaInvalidateAllocation(m_pAllocator, allocation.pHandle, offset, size);
+}
+
+std::vector<VmaBackend::Budget> VmaBackend::getBudgets(void) const {
+    const VkPhysicalDeviceMemoryProperties* pProperties = nullptr;
+    vmaGetMemoryProperties(m_pAllocator, &pProperties);
+
+    std::vector<VmaBudget> vmaBudgets(pProperties->memoryHeapCount);
+    vmaGetHeapBudgets(m_pAllocator, vmaBudgets.data());
+
+    std::vector<Budget> budgets;
+    budgets.reserve(vmaBudgets.size());
+    for(const auto& vmaBudget : vmaBudgets) {
+        budgets.push_back({
+            vmaBudget.statistics.blockBytes,
+            vmaBudget.statistics.allocationBytes,
+            vmaBudget.usage,
+            vmaBudget.budget,
+            vmaBudget.statistics.blockCount,
+            vmaBudget.statistics.allocationCount
+        });
+    }
+    return budgets;
+}
+
+void VmaBackend::setCurrentFrameIndex(uint32_t frameIndex) const {
+    vmaSetCurrentFrameIndex(m_pAllocator, frameIndex);
+}
+
+void VmaBackend::log(DebugLog* pLog) const {
+    pLog->verbose("VMA Backend");
+    pLog->push();
+    if(!isValid()) {
+        pLog->error("Failed to create allocator: %s", getResult().toString());
+    } else {
+        const auto budgets = getBudgets();
+        for(uint32_t h = 0; h < budgets.size(); ++h) {
+            pLog->verbose("Heap[%u]", h);
+            pLog->push();
+            pLog->verbose("blocks: %u (%" PRIu64 " bytes)", budgets[h].blockCount, budgets[h].blockBytes);
+            pLog->verbose("allocations: %u (%" PRIu64 " bytes)", budgets[h].allocationCount, budgets[h].allocationBytes);
+            pLog->verbose("usage: %" PRIu64 " MB / budget: %" PRIu64 " MB", budgets[h].usage / 1024 / 1024, budgets[h].budget / 1024 / 1024);
+            pLog->pop();
+        }
+    }
+    pLog->pop();
+}
+
+}
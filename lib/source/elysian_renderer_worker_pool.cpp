@@ -0,0 +1,89 @@
+#include <renderer/elysian_renderer_worker_pool.hpp>
+#include <algorithm>
+#include <atomic>
+
+namespace elysian::renderer {
+
+WorkerPool::WorkerPool(uint32_t threadCount) {
+    m_threads.reserve(threadCount);
+    for(uint32_t t = 0; t < threadCount; ++t) {
+        m_threads.emplace_back([this]{ run(); });
+    }
+}
+
+WorkerPool::~WorkerPool(void) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wakeUp.notify_all();
+    for(auto& thread : m_threads) thread.join();
+}
+
+void WorkerPool::enqueue(std::function<void(void)> task) {
+    if(m_threads.empty()) {
+        task();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+    m_wakeUp.notify_one();
+}
+
+void WorkerPool::run(void) {
+    for(;;) {
+        std::function<void(void)> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeUp.wait(lock, [&]{ return m_stopping || !m_tasks.empty(); });
+            // drain whatever is left before going away
+            if(m_tasks.empty()) return;
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void WorkerPool::parallelFor(uint32_t count, const std::function<void(uint32_t)>& fn) {
+    if(!count) return;
+
+    struct State {
+        std::atomic<uint32_t>       next    = { 0 };
+        std::atomic<uint32_t>       done    = { 0 };
+        uint32_t                    count   = 0;
+        const std::function<void(uint32_t)>* pFn = nullptr;
+        std::mutex                  mutex;
+        std::condition_variable     finished;
+    };
+
+    // helpers can start after we've returned, they only ever touch the shared state
+    auto pState = std::make_shared<State>();
+    pState->count = count;
+    pState->pFn = &fn;
+
+    auto work = [](State* pState) {
+        uint32_t index;
+        while((index = pState->next.fetch_add(1, std::memory_order_relaxed)) < pState->count) {
+            (*pState->pFn)(index);
+            if(pState->done.fetch_add(1, std::memory_order_acq_rel) + 1 == pState->count) {
+                std::lock_guard<std::mutex> lock(pState->mutex);
+                pState->finished.notify_all();
+            }
+        }
+    };
+
+    const uint32_t helperCount = std::min<uint32_t>(count - 1, getThreadCount());
+    for(uint32_t h = 0; h < helperCount; ++h) {
+        enqueue([pState, work]{ work(pState.get()); });
+    }
+
+    work(pState.get());
+
+    std::unique_lock<std::mutex> lock(pState->mutex);
+    pState->finished.wait(lock, [&]{ return pState->done.load(std::memory_order_acquire) == count; });
+}
+
+}
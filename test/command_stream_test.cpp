@@ -0,0 +1,237 @@
+#include <QtTest>
+#include <renderer/elysian_renderer_command_stream.hpp>
+#include <cstring>
+#include <vector>
+
+using namespace elysian::renderer;
+
+namespace {
+
+// works for both pointer and uint64_t non-dispatchable handles
+template<typename T>
+T fakeHandle(uintptr_t value) { return (T)value; }
+
+// everything the counting table saw, in order
+struct Calls {
+    VkCommandBuffer                 cmd = VK_NULL_HANDLE;
+    std::vector<CommandStream::Op>  ops;
+    std::vector<VkPipeline>         pipelines;
+    std::vector<VkBuffer>           vertexBuffers;
+    std::vector<VkDeviceSize>       vertexOffsets;
+    std::vector<VkDescriptorSet>    sets;
+    std::vector<uint32_t>           dynamicOffsets;
+    std::vector<uint8_t>            pushConstants;
+    std::vector<VkViewport>         viewports;
+    uint32_t                        clearValueCount = 0;
+    uint32_t                        vertexCount     = 0;
+};
+
+Calls calls;
+
+void record(VkCommandBuffer cmd, CommandStream::Op op) {
+    QCOMPARE(cmd, calls.cmd);
+    calls.ops.push_back(op);
+}
+
+VKAPI_ATTR void VKAPI_CALL bindPipeline(VkCommandBuffer cmd, VkPipelineBindPoint, VkPipeline pipeline) {
+    record(cmd, CommandStream::Op::BindPipeline);
+    calls.pipelines.push_back(pipeline);
+}
+
+VKAPI_ATTR void VKAPI_CALL bindVertexBuffers(VkCommandBuffer cmd, uint32_t, uint32_t bindingCount, const VkBuffer* pBuffers, const VkDeviceSize* pOffsets) {
+    record(cmd, CommandStream::Op::BindVertexBuffers);
+    calls.vertexBuffers.insert(calls.vertexBuffers.end(), pBuffers, pBuffers + bindingCount);
+    calls.vertexOffsets.insert(calls.vertexOffsets.end(), pOffsets, pOffsets + bindingCount);
+}
+
+VKAPI_ATTR void VKAPI_CALL bindDescriptorSets(VkCommandBuffer cmd, VkPipelineBindPoint, VkPipelineLayout, uint32_t,
+                                              uint32_t setCount, const VkDescriptorSet* pSets,
+                                              uint32_t dynamicOffsetCount, const uint32_t* pDynamicOffsets) {
+    record(cmd, CommandStream::Op::BindDescriptorSets);
+    calls.sets.insert(calls.sets.end(), pSets, pSets + setCount);
+    calls.dynamicOffsets.insert(calls.dynamicOffsets.end(), pDynamicOffsets, pDynamicOffsets + dynamicOffsetCount);
+}
+
+VKAPI_ATTR void VKAPI_CALL pushConstants(VkCommandBuffer cmd, VkPipelineLayout, VkShaderStageFlags, uint32_t, uint32_t size, const void* pValues) {
+    record(cmd, CommandStream::Op::PushConstants);
+    const auto* pBytes = static_cast<const uint8_t*>(pValues);
+    calls.pushConstants.insert(calls.pushConstants.end(), pBytes, pBytes + size);
+}
+
+VKAPI_ATTR void VKAPI_CALL setViewport(VkCommandBuffer cmd, uint32_t, uint32_t viewportCount, const VkViewport* pViewports) {
+    record(cmd, CommandStream::Op::SetViewport);
+    calls.viewports.insert(calls.viewports.end(), pViewports, pViewports + viewportCount);
+}
+
+VKAPI_ATTR void VKAPI_CALL draw(VkCommandBuffer cmd, uint32_t vertexCount, uint32_t, uint32_t, uint32_t) {
+    record(cmd, CommandStream::Op::Draw);
+    calls.vertexCount += vertexCount;
+}
+
+VKAPI_ATTR void VKAPI_CALL beginRenderPass(VkCommandBuffer cmd, const VkRenderPassBeginInfo* pInfo, VkSubpassContents) {
+    record(cmd, CommandStream::Op::BeginRenderPass);
+    calls.clearValueCount = pInfo->clearValueCount;
+}
+
+VKAPI_ATTR void VKAPI_CALL endRenderPass(VkCommandBuffer cmd) {
+    record(cmd, CommandStream::Op::EndRenderPass);
+}
+
+CommandStream::DispatchTable countingTable(void) {
+    CommandStream::DispatchTable table;
+    table.pfnBindPipeline       = bindPipeline;
+    table.pfnBindVertexBuffers  = bindVertexBuffers;
+    table.pfnBindDescriptorSets = bindDescriptorSets;
+    table.pfnPushConstants      = pushConstants;
+    table.pfnSetViewport        = setViewport;
+    table.pfnDraw               = draw;
+    table.pfnBeginRenderPass    = beginRenderPass;
+    table.pfnEndRenderPass      = endRenderPass;
+    return table;
+}
+
+}
+
+// Records into a CommandStream and replays it through a DispatchTable of counting
+// functions, nothing in here touches Vulkan.
+class CommandStreamTest: public QObject {
+    Q_OBJECT
+
+private slots:
+    void init(void);
+    void replayOrder(void);
+    void arraysAreCopied(void);
+    void redundantBindsKept(void);
+    void nullEntriesSkipped(void);
+    void clear(void);
+};
+
+void CommandStreamTest::init(void) {
+    calls = {};
+    calls.cmd = fakeHandle<VkCommandBuffer>(0x1000);
+}
+
+void CommandStreamTest::replayOrder(void) {
+    CommandStream stream;
+    const VkClearValue clearValues[2] = {};
+    const auto beginInfo = VkRenderPassBeginInfo {
+        VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+        nullptr,
+        fakeHandle<VkRenderPass>(0x10),
+        fakeHandle<VkFramebuffer>(0x20),
+        { { 0, 0 }, { 64, 64 } },
+        2,
+        clearValues
+    };
+
+    stream.cmdBeginRenderPass(beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    stream.cmdBindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, fakeHandle<VkPipeline>(0x30));
+    stream.cmdDraw(3, 1, 0, 0);
+    stream.cmdDraw(6, 1, 0, 0);
+    stream.cmdEndRenderPass();
+
+    QCOMPARE(stream.getStatistics().packetCount, 5u);
+    QCOMPARE(stream.getStatistics().byteSize % 8, size_t(0));
+
+    stream.replay(calls.cmd, countingTable());
+    const std::vector<CommandStream::Op> expected = {
+        CommandStream::Op::BeginRenderPass,
+        CommandStream::Op::BindPipeline,
+        CommandStream::Op::Draw,
+        CommandStream::Op::Draw,
+        CommandStream::Op::EndRenderPass
+    };
+    QVERIFY(calls.ops == expected);
+    QCOMPARE(calls.clearValueCount, 2u);
+    QCOMPARE(calls.vertexCount, 9u);
+}
+
+void CommandStreamTest::arraysAreCopied(void) {
+    CommandStream stream;
+
+    // everything passed by pointer gets overwritten right after recording
+    VkBuffer buffers[2] = { fakeHandle<VkBuffer>(0x1), fakeHandle<VkBuffer>(0x2) };
+    VkDeviceSize offsets[2] = { 16, 32 };
+    VkDescriptorSet sets[1] = { fakeHandle<VkDescriptorSet>(0x3) };
+    uint32_t dynamicOffsets[2] = { 256, 512 };
+    uint8_t constants[12] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+    VkViewport viewport = { 0.0f, 0.0f, 64.0f, 32.0f, 0.0f, 1.0f };
+
+    stream.cmdBindVertexBuffers(0, 2, buffers, offsets);
+    stream.cmdBindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, fakeHandle<VkPipelineLayout>(0x4), 0, 1, sets, 2, dynamicOffsets);
+    stream.cmdPushConstants(fakeHandle<VkPipelineLayout>(0x4), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), constants);
+    stream.cmdSetViewport(0, 1, &viewport);
+
+    std::memset(buffers, 0, sizeof(buffers));
+    std::memset(offsets, 0, sizeof(offsets));
+    std::memset(sets, 0, sizeof(sets));
+    std::memset(dynamicOffsets, 0, sizeof(dynamicOffsets));
+    std::memset(constants, 0, sizeof(constants));
+    viewport = {};
+
+    stream.replay(calls.cmd, countingTable());
+    QCOMPARE(calls.vertexBuffers.size(), size_t(2));
+    QCOMPARE(calls.vertexBuffers[1], fakeHandle<VkBuffer>(0x2));
+    QCOMPARE(calls.vertexOffsets[0], VkDeviceSize(16));
+    QCOMPARE(calls.vertexOffsets[1], VkDeviceSize(32));
+    QCOMPARE(calls.sets.size(), size_t(1));
+    QCOMPARE(calls.sets[0], fakeHandle<VkDescriptorSet>(0x3));
+    QCOMPARE(calls.dynamicOffsets.size(), size_t(2));
+    QCOMPARE(calls.dynamicOffsets[1], 512u);
+    QCOMPARE(calls.pushConstants.size(), size_t(12));
+    QCOMPARE(calls.pushConstants[11], uint8_t(12));
+    QCOMPARE(calls.viewports.size(), size_t(1));
+    QCOMPARE(calls.viewports[0].height, 32.0f);
+
+    // the packet accessors see the same thing
+    uint32_t visited = 0;
+    stream.forEach([&](const CommandStream::Packet& packet) {
+        if(packet.getOp() != CommandStream::Op::BindVertexBuffers) return;
+        QCOMPARE(packet.getPayload<CommandStream::BindVertexBuffers>()->bindingCount, 2u);
+        QCOMPARE(packet.getArray<VkDeviceSize>(1)[1], VkDeviceSize(32));
+        ++visited;
+    });
+    QCOMPARE(visited, 1u);
+}
+
+void CommandStreamTest::redundantBindsKept(void) {
+    CommandStream stream;
+    const VkPipeline pipeline = fakeHandle<VkPipeline>(0x30);
+
+    // eliding is up to the CommandBuffer's shadow state at replay, the raw path forwards everything
+    stream.cmdBindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    stream.cmdBindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    QCOMPARE(stream.getStatistics().packetCount, 2u);
+
+    stream.replay(calls.cmd, countingTable());
+    QCOMPARE(calls.pipelines.size(), size_t(2));
+}
+
+void CommandStreamTest::nullEntriesSkipped(void) {
+    CommandStream stream;
+    stream.cmdDispatch(1, 1, 1);
+    stream.cmdDraw(3, 1, 0, 0);
+
+    CommandStream::DispatchTable table;
+    table.pfnDraw = draw;
+    stream.replay(calls.cmd, table);
+    QCOMPARE(calls.ops.size(), size_t(1));
+    QCOMPARE(calls.vertexCount, 3u);
+}
+
+void CommandStreamTest::clear(void) {
+    CommandStream stream;
+    stream.cmdDraw(3, 1, 0, 0);
+    QVERIFY(!stream.isEmpty());
+
+    stream.clear();
+    QVERIFY(stream.isEmpty());
+    QCOMPARE(stream.getStatistics().packetCount, 0u);
+
+    stream.replay(calls.cmd, countingTable());
+    QVERIFY(calls.ops.empty());
+}
+
+QTEST_APPLESS_MAIN(CommandStreamTest)
+
+#include "command_stream_test.moc"
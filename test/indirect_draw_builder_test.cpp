@@ -0,0 +1,381 @@
+#include <QtTest>
+#include <renderer/elysian_renderer.hpp>
+#include <renderer/elysian_renderer_instance.hpp>
+#include <renderer/elysian_renderer_physical_device.hpp>
+#include <renderer/elysian_renderer_device.hpp>
+#include <renderer/elysian_renderer_debug_log.hpp>
+#include <renderer/elysian_renderer_command.hpp>
+#include <renderer/elysian_renderer_semaphore.hpp>
+#include <renderer/elysian_renderer_queue.hpp>
+#include <renderer/elysian_renderer_memory.hpp>
+#include <renderer/elysian_renderer_indirect_draw_builder.hpp>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+using namespace elysian::renderer;
+
+namespace {
+
+class QuietLog: public DebugLog {
+public:
+    virtual void push(void) override {}
+    virtual void pop(void) override {}
+    virtual void write(Source, Severity severity, va_list args, const char* pFormat) override {
+        if(severity == Severity::Error) qWarning("%s", qPrintable(QString::vasprintf(pFormat, args)));
+    }
+};
+
+bool operator==(const VkDrawIndexedIndirectCommand& lhs, const VkDrawIndexedIndirectCommand& rhs) {
+    return std::memcmp(&lhs, &rhs, sizeof(lhs)) == 0;
+}
+
+// void main() {}, nothing but a vertex invocation for the statistics query to count
+const uint32_t emptyVertexShader[] = {
+    0x07230203, 0x00010000, 0, 5, 0,
+    0x00020011, 1,                                  //OpCapability Shader
+    0x0003000E, 0, 1,                               //OpMemoryModel Logical GLSL450
+    0x0005000F, 0, 1, 0x6E69616D, 0,                //OpEntryPoint Vertex %1 "main"
+    0x00020013, 2,                                  //%2 = OpTypeVoid
+    0x00030021, 3, 2,                               //%3 = OpTypeFunction %2
+    0x00050036, 2, 1, 0, 3,                         //%1 = OpFunction %2 None %3
+    0x000200F8, 4,                                  //OpLabel
+    0x000100FD,                                     //OpReturn
+    0x00010038                                      //OpFunctionEnd
+};
+
+}
+
+// Layout of the batches IndirectDrawBuilder writes and the draws they turn into.
+// Needs a Vulkan device (lavapipe does), skips itself without one.
+class IndirectDrawBuilderTest: public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase(void);
+    void cleanupTestCase(void);
+    void cpuBatches(void);
+    void culledBatch(void);
+    void frameRegions(void);
+    void drawSubmission(void);
+
+private:
+    auto createBuilder(uint32_t frameCount=2, VkDeviceSize frameSize=4096) const -> std::unique_ptr<IndirectDrawBuilder>;
+
+    QuietLog                    m_log;
+    std::unique_ptr<Renderer>   m_pRenderer;
+    Device*                     m_pDevice           = nullptr;
+    uint32_t                    m_queueFamilyIndex  = 0;
+    VkPhysicalDeviceFeatures    m_features          = {};
+};
+
+void IndirectDrawBuilderTest::initTestCase(void) {
+    const InstanceInitializer instanceInitializer = { InstanceCreateInfo(), nullptr };
+    Renderer::Initializer initializer = { &m_log, nullptr, &instanceInitializer };
+    m_pRenderer = std::make_unique<Renderer>(&initializer);
+
+    const PhysicalDevice* pPhysicalDevice = m_pRenderer->isValid()? m_pRenderer->getPhysicalDevice(0) : nullptr;
+    if(!pPhysicalDevice) QSKIP("no Vulkan device");
+
+    const auto& families = pPhysicalDevice->getQueueFamilyProperties();
+    const auto it = std::find_if(families.begin(), families.end(), [](const VkQueueFamilyProperties& family) {
+        return family.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+    });
+    if(it == families.end()) QSKIP("no graphics queue family");
+    m_queueFamilyIndex = static_cast<uint32_t>(it - families.begin());
+
+    // only what drawSubmission() needs to count the vertices it drew
+    m_features.pipelineStatisticsQuery = pPhysicalDevice->getFeatures().pipelineStatisticsQuery;
+
+    auto pCreateInfo = std::make_shared<DeviceCreateInfo>();
+    pCreateInfo->queueGroupInfo.push_back({
+        QueueGroupProperties("Graphics", m_queueFamilyIndex),
+        0,
+        { QueueProperties("Graphics0", 1.0f) }
+    });
+    pCreateInfo->pFeatures = &m_features;
+    m_pDevice = m_pRenderer->createDevice("IndirectDrawBuilderTest", pPhysicalDevice, std::move(pCreateInfo));
+    if(!m_pDevice->getResult()) QSKIP("device creation failed");
+}
+
+void IndirectDrawBuilderTest::cleanupTestCase(void) {
+    m_pRenderer.reset();
+}
+
+auto IndirectDrawBuilderTest::createBuilder(uint32_t frameCount, VkDeviceSize frameSize) const -> std::unique_ptr<IndirectDrawBuilder> {
+    IndirectDrawBuilder::Initializer initializer;
+    initializer.name = "IndirectDrawBuilderTest";
+    initializer.pDevice = m_pDevice;
+    initializer.frameCount = frameCount;
+    initializer.frameSize = frameSize;
+    return std::make_unique<IndirectDrawBuilder>(std::move(initializer));
+}
+
+void IndirectDrawBuilderTest::cpuBatches(void) {
+    auto pBuilder = createBuilder();
+    QVERIFY(pBuilder->isValid());
+    QVERIFY(pBuilder->beginFrame());
+
+    const VkDrawIndexedIndirectCommand commands[] = {
+        { 3, 1, 0, 0, 0 },
+        { 6, 2, 3, 1, 7 },
+        { 9, 1, 0, -4, 2 }
+    };
+
+    const auto first = pBuilder->add(commands, 2);
+    QVERIFY(first.isValid());
+    QVERIFY(!first.culled);
+    QCOMPARE(first.buffer, pBuilder->getBuffer()->getHandle());
+    QCOMPARE(first.drawCount, 2u);
+    QVERIFY(first.pCommands[0] == commands[0]);
+    QVERIFY(first.pCommands[1] == commands[1]);
+
+    // packed back to back at the command stride
+    const auto second = pBuilder->add(commands + 2, 1);
+    QVERIFY(second.isValid());
+    QCOMPARE(second.offset, first.offset + 2 * sizeof(VkDrawIndexedIndirectCommand));
+    QCOMPARE(static_cast<void*>(second.pCommands), static_cast<void*>(first.pCommands + 2));
+    QVERIFY(second.pCommands[0] == commands[2]);
+
+    const VkDescriptorBufferInfo info = pBuilder->getCommandBufferInfo(first);
+    QCOMPARE(info.buffer, first.buffer);
+    QCOMPARE(info.offset, first.offset);
+    QCOMPARE(info.range, VkDeviceSize(2 * sizeof(VkDrawIndexedIndirectCommand)));
+
+    const auto& statistics = pBuilder->getStatistics();
+    QCOMPARE(statistics.batchCount, 2u);
+    QCOMPARE(statistics.commandCount, 3u);
+    QCOMPARE(statistics.usedSize, VkDeviceSize(3 * sizeof(VkDrawIndexedIndirectCommand)));
+
+    // more than the region holds
+    const uint32_t tooMany = static_cast<uint32_t>(pBuilder->getFrameSize() / sizeof(VkDrawIndexedIndirectCommand));
+    QVERIFY(!pBuilder->allocate(tooMany).isValid());
+    QCOMPARE(pBuilder->getStatistics().batchCount, 2u);
+}
+
+void IndirectDrawBuilderTest::culledBatch(void) {
+    auto pBuilder = createBuilder();
+    QVERIFY(pBuilder->isValid());
+    QVERIFY(pBuilder->beginFrame());
+
+    const VkDeviceSize alignment = std::max<VkDeviceSize>(
+                m_pDevice->getPhysicalDevice().getProperties().limits.minStorageBufferOffsetAlignment, 4);
+
+    // leave the region misaligned so the culled batch has to realign
+    const VkDrawIndexedIndirectCommand command = { 1, 1, 0, 0, 0 };
+    QVERIFY(pBuilder->add(&command, 1).isValid());
+
+    auto batch = pBuilder->allocateCulled(4);
+    QVERIFY(batch.isValid());
+    QVERIFY(batch.culled);
+    QCOMPARE(batch.drawCount, 4u);
+    QCOMPARE(batch.countOffset % alignment, VkDeviceSize(0));
+    QCOMPARE(batch.offset % alignment, VkDeviceSize(0));
+    QVERIFY(batch.offset > batch.countOffset);
+
+    const VkDescriptorBufferInfo countInfo = pBuilder->getCountBufferInfo(batch);
+    QCOMPARE(countInfo.buffer, batch.buffer);
+    QCOMPARE(countInfo.offset, batch.countOffset);
+    QCOMPARE(countInfo.range, VkDeviceSize(sizeof(uint32_t)));
+
+    // count and every slot start out empty, so whatever the GPU skips draws nothing
+    const auto* pCount = reinterpret_cast<const uint32_t*>(
+                reinterpret_cast<const char*>(batch.pCommands) - (batch.offset - batch.countOffset));
+    QCOMPARE(*pCount, 0u);
+    const VkDrawIndexedIndirectCommand empty = {};
+    for(uint32_t i = 0; i < batch.drawCount; ++i) QVERIFY(batch.pCommands[i] == empty);
+
+    QCOMPARE(pBuilder->getStatistics().batchCount, 2u);
+    QCOMPARE(pBuilder->getStatistics().commandCount, 5u);
+}
+
+void IndirectDrawBuilderTest::frameRegions(void) {
+    auto pBuilder = createBuilder(3);
+    QVERIFY(pBuilder->isValid());
+
+    const VkDrawIndexedIndirectCommand command = { 3, 1, 0, 0, 0 };
+    for(uint32_t frame = 0; frame < 4; ++frame) {
+        QVERIFY(pBuilder->beginFrame());
+        QCOMPARE(pBuilder->getFrameIndex(), frame % 3);
+        QCOMPARE(pBuilder->getStatistics().batchCount, 0u);
+
+        const auto batch = pBuilder->add(&command, 1);
+        QVERIFY(batch.isValid());
+        QCOMPARE(batch.offset, pBuilder->getFrameIndex() * pBuilder->getFrameSize());
+
+        QVERIFY(pBuilder->flush());
+        pBuilder->endFrame(nullptr); //never submitted, nothing to wait on
+    }
+}
+
+void IndirectDrawBuilderTest::drawSubmission(void) {
+    if(!m_features.pipelineStatisticsQuery) QSKIP("no pipelineStatisticsQuery");
+    const VkDevice device = m_pDevice->getHandle();
+
+    const auto pipelineInfo = VkPipelineLayoutCreateInfo {
+        VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO, nullptr, 0, 0, nullptr, 0, nullptr
+    };
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    QCOMPARE(vkCreatePipelineLayout(device, &pipelineInfo, nullptr, &layout), VK_SUCCESS);
+
+    const auto subpass = VkSubpassDescription {
+        0, VK_PIPELINE_BIND_POINT_GRAPHICS, 0, nullptr, 0, nullptr, nullptr, nullptr, 0, nullptr
+    };
+    const auto renderPassInfo = VkRenderPassCreateInfo {
+        VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO, nullptr, 0, 0, nullptr, 1, &subpass, 0, nullptr
+    };
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    QCOMPARE(vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass), VK_SUCCESS);
+
+    const auto framebufferInfo = VkFramebufferCreateInfo {
+        VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO, nullptr, 0, renderPass, 0, nullptr, 1, 1, 1
+    };
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    QCOMPARE(vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffer), VK_SUCCESS);
+
+    const auto moduleInfo = VkShaderModuleCreateInfo {
+        VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO, nullptr, 0, sizeof(emptyVertexShader), emptyVertexShader
+    };
+    VkShaderModule module = VK_NULL_HANDLE;
+    QCOMPARE(vkCreateShaderModule(device, &moduleInfo, nullptr, &module), VK_SUCCESS);
+
+    // rasterizer discard: only the vertex stage runs, no attachments or viewport needed
+    const auto stage = VkPipelineShaderStageCreateInfo {
+        VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0, VK_SHADER_STAGE_VERTEX_BIT, module, "main", nullptr
+    };
+    const auto vertexInput = VkPipelineVertexInputStateCreateInfo {
+        VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO, nullptr, 0, 0, nullptr, 0, nullptr
+    };
+    const auto inputAssembly = VkPipelineInputAssemblyStateCreateInfo {
+        VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO, nullptr, 0, VK_PRIMITIVE_TOPOLOGY_POINT_LIST, VK_FALSE
+    };
+    const auto rasterization = VkPipelineRasterizationStateCreateInfo {
+        VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO, nullptr, 0,
+        VK_FALSE, VK_TRUE, VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE,
+        VK_FALSE, 0.0f, 0.0f, 0.0f, 1.0f
+    };
+    const auto graphicsInfo = VkGraphicsPipelineCreateInfo {
+        VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO, nullptr, 0,
+        1, &stage, &vertexInput, &inputAssembly, nullptr, nullptr, &rasterization,
+        nullptr, nullptr, nullptr, nullptr,
+        layout, renderPass, 0, VK_NULL_HANDLE, -1
+    };
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    QCOMPARE(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &graphicsInfo, nullptr, &pipeline), VK_SUCCESS);
+
+    const auto queryInfo = VkQueryPoolCreateInfo {
+        VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO, nullptr, 0, VK_QUERY_TYPE_PIPELINE_STATISTICS, 1,
+        VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT
+    };
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    QCOMPARE(vkCreateQueryPool(device, &queryInfo, nullptr, &queryPool), VK_SUCCESS);
+
+    // every index points at vertex 0, the shader doesn't read it anyway
+    Buffer indexBuffer(Buffer::Initializer{
+        "IndirectDrawBuilderTest Indices",
+        m_pDevice,
+        BufferCreateInfo(0, 16 * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT)
+    });
+    QVERIFY(indexBuffer.getResult());
+
+    const VkMemoryRequirements requirements = indexBuffer.getMemoryRequirements();
+    const VkPhysicalDeviceMemoryProperties& memProperties = m_pDevice->getPhysicalDevice().getMemoryProperties();
+    const VkMemoryPropertyFlags hostFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    uint32_t memoryTypeIndex = 0;
+    while(memoryTypeIndex < memProperties.memoryTypeCount &&
+          !((requirements.memoryTypeBits & (1u << memoryTypeIndex)) &&
+            (memProperties.memoryTypes[memoryTypeIndex].propertyFlags & hostFlags) == hostFlags))
+    {
+        ++memoryTypeIndex;
+    }
+    QVERIFY(memoryTypeIndex < memProperties.memoryTypeCount);
+
+    auto pIndexMemory = std::make_shared<DeviceMemory>(DeviceMemory::Initializer{
+        DeviceMemoryAllocateInfo(requirements.size, memoryTypeIndex),
+        m_pDevice
+    });
+    QVERIFY(pIndexMemory->getResult());
+    QVERIFY(indexBuffer.bindDeviceMemory(pIndexMemory));
+
+    void* pIndices = nullptr;
+    QVERIFY(pIndexMemory->mapMemory(0, VK_WHOLE_SIZE, 0, &pIndices));
+    std::memset(pIndices, 0, 16 * sizeof(uint32_t));
+    pIndexMemory->unmapMemory();
+
+    // 3 + 5 * 2 vertices from the CPU batch, 4 from the culled one, its second slot stays empty
+    auto pBuilder = createBuilder();
+    QVERIFY(pBuilder->isValid());
+    QVERIFY(pBuilder->beginFrame());
+
+    const VkDrawIndexedIndirectCommand commands[] = {
+        { 3, 1, 0, 0, 0 },
+        { 5, 2, 0, 0, 0 }
+    };
+    const auto cpuBatch = pBuilder->add(commands, 2);
+    QVERIFY(cpuBatch.isValid());
+
+    auto culledBatch = pBuilder->allocateCulled(2);
+    QVERIFY(culledBatch.isValid());
+    culledBatch.pCommands[0] = { 4, 1, 0, 0, 0 }; //standing in for the cull shader
+
+    const auto poolInfo = CommandPoolCreateInfo(m_queueFamilyIndex, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+    auto pPool = m_pDevice->createCommandPool(&poolInfo);
+    std::unique_ptr<CommandBufferGroup> pGroup(pPool->createGroup(VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1));
+    QVERIFY(pGroup->getResult());
+    CommandBuffer* pCmdBuffer = pGroup->getBuffer();
+
+    const auto beginInfo = VkCommandBufferBeginInfo {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        nullptr,
+        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        nullptr
+    };
+    const auto renderPassBegin = VkRenderPassBeginInfo {
+        VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO, nullptr, renderPass, framebuffer, { { 0, 0 }, { 1, 1 } }, 0, nullptr
+    };
+
+    QVERIFY(pCmdBuffer->begin(beginInfo));
+    pCmdBuffer->cmdResetQueryPool(queryPool, 0, 1);
+    pCmdBuffer->cmdBeginQuery(queryPool, 0, 0);
+    pCmdBuffer->cmdBeginRenderPass(renderPassBegin, VK_SUBPASS_CONTENTS_INLINE);
+    pCmdBuffer->cmdBindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    pCmdBuffer->cmdBindIndexBuffer(indexBuffer.getHandle(), 0, VK_INDEX_TYPE_UINT32);
+    pBuilder->cmdDraw(pCmdBuffer, cpuBatch);
+    pBuilder->cmdDraw(pCmdBuffer, culledBatch);
+    pCmdBuffer->cmdEndRenderPass();
+    pCmdBuffer->cmdEndQuery(queryPool, 0);
+    QVERIFY(pCmdBuffer->end());
+
+    // one call per slot without multiDrawIndirect
+    QCOMPARE(pBuilder->getStatistics().indirectCallCount, 4u);
+
+    Fence fence(Fence::Initializer{ std::make_shared<Fence::CreateInfo>(0), m_pDevice });
+    QVERIFY(fence.getResult());
+
+    const VkCommandBuffer cmdBuffer = pCmdBuffer->getHandle();
+    const auto submitInfo = VkSubmitInfo {
+        VK_STRUCTURE_TYPE_SUBMIT_INFO, nullptr, 0, nullptr, nullptr, 1, &cmdBuffer, 0, nullptr
+    };
+    QVERIFY(pBuilder->flush());
+    QVERIFY(m_pDevice->getQueueByFamily(m_queueFamilyIndex, 0)->submit(1, &submitInfo, fence.getHandle()));
+    pBuilder->endFrame(&fence);
+    QVERIFY(fence.wait());
+
+    uint64_t vertexCount = 0;
+    QCOMPARE(vkGetQueryPoolResults(device, queryPool, 0, 1, sizeof(vertexCount), &vertexCount, sizeof(vertexCount),
+                                   VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT), VK_SUCCESS);
+    QCOMPARE(vertexCount, uint64_t(17));
+
+    pBuilder.reset(); //waits on the fence before it goes away
+    pGroup.reset();
+    vkDestroyQueryPool(device, queryPool, nullptr);
+    vkDestroyPipeline(device, pipeline, nullptr);
+    vkDestroyShaderModule(device, module, nullptr);
+    vkDestroyFramebuffer(device, framebuffer, nullptr);
+    vkDestroyRenderPass(device, renderPass, nullptr);
+    vkDestroyPipelineLayout(device, layout, nullptr);
+}
+
+QTEST_APPLESS_MAIN(IndirectDrawBuilderTest)
+
+#include "indirect_draw_builder_test.moc"
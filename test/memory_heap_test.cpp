@@ -0,0 +1,108 @@
+#include <QtTest>
+#include <renderer/elysian_renderer_memory_heap.hpp>
+
+using namespace elysian::renderer;
+
+Q_DECLARE_METATYPE(DeviceMemoryHeap::Strategy)
+
+// DeviceMemoryHeap without a Device never touches Vulkan, so all of this runs on the CPU.
+class MemoryHeapTest: public QObject {
+    Q_OBJECT
+
+private slots:
+    void tlsfExactFit(void);
+    void tlsfAlignment(void);
+    void dedicatedBlockAlignment(void);
+    void buddyBlockSizeRounded(void);
+    void simulate_data(void);
+    void simulate(void);
+};
+
+void MemoryHeapTest::tlsfExactFit(void) {
+    TlsfSubAllocator allocator(4096);
+
+    // an empty range has to take a request as big as itself, whatever the alignment
+    QCOMPARE(allocator.allocate(4096, 256), VkDeviceSize(0));
+    QCOMPARE(allocator.allocate(16, 16), DeviceMemorySubAllocator::kInvalidOffset);
+
+    allocator.free(0);
+    QVERIFY(allocator.isEmpty());
+    QCOMPARE(allocator.getStatistics().largestFreeRange, VkDeviceSize(4096));
+}
+
+void MemoryHeapTest::tlsfAlignment(void) {
+    TlsfSubAllocator allocator(1024 * 1024);
+
+    const VkDeviceSize first = allocator.allocate(100, 16);
+    const VkDeviceSize second = allocator.allocate(100, 4096);
+    QVERIFY(first != DeviceMemorySubAllocator::kInvalidOffset);
+    QVERIFY(second != DeviceMemorySubAllocator::kInvalidOffset);
+    QCOMPARE(second % 4096, VkDeviceSize(0));
+    QVERIFY(second >= first + 100);
+
+    allocator.free(first);
+    allocator.free(second);
+    QVERIFY(allocator.isEmpty());
+    QCOMPARE(allocator.getStatistics().freeRangeCount, 1u);
+}
+
+void MemoryHeapTest::dedicatedBlockAlignment(void) {
+    DeviceMemoryHeap heap({ "Dedicated", nullptr, DeviceMemoryHeap::Strategy::Tlsf, 1024 * 1024 });
+
+    // bigger than half a block and aligned past TLSF's granularity
+    const VkMemoryRequirements requirements = { 1024 * 1024 + 100, 4096, 0x1 };
+    DeviceMemoryHeap::Allocation allocation;
+    QVERIFY(heap.allocate(requirements, 0, &allocation));
+    QVERIFY(allocation.isValid());
+    QCOMPARE(allocation.offset % 4096, VkDeviceSize(0));
+    QCOMPARE(heap.getStatistics().blockCount, 1u);
+
+    heap.free(allocation);
+    QVERIFY(!allocation.isValid());
+    QCOMPARE(heap.getStatistics().blockCount, 0u);
+}
+
+void MemoryHeapTest::buddyBlockSizeRounded(void) {
+    DeviceMemoryHeap heap({ "Buddy", nullptr, DeviceMemoryHeap::Strategy::Buddy, 3 * 1024 * 1024 });
+
+    // the standard block gets rounded up to 4 MB, it's still not a dedicated one
+    const VkMemoryRequirements requirements = { 1000, 256, 0x1 };
+    DeviceMemoryHeap::Allocation allocation;
+    QVERIFY(heap.allocate(requirements, 0, &allocation));
+    QCOMPARE(heap.getStatistics().reservedSize, VkDeviceSize(4 * 1024 * 1024));
+
+    // kept around empty for the next allocation
+    heap.free(allocation);
+    QCOMPARE(heap.getStatistics().blockCount, 1u);
+    QVERIFY(heap.allocate(requirements, 0, &allocation));
+    QCOMPARE(heap.getStatistics().blockCount, 1u);
+    heap.free(allocation);
+}
+
+void MemoryHeapTest::simulate_data(void) {
+    QTest::addColumn<DeviceMemoryHeap::Strategy>("strategy");
+    QTest::newRow("tlsf") << DeviceMemoryHeap::Strategy::Tlsf;
+    QTest::newRow("buddy") << DeviceMemoryHeap::Strategy::Buddy;
+}
+
+void MemoryHeapTest::simulate(void) {
+    QFETCH(DeviceMemoryHeap::Strategy, strategy);
+
+    DeviceMemoryHeap::SimulationSettings settings;
+    settings.operationCount = 20000;
+
+    const auto results = DeviceMemoryHeap::simulate({ "Simulated", nullptr, strategy }, settings);
+    QVERIFY(results.consistent);
+    QCOMPARE(results.failures, uint64_t(0));
+    QVERIFY(results.allocations > results.frees);
+    QVERIFY(results.statistics.usedSize <= results.statistics.reservedSize);
+
+    qInfo("%.0f ops/s, %.2f%% utilization, %.2f%% fragmentation",
+          results.operationsPerSecond,
+          results.statistics.getUtilization() * 100.0f,
+          results.statistics.getFragmentation() * 100.0f);
+}
+
+QTEST_APPLESS_MAIN(MemoryHeapTest)
+
+#include "memory_heap_test.moc"
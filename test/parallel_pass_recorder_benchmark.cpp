@@ -0,0 +1,135 @@
+#include <QtTest>
+#include <renderer/elysian_renderer.hpp>
+#include <renderer/elysian_renderer_instance.hpp>
+#include <renderer/elysian_renderer_physical_device.hpp>
+#include <renderer/elysian_renderer_device.hpp>
+#include <renderer/elysian_renderer_debug_log.hpp>
+#include <renderer/elysian_renderer_command_pool_manager.hpp>
+#include <renderer/elysian_renderer_parallel_pass_recorder.hpp>
+#include <renderer/elysian_renderer_worker_pool.hpp>
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+using namespace elysian::renderer;
+
+namespace {
+
+class QuietLog: public DebugLog {
+public:
+    virtual void push(void) override {}
+    virtual void pop(void) override {}
+    virtual void write(Source, Severity severity, va_list args, const char* pFormat) override {
+        if(severity == Severity::Error) qWarning("%s", qPrintable(QString::vasprintf(pFormat, args)));
+    }
+};
+
+}
+
+// Recording throughput of ParallelPassRecorder for 1, 2, 4 ... hardware threads.
+// Needs a Vulkan device, skips without one. The buffers are never submitted.
+class ParallelPassRecorderBenchmark: public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase(void);
+    void cleanupTestCase(void);
+    void recordOutsideRenderPass(void);
+
+private:
+    QuietLog                    m_log;
+    std::unique_ptr<Renderer>   m_pRenderer;
+    Device*                     m_pDevice           = nullptr;
+    uint32_t                    m_queueFamilyIndex  = 0;
+};
+
+void ParallelPassRecorderBenchmark::initTestCase(void) {
+    const InstanceInitializer instanceInitializer = { InstanceCreateInfo(), nullptr };
+    Renderer::Initializer initializer = { &m_log, nullptr, &instanceInitializer };
+    m_pRenderer = std::make_unique<Renderer>(&initializer);
+
+    const PhysicalDevice* pPhysicalDevice = m_pRenderer->isValid()? m_pRenderer->getPhysicalDevice(0) : nullptr;
+    if(!pPhysicalDevice) QSKIP("no Vulkan device");
+
+    const auto& families = pPhysicalDevice->getQueueFamilyProperties();
+    const auto it = std::find_if(families.begin(), families.end(), [](const VkQueueFamilyProperties& family) {
+        return family.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+    });
+    if(it == families.end()) QSKIP("no graphics queue family");
+    m_queueFamilyIndex = static_cast<uint32_t>(it - families.begin());
+
+    auto pCreateInfo = std::make_shared<DeviceCreateInfo>();
+    pCreateInfo->queueGroupInfo.push_back({
+        QueueGroupProperties("Graphics", m_queueFamilyIndex),
+        0,
+        { QueueProperties("Graphics0", 1.0f) }
+    });
+    m_pDevice = m_pRenderer->createDevice("Benchmark", pPhysicalDevice, std::move(pCreateInfo));
+    if(!m_pDevice->getResult()) QSKIP("device creation failed");
+}
+
+void ParallelPassRecorderBenchmark::cleanupTestCase(void) {
+    m_pRenderer.reset();
+}
+
+void ParallelPassRecorderBenchmark::recordOutsideRenderPass(void) {
+    constexpr uint32_t itemCount = 20000;
+    constexpr uint32_t iterationCount = 16;
+    const uint32_t maxThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+    // cheapest command there is, so this measures the recording overhead itself
+    const ParallelPassRecorder::RecordFunction recordFunction = [](CommandBuffer* pCmdBuffer, uint32_t, uint32_t, uint32_t count) {
+        for(uint32_t i = 0; i < count; ++i) {
+            pCmdBuffer->cmdPipelineBarrier(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                                           0, nullptr, 0, nullptr, 0, nullptr);
+        }
+    };
+
+    const auto poolInfo = CommandPoolCreateInfo(m_queueFamilyIndex, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+    auto pPrimaryPool = m_pDevice->createCommandPool(&poolInfo);
+    std::unique_ptr<CommandBufferGroup> pPrimaryGroup(pPrimaryPool->createGroup(VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1));
+    QVERIFY(pPrimaryGroup->getResult());
+    CommandBuffer* pPrimary = pPrimaryGroup->getBuffer();
+
+    const auto primaryBegin = VkCommandBufferBeginInfo {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        nullptr,
+        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        nullptr
+    };
+
+    double singleThreadSeconds = 0.0;
+    for(uint32_t threadCount = 1; ; threadCount = std::min(threadCount * 2, maxThreadCount)) {
+        // fresh workers and pools per run so every thread count starts out cold the same way
+        WorkerPool workers(threadCount - 1);
+        CommandPoolManager poolManager({ "Benchmark", m_pDevice, 1 });
+        ParallelPassRecorder recorder({ "Benchmark", &poolManager, &workers, m_queueFamilyIndex });
+
+        double seconds = 0.0;
+        for(uint32_t i = 0; i < iterationCount; ++i) {
+            poolManager.beginFrame();
+            QVERIFY(pPrimary->reset(0));
+            QVERIFY(pPrimary->begin(primaryBegin));
+            QVERIFY(recorder.record(pPrimary, {}, itemCount, threadCount, recordFunction));
+            QCOMPARE(recorder.getStatistics().chunkCount, threadCount);
+            QVERIFY(pPrimary->end());
+            seconds += recorder.getStatistics().seconds;
+        }
+
+        seconds /= iterationCount;
+        if(threadCount == 1) singleThreadSeconds = seconds;
+        qInfo("%2u threads: %8.3f ms, %12.0f items/s, %.2fx",
+              threadCount,
+              seconds * 1000.0,
+              seconds > 0.0? itemCount / seconds : 0.0,
+              singleThreadSeconds / std::max(seconds, 1e-9));
+
+        if(threadCount == maxThreadCount) break;
+    }
+
+    QVERIFY(pPrimary->reset(0));
+}
+
+QTEST_APPLESS_MAIN(ParallelPassRecorderBenchmark)
+
+#include "parallel_pass_recorder_benchmark.moc"